@@ -0,0 +1,95 @@
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#include "enjam/assets_repository.h"
+#include "enjam/dcc_asset.h"
+#include "enjam/geometry_layout.h"
+#include "bench.h"
+
+using namespace Enjam;
+
+// Loads of a mesh asset with a buffer per vertex stream and index array, and of the same mesh packed into one
+// geometry buffer. The files stay in the page cache between runs, so this measures the loading path and not
+// the disk.
+constexpr uint32_t GRID_SIZE = 512;
+constexpr uint32_t VERTICES_COUNT = GRID_SIZE * GRID_SIZE;
+constexpr uint32_t RUNS_COUNT = 20;
+
+template<class T>
+static void append(ByteArray& bytes, const T& value) {
+  auto begin = reinterpret_cast<const uint8_t*>(&value);
+  bytes.insert(bytes.end(), begin, begin + sizeof(value));
+}
+
+int main() {
+  // float positions and texture coordinates in separate streams, as imported without options
+  std::vector<ByteArray> streams(4);
+  ByteArray texCoords1;
+  for(uint32_t z = 0; z < GRID_SIZE; z++) {
+    for(uint32_t x = 0; x < GRID_SIZE; x++) {
+      auto u = float(x) / GRID_SIZE, v = float(z) / GRID_SIZE;
+      append(streams[0], std::array<float, 3> { u, 0, v });
+      append(streams[1], std::array<float, 2> { u, v });
+      append(streams[2], encodeOctahedral(math::vec3f { 0, 1, 0 }));
+      append(streams[3], encodeTangent(math::vec3f { 1, 0, 0 }, 1));
+      append(texCoords1, std::array<float, 2> { u, v });
+    }
+  }
+  ByteArray indices;
+  for(uint32_t z = 0; z + 1 < GRID_SIZE; z++) {
+    for(uint32_t x = 0; x + 1 < GRID_SIZE; x++) {
+      auto corner = z * GRID_SIZE + x;
+      for(auto index : { corner, corner + GRID_SIZE, corner + 1, corner + 1, corner + GRID_SIZE, corner + GRID_SIZE + 1 }) {
+        append(indices, index);
+      }
+    }
+  }
+
+  Asset mesh;
+  mesh["offset"] = 0;
+  mesh["count"] = uint32_t(indices.size() / sizeof(uint32_t));
+  mesh["indexType"] = uint32_t(IndexType::UINT32);
+  Asset node;
+  node["parent"] = -1;
+  node["transform"] = math::mat4f { 1.0f };
+  node["meshes"] = Asset::array();
+  node["meshes"].pushBack(std::move(mesh));
+
+  Asset separate;
+  separate["nodes"] = Asset::array();
+  separate["nodes"].pushBack(node);
+  separate["texCoords1"] = texCoords1;
+  Asset packed = separate;
+
+  separate["positions"] = streams[0];
+  separate["texCoords0"] = streams[1];
+  separate["normals"] = streams[2];
+  separate["tangents"] = streams[3];
+  separate["indices"] = indices;
+
+  ByteArray geometry;
+  packed["geometryLayout"] = GeometryLayout::pack(VERTICES_COUNT, streams, indices, { }, geometry);
+  packed["geometry"] = std::move(geometry);
+
+  auto directory = std::filesystem::temp_directory_path() / "enjam_asset_load_bench";
+  std::filesystem::remove_all(directory);
+  AssetsFilesystemRep repository(directory);
+  repository.save("separate.nj_dcc", separate);
+  repository.save("packed.nj_dcc", packed);
+
+  uint64_t geometrySize = 0;
+  auto load = [&repository, &geometrySize](const char* path) {
+    auto asset = DCCAssetFactory { }(repository.load(path));
+    geometrySize = asset->getGeometry().size();
+  };
+  auto separateTime = measure(RUNS_COUNT, [&] { load("separate.nj_dcc"); });
+  auto packedTime = measure(RUNS_COUNT, [&] { load("packed.nj_dcc"); });
+  std::filesystem::remove_all(directory);
+
+  auto megabytes = double(geometrySize) / (1024 * 1024);
+  std::printf("%u vertices, %.1fMB of geometry\n", VERTICES_COUNT, megabytes);
+  std::printf("separate buffers %.3fms %.0fMB/s, packed %.3fms %.0fMB/s (best of %u runs)\n",
+              separateTime, megabytes * 1000 / separateTime, packedTime, megabytes * 1000 / packedTime, RUNS_COUNT);
+  return 0;
+}
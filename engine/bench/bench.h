@@ -0,0 +1,21 @@
+#ifndef ENGINE_BENCH_BENCH_H_
+#define ENGINE_BENCH_BENCH_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+// Best time of f over the runs in milliseconds, the slower ones are disturbed by the rest of the system
+template<class F>
+double measure(uint32_t runsCount, F&& f) {
+  auto best = 1e30;
+  for(uint32_t run = 0; run < runsCount; run++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  return best;
+}
+
+#endif //ENGINE_BENCH_BENCH_H_
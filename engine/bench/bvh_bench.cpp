@@ -0,0 +1,56 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "enjam/bvh.h"
+#include "bench.h"
+
+using namespace Enjam;
+
+// Frustum culling of static objects with the BVH against testing every object
+constexpr uint32_t OBJECTS_COUNT = 1000000;
+constexpr uint32_t RUNS_COUNT = 20;
+
+int main() {
+  std::mt19937 random { 1 };
+  std::uniform_real_distribution<float> position { -1000, 1000 };
+  std::uniform_real_distribution<float> size { 0.5f, 4 };
+
+  Bvh bvh;
+  std::vector<Aabb> boxes;
+  for(uint32_t i = 0; i < OBJECTS_COUNT; i++) {
+    math::vec3f min { position(random), position(random) * 0.05f, position(random) };
+    boxes.push_back(Aabb { .min = min, .max = min + math::vec3f { size(random), size(random), size(random) } });
+    bvh.insert(boxes.back(), i);
+  }
+
+  auto buildStart = std::chrono::steady_clock::now();
+  bvh.build();
+  auto buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+  auto projection = math::mat4f::perspective(60, 1.7, 0.1, 400);
+  auto frustum = Frustum::fromMatrix(projection * inverse(math::mat4f::translation(math::vec3f { 0, 0, 300 })));
+
+  std::vector<uint32_t> visible;
+  visible.reserve(OBJECTS_COUNT);
+
+  auto bvhTime = measure(RUNS_COUNT, [&] {
+    visible.clear();
+    bvh.query(frustum, visible);
+  });
+  auto visibleCount = visible.size();
+
+  auto linearTime = measure(RUNS_COUNT, [&] {
+    visible.clear();
+    for(uint32_t i = 0; i < OBJECTS_COUNT; i++) {
+      if(frustum.intersects(boxes[i])) {
+        visible.push_back(i);
+      }
+    }
+  });
+
+  std::printf("%u objects, %zu visible, %u nodes, build %.1fms\n",
+              OBJECTS_COUNT, visibleCount, bvh.getStats().nodesCount, buildTime);
+  std::printf("frustum cull: bvh %.3fms, linear %.3fms (best of %u runs)\n", bvhTime, linearTime, RUNS_COUNT);
+  return 0;
+}
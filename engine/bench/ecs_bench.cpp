@@ -0,0 +1,79 @@
+#include <cstdio>
+#include <vector>
+#include "enjam/entity_registry.h"
+#include "enjam/render_components.h"
+#include "enjam/render_primitive.h"
+#include "enjam/render_view.h"
+#include "bench.h"
+
+using namespace Enjam;
+
+// Compares the entity registry with the array of RenderPrimitive the scene used to keep
+constexpr uint32_t ENTITIES_COUNT = 100000;
+constexpr uint32_t RUNS_COUNT = 50;
+
+static math::mat4f makeTransform(uint32_t i) {
+  return math::mat4f::translation(math::vec3f { float(i % 100), float(i / 100 % 100), float(i / 10000) });
+}
+
+int main() {
+  std::vector<RenderPrimitive> primitives;
+  EntityRegistry registry;
+  for(uint32_t i = 0; i < ENTITIES_COUNT; i++) {
+    auto& primitive = primitives.emplace_back();
+    primitive.setTransform(makeTransform(i));
+    primitive.setMaterialIndex(i % 16);
+    primitive.setRange(36, 0, 0);
+
+    registry.create(TransformComponent { .world = makeTransform(i) },
+                    MeshComponent { .vertexBuffer = { }, .indexBuffer = { }, .indexCount = 36 },
+                    MaterialComponent { .programHandle = { }, .descriptorSetHandle = { }, .materialIndex = i % 16 });
+  }
+
+  std::vector<PerObjectUniforms> uniforms(ENTITIES_COUNT);
+  volatile uint32_t sink = 0;
+
+  // per object uniforms, what RenderView::prepareBuffers does for every object
+  auto arrayPrepare = measure(RUNS_COUNT, [&] {
+    for(uint32_t i = 0; i < primitives.size(); i++) {
+      uniforms[i].model = primitives[i].getTransform();
+      uniforms[i].materialIndex = primitives[i].getMaterialIndex();
+    }
+  });
+
+  auto registryPrepare = measure(RUNS_COUNT, [&] {
+    uint32_t objectIndex = 0;
+    registry.forEachChunk<TransformComponent, MaterialComponent>(
+        [&](uint32_t count, Entity*, TransformComponent* transforms, MaterialComponent* materials) {
+      for(uint32_t i = 0; i < count; i++, objectIndex++) {
+        uniforms[objectIndex].model = transforms[i].world;
+        uniforms[objectIndex].materialIndex = materials[i].materialIndex;
+      }
+    });
+  });
+
+  // positions only, the access pattern of culling
+  auto arrayCull = measure(RUNS_COUNT, [&] {
+    uint32_t visible = 0;
+    for(auto& primitive : primitives) {
+      visible += primitive.getTransform()[3].z < 5 ? 1 : 0;
+    }
+    sink = visible;
+  });
+
+  auto registryCull = measure(RUNS_COUNT, [&] {
+    uint32_t visible = 0;
+    registry.forEachChunk<TransformComponent>([&visible](uint32_t count, Entity*, TransformComponent* transforms) {
+      for(uint32_t i = 0; i < count; i++) {
+        visible += transforms[i].world[3].z < 5 ? 1 : 0;
+      }
+    });
+    sink = visible;
+  });
+
+  std::printf("%u entities, best of %u runs\n", ENTITIES_COUNT, RUNS_COUNT);
+  std::printf("%-10s %18s %18s\n", "", "RenderPrimitive[]", "EntityRegistry");
+  std::printf("%-10s %16.3fms %16.3fms\n", "prepare", arrayPrepare, registryPrepare);
+  std::printf("%-10s %16.3fms %16.3fms\n", "cull", arrayCull, registryCull);
+  return 0;
+}
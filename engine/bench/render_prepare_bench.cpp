@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "enjam/render_components.h"
+#include "enjam/render_primitive.h"
+#include "enjam/render_view.h"
+#include "enjam/scene.h"
+#include "enjam/thread_pool.h"
+#include "bench.h"
+
+using namespace Enjam;
+
+// Per frame preparation of the draw lists of several views. Before gathers every visible entity in each
+// view through per entity component lookups into fat draw commands, after reads the shared parallel arrays
+// of FrameObjects, which only refresh their material columns while the entities do not change.
+constexpr uint32_t OBJECTS_COUNT = 100000;
+constexpr uint32_t MATERIALS_COUNT = 64;
+constexpr uint32_t RUNS_COUNT = 20;
+
+// The draw command views built from the components before they shared the per object data
+struct GatheredDrawCommand {
+  uint64_t sortKey;
+  ProgramHandle programHandle;
+  DescriptorSetHandle descriptorSetHandle;
+  VertexBufferHandle vertexBuffer;
+  IndexBufferHandle indexBuffer;
+  uint32_t indexCount;
+  uint32_t indexOffset;
+  int32_t baseVertex;
+  uint32_t objectIndex;
+};
+
+static void gatherView(const Scene& scene, const Camera& camera, std::vector<Entity>& visible,
+                       std::vector<PerObjectUniforms>& uniforms, std::vector<GatheredDrawCommand>& commands) {
+  auto& entities = scene.getEntities();
+  visible.clear();
+  uniforms.clear();
+  commands.clear();
+  scene.query(Frustum::fromMatrix(camera.projectionMatrix * inverse(camera.modelMatrix)), visible);
+
+  for(auto entity : visible) {
+    auto transform = entities.get<TransformComponent>(entity);
+    auto mesh = entities.get<MeshComponent>(entity);
+    auto material = entities.get<MaterialComponent>(entity);
+
+    auto objectIndex = uint32_t(uniforms.size());
+    auto& object = uniforms.emplace_back();
+    object.model = transform->world;
+    object.materialIndex = material->materialIndex;
+
+    commands.push_back(GatheredDrawCommand {
+        .sortKey = material->getSortKey(),
+        .programHandle = material->getDrawProgramHandle(),
+        .descriptorSetHandle = material->getDrawDescriptorSetHandle(),
+        .vertexBuffer = mesh->vertexBuffer,
+        .indexBuffer = mesh->indexBuffer,
+        .indexCount = mesh->indexCount,
+        .indexOffset = mesh->indexOffset,
+        .baseVertex = mesh->baseVertex,
+        .objectIndex = objectIndex
+    });
+  }
+
+  std::stable_sort(commands.begin(), commands.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.sortKey < rhs.sortKey;
+  });
+}
+
+int main() {
+  std::mt19937 random { 3 };
+  std::uniform_real_distribution<float> position { -500, 500 };
+
+  Scene scene;
+  for(uint32_t i = 0; i < OBJECTS_COUNT; i++) {
+    RenderPrimitive primitive { VertexBufferHandle { 1 }, IndexBufferHandle { 1 }, ProgramHandle { i % MATERIALS_COUNT } };
+    primitive.setRange(36, i * 36);
+    primitive.setTransform(math::mat4f::translation(math::vec3f { position(random), position(random) * 0.05f, position(random) }));
+    primitive.setBounds(Aabb { .min = math::vec3f { -1 }, .max = math::vec3f { 1 } });
+    scene.addPrimitive(primitive);
+  }
+  scene.updateTransforms();
+  scene.updateSpatialIndex();
+
+  // cameras at the sides of the scene looking at its middle
+  auto projection = math::mat4f::perspective(60, 1.7, 0.1, 600);
+  auto makeCamera = [&projection](float x, float z, bool flip) {
+    math::mat4f model = math::mat4f::translation(math::vec3f { x, 0, z });
+    if(flip) {
+      model[0][0] = -1;
+      model[2][2] = -1;
+    }
+    return Camera { .projectionMatrix = projection, .modelMatrix = model };
+  };
+  std::vector<Camera> cameras {
+      makeCamera(0, 450, false),
+      makeCamera(0, -450, true),
+      makeCamera(300, 450, false),
+      makeCamera(-300, -450, true),
+  };
+
+  ThreadPool threadPool { 0 };
+  FrameObjects objects;
+  std::vector<RenderView> views(cameras.size());
+  for(size_t i = 0; i < views.size(); i++) {
+    views[i].setScene(&scene);
+    views[i].setCamera(&cameras[i]);
+    views[i].setOcclusionCulling(false);
+  }
+
+  std::vector<Entity> visible;
+  std::vector<PerObjectUniforms> uniforms;
+  std::vector<GatheredDrawCommand> commands;
+
+  for(uint32_t viewsCount = 1; viewsCount <= views.size(); viewsCount *= 2) {
+    size_t drawsCount = 0;
+    auto beforeTime = measure(RUNS_COUNT, [&] {
+      drawsCount = 0;
+      for(uint32_t i = 0; i < viewsCount; i++) {
+        gatherView(scene, cameras[i], visible, uniforms, commands);
+        drawsCount += commands.size();
+      }
+    });
+
+    auto afterTime = measure(RUNS_COUNT, [&] {
+      objects.prepare(scene);
+      for(uint32_t i = 0; i < viewsCount; i++) {
+        views[i].prepareBuffers(threadPool, objects);
+      }
+    });
+
+    std::printf("%u objects, %u views, %zu draws: before %.3fms, after %.3fms (best of %u runs)\n",
+                OBJECTS_COUNT, viewsCount, drawsCount, beforeTime, afterTime, RUNS_COUNT);
+  }
+  return 0;
+}
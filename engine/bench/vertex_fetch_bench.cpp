@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "enjam/vertex_format.h"
+#include "bench.h"
+
+using namespace Enjam;
+
+// Vertex fetch of the separate and interleaved layouts, emulated on the CPU: every index reads the attributes
+// where their VertexAttribute says. Decoding is the work of the shader and is left out.
+constexpr uint32_t GRID_SIZE = 1024;
+constexpr uint32_t VERTICES_COUNT = GRID_SIZE * GRID_SIZE;
+constexpr uint32_t RUNS_COUNT = 20;
+
+struct Layout {
+  std::array<VertexAttribute, 4> attributes;
+  std::array<uint32_t, 4> sizes;
+  std::array<const uint8_t*, 4> buffers; // of every attribute
+};
+
+// Bytes of the attributes of every index gathered into a vertex, as the input assembler does before the shader
+static uint32_t fetch(const Layout& layout, const std::vector<uint32_t>& indices) {
+  uint32_t checksum = 0;
+  for(auto index : indices) {
+    uint32_t vertex[8] = { };
+    auto destination = reinterpret_cast<uint8_t*>(vertex);
+    for(uint32_t attribute = 0; attribute < layout.attributes.size(); attribute++) {
+      auto& desc = layout.attributes[attribute];
+      auto size = layout.sizes[attribute];
+      std::memcpy(destination, layout.buffers[attribute] + desc.offset + uint64_t(index) * desc.stride, size);
+      destination += size;
+    }
+    for(auto word : vertex) {
+      checksum ^= word;
+    }
+  }
+  return checksum;
+}
+
+int main() {
+  VertexFormat format {
+      .positions = VertexFormat::Position::UNORM16,
+      .texCoords = VertexFormat::TexCoord::HALF2,
+      .positionOffset = math::vec3f { 0.0f },
+      .positionScale = float(GRID_SIZE)
+  };
+
+  std::vector<std::vector<uint8_t>> streams(4);
+  for(uint32_t z = 0; z < GRID_SIZE; z++) {
+    for(uint32_t x = 0; x < GRID_SIZE; x++) {
+      auto append = [](std::vector<uint8_t>& stream, const auto& value) {
+        auto begin = reinterpret_cast<const uint8_t*>(&value);
+        stream.insert(stream.end(), begin, begin + sizeof(value));
+      };
+      auto u = float(x) / GRID_SIZE, v = float(z) / GRID_SIZE;
+      append(streams[0], std::array<uint16_t, 4> { toUnorm16(u), 0, toUnorm16(v), 0 });
+      append(streams[1], std::array<uint16_t, 2> { toHalf(u), toHalf(v) });
+      append(streams[2], encodeOctahedral(normalize(math::vec3f { u - 0.5f, 1, v - 0.5f })));
+      append(streams[3], encodeTangent(math::vec3f { 1, 0, 0 }, 1));
+    }
+  }
+
+  std::vector<uint8_t> vertices(uint64_t(VERTICES_COUNT) * format.getVertexStride());
+  uint32_t offset = 0;
+  for(auto& stream : streams) {
+    auto size = stream.size() / VERTICES_COUNT;
+    for(uint32_t i = 0; i < VERTICES_COUNT; i++) {
+      std::memcpy(vertices.data() + uint64_t(i) * format.getVertexStride() + offset, stream.data() + i * size, size);
+    }
+    offset += size;
+  }
+
+  std::array<uint32_t, 4> sizes { format.getPositionStride(), format.getTexCoordStride(),
+                                  VertexFormat::NORMAL_SIZE, VertexFormat::TANGENT_SIZE };
+  Layout separate {
+      .attributes = { format.getPositionAttribute(), format.getTexCoordAttribute(),
+                      format.getNormalAttribute(), format.getTangentAttribute() },
+      .sizes = sizes,
+      .buffers = { streams[0].data(), streams[1].data(), streams[2].data(), streams[3].data() }
+  };
+  format.layout = VertexFormat::Layout::INTERLEAVED;
+  Layout interleaved {
+      .attributes = { format.getPositionAttribute(), format.getTexCoordAttribute(),
+                      format.getNormalAttribute(), format.getTangentAttribute() },
+      .sizes = sizes,
+      .buffers = { vertices.data(), vertices.data(), vertices.data(), vertices.data() }
+  };
+
+  // vertices in their order, as after the fetch remap of the importer, and in a random one
+  std::vector<uint32_t> linearIndices(VERTICES_COUNT);
+  std::iota(linearIndices.begin(), linearIndices.end(), 0);
+  auto randomIndices = linearIndices;
+  std::shuffle(randomIndices.begin(), randomIndices.end(), std::mt19937 { 1 });
+
+  uint32_t checksum = 0;
+  auto separateLinear = measure(RUNS_COUNT, [&] { checksum += fetch(separate, linearIndices); });
+  auto interleavedLinear = measure(RUNS_COUNT, [&] { checksum += fetch(interleaved, linearIndices); });
+  auto separateRandom = measure(RUNS_COUNT, [&] { checksum += fetch(separate, randomIndices); });
+  auto interleavedRandom = measure(RUNS_COUNT, [&] { checksum += fetch(interleaved, randomIndices); });
+
+  std::printf("%u vertices, %u bytes each (checksum %x)\n", VERTICES_COUNT, format.getVertexStride(), checksum);
+  std::printf("in order: separate %.3fms, interleaved %.3fms\n", separateLinear, interleavedLinear);
+  std::printf("random: separate %.3fms, interleaved %.3fms (best of %u runs)\n",
+              separateRandom, interleavedRandom, RUNS_COUNT);
+  return 0;
+}
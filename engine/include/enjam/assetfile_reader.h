@@ -135,19 +135,20 @@ bool AssetFileReader<TInput>::parseProperty(Asset& value) {
     }
     case token_type::hex_int_value: {
       auto hash = lexer.getInt();
+      // read straight into the returned buffer, large ones are whole vertex and index arrays
       value = [hash, buffers = input.buffers]() -> ByteArray {
         auto stream = buffers(hash);
-        std::vector<std::istream::char_type> buffer;
+        ByteArray buffer;
         stream->seekg(0, std::ios::end);
         auto size = stream->tellg();
-        if (size) {
+        if (size > 0) {
           stream->seekg(0, std::ios::beg);
           buffer.resize(size);
 
-          stream->read(&buffer.front(), size);
+          stream->read(reinterpret_cast<std::istream::char_type*>(buffer.data()), size);
         }
 
-        return { buffer.begin(), buffer.end() };
+        return buffer;
       };
 
       return true;
@@ -33,12 +33,16 @@ class AssetsFilesystemRep : public AssetsLoader {
   Asset load(const Path& path) override;
   void save(const Path& path, const Asset& asset);
 
+  // Asset and buffer files written by save, threads saving concurrently need repositories of their own
+  const std::vector<Path>& getSavedFiles() const { return savedFiles; }
+
  private:
   std::unique_ptr<std::istream> getBufferInput(const Path& path, uint64_t hash);
   std::unique_ptr<std::ostream> getBufferOutput(const Path& path, uint64_t hash);
 
  private:
   Path rootPath;
+  std::vector<Path> savedFiles;
 };
 
 class AssetsBinaryArchiveRep : public AssetsLoader {
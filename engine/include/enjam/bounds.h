@@ -0,0 +1,189 @@
+#ifndef INCLUDE_ENJAM_BOUNDS_H_
+#define INCLUDE_ENJAM_BOUNDS_H_
+
+#include <cstdint>
+#include <enjam/math.h>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+
+namespace Enjam {
+
+struct Aabb {
+  math::vec3f min { FLT_MAX };
+  math::vec3f max { -FLT_MAX };
+
+  bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+  math::vec3f getCenter() const { return (min + max) * 0.5f; }
+  math::vec3f getExtents() const { return (max + (-min)) * 0.5f; }
+
+  float getSurfaceArea() const {
+    if(isEmpty()) {
+      return 0;
+    }
+    auto dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+    return 2 * (dx * dy + dy * dz + dz * dx);
+  }
+
+  void expand(const math::vec3f& point) {
+    for(auto i = 0; i < 3; i++) {
+      min[i] = std::min(min[i], point[i]);
+      max[i] = std::max(max[i], point[i]);
+    }
+  }
+
+  void expand(const Aabb& other) {
+    for(auto i = 0; i < 3; i++) {
+      min[i] = std::min(min[i], other.min[i]);
+      max[i] = std::max(max[i], other.max[i]);
+    }
+  }
+
+  bool intersects(const Aabb& other) const {
+    return min.x <= other.max.x && max.x >= other.min.x
+        && min.y <= other.max.y && max.y >= other.min.y
+        && min.z <= other.max.z && max.z >= other.min.z;
+  }
+
+  bool contains(const Aabb& other) const {
+    return min.x <= other.min.x && max.x >= other.max.x
+        && min.y <= other.min.y && max.y >= other.max.y
+        && min.z <= other.min.z && max.z >= other.max.z;
+  }
+
+  // Bounds of the transformed box, larger than the box itself when the transform rotates it
+  Aabb transformed(const math::mat4f& m) const {
+    if(isEmpty()) {
+      return *this;
+    }
+
+    Aabb result { m[3].xyz, m[3].xyz };
+    for(auto column = 0; column < 3; column++) {
+      for(auto row = 0; row < 3; row++) {
+        auto a = m[column][row] * min[column];
+        auto b = m[column][row] * max[column];
+        result.min[row] += std::min(a, b);
+        result.max[row] += std::max(a, b);
+      }
+    }
+    return result;
+  }
+};
+
+struct Sphere {
+  math::vec3f center { 0 };
+  float radius = 0;
+
+  float distanceSquared(const Aabb& box) const {
+    float result = 0;
+    for(auto i = 0; i < 3; i++) {
+      auto d = std::max(std::max(box.min[i] - center[i], center[i] - box.max[i]), 0.0f);
+      result += d * d;
+    }
+    return result;
+  }
+
+  bool intersects(const Aabb& box) const { return distanceSquared(box) <= radius * radius; }
+
+  bool contains(const Aabb& box) const {
+    float farthest = 0;
+    for(auto i = 0; i < 3; i++) {
+      auto d = std::max(center[i] - box.min[i], box.max[i] - center[i]);
+      farthest += d * d;
+    }
+    return farthest <= radius * radius;
+  }
+};
+
+struct Ray {
+  math::vec3f origin { 0 };
+  math::vec3f direction { 0, 0, 1 };
+
+  // Distance along the ray where it enters the box, negative when it misses it within maxDistance
+  float intersect(const Aabb& box, float maxDistance) const {
+    float tMin = 0, tMax = maxDistance;
+    for(auto i = 0; i < 3; i++) {
+      clipSlab(box.min[i], box.max[i], origin[i], direction[i], 1.0f / direction[i], tMin, tMax);
+    }
+    return tMin <= tMax ? tMin : -1;
+  }
+
+  // Narrows [tMin, tMax] to the part of the ray between min and max along one axis. A ray parallel to the slab
+  // is inside it everywhere or nowhere, its infinite inverse would give NaN for an origin on a slab plane.
+  static void clipSlab(float min, float max, float origin, float direction, float inverse, float& tMin, float& tMax) {
+    if(direction == 0) {
+      if(origin < min || origin > max) {
+        tMax = -1;
+      }
+      return;
+    }
+
+    auto t0 = (min - origin) * inverse;
+    auto t1 = (max - origin) * inverse;
+    tMin = std::max(tMin, std::min(t0, t1));
+    tMax = std::min(tMax, std::max(t0, t1));
+  }
+};
+
+enum class Containment : uint8_t {
+  OUTSIDE,
+  INTERSECTS,
+  INSIDE
+};
+
+// Planes point inside, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for every plane
+struct Frustum {
+  std::array<math::vec4f, 6> planes;
+
+  // Planes of the clip volume of a projection * view matrix, -w <= x, y, z <= w
+  static Frustum fromMatrix(const math::mat4f& m) {
+    auto row = [&m](int r) { return math::vec4f { m[0][r], m[1][r], m[2][r], m[3][r] }; };
+    auto normalized = [](const math::vec4f& plane) { return plane * (1.0f / length(plane.xyz)); };
+
+    auto w = row(3);
+    return Frustum { {
+        normalized(w + row(0)),
+        normalized(w + -row(0)),
+        normalized(w + row(1)),
+        normalized(w + -row(1)),
+        normalized(w + row(2)),
+        normalized(w + -row(2))
+    } };
+  }
+
+  Containment test(const Aabb& box) const {
+    auto result = Containment::INSIDE;
+    for(auto& plane : planes) {
+      // the corners farthest along and against the plane normal
+      math::vec3f p, n;
+      for(auto i = 0; i < 3; i++) {
+        p[i] = plane[i] > 0 ? box.max[i] : box.min[i];
+        n[i] = plane[i] > 0 ? box.min[i] : box.max[i];
+      }
+      if(dot(plane.xyz, p) + plane.w < 0) {
+        return Containment::OUTSIDE;
+      }
+      if(dot(plane.xyz, n) + plane.w < 0) {
+        result = Containment::INTERSECTS;
+      }
+    }
+    return result;
+  }
+
+  bool intersects(const Aabb& box) const { return test(box) != Containment::OUTSIDE; }
+
+  // Conservative, spheres near the frustum corners may pass without touching it
+  bool intersects(const Sphere& sphere) const {
+    for(auto& plane : planes) {
+      if(dot(plane.xyz, sphere.center) + plane.w < -sphere.radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+}
+
+#endif //INCLUDE_ENJAM_BOUNDS_H_
@@ -0,0 +1,126 @@
+#ifndef INCLUDE_ENJAM_BVH_H_
+#define INCLUDE_ENJAM_BVH_H_
+
+#include <enjam/defines.h>
+#include <enjam/bounds.h>
+#include <cstdint>
+#include <vector>
+
+namespace Enjam {
+
+// Bounding volume hierarchy of proxies, each one a box with a user value.
+// Built with the binned surface area heuristic into 4-wide nodes whose children bounds are stored as
+// arrays, so a node is tested against a query in one pass over its 4 lanes.
+// Moved proxies are refitted in place, inserted ones are tested linearly until the next rebuild.
+// Queries are const and may run concurrently, but not together with any of the modifying methods.
+class ENJAM_API Bvh final {
+ public:
+  static constexpr uint32_t INVALID_PROXY = UINT32_MAX;
+  static constexpr uint32_t WIDTH = 4;
+  static constexpr uint32_t LEAF_SIZE = 4;
+
+  struct RayHit {
+    uint32_t userData = INVALID_PROXY;
+    float distance = 0; // to the proxy bounds
+  };
+
+  struct Stats {
+    uint32_t proxiesCount = 0;
+    uint32_t nodesCount = 0;
+    uint32_t pendingCount = 0;
+    uint32_t rebuildsCount = 0;
+    uint32_t refitsCount = 0;
+  };
+
+  uint32_t insert(const Aabb&, uint32_t userData);
+  void remove(uint32_t proxy);
+  void update(uint32_t proxy, const Aabb&);
+  void clear();
+
+  const Aabb& getBounds(uint32_t proxy) const { return proxyBounds[proxy]; }
+
+  // Applies the changes: refits the moved proxies or rebuilds the tree when it degraded.
+  // Rebuilds at least every rebuildInterval commits that moved something.
+  void commit();
+  void build();
+
+  void setRebuildInterval(uint32_t commits) { rebuildInterval = commits; }
+
+  // Append the user values of the proxies overlapping the shape
+  void query(const Frustum&, std::vector<uint32_t>& result) const;
+  void query(const Aabb&, std::vector<uint32_t>& result) const;
+  void query(const Sphere&, std::vector<uint32_t>& result) const;
+
+  // Closest proxy whose bounds the ray enters within maxDistance
+  bool raycast(const Ray&, float maxDistance, RayHit&) const;
+
+  Stats getStats() const;
+
+ private:
+  static constexpr uint32_t NO_NODE = UINT32_MAX;
+  static constexpr uint8_t PROXY_ALIVE = 0x01;
+  static constexpr uint8_t PROXY_IN_TREE = 0x02;
+
+  // Every slot covers the primitives range [first, first + count), a leaf when child is NO_NODE
+  struct Node {
+    float minX[WIDTH], minY[WIDTH], minZ[WIDTH];
+    float maxX[WIDTH], maxY[WIDTH], maxZ[WIDTH];
+    uint32_t child[WIDTH];
+    uint32_t first[WIDTH];
+    uint32_t count[WIDTH];
+    uint32_t parent;
+    uint8_t dirty;
+
+    Aabb getSlotBounds(uint32_t slot) const;
+    void setSlotBounds(uint32_t slot, const Aabb&);
+  };
+
+  struct BuildPrimitive {
+    Aabb bounds;
+    math::vec3f center;
+    uint32_t proxy;
+  };
+
+  template<class Shape>
+  void queryShape(const Shape&, std::vector<uint32_t>& result) const;
+  void appendRange(uint32_t first, uint32_t count, std::vector<uint32_t>& result) const;
+
+  uint32_t buildNode(uint32_t first, uint32_t count, uint32_t parent);
+  uint32_t split(uint32_t first, uint32_t count);
+  Aabb getBuildRangeBounds(uint32_t first, uint32_t count) const;
+  Aabb getRangeBounds(uint32_t first, uint32_t count) const;
+  void markDirty(uint32_t node);
+  void refit();
+  bool needsRebuild() const;
+
+ private:
+  std::vector<Node> nodes;
+
+  // proxies in tree order, their bounds and user values are duplicated to be read sequentially
+  std::vector<uint32_t> primitives;
+  std::vector<Aabb> primitivesBounds;
+  std::vector<uint32_t> primitivesUserData;
+  std::vector<BuildPrimitive> buildPrimitives;
+
+  std::vector<Aabb> proxyBounds;
+  std::vector<uint32_t> proxyUserData;
+  std::vector<uint32_t> proxyNodes;
+  std::vector<uint32_t> proxyPositions;
+  std::vector<uint8_t> proxyFlags;
+  std::vector<uint32_t> freeProxies;
+  std::vector<uint32_t> pendingProxies;
+
+  uint32_t proxiesCount = 0;
+  uint32_t removedCount = 0;
+  uint32_t movedCount = 0;
+  uint32_t commitsSinceBuild = 0;
+  uint32_t rebuildInterval = 120;
+  float builtRootArea = 0;
+
+  uint32_t rebuildsCount = 0;
+  uint32_t refitsCount = 0;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_BVH_H_
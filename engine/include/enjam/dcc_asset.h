@@ -1,51 +1,172 @@
 #ifndef ENGINE_INCLUDE_ENJAM_DCC_ASSET_H_
 #define ENGINE_INCLUDE_ENJAM_DCC_ASSET_H_
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <enjam/assets_manager.h>
+#include <enjam/geometry_layout.h>
 #include <enjam/math.h>
 #include <enjam/math_assetparser.h>
+#include <enjam/meshlet.h>
+#include <enjam/occlusion_culler.h>
+#include <enjam/vertex_format.h>
 
 namespace Enjam {
 
 class DCCAsset {
  public:
+  // Simplified index range over the vertices of the full mesh
+  struct Lod {
+    uint32_t offset;
+    uint32_t count;
+    float error; // distance to the full mesh surface, in mesh units
+  };
+
+  // Index range of a merged static mesh that came from the mesh of a node
+  struct Source {
+    int32_t node;
+    uint32_t offset;
+    uint32_t count;
+  };
+
+  // Indices of the mesh and of its levels of detail are relative to vertexOffset, they are 16 bit when
+  // the mesh has less than 65536 vertices. Offsets are in the index array of that type.
   struct Mesh {
     uint32_t offset;
     uint32_t count;
+    std::vector<Lod> lods; // coarser and coarser
+    IndexType indexType = IndexType::UINT32;
+    uint32_t vertexOffset = 0;
+
+    // simplified copy in the occluder buffers, indices are relative to the first occluder vertex
+    uint32_t occluderVertexOffset = 0;
+    uint32_t occluderVertexCount = 0;
+    uint32_t occluderIndexOffset = 0;
+    uint32_t occluderIndexCount = 0;
+
+    // meshlets of the full index range in the meshlet array, none for meshes imported without them
+    uint32_t meshletOffset = 0;
+    uint32_t meshletCount = 0;
+
+    uint32_t material = 0; // index of the material in the source scene
+    std::vector<Source> sources; // set when the meshes of static nodes were merged, by offset
   };
 
   struct Node {
-    math::mat4f transform;
+    math::mat4f transform; // relative to the parent
+    int32_t parent = -1; // nodes are in depth-first order, parents come before their children
     std::vector<Mesh> meshes;
   };
 
  public:
+  // Streams of the drawn attributes, laid out and encoded as the format says, and the index arrays are sections
+  // of the geometry buffer. The second texture coordinates are not drawn and stay in a stream of their own.
   explicit DCCAsset(
       std::vector<Node> nodes,
-      std::vector<uint32_t> indices,
-      std::vector<math::vec3f> positions,
-      std::vector<math::vec2f> texCoords0,
-      std::vector<math::vec2f> texCoords1) :
+      VertexFormat vertexFormat,
+      GeometryLayout geometryLayout,
+      ByteArray geometry,
+      ByteArray texCoords1,
+      std::vector<math::vec3f> occluderPositions = { },
+      std::vector<uint32_t> occluderIndices = { },
+      std::vector<Meshlet> meshlets = { }) :
       nodes(std::move(nodes)),
-      indices(std::move(indices)),
-      positions(std::move(positions)),
-      texCoords0(std::move(texCoords0)),
-      texCoords1(std::move(texCoords1))
-  { }
+      vertexFormat(vertexFormat),
+      geometryLayout(std::move(geometryLayout)),
+      geometry(std::move(geometry)),
+      texCoords1(std::move(texCoords1)),
+      occluderPositions(std::move(occluderPositions)),
+      occluderIndices(std::move(occluderIndices)),
+      meshlets(std::move(meshlets))
+  {
+    ENJAM_ASSERT(this->geometryLayout.isValid(vertexFormat, this->geometry.size()));
+    ENJAM_ASSERT(this->texCoords1.size() == getVertexCount() * vertexFormat.getTexCoordStride());
+  }
 
   const std::vector<Node>& getNodes() { return nodes; }
-  const std::vector<uint32_t>& getIndices() { return indices; }
-  const std::vector<math::vec3f>& getPositions() { return positions; }
-  const std::vector<math::vec2f>& getTexCoords0() { return texCoords0; }
-  const std::vector<math::vec2f>& getTexCoords1() { return texCoords1; }
+
+  // Uploaded as they are, the vertex streams to the streams of a GeometryPool made of the attributes of the format
+  const ByteArray& getGeometry() const { return geometry; }
+  const GeometryLayout& getGeometryLayout() const { return geometryLayout; }
+
+  const uint32_t* getIndices() const { return reinterpret_cast<const uint32_t*>(getSection(geometryLayout.indices)); }
+  uint32_t getIndicesCount() const { return uint32_t(geometryLayout.indices.size / sizeof(uint32_t)); }
+  const uint16_t* getIndices16() const { return reinterpret_cast<const uint16_t*>(getSection(geometryLayout.indices16)); }
+  uint32_t getIndices16Count() const { return uint32_t(geometryLayout.indices16.size / sizeof(uint16_t)); }
+
+  // Vertex of the n-th index of the index array of the mesh
+  uint32_t getVertex(const Mesh& mesh, uint32_t n) const {
+    return mesh.vertexOffset + (mesh.indexType == IndexType::UINT16 ? getIndices16()[n] : getIndices()[n]);
+  }
+
+  const VertexFormat& getVertexFormat() const { return vertexFormat; }
+  uint32_t getVertexCount() const { return geometryLayout.vertexCount; }
+  const uint8_t* getVertexStream(uint32_t stream) const { return getSection(geometryLayout.vertexStreams[stream]); }
+  const ByteArray& getTexCoords1() const { return texCoords1; }
+
+  // positions are first in the first stream with either layout
+  math::vec3f getPosition(uint32_t vertex) const {
+    return vertexFormat.decodePosition(getVertexStream(0) + uint64_t(vertex) * vertexFormat.getStreamStride(0));
+  }
+
+  // Of the vertices of the full mesh, in mesh units
+  Aabb getBounds(const Mesh& mesh) const {
+    Aabb bounds;
+    for(auto i = mesh.offset; i < mesh.offset + mesh.count; i++) {
+      bounds.expand(getPosition(getVertex(mesh, i)));
+    }
+    return bounds;
+  }
+
+  // Node whose mesh the index at offset of a merged static mesh came from, to pick the node of a triangle.
+  // Meshes that were not merged belong to their own node, -1 is returned for them.
+  static int32_t findSourceNode(const Mesh& mesh, uint32_t offset) {
+    auto it = std::upper_bound(mesh.sources.begin(), mesh.sources.end(), offset, [](uint32_t offset, const Source& source) {
+      return offset < source.offset;
+    });
+    if(it == mesh.sources.begin() || offset >= std::prev(it)->offset + std::prev(it)->count) {
+      return -1;
+    }
+    return std::prev(it)->node;
+  }
+
+  // Null when the mesh was not imported as an occluder
+  std::shared_ptr<const OccluderMesh> getOccluder(const Mesh& mesh) const {
+    if(mesh.occluderIndexCount == 0) {
+      return nullptr;
+    }
+
+    auto positionsBegin = occluderPositions.begin() + mesh.occluderVertexOffset;
+    auto indicesBegin = occluderIndices.begin() + mesh.occluderIndexOffset;
+    return std::make_shared<OccluderMesh>(OccluderMesh {
+        .positions = std::vector<math::vec3f>(positionsBegin, positionsBegin + mesh.occluderVertexCount),
+        .indices = std::vector<uint32_t>(indicesBegin, indicesBegin + mesh.occluderIndexCount)
+    });
+  }
+
+  // Null when the mesh was imported without meshlets
+  std::shared_ptr<const std::vector<Meshlet>> getMeshlets(const Mesh& mesh) const {
+    if(mesh.meshletCount == 0) {
+      return nullptr;
+    }
+
+    auto begin = meshlets.begin() + mesh.meshletOffset;
+    return std::make_shared<std::vector<Meshlet>>(begin, begin + mesh.meshletCount);
+  }
+
+ private:
+  const uint8_t* getSection(const GeometryLayout::Section& section) const { return geometry.data() + section.offset; }
 
  private:
   std::vector<Node> nodes;
-  std::vector<uint32_t> indices;
-  std::vector<math::vec3f> positions;
-  std::vector<math::vec2f> texCoords0;
-  std::vector<math::vec2f> texCoords1;
+  VertexFormat vertexFormat;
+  GeometryLayout geometryLayout;
+  ByteArray geometry;
+  ByteArray texCoords1;
+  std::vector<math::vec3f> occluderPositions;
+  std::vector<uint32_t> occluderIndices;
+  std::vector<Meshlet> meshlets;
 };
 
 class DCCAssetFactory {
@@ -58,33 +179,139 @@ class DCCAssetFactory {
     return dst;
   }
 
+  static ByteArray makeDefaultStream(const std::array<int16_t, 2>& value, size_t vertexCount) {
+    ByteArray stream(vertexCount * sizeof(value));
+    for(size_t i = 0; i < vertexCount; i++) {
+      std::memcpy(stream.data() + i * sizeof(value), value.data(), sizeof(value));
+    }
+    return stream;
+  }
+
+  // Assets imported without -packed have a buffer per stream and index array, copied once into a geometry buffer
+  static GeometryLayout packGeometry(const Asset& asset, VertexFormat& vertexFormat, ByteArray& geometry) {
+    // interleaved vertices are loaded as they were written
+    std::vector<ByteArray> vertexStreams;
+    if(auto vertices = asset.at("vertices")) {
+      vertexFormat.layout = VertexFormat::Layout::INTERLEAVED;
+      vertexStreams.push_back(vertices->loadBuffer());
+    } else {
+      auto positions = asset.at("positions")->loadBuffer();
+      auto vertexCount = positions.size() / vertexFormat.getPositionStride();
+      vertexStreams.push_back(std::move(positions));
+      vertexStreams.push_back(asset.at("texCoords0")->loadBuffer());
+
+      // and older ones have no normals, every vertex faces +Z
+      auto normals = asset.at("normals");
+      auto tangents = asset.at("tangents");
+      vertexStreams.push_back(normals ? normals->loadBuffer() : makeDefaultStream(encodeOctahedral(math::vec3f { 0, 0, 1 }), vertexCount));
+      vertexStreams.push_back(tangents ? tangents->loadBuffer() : makeDefaultStream(encodeTangent(math::vec3f { 1, 0, 0 }, 1), vertexCount));
+    }
+
+    auto indices16 = asset.at("indices16");
+    auto vertexCount = uint32_t(vertexStreams[0].size() / vertexFormat.getStreamStride(0));
+    return GeometryLayout::pack(vertexCount, vertexStreams, asset.at("indices")->loadBuffer(),
+                                indices16 ? indices16->loadBuffer() : ByteArray { }, geometry);
+  }
+
  public:
   AssetRef<DCCAsset> operator()(const Asset& asset) {
-    auto indices = reinterpret<uint32_t>(asset.at("indices")->loadBuffer());
-    auto positions = reinterpret<math::vec3f>(asset.at("positions")->loadBuffer());
-    auto texCoords0 = reinterpret<math::vec2f>(asset.at("texCoords0")->loadBuffer());
-    auto texCoords1 = reinterpret<math::vec2f>(asset.at("texCoords1")->loadBuffer());
+    // assets imported without quantization have float positions and texture coordinates
+    VertexFormat vertexFormat;
+    if(auto positionFormat = asset.at("positionFormat")) {
+      vertexFormat.positions = VertexFormat::Position(positionFormat->as<uint32_t>());
+      vertexFormat.positionOffset = asset.at("positionOffset")->as<math::vec3f>();
+      vertexFormat.positionScale = asset.at("positionScale")->as<float>();
+    }
+    if(auto texCoordFormat = asset.at("texCoordFormat")) {
+      vertexFormat.texCoords = VertexFormat::TexCoord(texCoordFormat->as<uint32_t>());
+    }
+
+    // packed geometry is read once and used where it was read to, the layout is interleaved when it has one stream
+    GeometryLayout geometryLayout;
+    ByteArray geometry;
+    if(auto geometryAsset = asset.at("geometry")) {
+      geometryLayout = asset.at("geometryLayout")->as<GeometryLayout>();
+      geometry = geometryAsset->loadBuffer();
+      if(geometryLayout.vertexStreams.size() == 1) {
+        vertexFormat.layout = VertexFormat::Layout::INTERLEAVED;
+      }
+    } else {
+      geometryLayout = packGeometry(asset, vertexFormat, geometry);
+    }
+    auto texCoords1 = asset.at("texCoords1")->loadBuffer();
+
+    // assets imported without occluders have no occluder buffers
+    auto occluderPositionsAsset = asset.at("occluderPositions");
+    auto occluderIndicesAsset = asset.at("occluderIndices");
+    auto occluderPositions = occluderPositionsAsset
+        ? reinterpret<math::vec3f>(occluderPositionsAsset->loadBuffer()) : std::vector<math::vec3f> { };
+    auto occluderIndices = occluderIndicesAsset
+        ? reinterpret<uint32_t>(occluderIndicesAsset->loadBuffer()) : std::vector<uint32_t> { };
+    auto meshletsAsset = asset.at("meshlets");
+    auto meshlets = meshletsAsset ? reinterpret<Meshlet>(meshletsAsset->loadBuffer()) : std::vector<Meshlet> { };
 
     std::vector<DCCAsset::Node> nodes;
     for (auto& assetNode: *asset.at("nodes")) {
+      auto parent = assetNode.at("parent");
       DCCAsset::Node node {
           .transform = assetNode.at("transform")->as<math::mat4f>(),
+          .parent = parent ? parent->as<int32_t>() : -1,
       };
       for (auto& assetMesh: *assetNode.at("meshes")) {
+        auto optional = [&assetMesh](const char* key) {
+          auto value = assetMesh.at(key);
+          return value ? value->as<uint32_t>() : 0u;
+        };
+        // assets imported before 16 bit indices have absolute 32 bit ones
+        auto indexType = assetMesh.at("indexType");
         node.meshes.push_back({
             .offset = assetMesh.at("offset")->as<uint32_t>(),
             .count = assetMesh.at("count")->as<uint32_t>(),
+            .lods = { },
+            .indexType = indexType ? IndexType(indexType->as<uint32_t>()) : IndexType::UINT32,
+            .vertexOffset = optional("vertexOffset"),
+            .occluderVertexOffset = optional("occluderVertexOffset"),
+            .occluderVertexCount = optional("occluderVertexCount"),
+            .occluderIndexOffset = optional("occluderIndexOffset"),
+            .occluderIndexCount = optional("occluderIndexCount"),
+            .meshletOffset = optional("meshletOffset"),
+            .meshletCount = optional("meshletCount"),
+            .material = optional("material"),
+            .sources = { },
         });
+
+        if(auto sources = assetMesh.at("sources")) {
+          for(auto& assetSource : *sources) {
+            node.meshes.back().sources.push_back({
+                .node = assetSource.at("node")->as<int32_t>(),
+                .offset = assetSource.at("offset")->as<uint32_t>(),
+                .count = assetSource.at("count")->as<uint32_t>(),
+            });
+          }
+        }
+
+        if(auto lods = assetMesh.at("lods")) {
+          for(auto& assetLod : *lods) {
+            node.meshes.back().lods.push_back({
+                .offset = assetLod.at("offset")->as<uint32_t>(),
+                .count = assetLod.at("count")->as<uint32_t>(),
+                .error = assetLod.at("error")->as<float>(),
+            });
+          }
+        }
       }
       nodes.push_back(std::move(node));
     }
 
     return std::make_shared<DCCAsset>(
         std::move(nodes),
-        std::move(indices),
-        std::move(positions),
-        std::move(texCoords0),
-        std::move(texCoords1));
+        vertexFormat,
+        std::move(geometryLayout),
+        std::move(geometry),
+        std::move(texCoords1),
+        std::move(occluderPositions),
+        std::move(occluderIndices),
+        std::move(meshlets));
   }
 };
 
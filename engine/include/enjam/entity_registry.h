@@ -0,0 +1,247 @@
+#ifndef INCLUDE_ENJAM_ENTITY_REGISTRY_H_
+#define INCLUDE_ENJAM_ENTITY_REGISTRY_H_
+
+#include <enjam/defines.h>
+#include <enjam/assert.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace Enjam {
+
+// Stable id of an entity. The generation tells apart entities that reused the same index.
+struct Entity {
+  static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+  uint32_t index = INVALID_INDEX;
+  uint32_t generation = 0;
+
+  bool isValid() const { return index != INVALID_INDEX; }
+  bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+  bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+using ComponentId = uint8_t;
+using ComponentMask = uint64_t;
+
+constexpr uint32_t MAX_COMPONENT_TYPES = 64;
+
+struct ComponentInfo {
+  uint32_t size;
+  uint32_t alignment;
+  void (*moveConstruct)(void* dst, void* src);
+  void (*destroy)(void* ptr);
+};
+
+class ENJAM_API ComponentTypes final {
+ public:
+  // Ids are assigned in the engine library, so every module gets the same id for a type
+  static ComponentId getId(std::type_index, const ComponentInfo&);
+  static const ComponentInfo& getInfo(ComponentId);
+
+  template<class T>
+  static ComponentId get() {
+    static const ComponentId id = getId(typeid(T), ComponentInfo {
+        .size = sizeof(T),
+        .alignment = alignof(T),
+        .moveConstruct = [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); },
+        .destroy = [](void* ptr) { static_cast<T*>(ptr)->~T(); }
+    });
+    return id;
+  }
+
+  template<class ...Ts>
+  static ComponentMask getMask() {
+    return (ComponentMask(0) | ... | (ComponentMask(1) << get<Ts>()));
+  }
+};
+
+// Entities with the same set of components. They are stored in fixed size chunks holding one tightly
+// packed array per component type, so iterating a few components does not pull the others through the cache.
+// Rows are kept dense, removing an entity moves the last one into its place.
+class ENJAM_API Archetype final {
+ public:
+  static constexpr uint32_t CHUNK_SIZE = 16 * 1024;
+  static constexpr uint32_t CHUNK_ALIGNMENT = 64;
+
+  explicit Archetype(ComponentMask);
+  ~Archetype();
+
+  Archetype(const Archetype&) = delete;
+  Archetype& operator=(const Archetype&) = delete;
+
+  ComponentMask getMask() const { return mask; }
+  bool has(ComponentId id) const { return mask & (ComponentMask(1) << id); }
+
+  uint32_t getEntitiesCount() const { return entitiesCount; }
+  uint32_t getChunkCapacity() const { return chunkCapacity; }
+  uint32_t getChunksCount() const { return (entitiesCount + chunkCapacity - 1) / chunkCapacity; }
+  uint32_t getChunkEntitiesCount(uint32_t chunk) const;
+
+  Entity* getEntities(uint32_t chunk) const { return reinterpret_cast<Entity*>(chunks[chunk]); }
+  void* getColumn(uint32_t chunk, ComponentId id) const { return chunks[chunk] + columnOffsets[id]; }
+
+  template<class T>
+  T* getColumn(uint32_t chunk) const { return static_cast<T*>(getColumn(chunk, ComponentTypes::get<T>())); }
+
+ private:
+  friend class EntityRegistry;
+
+  // Appends a row with uninitialized components, returns its index
+  uint32_t pushRow(Entity);
+
+  // Destroys the row components and fills the hole with the last row, returns the entity moved into it
+  Entity removeRow(uint32_t row);
+
+  void* getComponent(uint32_t row, ComponentId id) const;
+  Entity& getEntity(uint32_t row) const;
+
+ private:
+  ComponentMask mask;
+  std::vector<ComponentId> components;
+  std::array<uint32_t, MAX_COMPONENT_TYPES> columnOffsets { };
+  std::array<ComponentInfo, MAX_COMPONENT_TYPES> infos { };
+  std::vector<std::byte*> chunks;
+  uint32_t chunkCapacity = 0;
+  uint32_t entitiesCount = 0;
+};
+
+// Archetype based entity and component storage. Queries visit only the archetypes that have all the
+// requested components and hand out the component arrays of a chunk at once.
+// Entities must not be created, destroyed or change their components inside a query callback.
+class ENJAM_API EntityRegistry final {
+ public:
+  EntityRegistry() = default;
+  ~EntityRegistry();
+
+  EntityRegistry(const EntityRegistry&) = delete;
+  EntityRegistry& operator=(const EntityRegistry&) = delete;
+
+  template<class ...Ts>
+  Entity create(Ts&& ...components) {
+    auto& archetype = getArchetype(ComponentTypes::getMask<std::decay_t<Ts>...>());
+    auto entity = allocateEntity();
+    place(entity, archetype);
+    (construct<std::decay_t<Ts>>(archetype, records[entity.index].row, std::forward<Ts>(components)), ...);
+    return entity;
+  }
+
+  void destroy(Entity);
+  bool isAlive(Entity) const;
+  // Destroys every entity, their handles are not alive afterwards even once the indices are reused
+  void clear();
+
+  // Entity currently using the index, lets external structures store the index alone
+  // Indices of the entities are below it
+  uint32_t getCapacity() const { return records.size(); }
+
+  // Changes when entities are created or destroyed or gain or lose components.
+  // Pointers to the components stay valid as long as it does not.
+  uint64_t getVersion() const { return version; }
+
+  Entity getEntity(uint32_t index) const { return Entity { .index = index, .generation = records[index].generation }; }
+
+  // Null when the entity has no such component
+  template<class T>
+  T* get(Entity entity) const {
+    ENJAM_ASSERT(isAlive(entity));
+    auto& record = records[entity.index];
+    auto id = ComponentTypes::get<T>();
+    return record.archetype->has(id) ? static_cast<T*>(record.archetype->getComponent(record.row, id)) : nullptr;
+  }
+
+  template<class T>
+  bool has(Entity entity) const { return get<T>(entity) != nullptr; }
+
+  template<class T>
+  T& add(Entity entity, T&& component) {
+    using Type = std::decay_t<T>;
+    if(auto existing = get<Type>(entity)) {
+      *existing = std::forward<T>(component);
+      return *existing;
+    }
+
+    auto& record = records[entity.index];
+    auto row = migrate(entity, record.archetype->getMask() | ComponentTypes::getMask<Type>());
+    return *construct<Type>(*record.archetype, row, std::forward<T>(component));
+  }
+
+  template<class T>
+  void remove(Entity entity) {
+    if(has<T>(entity)) {
+      migrate(entity, records[entity.index].archetype->getMask() & ~ComponentTypes::getMask<T>());
+    }
+  }
+
+  // Calls f(count, entities, Ts* ...) with the component arrays of every chunk that has all of Ts
+  // and none of the excluded components
+  template<class ...Ts, class F>
+  void forEachChunk(F&& f, ComponentMask excluded = 0) const {
+    auto required = ComponentTypes::getMask<Ts...>();
+    for(auto& archetype : archetypes) {
+      if((archetype->getMask() & required) != required || (archetype->getMask() & excluded)) {
+        continue;
+      }
+      for(uint32_t chunk = 0; chunk < archetype->getChunksCount(); chunk++) {
+        f(archetype->getChunkEntitiesCount(chunk), archetype->getEntities(chunk), archetype->template getColumn<Ts>(chunk)...);
+      }
+    }
+  }
+
+  // Calls f(entity, Ts& ...) for every entity that has all of Ts
+  template<class ...Ts, class F>
+  void each(F&& f) const {
+    forEachChunk<Ts...>([&f](uint32_t count, Entity* entities, Ts* ...columns) {
+      for(uint32_t i = 0; i < count; i++) {
+        f(entities[i], columns[i]...);
+      }
+    });
+  }
+
+  template<class ...Ts>
+  uint32_t count() const {
+    uint32_t result = 0;
+    forEachChunk<Ts...>([&result](uint32_t count, Entity*, Ts* ...) { result += count; });
+    return result;
+  }
+
+  uint32_t getEntitiesCount() const { return entitiesCount; }
+  uint32_t getArchetypesCount() const { return archetypes.size(); }
+
+ private:
+  struct Record {
+    Archetype* archetype = nullptr;
+    uint32_t row = 0;
+    uint32_t generation = 0;
+  };
+
+  template<class T, class U>
+  T* construct(Archetype& archetype, uint32_t row, U&& value) {
+    return new (archetype.getComponent(row, ComponentTypes::get<T>())) T(std::forward<U>(value));
+  }
+
+  Entity allocateEntity();
+  Archetype& getArchetype(ComponentMask);
+  uint32_t place(Entity, Archetype&);
+
+  // Moves the entity to the archetype with the mask, the components it does not have are left uninitialized
+  uint32_t migrate(Entity, ComponentMask);
+
+ private:
+  std::vector<std::unique_ptr<Archetype>> archetypes;
+  std::unordered_map<ComponentMask, Archetype*> archetypesByMask;
+  std::vector<Record> records;
+  std::vector<uint32_t> freeIndices;
+  uint32_t entitiesCount = 0;
+  uint64_t version = 0;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_ENTITY_REGISTRY_H_
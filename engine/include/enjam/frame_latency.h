@@ -0,0 +1,41 @@
+#ifndef INCLUDE_ENJAM_FRAME_LATENCY_H_
+#define INCLUDE_ENJAM_FRAME_LATENCY_H_
+
+#include <enjam/defines.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace Enjam {
+
+// Measures CPU-side input-to-present latency: the time between polling input for a frame
+// and handing that frame to the presentation engine.
+class ENJAM_API FrameLatency final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t WINDOW_SIZE = 128;
+
+  struct Stats {
+    uint64_t frames = 0;
+    float lastMs = 0;
+    float averageMs = 0;
+    float maxMs = 0;
+  };
+
+  void onInputPolled(Clock::time_point time = Clock::now());
+  void onPresented(Clock::time_point time = Clock::now());
+
+  Stats getStats() const;
+  void reset();
+
+ private:
+  std::optional<Clock::time_point> inputTime;
+  std::array<float, WINDOW_SIZE> samples { };
+  uint64_t framesCount = 0;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_FRAME_LATENCY_H_
@@ -0,0 +1,77 @@
+#ifndef INCLUDE_ENJAM_GEOMETRY_LAYOUT_H_
+#define INCLUDE_ENJAM_GEOMETRY_LAYOUT_H_
+
+#include <enjam/asset.h>
+#include <enjam/byte_array.h>
+#include <enjam/defines.h>
+#include <enjam/vertex_format.h>
+#include <cstdint>
+#include <vector>
+
+namespace Enjam {
+
+// Where the vertex streams and the index arrays of a mesh asset are in its geometry buffer, which holds them
+// in the format they are uploaded in. Every section starts at a multiple of ALIGNMENT, so the buffer is used
+// where it was read to, without converting or copying its elements.
+struct GeometryLayout {
+  static constexpr uint64_t ALIGNMENT = 16;
+
+  struct Section {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+  };
+
+  uint32_t vertexCount = 0;
+  std::vector<Section> vertexStreams; // the streams of the vertex format, in its order
+  Section indices;
+  Section indices16;
+
+  // Appends the streams and the index arrays to geometry, aligned, and returns where they went
+  ENJAM_API static GeometryLayout pack(uint32_t vertexCount, const std::vector<ByteArray>& vertexStreams,
+                                       const ByteArray& indices, const ByteArray& indices16, ByteArray& geometry);
+
+  // Whether the sections are aligned, inside the geometry buffer and sized for the vertex format
+  ENJAM_API bool isValid(const VertexFormat&, uint64_t geometrySize) const;
+};
+
+template<>
+struct AssetParser<GeometryLayout::Section> {
+  static void fromAsset(const Asset& asset, GeometryLayout::Section& val) {
+    val.offset = asset.at("offset")->as<uint64_t>();
+    val.size = asset.at("size")->as<uint64_t>();
+  }
+
+  static void toAsset(Asset& asset, const GeometryLayout::Section& val) {
+    asset["offset"] = val.offset;
+    asset["size"] = val.size;
+  }
+};
+
+template<>
+struct AssetParser<GeometryLayout> {
+  static void fromAsset(const Asset& asset, GeometryLayout& val) {
+    val.vertexCount = asset.at("vertexCount")->as<uint32_t>();
+    val.vertexStreams.clear();
+    for(auto& stream : *asset.at("vertexStreams")) {
+      val.vertexStreams.push_back(stream.as<GeometryLayout::Section>());
+    }
+    val.indices = asset.at("indices")->as<GeometryLayout::Section>();
+    val.indices16 = asset.at("indices16")->as<GeometryLayout::Section>();
+  }
+
+  static void toAsset(Asset& asset, const GeometryLayout& val) {
+    asset["vertexCount"] = val.vertexCount;
+    asset["vertexStreams"] = Asset::array();
+    for(auto& stream : val.vertexStreams) {
+      Asset streamAsset;
+      streamAsset = stream;
+      asset["vertexStreams"].pushBack(std::move(streamAsset));
+    }
+    asset["indices"] = val.indices;
+    asset["indices16"] = val.indices16;
+  }
+};
+
+}
+
+#endif //INCLUDE_ENJAM_GEOMETRY_LAYOUT_H_
@@ -0,0 +1,76 @@
+#ifndef INCLUDE_ENJAM_GEOMETRY_POOL_H_
+#define INCLUDE_ENJAM_GEOMETRY_POOL_H_
+
+#include <enjam/defines.h>
+#include <enjam/range_allocator.h>
+#include <enjam/render_primitive.h>
+#include <enjam/renderer_backend.h>
+#include <array>
+#include <vector>
+
+namespace Enjam {
+
+// Mesh location inside a GeometryPool. Indices are relative to the mesh and get baseVertex added on draw.
+// A mesh may have indices of both types, the ranges of the types it has none of are invalid.
+struct GeometryRange {
+  RangeAllocator::Range vertices;
+  std::array<RangeAllocator::Range, 2> indices; // by IndexType
+
+  bool isValid() const { return vertices.isValid(); }
+
+  int32_t getBaseVertex() const { return int32_t(vertices.offset); }
+  uint32_t getVertexCount() const { return vertices.size; }
+  uint32_t getFirstIndex(IndexType type = IndexType::UINT32) const { return indices[uint8_t(type)].offset; }
+  uint32_t getIndexCount(IndexType type = IndexType::UINT32) const { return indices[uint8_t(type)].size; }
+};
+
+// Shared vertex and index arenas for meshes with the same vertex layout.
+// Every mesh of the pool draws with the same vertex buffer, so the attributes are bound once for all of them.
+// An attribute with a zero offset starts a vertex stream, the following ones with an offset are interleaved
+// in it and have its stride. 16 and 32 bit indices go to index buffers of their own.
+class ENJAM_API GeometryPool final {
+ public:
+  struct Stats {
+    RangeAllocator::Stats vertices;
+    RangeAllocator::Stats indices;
+    RangeAllocator::Stats indices16;
+  };
+
+  GeometryPool(RendererBackend&, std::initializer_list<VertexAttribute>,
+               uint32_t vertexCapacity, uint32_t indexCapacity, uint32_t index16Capacity = 0);
+
+  GeometryRange allocate(uint32_t vertexCount, uint32_t indexCount, uint32_t index16Count = 0);
+  void free(const GeometryRange&);
+
+  // Data goes to the range from its firstVertex / firstIndex on, so large meshes can be uploaded in slices
+  void setVertices(RendererBackend&, const GeometryRange&, uint8_t stream, BufferDataDesc&&, uint32_t firstVertex = 0);
+  void setIndices(RendererBackend&, const GeometryRange&, BufferDataDesc&&, uint32_t firstIndex = 0,
+                  IndexType = IndexType::UINT32);
+
+  void destroy(RendererBackend&);
+
+  VertexBuffer* getVertexBuffer() { return &vertexBuffer; }
+  IndexBuffer* getIndexBuffer(IndexType type = IndexType::UINT32) { return &indexArenas[uint8_t(type)].buffer; }
+
+  uint32_t getStreamsCount() const { return uint32_t(vertexStrides.size()); }
+  uint8_t getVertexStride(uint8_t stream) const { return vertexStrides[stream]; }
+
+  Stats getStats() const;
+  void logStats() const;
+
+ private:
+  struct IndexArena {
+    IndexBuffer buffer;
+    RangeAllocator ranges;
+  };
+
+  VertexBuffer vertexBuffer;
+  std::vector<BufferObject> vertexStreams;
+  std::vector<uint8_t> vertexStrides;
+  RangeAllocator vertexRanges;
+  std::array<IndexArena, 2> indexArenas; // by IndexType
+};
+
+}
+
+#endif //INCLUDE_ENJAM_GEOMETRY_POOL_H_
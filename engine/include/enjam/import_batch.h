@@ -0,0 +1,37 @@
+#ifndef INCLUDE_ENJAM_IMPORT_BATCH_H_
+#define INCLUDE_ENJAM_IMPORT_BATCH_H_
+
+#include <enjam/defines.h>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace Enjam {
+
+class ThreadPool;
+class ImportCache;
+class AssetsFilesystemRep;
+
+// Asset an importer makes from its inputs, a file or the stages of a shader program
+struct ImportJob {
+  std::vector<std::filesystem::path> inputs;
+  std::filesystem::path output; // empty for the default of the importer, next to the first input
+};
+
+// Jobs of a manifest. Every line holds the arguments of one job: its inputs, then optionally -o and its output.
+// Paths are relative to the manifest, the ones with spaces are quoted. Empty lines and lines starting with # are skipped.
+ENJAM_API std::vector<ImportJob> readImportManifest(const std::filesystem::path&);
+
+// The output of a job, or its first input with the extension of the importer when it has none
+ENJAM_API std::filesystem::path getImportOutput(const ImportJob&, std::string_view extension);
+
+// Imports the jobs concurrently on the pool and logs how long each one took. The jobs must have their outputs set
+// and write to different ones, every job saves through a AssetsFilesystemRep of its own. Jobs the cache restores
+// are skipped, the ones imported are stored to it. Returns whether every job succeeded.
+ENJAM_API bool runImportJobs(ThreadPool&, const std::vector<ImportJob>&, ImportCache* cache,
+                             const std::function<bool(const ImportJob&, AssetsFilesystemRep&)>& import);
+
+}
+
+#endif //INCLUDE_ENJAM_IMPORT_BATCH_H_
@@ -0,0 +1,72 @@
+#ifndef INCLUDE_ENJAM_IMPORT_CACHE_H_
+#define INCLUDE_ENJAM_IMPORT_CACHE_H_
+
+#include <enjam/defines.h>
+#include <enjam/import_batch.h>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Enjam {
+
+// Files an importer made from the content of its inputs, kept in a manifest between runs. A job whose output
+// was made from the same inputs and settings is skipped, and inputs imported before to another output get
+// the files of that output copied instead of imported again.
+// Input content hashes are reused while the size and write time of the input stay the same.
+class ENJAM_API ImportCache final {
+ public:
+  enum class Result {
+    MISSING, // the job has to be imported
+    UP_TO_DATE, // its output is touched, so build rules see it newer than the inputs and the importer
+    COPIED
+  };
+
+  // settings are everything besides the inputs the outputs depend on: the importer, its version and options
+  ImportCache(std::filesystem::path path, std::string settings);
+
+  // Lookups and stores of different jobs can run concurrently
+  Result restore(const ImportJob&);
+  // Files are the ones the job saved, its output and everything it references
+  void store(const ImportJob&, const std::vector<std::filesystem::path>& files);
+
+  void save() const;
+
+ private:
+  struct File {
+    std::string path;
+    uint64_t size;
+  };
+
+  struct Entry {
+    uint64_t key;
+    std::vector<File> files;
+    bool relocatable; // only the output and the buffers of its asset, which can be copied to another output
+  };
+
+  struct Input {
+    uint64_t size;
+    uint64_t time;
+    uint64_t hash;
+  };
+
+  uint64_t getKey(const ImportJob&);
+  uint64_t hashInput(const std::filesystem::path&);
+  static bool isIntact(const Entry&);
+  static bool copy(const Entry&, const std::filesystem::path& from, const std::filesystem::path& to);
+  void load();
+
+ private:
+  std::filesystem::path path;
+  std::string settings;
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, Entry> entries; // by output
+  std::unordered_map<std::string, Input> inputs; // by path
+};
+
+}
+
+#endif //INCLUDE_ENJAM_IMPORT_CACHE_H_
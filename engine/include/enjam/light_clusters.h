@@ -0,0 +1,109 @@
+#ifndef INCLUDE_ENJAM_LIGHT_CLUSTERS_H_
+#define INCLUDE_ENJAM_LIGHT_CLUSTERS_H_
+
+#include <cstdint>
+#include <enjam/defines.h>
+#include <enjam/math.h>
+#include <array>
+#include <vector>
+
+namespace Enjam {
+
+class ThreadPool;
+
+// Point light of the frame in world space, gathered once for all the views
+struct FrameLight {
+  math::vec3f position;
+  float radius;
+  math::vec3f color; // premultiplied by the intensity
+};
+
+// Uniform blocks read by the shaders, std140 layout
+
+struct LightsUniforms {
+  static constexpr uint32_t MAX_LIGHTS = 256;
+
+  std::array<std140::vec4, MAX_LIGHTS> positionRadius; // world position, radius
+  std::array<std140::vec4, MAX_LIGHTS> colors;
+};
+
+struct LightClustersUniforms {
+  static constexpr uint32_t GRID_X = 16;
+  static constexpr uint32_t GRID_Y = 8;
+  static constexpr uint32_t GRID_Z = 24;
+  static constexpr uint32_t CLUSTERS_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+  // slice of a view depth d is log(d) * x + y
+  std140::vec4 params;
+  // light indices range of every cluster, offset | count << 16, four clusters per element.
+  // Clusters are indexed by (slice * GRID_Y + tileY) * GRID_X + tileX, tiles split the NDC square evenly.
+  std::array<std::array<uint32_t, 4>, CLUSTERS_COUNT / 4> ranges;
+};
+
+struct LightIndicesUniforms {
+  static constexpr uint32_t MAX_INDICES = 16384; // a byte each, Renderer::init checks the block fits the backend
+
+  // 8 bit light indices, sixteen per element
+  std::array<std::array<uint32_t, 4>, MAX_INDICES / 16> indices;
+};
+
+static_assert(LightsUniforms::MAX_LIGHTS <= 256, "Light indices are 8 bit");
+static_assert(LightIndicesUniforms::MAX_INDICES < (1 << 16), "Cluster offsets are 16 bit");
+
+// Clustered forward light assignment. The view frustum is split into a grid of tiles in screen space and
+// exponential slices in depth, every cluster gets the list of the lights whose sphere touches it.
+// Slices are assigned in parallel.
+class ENJAM_API LightClusters final {
+ public:
+  struct Stats {
+    uint32_t lightsCount = 0; // in the view
+    uint32_t droppedLightsCount = 0; // farthest ones past MAX_LIGHTS
+    uint32_t indicesCount = 0;
+    uint32_t droppedIndicesCount = 0; // past MAX_INDICES, the clusters at the back lose lights first
+    float buildMs = 0;
+  };
+
+  void build(const math::mat4f& view, const math::mat4f& projection, const std::vector<FrameLight>&, ThreadPool&);
+
+  const LightsUniforms& getLights() const { return lights; }
+  const LightClustersUniforms& getClusters() const { return clusters; }
+  const LightIndicesUniforms& getIndices() const { return indices; }
+
+  // Index of the n-th light of a cluster in getLights
+  uint32_t getLightIndex(uint32_t n) const {
+    return (indices.indices[n / 16][n / 4 % 4] >> (n % 4 * 8)) & 0xff;
+  }
+  uint32_t getClusterOffset(uint32_t cluster) const { return clusters.ranges[cluster / 4][cluster % 4] & 0xffff; }
+  uint32_t getClusterCount(uint32_t cluster) const { return clusters.ranges[cluster / 4][cluster % 4] >> 16; }
+
+  const Stats& getStats() const { return stats; }
+
+ private:
+  // view space lights touching a slice, gathered once and tested against every tile of the slice
+  struct SliceLights {
+    std::vector<float> x, y, z, radiusSquared;
+    std::vector<uint8_t> lights;
+    std::vector<uint8_t> hits;
+
+    std::vector<uint8_t> clusterLights; // of every cluster of the slice, one after the other
+    std::array<uint16_t, LightClustersUniforms::GRID_X * LightClustersUniforms::GRID_Y> clusterCounts;
+  };
+
+  void assignSlice(uint32_t slice, const math::mat4f& projection, float near, float far);
+
+ private:
+  LightsUniforms lights;
+  LightClustersUniforms clusters;
+  LightIndicesUniforms indices;
+  Stats stats;
+
+  // in view space, by depth
+  std::vector<std::pair<float, uint32_t>> visibleLights;
+  std::vector<math::vec3f> viewPositions;
+  std::vector<float> radiuses;
+  std::array<SliceLights, LightClustersUniforms::GRID_Z> slices;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_LIGHT_CLUSTERS_H_
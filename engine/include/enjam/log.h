@@ -16,22 +16,23 @@ class ENJAM_API Log final {
 
 template<typename... Args>
 void Log::info(const char* location, fmt::format_string<Args...> format, Args &&... args) {
-  std::cout << "[INFO] " << fmt::format(format, args...) << " (" << location << ")\n";
+  // a single write per line, so the lines logged by concurrent threads do not interleave
+  std::cout << fmt::format("[INFO] {} ({})\n", fmt::format(format, args...), location);
 }
 
 template<typename... Args>
 void Log::debug(const char* location, fmt::format_string<Args...> format, Args &&... args) {
-  std::cout << "[DEBUG] " << fmt::format(format, args...) << " (" << location << ")\n";
+  std::cout << fmt::format("[DEBUG] {} ({})\n", fmt::format(format, args...), location);
 }
 
 template<typename... Args>
 void Log::warn(const char* location, fmt::format_string<Args...> format, Args &&... args) {
-  std::cout << "[WARN] " << fmt::format(format, args...) << " (" << location << ")\n";
+  std::cout << fmt::format("[WARN] {} ({})\n", fmt::format(format, args...), location);
 }
 
 template<typename... Args>
 void Log::error(const char* location, fmt::format_string<Args...> format, Args &&... args) {
-  std::cout << "[ERROR] " << fmt::format(format, args...) << " (" << location << ")\n";
+  std::cout << fmt::format("[ERROR] {} ({})\n", fmt::format(format, args...), location);
 }
 
 }
@@ -1,11 +1,157 @@
 #ifndef INCLUDE_ENJAM_MATERIAL_H_
 #define INCLUDE_ENJAM_MATERIAL_H_
 
+#include <enjam/defines.h>
+#include <enjam/assert.h>
+#include <enjam/byte_array.h>
+#include <enjam/program.h>
 #include "renderer_backend.h"
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace Enjam {
 
+enum class MaterialParameterType : uint8_t {
+  FLOAT,
+  FLOAT2,
+  FLOAT3,
+  FLOAT4,
+  INT,
+  UINT,
+  MAT4
+};
 
+// std140 layout of the material parameters block, parameters must be added in the order the shader declares them
+class ENJAM_API MaterialParameterLayout {
+ public:
+  struct Parameter {
+    std::string name;
+    MaterialParameterType type;
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  MaterialParameterLayout& add(std::string name, MaterialParameterType type);
+
+  const Parameter* find(std::string_view name) const;
+  const std::vector<Parameter>& getParameters() const { return parameters; }
+
+  // Size of the block with the std140 tail padding
+  uint32_t getSize() const { return (size + 15) & ~15u; }
+
+ private:
+  std::vector<Parameter> parameters;
+  uint32_t size = 0;
+};
+
+// Program with its parameters layout and texture slots. Parameters and textures are bound in the
+// MATERIAL_SET descriptor set: the parameters block at binding 0, textures at the following bindings.
+class ENJAM_API Material final {
+ public:
+  static constexpr uint8_t MATERIAL_SET = 1;
+  static constexpr uint8_t PARAMETERS_BINDING = 0;
+  static constexpr const char* PARAMETERS_BLOCK_NAME = "material";
+
+  Material(RendererBackend&, ProgramData&, MaterialParameterLayout&&, std::vector<std::string>&& textureNames);
+  void destroy(RendererBackend&);
+
+  ProgramHandle getProgramHandle() const { return programHandle; }
+  const MaterialParameterLayout& getLayout() const { return layout; }
+  uint32_t getTexturesCount() const { return textureNames.size(); }
+  int32_t findTexture(std::string_view name) const;
+
+  // Unique for the lifetime of the process, materials created earlier sort first
+  uint32_t getId() const { return id; }
+
+ private:
+  ProgramHandle programHandle;
+  MaterialParameterLayout layout;
+  std::vector<std::string> textureNames;
+  uint32_t id;
+};
+
+class MaterialSystem;
+
+// Descriptor set and parameters buffer shared by the instances with equal content
+struct MaterialBinding {
+  const Material* material = nullptr;
+  ByteArray parameters;
+  std::vector<TextureHandle> textures;
+  DescriptorSetHandle descriptorSetHandle;
+  BufferDataHandle bufferHandle;
+  uint64_t hash = 0;
+  uint32_t refCount = 0;
+};
+
+// Packed parameters and textures of a material. Instances with equal content share a descriptor set.
+class ENJAM_API MaterialInstance final {
+ public:
+  explicit MaterialInstance(const Material&);
+
+  template<class T>
+  void setParameter(std::string_view name, const T& value) {
+    auto parameter = material->getLayout().find(name);
+    ENJAM_ASSERT(parameter && sizeof(T) == parameter->size);
+    if(std::memcmp(parameters.data() + parameter->offset, &value, sizeof(T)) != 0) {
+      std::memcpy(parameters.data() + parameter->offset, &value, sizeof(T));
+      dirty = true;
+    }
+  }
+
+  void setTexture(std::string_view name, TextureHandle);
+
+  const Material& getMaterial() const { return *material; }
+  DescriptorSetHandle getDescriptorSetHandle() const;
+
+  // Groups draws by program first and by descriptor set second
+  uint64_t getSortKey() const;
+
+  bool isDirty() const { return dirty; }
+
+ private:
+  friend class MaterialSystem;
+
+  const Material* material;
+  ByteArray parameters;
+  std::vector<TextureHandle> textures;
+  bool dirty = true;
+
+  MaterialBinding* binding = nullptr;
+};
+
+// Resolves material instances to shared descriptor sets, uploads parameters only when an instance changed
+class ENJAM_API MaterialSystem final {
+ public:
+  struct Stats {
+    uint32_t descriptorSetsCount = 0;
+    uint32_t instancesCount = 0;
+    uint32_t uploadsCount = 0;
+  };
+
+  explicit MaterialSystem(RendererBackend& backend) : backend(backend) { }
+
+  void update(MaterialInstance&);
+  void release(MaterialInstance&);
+  void destroy();
+
+  const Stats& getStats() const { return stats; }
+
+ private:
+  using BindingsMap = std::unordered_multimap<uint64_t, MaterialBinding>;
+
+  MaterialBinding* find(uint64_t hash, const MaterialInstance&);
+  MaterialBinding& create(uint64_t hash, const MaterialInstance&);
+  void upload(MaterialBinding&, const MaterialInstance&);
+  BindingsMap::iterator locate(const MaterialBinding*);
+
+ private:
+  RendererBackend& backend;
+  BindingsMap bindings;
+  Stats stats;
+};
 
 }
 
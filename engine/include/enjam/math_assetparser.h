@@ -6,6 +6,22 @@
 
 namespace Enjam {
 
+template<>
+struct AssetParser<math::vec3f> {
+  static void fromAsset(const Asset& asset, math::vec3f& val) {
+    auto i = 0;
+    for (auto& aVal: asset) {
+      val[i++] = aVal.as<float>();
+    }
+  }
+
+  static void toAsset(Asset& asset, const math::vec3f& val) {
+    for (auto i = 0; i < 3; i++) {
+      asset.pushBack(val[i]);
+    }
+  }
+};
+
 template<>
 struct AssetParser<math::mat4f> {
   static void fromAsset(const Asset& asset, math::mat4f& val) {
@@ -0,0 +1,38 @@
+#ifndef INCLUDE_ENJAM_MESHLET_H_
+#define INCLUDE_ENJAM_MESHLET_H_
+
+#include <cstdint>
+#include <enjam/math.h>
+#include <type_traits>
+
+namespace Enjam {
+
+// Small cluster of the triangles of a mesh, contiguous in its index range. The views cull the meshlets
+// of dense meshes one by one and draw the ones left with a single multi-draw.
+struct Meshlet {
+  static constexpr uint32_t MAX_VERTICES = 64;
+  static constexpr uint32_t MAX_TRIANGLES = 124;
+
+  // bounding sphere, in mesh units
+  math::vec3f center;
+  float radius;
+  // the triangles face at most the cone angle away from the axis, the cutoff is the sine of that angle.
+  // It is 1 when they face too many ways, such meshlets are never backfacing.
+  math::vec3f coneAxis;
+  float coneCutoff;
+  uint32_t indexOffset; // relative to the first index of the mesh
+  uint32_t indexCount;
+
+  // Every triangle faces away from the camera, in mesh units. Conservative, the directions from the camera
+  // to every point of the bounding sphere are within 90 degrees minus the cone angle of the axis.
+  bool isBackfacing(const math::vec3f& camera) const {
+    auto toCenter = center + (-camera);
+    return dot(toCenter, coneAxis) >= coneCutoff * length(toCenter) + radius * (1 + coneCutoff);
+  }
+};
+
+static_assert(std::is_trivially_copyable_v<Meshlet>, "Meshlets are stored as a buffer");
+
+}
+
+#endif //INCLUDE_ENJAM_MESHLET_H_
@@ -0,0 +1,108 @@
+#ifndef INCLUDE_ENJAM_OCCLUSION_CULLER_H_
+#define INCLUDE_ENJAM_OCCLUSION_CULLER_H_
+
+#include <enjam/defines.h>
+#include <enjam/bounds.h>
+#include <enjam/math.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Enjam {
+
+class ThreadPool;
+
+// Simplified mesh rasterized into the occlusion depth buffer, should lie inside the mesh it stands for
+struct OccluderMesh {
+  std::vector<math::vec3f> positions;
+  std::vector<uint32_t> indices;
+
+  // Simplifies a closed mesh by clustering its vertices on a gridSize^3 grid over its bounds. Every cell keeps
+  // the vertex closest to the average of its vertices, and triangles that would stick out of the surface,
+  // tested at a few points each, are dropped, so the result stays inside the mesh.
+  ENJAM_API static OccluderMesh simplify(const math::vec3f* positions, uint32_t verticesCount,
+                                         const std::vector<uint32_t>& indices, uint32_t gridSize);
+};
+
+// Software occlusion culling. Occluders are rasterized into a small depth buffer split into tiles
+// that are rasterized in parallel, then a hierarchical depth pyramid keeps the farthest depth of every
+// region. A box is occluded when its nearest point is behind the farthest occluder over its screen rect.
+// Depth is stored as 1 / w, so it interpolates linearly over the screen and 0 means nothing was drawn.
+class ENJAM_API OcclusionCuller final {
+ public:
+  static constexpr uint32_t TILE_SIZE = 32;
+
+  struct Config {
+    uint32_t width = 256; // multiple of TILE_SIZE
+    uint32_t height = 128; // multiple of TILE_SIZE
+    uint32_t maxOccluders = 32;
+    uint32_t maxOccluderTriangles = 16384;
+  };
+
+  struct Stats {
+    uint32_t occludersCount = 0;
+    uint32_t occluderTrianglesCount = 0;
+    uint32_t testedCount = 0;
+    uint32_t culledCount = 0;
+    float rasterizeMs = 0;
+    float testMs = 0;
+  };
+
+  OcclusionCuller();
+  explicit OcclusionCuller(const Config&);
+
+  const Config& getConfig() const { return config; }
+
+  // Clears the depth buffer for a new frame seen with the projection * view matrix
+  void begin(const math::mat4f& viewProjection);
+
+  // Returns false when the triangles budget is exhausted
+  bool addOccluder(const OccluderMesh&, const math::mat4f& world);
+
+  void rasterize(ThreadPool&);
+
+  bool isVisible(const Aabb& worldBounds) const;
+
+  // Writes 1 to visible for the boxes that may be visible, 0 for the occluded ones
+  void cull(const Aabb* bounds, uint32_t count, uint8_t* visible, ThreadPool&);
+
+  const Stats& getStats() const { return stats; }
+
+  // Level 0 is the depth buffer
+  uint32_t getLevelsCount() const { return levels.size(); }
+  float getDepth(uint32_t level, uint32_t x, uint32_t y) const;
+
+ private:
+  struct Level {
+    uint32_t width;
+    uint32_t height;
+    std::vector<float> depth;
+  };
+
+  struct Triangle {
+    float x[3];
+    float y[3];
+    float depth[3];
+  };
+
+  void rasterizeTile(uint32_t tile);
+  void rasterizeTriangle(const Triangle&, uint32_t minX, uint32_t minY, uint32_t maxX, uint32_t maxY);
+  void reduceTile(uint32_t tile);
+  void reduceLevel(uint32_t level, uint32_t minX, uint32_t minY, uint32_t maxX, uint32_t maxY);
+
+ private:
+  Config config;
+  Stats stats;
+
+  math::mat4f viewProjection;
+  uint32_t tilesX;
+  uint32_t tilesY;
+
+  std::vector<Level> levels;
+  std::vector<Triangle> triangles;
+  std::vector<std::vector<uint32_t>> tileTriangles;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_OCCLUSION_CULLER_H_
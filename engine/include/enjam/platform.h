@@ -2,24 +2,32 @@
 #define INCLUDE_ENJAM_PLATFORM_H_
 
 #include <enjam/defines.h>
+#include <enjam/renderer_backend.h>
 #include <enjam/renderer_backend_type.h>
+#include <enjam/frame_latency.h>
 #include <memory>
 
 
 namespace Enjam {
 
 class Input;
-class RendererBackend;
 
 class Platform {
  public:
   virtual ~Platform() = default;
 
-  virtual std::unique_ptr<RendererBackend> createRendererBackend(RendererBackendType = RendererBackendType::DEFAULT) = 0;
+  // The presentation config is applied before the backend creates its swapchain
+  virtual std::unique_ptr<RendererBackend> createRendererBackend(RendererBackendType = RendererBackendType::DEFAULT,
+                                                                 const PresentationConfig& = { }) = 0;
   virtual void pollInputEvents(Input&) = 0;
 
+  // Only the OpenGL backend presents frames and reports them, at its buffer swap
+  FrameLatency& getFrameLatency() { return frameLatency; }
+
  protected:
   Platform() = default;
+
+  FrameLatency frameLatency;
 };
 
 }
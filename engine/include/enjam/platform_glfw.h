@@ -11,7 +11,8 @@ namespace Enjam {
 class ENJAM_API PlatformGlfw : public Platform {
  public:
   PlatformGlfw() = default;
-  std::unique_ptr<RendererBackend> createRendererBackend(RendererBackendType = RendererBackendType::DEFAULT) override;
+  std::unique_ptr<RendererBackend> createRendererBackend(RendererBackendType = RendererBackendType::DEFAULT,
+                                                         const PresentationConfig& = { }) override;
   void pollInputEvents(Input& input) override;
   void shutdown();
 
@@ -31,10 +31,17 @@ class ProgramData {
   struct DescriptorInfo {
     std::string name;
     DescriptorType type;
+    uint32_t size = 0; // of a uniform block when set, the backend checks the shader declares the same
+  };
+
+  struct PushConstantsInfo {
+    std::string name;
+    uint32_t size = 0;
   };
 
   static constexpr size_t MAX_DESCRIPTOR_BINDINGS_COUNT = 16;
   static constexpr size_t DESCRIPTOR_SET_COUNT = 4;
+  static constexpr uint32_t MAX_PUSH_CONSTANTS_SIZE = 128;
   using ProgramSource = std::array<ByteArray, (size_t) ShaderStage::COUNT>;
   using DescriptorSetInfo = std::vector<DescriptorInfo>;
   using DescriptorsMap = std::array<DescriptorSetInfo, (size_t) DESCRIPTOR_SET_COUNT>;
@@ -51,9 +58,18 @@ class ProgramData {
 
   const DescriptorsMap& getDescriptorsMap() const { return descriptorSets; }
 
+  ProgramData& setPushConstants(std::string name, uint32_t size) {
+    ENJAM_ASSERT(size <= MAX_PUSH_CONSTANTS_SIZE);
+    pushConstants = { std::move(name), size };
+    return *this;
+  }
+
+  const PushConstantsInfo& getPushConstants() const { return pushConstants; }
+
  private:
   ProgramSource source;
   DescriptorsMap descriptorSets { };
+  PushConstantsInfo pushConstants { };
 };
 
 }
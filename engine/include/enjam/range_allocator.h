@@ -0,0 +1,84 @@
+#ifndef INCLUDE_ENJAM_RANGE_ALLOCATOR_H_
+#define INCLUDE_ENJAM_RANGE_ALLOCATOR_H_
+
+#include <enjam/defines.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Enjam {
+
+// Two level segregated fit allocator of [offset, offset + size) ranges inside a fixed capacity.
+// Does not touch any memory, used to suballocate GPU buffers. Allocation and free are O(1),
+// free ranges are merged with their free neighbours.
+class ENJAM_API RangeAllocator final {
+ public:
+  static constexpr uint32_t NO_SPACE = UINT32_MAX;
+
+  struct Range {
+    uint32_t offset = NO_SPACE;
+    uint32_t size = 0;
+    uint32_t node = NO_SPACE;
+
+    bool isValid() const { return offset != NO_SPACE; }
+  };
+
+  struct Stats {
+    uint32_t capacity = 0;
+    uint32_t usedSize = 0;
+    uint32_t allocationsCount = 0;
+    uint32_t freeRangesCount = 0;
+    uint32_t largestFreeRange = 0;
+
+    // 0 when all the free space is contiguous, close to 1 when it is split into many small ranges
+    float fragmentation() const {
+      auto freeSize = capacity - usedSize;
+      return freeSize == 0 ? 0.0f : 1.0f - float(largestFreeRange) / float(freeSize);
+    }
+  };
+
+  explicit RangeAllocator(uint32_t capacity);
+
+  Range allocate(uint32_t size);
+  void free(const Range&);
+  void reset();
+
+  Stats getStats() const;
+  uint32_t getCapacity() const { return capacity; }
+
+ private:
+  static constexpr uint32_t TOP_BINS_COUNT = 32;
+  static constexpr uint32_t BINS_PER_LEAF = 8;
+  static constexpr uint32_t LEAF_BINS_COUNT = TOP_BINS_COUNT * BINS_PER_LEAF;
+  static constexpr uint32_t UNUSED = UINT32_MAX;
+
+  struct Node {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    uint32_t binPrev = UNUSED;
+    uint32_t binNext = UNUSED;
+    uint32_t neighbourPrev = UNUSED;
+    uint32_t neighbourNext = UNUSED;
+    bool used = false;
+  };
+
+  uint32_t insertNodeIntoBin(uint32_t size, uint32_t offset);
+  void removeNodeFromBin(uint32_t nodeIndex);
+  uint32_t allocNode();
+
+ private:
+  uint32_t capacity;
+  uint32_t freeSize = 0;
+  uint32_t allocationsCount = 0;
+
+  uint32_t usedBinsTop = 0;
+  std::array<uint8_t, TOP_BINS_COUNT> usedBins { };
+  std::array<uint32_t, LEAF_BINS_COUNT> binHeads { };
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> freeNodes;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_RANGE_ALLOCATOR_H_
@@ -0,0 +1,94 @@
+#ifndef INCLUDE_ENJAM_RENDER_COMPONENTS_H_
+#define INCLUDE_ENJAM_RENDER_COMPONENTS_H_
+
+#include <cstdint>
+#include <enjam/math.h>
+#include <enjam/bounds.h>
+#include <enjam/meshlet.h>
+#include <enjam/occlusion_culler.h>
+#include <array>
+#include <memory>
+#include <vector>
+#include <enjam/renderer_backend.h>
+
+namespace Enjam {
+
+class MaterialInstance;
+
+// Components of the renderable scene entities, split by how often the render passes touch them
+
+struct TransformComponent {
+  math::mat4f world = math::mat4f(1);
+};
+
+// World transform is copied from the scene node when its subtree is updated
+struct SceneNodeComponent {
+  int32_t node = -1;
+};
+
+// Local bounds of the mesh, the world bounds are kept in the scene BVH
+struct BoundsComponent {
+  Aabb local;
+  uint32_t proxy;
+};
+
+// Entities with an occluder hide the ones behind them from the occlusion culling
+struct OccluderComponent {
+  std::shared_ptr<const OccluderMesh> mesh;
+};
+
+// Meshlets of the full mesh range, culled one by one when the view draws that range
+struct MeshletComponent {
+  std::shared_ptr<const std::vector<Meshlet>> meshlets;
+};
+
+// Part of the buffers to draw, the whole index buffer when indexCount is 0
+struct MeshComponent {
+  VertexBufferHandle vertexBuffer;
+  IndexBufferHandle indexBuffer;
+  uint32_t indexCount = 0;
+  uint32_t indexOffset = 0;
+  int32_t baseVertex = 0;
+  math::vec4f positionDecode { 0, 0, 0, 1 }; // offset and scale of quantized positions
+};
+
+// Index range of a simplified version of the mesh over the same vertices, and its distance to the full mesh surface
+struct MeshLod {
+  uint32_t indexCount = 0;
+  uint32_t indexOffset = 0;
+  float error = 0;
+};
+
+// Levels of detail replacing the range of the MeshComponent, the view picks the coarsest one
+// whose error projects to less than its threshold. Selected per view, needs bounds.
+struct LodComponent {
+  static constexpr uint32_t MAX_LODS = 8;
+
+  std::array<MeshLod, MAX_LODS> lods; // lods[0] is the full mesh
+  uint32_t lodsCount = 0;
+};
+
+// Point light at the translation of the TransformComponent, it does not reach past its radius
+struct LightComponent {
+  math::vec3f color { 1 };
+  float intensity = 1;
+  float radius = 10;
+};
+
+// Program and material descriptor set come from the material instance when it is set
+struct MaterialComponent {
+  MaterialInstance* instance = nullptr;
+  ProgramHandle programHandle;
+  DescriptorSetHandle descriptorSetHandle;
+  uint32_t materialIndex = 0; // layer of the texture array the program samples
+
+  ProgramHandle getDrawProgramHandle() const;
+  DescriptorSetHandle getDrawDescriptorSetHandle() const;
+
+  // Draws sorted by this key switch programs and descriptor sets as rarely as possible
+  uint64_t getSortKey() const;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_RENDER_COMPONENTS_H_
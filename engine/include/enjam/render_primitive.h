@@ -1,24 +1,32 @@
 #ifndef INCLUDE_ENJAM_RENDER_PRIMITIVE_H_
 #define INCLUDE_ENJAM_RENDER_PRIMITIVE_H_
 
+#include <memory>
 #include <optional>
+#include <vector>
 #include <enjam/math.h>
+#include <enjam/bounds.h>
+#include <enjam/occlusion_culler.h>
+#include <enjam/render_components.h>
 #include <enjam/renderer_backend.h>
 
 namespace Enjam {
 
 class IndexBuffer {
  public:
-  IndexBuffer(RendererBackend&, size_t indexCount);
+  IndexBuffer(RendererBackend&, size_t indexCount, IndexType = IndexType::UINT32);
   void setBuffer(RendererBackend&, BufferDataDesc&& desc, uint32_t byteOffset = 0);
   void destroy(RendererBackend&);
   IndexBufferHandle& getHandle() { return handle; }
+  IndexType getType() const { return type; }
 
  private:
   IndexBufferHandle handle;
+  IndexType type;
 };
 
 class BufferObject;
+class MaterialInstance;
 
 class VertexBuffer {
  public:
@@ -26,13 +34,20 @@ class VertexBuffer {
   VertexBuffer(RendererBackend&, std::initializer_list<VertexAttribute>, uint64_t count);
   void setBuffer(RendererBackend&, uint32_t attributeIndex, BufferDataDesc&&, uint32_t offset = 0);
   void setBuffer(RendererBackend&, uint32_t attributeIndex, BufferObject&);
+  // Interleaved attributes, the buffer is shared by attributesCount attributes from firstAttribute on.
+  // Their offsets locate them in a vertex and their stride is the size of a whole vertex.
+  void setInterleavedBuffer(RendererBackend&, uint32_t firstAttribute, uint32_t attributesCount, BufferDataDesc&&);
+  void setInterleavedBuffer(RendererBackend&, uint32_t firstAttribute, uint32_t attributesCount, BufferObject&);
   void destroy(RendererBackend&);
   VertexBufferHandle getHandle() { return handle; }
 
  private:
   static constexpr uint8_t FLAG_DESTROY_BUFFER_OBJECT = 0x01;
 
+  void releaseBuffers(RendererBackend&, uint32_t firstAttribute, uint32_t attributesCount);
+
   VertexBufferHandle handle;
+  // owned buffers, an interleaved one is kept by its first attribute
   std::array<std::optional<BufferDataHandle>, VERTEX_ARRAY_MAX_SIZE> bufferHandles;
 };
 
@@ -52,18 +67,20 @@ class BufferObject {
   BufferTargetBinding binding;
 };
 
+// Description of a drawable, Scene::addPrimitive splits it into the render components of an entity
+// and returns the entity, the stable id of the primitive
 class RenderPrimitive {
  public:
-  RenderPrimitive(VertexBuffer* vertexBuffer = nullptr,
-                  IndexBuffer* indexBuffer = nullptr,
+  RenderPrimitive(VertexBufferHandle vertexBuffer = {},
+                  IndexBufferHandle indexBuffer = {},
                   ProgramHandle programHandle = {})
       : vertexBuffer(vertexBuffer), indexBuffer(indexBuffer), programHandle(programHandle), transform(1) {}
 
-  VertexBuffer* getVertexBuffer() { return vertexBuffer; }
-  IndexBuffer* getIndexBuffer() { return indexBuffer; }
+  VertexBufferHandle getVertexBuffer() const { return vertexBuffer; }
+  IndexBufferHandle getIndexBuffer() const { return indexBuffer; }
 
-  void setVertexBuffer(VertexBuffer* buffer) { vertexBuffer = buffer; }
-  void setIndexBuffer(IndexBuffer* buffer) { indexBuffer = buffer; }
+  void setVertexBuffer(VertexBufferHandle handle) { vertexBuffer = handle; }
+  void setIndexBuffer(IndexBufferHandle handle) { indexBuffer = handle; }
 
   ProgramHandle getProgramHandle() { return programHandle; }
   void setProgramHandle(ProgramHandle handle) { programHandle = handle; }
@@ -71,15 +88,71 @@ class RenderPrimitive {
   DescriptorSetHandle getDescriptorSetHandle() { return descriptorSetHandle; }
   void setDescriptorSetHandle(DescriptorSetHandle handle) { descriptorSetHandle = handle; }
 
+  // Program and material descriptor set come from the material instance when it is set
+  MaterialInstance* getMaterialInstance() { return materialInstance; }
+  void setMaterialInstance(MaterialInstance* instance) { materialInstance = instance; }
+
+  // Index the program samples its textures with, the layer of a TextureTable array
+  uint32_t getMaterialIndex() const { return materialIndex; }
+  void setMaterialIndex(uint32_t index) { materialIndex = index; }
+
   const math::mat4f& getTransform() const { return transform; }
   void setTransform(math::mat4f&& tr) { transform = tr; }
 
+  // Local bounds, primitives without bounds are never culled
+  const Aabb& getBounds() const { return bounds; }
+  void setBounds(const Aabb& aabb) { bounds = aabb; }
+
+  // Simplified mesh hiding what is behind the primitive, needs bounds
+  const std::shared_ptr<const OccluderMesh>& getOccluder() const { return occluder; }
+  void setOccluder(std::shared_ptr<const OccluderMesh> mesh) { occluder = std::move(mesh); }
+
+  // Clusters of the range set by setRange, culled on their own by the views. Needs bounds.
+  const std::shared_ptr<const std::vector<Meshlet>>& getMeshlets() const { return meshlets; }
+  void setMeshlets(std::shared_ptr<const std::vector<Meshlet>> list) { meshlets = std::move(list); }
+
+  // Scene node the primitive follows, the own transform is used when it is negative
+  int32_t getNode() const { return node; }
+  void setNode(int32_t index) { node = index; }
+
+  // Part of the buffers to draw, the whole index buffer when indexCount is 0
+  void setRange(uint32_t count, uint32_t firstIndex, int32_t vertexOffset = 0) {
+    indexCount = count;
+    indexOffset = firstIndex;
+    baseVertex = vertexOffset;
+  }
+  uint32_t getIndexCount() const { return indexCount; }
+  uint32_t getIndexOffset() const { return indexOffset; }
+  int32_t getBaseVertex() const { return baseVertex; }
+
+  // Simplified range drawn from far away, added from the finest to the coarsest with increasing error.
+  // Error is in the units of the primitive bounds.
+  void addLod(uint32_t count, uint32_t firstIndex, float error) {
+    lods.push_back(MeshLod { .indexCount = count, .indexOffset = firstIndex, .error = error });
+  }
+  const std::vector<MeshLod>& getLods() const { return lods; }
+
+  // Quantized positions are decoded to offset.xyz + position * scale.w in the vertex shader, see VertexFormat
+  const math::vec4f& getPositionDecode() const { return positionDecode; }
+  void setPositionDecode(const math::vec4f& decode) { positionDecode = decode; }
+
  private:
-  VertexBuffer* vertexBuffer;
-  IndexBuffer* indexBuffer;
+  VertexBufferHandle vertexBuffer;
+  IndexBufferHandle indexBuffer;
+  uint32_t indexCount = 0;
+  uint32_t indexOffset = 0;
+  int32_t baseVertex = 0;
+  std::vector<MeshLod> lods;
+  math::vec4f positionDecode { 0, 0, 0, 1 };
+  uint32_t materialIndex = 0;
+  MaterialInstance* materialInstance = nullptr;
   ProgramHandle programHandle;
   DescriptorSetHandle descriptorSetHandle;
   math::mat4f transform;
+  Aabb bounds;
+  std::shared_ptr<const OccluderMesh> occluder;
+  std::shared_ptr<const std::vector<Meshlet>> meshlets;
+  int32_t node = -1;
 };
 
 }
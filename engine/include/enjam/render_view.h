@@ -4,6 +4,11 @@
 #include <enjam/math.h>
 #include <enjam/renderer_backend.h>
 #include <enjam/render_primitive.h>
+#include <enjam/entity_registry.h>
+#include <enjam/occlusion_culler.h>
+#include <enjam/render_components.h>
+#include <enjam/bvh.h>
+#include <enjam/light_clusters.h>
 #include <vector>
 
 namespace Enjam {
@@ -25,29 +30,154 @@ struct PerViewUniforms {
 
 struct PerObjectUniforms {
   std140::mat44 model;
+  std140::vec4 positionDecode; // offset, scale of quantized positions
+  uint32_t materialIndex; // layer of the texture array the object samples
+  uint32_t padding[3];
 };
 
+static_assert(sizeof(PerObjectUniforms) <= ProgramData::MAX_PUSH_CONSTANTS_SIZE,
+              "Per object data is sent as push constants");
+
 class Scene;
+class ThreadPool;
+
+// Render data of the drawable scene entities as parallel arrays indexed by object, shared by every view
+// of a frame. The arrays pointing into the component chunks are rebuilt only when the entities change,
+// the material ones are refreshed every frame since materials may switch programs.
+class FrameObjects {
+ public:
+  static constexpr uint32_t NO_OBJECT = UINT32_MAX;
+
+  void prepare(const Scene&);
+
+  uint32_t getCount() const { return transforms.size(); }
+  uint32_t getObjectIndex(Entity entity) const { return objectIndices[entity.index]; }
+  const Aabb& getBounds(uint32_t object) const { return bvh->getBounds(proxies[object]); }
+  bool hasBounds(uint32_t object) const { return proxies[object] != Bvh::INVALID_PROXY; }
+
+ public:
+  std::vector<const math::mat4f*> transforms;
+  std::vector<const MeshComponent*> meshes;
+  std::vector<uint32_t> proxies; // of the world bounds in the scene BVH
+  std::vector<const LodComponent*> lods; // null without levels of detail
+  std::vector<const OccluderMesh*> occluders; // null for the objects hiding nothing
+  std::vector<const std::vector<Meshlet>*> meshlets; // null for the objects drawn whole
+  std::vector<uint32_t> unboundedObjects; // never culled
+
+  std::vector<uint64_t> sortKeys;
+  std::vector<uint32_t> materialIndices;
+  std::vector<ProgramHandle> programs;
+  std::vector<DescriptorSetHandle> descriptorSets;
+
+  std::vector<FrameLight> lights; // gathered every frame
+
+ private:
+  void rebuild(const EntityRegistry&);
+
+ private:
+  std::vector<uint32_t> objectIndices; // by entity index
+  const EntityRegistry* registry = nullptr;
+  uint64_t registryVersion = 0;
+  const Bvh* bvh = nullptr;
+};
+
+// Range of an object to draw, everything else is read from the FrameObjects
+struct DrawCommand {
+  uint64_t sortKey;
+  uint32_t objectIndex;
+  uint32_t indexCount; // of the selected level of detail
+  uint32_t indexOffset;
+  // visible meshlets of the range, drawn instead of it when rangesCount is set, in RenderView::getDrawRanges
+  uint32_t firstRange = 0;
+  uint32_t rangesCount = 0;
+};
 
 class RenderView {
  public:
+  struct MeshletStats {
+    uint32_t testedCount = 0;
+    uint32_t frustumCulledCount = 0;
+    uint32_t backfacingCount = 0;
+  };
+
   ~RenderView() = default;
 
   void setCamera(Camera* ptr) { camera = ptr; }
   void setScene(Scene* ptr) { scene = ptr; }
 
+  // Hides the entities behind the occluders in the view, on by default
+  void setOcclusionCulling(bool enabled) { occlusionCullingEnabled = enabled; }
+  const OcclusionCuller::Stats& getOcclusionStats() const { return occlusionCuller.getStats(); }
+
+  // Culls the meshlets of the objects drawn with their full mesh against the frustum and by their facing,
+  // on by default. Backfacing meshlets are dropped, meshes seen from behind should not have meshlets.
+  void setMeshletCulling(bool enabled) { meshletCullingEnabled = enabled; }
+  const MeshletStats& getMeshletStats() const { return meshletStats; }
+
+  // Levels of detail are switched when their error projects to less than errorPixels on the viewport
+  void setLodErrorThreshold(float errorPixels) { lodErrorThreshold = errorPixels; }
+  void setViewportHeight(uint32_t height) { viewportHeight = height; }
+
+  // Culls the scene and builds the draw commands, called by Renderer::draw.
+  // Views of a frame are prepared concurrently.
+  void prepareBuffers(ThreadPool&, const FrameObjects&);
+  const std::vector<DrawCommand>& getDrawCommands() const { return drawCommands; }
+  const std::vector<DrawRange>& getDrawRanges() const { return drawRanges; }
+  const LightClusters& getLightClusters() const { return lightClusters; }
+
  private:
   friend class Renderer;
 
-  void prepareBuffers();
+  void cullOccluded(const math::mat4f& viewProjection, const FrameObjects&, ThreadPool&);
+  void cullMeshlets(const math::mat4f& viewProjection, const FrameObjects&, ThreadPool&);
+  uint32_t selectLod(const LodComponent&, const Aabb& worldBounds, const math::mat4f& world) const;
   void updateViewUniformBuffer(RendererBackend& backend, BufferDataHandle);
-  void updateObjectUniformBuffer(RendererBackend& backend, BufferDataHandle, uint32_t primitiveIndex);
+  void updateLightBuffers(RendererBackend& backend, BufferDataHandle lights, BufferDataHandle clusters, BufferDataHandle indices);
 
  private:
-  using PerObjectUniformBufferData = std::vector<PerObjectUniforms>;
-
-  PerObjectUniformBufferData perObjectUniformBufferData;
   PerViewUniforms perViewUniformBufferData;
+  std::vector<DrawCommand> drawCommands; // sorted by material
+  std::vector<DrawRange> drawRanges;
+  std::vector<Entity> visibleEntities;
+  std::vector<uint32_t> visibleObjects;
+
+  OcclusionCuller occlusionCuller;
+  bool occlusionCullingEnabled = true;
+  std::vector<std::pair<float, uint32_t>> occluders;
+  std::vector<Aabb> visibleBounds;
+  std::vector<uint8_t> visibleFlags;
+
+  // meshlets are culled in jobs of at most MESHLETS_PER_JOB, every job writes its visible ranges
+  // to the slots of its meshlets in drawRanges and the ranges are packed once all are done
+  static constexpr uint32_t MESHLETS_PER_JOB = 256;
+
+  // command drawing the full mesh of an object with meshlets, with the view in mesh units
+  struct MeshletObject {
+    uint32_t command;
+    Frustum frustum;
+    math::vec3f camera;
+    bool mirrored; // the triangles face the other way
+  };
+
+  struct MeshletJob {
+    uint32_t object;
+    uint32_t firstMeshlet;
+    uint32_t meshletsCount;
+    uint32_t firstRange;
+    uint32_t rangesCount;
+    MeshletStats stats;
+  };
+
+  bool meshletCullingEnabled = true;
+  MeshletStats meshletStats;
+  std::vector<MeshletObject> meshletObjects;
+  std::vector<MeshletJob> meshletJobs;
+
+  float lodErrorThreshold = 1.0f;
+  uint32_t viewportHeight = 720;
+  float lodPixelsPerUnit = 0; // at a distance of 1 from the camera
+
+  LightClusters lightClusters;
 
   Scene* scene;
   Camera* camera;
@@ -6,28 +6,71 @@
 #include <enjam/platform.h>
 #include <enjam/renderer_backend_type.h>
 #include <enjam/math.h>
+#include <enjam/material.h>
 #include <enjam/render_primitive.h>
+#include <enjam/occlusion_culler.h>
+#include <enjam/thread_pool.h>
+#include <enjam/render_view.h>
 #include <vector>
 
 namespace Enjam {
 
-class RenderView;
 class RendererBackend;
 
 class ENJAM_API Renderer final {
  public:
+  struct Stats {
+    uint32_t viewsCount = 0;
+    uint32_t objectsCount = 0;
+    uint32_t drawCallsCount = 0;
+    uint64_t trianglesCount = 0;
+    uint32_t lightsCount = 0; // in the views
+    uint32_t lightIndicesCount = 0; // in the light clusters
+    OcclusionCuller::Stats occlusion { };
+    RenderView::MeshletStats meshlets { };
+  };
+
   explicit Renderer(RendererBackend& backend);
   ~Renderer() = default;
   void init();
   void draw(RenderView&);
+
+  // Views of the same scene drawn in order. Per object data is gathered once for all of them
+  // and the views are culled in parallel.
+  void draw(const std::vector<RenderView*>& views);
   void shutdown();
 
+  MaterialSystem& getMaterialSystem() { return materialSystem; }
+
+  // Of the last frame, summed over its views
+  const Stats& getStats() const { return stats; }
+
+ private:
+  // Per view descriptor set bindings, the light blocks are read by the programs shading with lights
+  static constexpr uint8_t VIEW_BINDING = 0;
+  static constexpr uint8_t LIGHTS_BINDING = 1;
+  static constexpr uint8_t LIGHT_CLUSTERS_BINDING = 2;
+  static constexpr uint8_t LIGHT_INDICES_BINDING = 3;
+
+  struct ViewResources {
+    DescriptorSetHandle descriptorSetHandle;
+    BufferDataHandle uniformBufferHandle;
+    BufferDataHandle lightsBufferHandle;
+    BufferDataHandle lightClustersBufferHandle;
+    BufferDataHandle lightIndicesBufferHandle;
+  };
+
+  ViewResources& getViewResources(uint32_t view);
+
  private:
   RendererBackend& rendererBackend;
+  MaterialSystem materialSystem;
+  ThreadPool threadPool;
+  Stats stats;
+  FrameObjects frameObjects;
 
-  DescriptorSetHandle viewDescriptorSetHandle;
-  BufferDataHandle objectsUniformBufferHandle;
-  BufferDataHandle viewUniformBufferHandle;
+  // every view of a frame has its own uniforms, the frame reads them all
+  std::vector<ViewResources> viewResources;
 };
 
 }
@@ -17,6 +17,10 @@ enum class VertexAttributeType : uint8_t {
   FLOAT2,
   FLOAT3,
   FLOAT4,
+  HALF,
+  HALF2,
+  HALF3,
+  HALF4,
   BYTE,
   BYTE2,
   BYTE3,
@@ -43,6 +47,16 @@ enum class VertexAttributeType : uint8_t {
   UINT4
 };
 
+// Every index buffer holds one type of indices, draws read them with the type of their buffer
+enum class IndexType : uint8_t {
+  UINT16,
+  UINT32
+};
+
+constexpr inline uint32_t getIndexSize(IndexType type) {
+  return type == IndexType::UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
 enum class BufferTargetBinding : uint8_t {
   VERTEX,
   UNIFORM
@@ -57,6 +71,17 @@ enum class TextureFormat : uint16_t {
   RGB8
 };
 
+enum class PresentMode : uint8_t {
+  FIFO,       // waits for vblank and never tears (GL swap interval 1)
+  MAILBOX,    // replaces the queued image instead of blocking on vblank (GL swap interval 0)
+  IMMEDIATE   // presents right away and may tear (GL swap interval 0)
+};
+
+struct PresentationConfig {
+  PresentMode presentMode = PresentMode::FIFO;
+  uint8_t imageCount = 0; // 0 requests one more than the surface minimum
+};
+
 struct DescriptorSetBinding {
   uint8_t binding;
   DescriptorType type;
@@ -81,6 +106,12 @@ using DescriptorSetHandle = Handle<DescriptorSetHW>;
 using BufferDataHandle = Handle<BufferDataHW>;
 using TextureHandle = Handle<TextureHW>;
 
+// Index range of a multi-draw
+struct DrawRange {
+  uint32_t indexCount;
+  uint32_t indexOffset;
+};
+
 struct VertexAttribute {
   static constexpr uint32_t FLAG_NORMALIZED = 0x01;
 
@@ -134,11 +165,25 @@ class ENJAM_API RendererBackend {
   virtual void beginFrame() = 0;
   virtual void endFrame() = 0;
 
+  virtual void setPresentationConfig(const PresentationConfig&) = 0;
+
+  // Largest uniform block a program can read, valid after init
+  virtual uint32_t getMaxUniformBlockSize() const = 0;
+
+  // baseVertex is added to every index, lets meshes sharing one vertex buffer keep zero based indices
   virtual void draw(ProgramHandle,
                     VertexBufferHandle,
                     IndexBufferHandle,
                     uint32_t indexCount = 0,
-                    uint32_t indexOffset = 0) = 0;
+                    uint32_t indexOffset = 0,
+                    int32_t baseVertex = 0) = 0;
+  // Ranges of the same buffers with the same program and bindings, drawn with a single call where the API has one
+  virtual void multiDraw(ProgramHandle,
+                         VertexBufferHandle,
+                         IndexBufferHandle,
+                         const DrawRange* ranges,
+                         uint32_t rangesCount,
+                         int32_t baseVertex = 0) = 0;
 
   virtual ProgramHandle createProgram(ProgramData&) = 0;
   virtual void destroyProgram(ProgramHandle) = 0;
@@ -153,11 +198,14 @@ class ENJAM_API RendererBackend {
   virtual void updateDescriptorSetTexture(DescriptorSetHandle dsh, uint8_t binding, TextureHandle th) = 0;
   virtual void bindDescriptorSet(DescriptorSetHandle dsh, uint8_t set) = 0;
 
+  // Small per-draw data (up to ProgramData::MAX_PUSH_CONSTANTS_SIZE bytes) consumed by the next draw call
+  virtual void setPushConstants(const void* data, uint32_t size, uint32_t offset = 0) = 0;
+
   virtual VertexBufferHandle createVertexBuffer(std::initializer_list<VertexAttribute>, uint64_t vertexCount) = 0;
   virtual void assignVertexBufferData(VertexBufferHandle, uint8_t attributeIndex, BufferDataHandle) = 0;
   virtual void destroyVertexBuffer(VertexBufferHandle) = 0;
 
-  virtual IndexBufferHandle createIndexBuffer(uint32_t byteSize) = 0;
+  virtual IndexBufferHandle createIndexBuffer(uint32_t byteSize, IndexType) = 0;
   virtual void updateIndexBuffer(IndexBufferHandle, BufferDataDesc&&, uint32_t byteOffset) = 0;
   virtual void destroyIndexBuffer(IndexBufferHandle) = 0;
 
@@ -166,6 +214,8 @@ class ENJAM_API RendererBackend {
   virtual void destroyBufferData(BufferDataHandle) = 0;
 
   virtual TextureHandle createTexture(uint32_t width, uint32_t height, uint8_t levels, TextureFormat format) = 0;
+  // 2D texture array, setTextureData addresses layers with zoffset and depth
+  virtual TextureHandle createTextureArray(uint32_t width, uint32_t height, uint8_t levels, uint32_t layers, TextureFormat format) = 0;
   virtual void setTextureData(TextureHandle th, uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
                               uint32_t width, uint32_t height, uint32_t depth, const void* data) = 0;
   virtual void destroyTexture(TextureHandle) = 0;
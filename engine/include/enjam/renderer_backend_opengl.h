@@ -3,6 +3,8 @@
 
 #include <enjam/renderer_backend.h>
 #include <enjam/handle_allocator.h>
+#include <enjam/frame_latency.h>
+#include <enjam/range_allocator.h>
 #include <bitset>
 #include <functional>
 #include <type_traits>
@@ -16,10 +18,14 @@ struct GLSwapChain {
   virtual ~GLSwapChain() = default;
   virtual void makeCurrent() = 0;
   virtual void swapBuffers() = 0;
+  virtual void setSwapInterval(int32_t interval) = 0;
 };
 
 struct GLProgram : public ProgramHW {
+  static constexpr uint32_t NO_PUSH_CONSTANTS = UINT32_MAX;
+
   GLuint id = 0;
+  uint32_t pushConstantsBinding = NO_PUSH_CONSTANTS;
 
   struct DescriptorInfo {
     uint32_t binding;
@@ -45,17 +51,24 @@ struct GLVertexBuffer : public VertexBufferHW {
 struct GLIndexBuffer : public IndexBufferHW {
   GLuint id = 0;
   uint32_t size = 0;
+  IndexType type = IndexType::UINT32;
 };
 
 struct GLBufferData : public BufferDataHW {
   GLuint id = 0;
   uint32_t size = 0;
+  uint32_t offset = 0; // slice start in the GL buffer, non zero only for pooled uniform buffers
   GLenum target = 0; // GL_UNIFORM_BUFFER / GL_ARRAY_BUFFER
+
+  uint32_t poolBlock = 0;
+  RangeAllocator::Range poolRange;
+
+  bool isPooled() const { return poolRange.isValid(); }
 };
 
 struct GLTexture : TextureHW {
   GLuint id;
-  GLenum target;
+  GLenum target; // GL_TEXTURE_2D / GL_TEXTURE_2D_ARRAY
   GLenum glFormat;
 };
 
@@ -76,6 +89,41 @@ struct GLDescriptorTexture {
 
 struct GLDescriptorNone {};
 
+// Uniform buffer ring emulating push constants: every update takes the next aligned slice
+struct GLPushConstantsRing {
+  static constexpr uint32_t SIZE = 64 * 1024;
+
+  GLuint id = 0;
+  uint32_t head = 0;
+  uint32_t alignment = 0;
+  uint32_t lastOffset = 0;
+};
+
+// Small uniform buffers are aligned slices of a few large GL buffers instead of a GL buffer each.
+// Slices refer to their block by index, so a released block keeps its slot until it is the last one.
+struct GLUniformBufferPool {
+  static constexpr uint32_t BLOCK_SIZE = 1024 * 1024;
+  static constexpr uint32_t MAX_SLICE_SIZE = 16 * 1024; // the minimum GL_MAX_UNIFORM_BLOCK_SIZE
+  static constexpr uint32_t IDLE_FRAMES = 120; // frames a block stays empty before its buffer is deleted
+
+  struct Block {
+    GLuint id = 0; // 0 once released
+    RangeAllocator ranges; // in units of alignment
+    uint32_t slicesCount = 0;
+    uint32_t idleFrames = 0;
+  };
+
+  std::vector<Block> blocks;
+  uint32_t alignment = 0;
+
+  bool alloc(uint32_t size, GLBufferData& bd);
+  void free(GLBufferData& bd);
+  // Called at the end of every frame, deletes the buffers of the blocks left empty for IDLE_FRAMES
+  void trim();
+  void destroy();
+  void logStats() const;
+};
+
 using GLDescriptor = std::variant<GLDescriptorNone, GLDescriptorBuffer, GLDescriptorTexture>;
 
 struct GLDescriptorSet : public DescriptorSetHW {
@@ -109,7 +157,7 @@ class RendererBackendOpengl : public RendererBackend {
  public:
   using HandleAllocator = HandleAllocator<GLVertexBuffer, GLIndexBuffer, GLProgram, GLTexture, GLBufferData, GLDescriptorSet>;
 
-  explicit RendererBackendOpengl(GLLoaderProc, GLSwapChain*);
+  explicit RendererBackendOpengl(GLLoaderProc, GLSwapChain*, FrameLatency* = nullptr);
   ~RendererBackendOpengl() override;
 
   bool init() override;
@@ -118,7 +166,11 @@ class RendererBackendOpengl : public RendererBackend {
   void beginFrame() override;
   void endFrame() override;
 
-  void draw(ProgramHandle, VertexBufferHandle, IndexBufferHandle, uint32_t indexCount, uint32_t indexOffset) override;
+  void setPresentationConfig(const PresentationConfig&) override;
+  uint32_t getMaxUniformBlockSize() const override { return maxUniformBlockSize; }
+
+  void draw(ProgramHandle, VertexBufferHandle, IndexBufferHandle, uint32_t indexCount, uint32_t indexOffset, int32_t baseVertex) override;
+  void multiDraw(ProgramHandle, VertexBufferHandle, IndexBufferHandle, const DrawRange*, uint32_t rangesCount, int32_t baseVertex) override;
 
   ProgramHandle createProgram(ProgramData&) override;
   void destroyProgram(ProgramHandle) override;
@@ -133,11 +185,13 @@ class RendererBackendOpengl : public RendererBackend {
   void updateDescriptorSetTexture(DescriptorSetHandle dsh, uint8_t binding, TextureHandle th) override;
   void bindDescriptorSet(DescriptorSetHandle dsh, uint8_t set) override;
 
+  void setPushConstants(const void* data, uint32_t size, uint32_t offset) override;
+
   VertexBufferHandle createVertexBuffer(std::initializer_list<VertexAttribute>, uint64_t vertexCount) override;
   void assignVertexBufferData(VertexBufferHandle, uint8_t attributeIndex, BufferDataHandle) override;
   void destroyVertexBuffer(VertexBufferHandle) override;
 
-  IndexBufferHandle createIndexBuffer(uint32_t byteSize) override;
+  IndexBufferHandle createIndexBuffer(uint32_t byteSize, IndexType) override;
   void updateIndexBuffer(IndexBufferHandle, BufferDataDesc&&, uint32_t byteOffset) override;
   void destroyIndexBuffer(IndexBufferHandle) override;
 
@@ -146,6 +200,7 @@ class RendererBackendOpengl : public RendererBackend {
   void destroyBufferData(BufferDataHandle) override;
 
   TextureHandle createTexture(uint32_t width, uint32_t height, uint8_t levels, TextureFormat format) override;
+  TextureHandle createTextureArray(uint32_t width, uint32_t height, uint8_t levels, uint32_t layers, TextureFormat format) override;
   void setTextureData(TextureHandle th, uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
                       uint32_t width, uint32_t height, uint32_t depth, const void* data) override;
   void destroyTexture(TextureHandle) override;
@@ -155,13 +210,37 @@ class RendererBackendOpengl : public RendererBackend {
 
   void updateVertexAttributes(const GLVertexAttributesArray&, uint32_t count);
   void updateDescriptorSets(GLProgram*, const DescriptorSetBitset&);
+  void invalidateDescriptorSet(DescriptorSetHandle);
+  void updatePushConstants(GLProgram*);
+  GLIndexBuffer* bindDrawState(ProgramHandle, VertexBufferHandle, IndexBufferHandle);
+  void setDefaultTextureParameters(GLenum target);
 
  private:
   GLLoaderProc loaderProc;
   GLSwapChain* swapChain;
+  FrameLatency* frameLatency;
+  PresentationConfig presentationConfig;
+  bool presentationConfigDirty = true;
   HandleAllocator handleAllocator;
   GLuint defaultVertexArray;
+  uint32_t maxUniformBlockSize = 0;
+  VertexBufferHandle boundVertexBuffer; // attributes currently set up in the default vertex array
   std::array<DescriptorSetHandle, ProgramData::DESCRIPTOR_SET_COUNT> boundDescriptorSets;
+  // Bound sets not applied to the GL bindings yet. Applied sets stay valid for the program they were applied with,
+  // so objects sharing a material descriptor set, like the ones sampling one texture array, do not rebind it.
+  DescriptorSetBitset dirtyDescriptorSets;
+  ProgramHandle appliedProgram;
+
+  std::array<uint8_t, ProgramData::MAX_PUSH_CONSTANTS_SIZE> pushConstants { };
+  uint32_t pushConstantsSize = 0;
+  bool pushConstantsDirty = false;
+  GLPushConstantsRing pushConstantsRing;
+  GLUniformBufferPool uniformBufferPool;
+
+  // arguments of glMultiDrawElementsBaseVertex, kept between the calls
+  std::vector<GLsizei> multiDrawCounts;
+  std::vector<const void*> multiDrawOffsets;
+  std::vector<GLint> multiDrawBaseVertices;
 };
 
 }
@@ -3,6 +3,7 @@
 
 #include <enjam/renderer_backend.h>
 #include <enjam/vulkan_defines.h>
+#include <enjam/vulkan_allocator.h>
 #include <vulkan/vulkan.h>
 #include <enjam/math.h>
 
@@ -20,18 +21,35 @@ struct VulkanSwapChain {
 
 class RendererBackendVulkan : public RendererBackend {
  public:
-  explicit RendererBackendVulkan(VkInstance inst, VkSurfaceKHR surface, math::vec2i frameBufferSize)
-    : frameBufferSize(frameBufferSize), instance(inst), surface(surface) { }
+  // hostAllocator has to be the one instance and surface were created with
+  explicit RendererBackendVulkan(VkInstance inst,
+                                 VkSurfaceKHR surface,
+                                 math::vec2i frameBufferSize,
+                                 std::unique_ptr<VulkanHostAllocator> hostAllocator = nullptr)
+    : hostAllocator(std::move(hostAllocator))
+    , vkAlloc(this->hostAllocator ? this->hostAllocator->getCallbacks() : nullptr)
+    , frameBufferSize(frameBufferSize)
+    , instance(inst)
+    , surface(surface) { }
 
   bool init() override;
   void shutdown() override;
   void beginFrame() override;
   void endFrame() override;
+  void setPresentationConfig(const PresentationConfig& config) override;
+  uint32_t getMaxUniformBlockSize() const override { return maxUniformBlockSize; }
   void draw(ProgramHandle handle,
             VertexBufferHandle bufferHandle,
             IndexBufferHandle indexBufferHandle,
             uint32_t indexCount,
-            uint32_t indexOffset) override;
+            uint32_t indexOffset,
+            int32_t baseVertex) override;
+  void multiDraw(ProgramHandle handle,
+                 VertexBufferHandle bufferHandle,
+                 IndexBufferHandle indexBufferHandle,
+                 const DrawRange* ranges,
+                 uint32_t rangesCount,
+                 int32_t baseVertex) override;
   ProgramHandle createProgram(ProgramData& data) override;
   void destroyProgram(ProgramHandle handle) override;
   DescriptorSetHandle createDescriptorSet(DescriptorSetData&& data) override;
@@ -43,16 +61,18 @@ class RendererBackendVulkan : public RendererBackend {
                                  uint32_t offset) override;
   void updateDescriptorSetTexture(DescriptorSetHandle dsh, uint8_t binding, TextureHandle th) override;
   void bindDescriptorSet(DescriptorSetHandle dsh, uint8_t set) override;
+  void setPushConstants(const void* data, uint32_t size, uint32_t offset) override;
   VertexBufferHandle createVertexBuffer(std::initializer_list<VertexAttribute> list, uint64_t vertexCount) override;
   void assignVertexBufferData(VertexBufferHandle handle, uint8_t attributeIndex, BufferDataHandle dataHandle) override;
   void destroyVertexBuffer(VertexBufferHandle handle) override;
-  IndexBufferHandle createIndexBuffer(uint32_t byteSize) override;
+  IndexBufferHandle createIndexBuffer(uint32_t byteSize, IndexType type) override;
   void updateIndexBuffer(IndexBufferHandle handle, BufferDataDesc&& desc, uint32_t byteOffset) override;
   void destroyIndexBuffer(IndexBufferHandle handle) override;
   BufferDataHandle createBufferData(uint32_t size, BufferTargetBinding binding) override;
   void updateBufferData(BufferDataHandle handle, BufferDataDesc&& desc, uint32_t byteOffset) override;
   void destroyBufferData(BufferDataHandle handle) override;
   TextureHandle createTexture(uint32_t width, uint32_t height, uint8_t levels, TextureFormat format) override;
+  TextureHandle createTextureArray(uint32_t width, uint32_t height, uint8_t levels, uint32_t layers, TextureFormat format) override;
   void setTextureData(TextureHandle th,
                       uint32_t level,
                       uint32_t xoffset,
@@ -64,18 +84,23 @@ class RendererBackendVulkan : public RendererBackend {
                       const void* data) override;
   void destroyTexture(TextureHandle handle) override;
 
+  const VulkanHostAllocator* getHostAllocator() const { return hostAllocator.get(); }
+
  private:
   VulkanSwapChain createSwapChain();
   void createGraphicsPipeline(const ProgramData& data);
   VkShaderModule createShaderModule(const ByteArray& code);
 
  private:
-  struct VkAllocationCallbacks* vkAlloc = nullptr;
+  std::unique_ptr<VulkanHostAllocator> hostAllocator;
+  const VkAllocationCallbacks* vkAlloc = nullptr;
 
   math::vec2i frameBufferSize;
   VkInstance instance;
   VkSurfaceKHR surface;
+  PresentationConfig presentationConfig;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t maxUniformBlockSize = 0;
   VulkanSwapChain swapChain;
   VkDevice device = VK_NULL_HANDLE;
   VkQueue graphicsQueue = VK_NULL_HANDLE;
@@ -1,22 +1,105 @@
 #ifndef INCLUDE_ENJAM_SCENE_H_
 #define INCLUDE_ENJAM_SCENE_H_
 
+#include <enjam/defines.h>
+#include <cstdint>
+#include <enjam/math.h>
+#include <enjam/entity_registry.h>
+#include <enjam/bvh.h>
 #include <vector>
 
 namespace Enjam {
 
 class RenderPrimitive;
 
-class Scene {
+// Description of a point light, Scene::addLight makes it an entity with TransformComponent and LightComponent
+struct PointLight {
+  math::vec3f position { 0 }; // the light sits at the origin of its node when it follows one
+  math::vec3f color { 1 };
+  float intensity = 1;
+  float radius = 10;
+  int32_t node = -1;
+};
+
+struct Transform {
+  math::vec3f translation { 0 };
+  math::vec4f rotation { 0, 0, 0, 1 }; // unit quaternion xyzw
+  math::vec3f scale { 1 };
+
+  math::mat4f toMatrix() const;
+
+  // Shear is lost, the matrix is expected to be a composition of translation, rotation and scale
+  static Transform fromMatrix(const math::mat4f&);
+};
+
+class ENJAM_API Scene {
  public:
-  using PrimitivesContainer = std::vector<RenderPrimitive>;
+  using NodeIndex = int32_t;
+
+  static constexpr NodeIndex NO_NODE = -1;
+
+  // Renderable entities have TransformComponent, MeshComponent and MaterialComponent,
+  // the ones following a node also have SceneNodeComponent, the ones with bounds BoundsComponent.
+  // Lights have TransformComponent and LightComponent.
+  EntityRegistry& getEntities() { return entities; }
+  const EntityRegistry& getEntities() const { return entities; }
+
+  Entity addPrimitive(RenderPrimitive&);
+  void removePrimitive(Entity);
+  void clearPrimitives();
+
+  // Lights are moved with setTransform like the primitives
+  Entity addLight(const PointLight&);
+  void removeLight(Entity);
+
+  // Moves a primitive or a light that does not follow a node
+  void setTransform(Entity, const math::mat4f&);
+
+  // Spatial queries over the world bounds of the primitives, valid after updateSpatialIndex
+  void query(const Frustum&, std::vector<Entity>& result) const;
+  void query(const Aabb&, std::vector<Entity>& result) const;
+  void query(const Sphere&, std::vector<Entity>& result) const;
+  bool raycast(const Ray&, float maxDistance, Entity& entity, float& distance) const;
+
+  // Refits the BVH to the moved primitives, rebuilds it from time to time
+  void updateSpatialIndex() { bvh.commit(); }
+  const Bvh& getBvh() const { return bvh; }
+
+  // Nodes are kept in depth-first order, so a subtree is the contiguous range [node, node + subtree size).
+  // A node can only be added under the root or a node whose subtree ends at the last added node.
+  NodeIndex addNode(NodeIndex parent, const Transform& local = { });
+  void clearNodes();
+
+  void setLocalTransform(NodeIndex, const Transform&);
+  const Transform& getLocalTransform(NodeIndex node) const { return localTransforms[node]; }
+  const math::mat4f& getWorldTransform(NodeIndex node) const { return worldTransforms[node]; }
+
+  NodeIndex getParent(NodeIndex node) const { return parents[node]; }
+  uint32_t getSubtreeSize(NodeIndex node) const { return subtreeSizes[node]; }
+  uint32_t getNodesCount() const { return parents.size(); }
+
+  // Recomputes world transforms of the dirty subtrees only and copies them to the entities following the nodes,
+  // returns the number of updated nodes
+  uint32_t updateTransforms();
+
+ private:
+  template<class Shape>
+  void queryEntities(const Shape&, std::vector<Entity>& result) const;
 
-  PrimitivesContainer& getPrimitives() { return primitives; }
-  const PrimitivesContainer& getPrimitives() const { return primitives; }
+  // Drops the entity from the followers of its node
+  void unfollowNode(Entity);
 
  private:
-  PrimitivesContainer primitives;
+  EntityRegistry entities;
+  Bvh bvh; // user data is the entity index
 
+  std::vector<Transform> localTransforms;
+  std::vector<math::mat4f> worldTransforms;
+  std::vector<NodeIndex> parents;
+  std::vector<uint32_t> subtreeSizes;
+  std::vector<NodeIndex> dirtyNodes;
+  std::vector<uint8_t> dirtyFlags;
+  std::vector<std::vector<Entity>> nodeEntities; // entities following each node
 };
 
 }
@@ -3,6 +3,7 @@
 
 #include <enjam/renderer_backend.h>
 #include <enjam/assets_manager.h>
+#include <enjam/texture_table.h>
 
 namespace Enjam {
 
@@ -13,30 +14,49 @@ class Texture {
     handle = backend.createTexture(width, height, 1, Enjam::TextureFormat::RGB8);
   }
 
+  // Texture stored in a layer of a shared texture array
+  Texture(RendererBackend& backend, TextureTable& table, int width, int height)
+      : backend(backend), table(&table), width(width), height(height) {
+    auto slot = table.allocate(width, height, 1, Enjam::TextureFormat::RGB8);
+    handle = slot.handle;
+    layer = slot.layer;
+  }
+
   ~Texture() {
-    backend.destroyTexture(handle);
+    if(table) {
+      table->free({ handle, layer });
+    } else {
+      backend.destroyTexture(handle);
+    }
   }
 
   void setBuffer(const void* data) {
-    backend.setTextureData(handle, 0, 0, 0, 0, width, height, 0, data);
+    backend.setTextureData(handle, 0, 0, 0, layer, width, height, 1, data);
   }
 
   [[nodiscard]] const TextureHandle& getHandle() const { return handle; }
+  [[nodiscard]] uint32_t getLayer() const { return layer; }
 
  private:
   RendererBackend& backend;
+  TextureTable* table = nullptr;
   TextureHandle handle;
+  uint32_t layer = 0;
   int width;
   int height;
 };
 
 struct TextureAssetFactory {
+  TextureTable* textureTable = nullptr; // textures get their own GL texture when not set
+
   AssetRef<Texture> operator()(const Asset& asset, RendererBackend& rendererBackend) {
     auto width = asset.at("width")->as<int>();
     auto height = asset.at("height")->as<int>();
     auto buffer = asset.at("data")->loadBuffer();
 
-    auto ptr = std::make_shared<Texture>(rendererBackend, width, height);
+    auto ptr = textureTable
+        ? std::make_shared<Texture>(rendererBackend, *textureTable, width, height)
+        : std::make_shared<Texture>(rendererBackend, width, height);
     ptr->setBuffer(buffer.data());
     return ptr;
   }
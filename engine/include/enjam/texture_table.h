@@ -0,0 +1,48 @@
+#ifndef INCLUDE_ENJAM_TEXTURE_TABLE_H_
+#define INCLUDE_ENJAM_TEXTURE_TABLE_H_
+
+#include <enjam/defines.h>
+#include <enjam/renderer_backend.h>
+#include <vector>
+
+namespace Enjam {
+
+struct TextureSlot {
+  TextureHandle handle; // texture array the slot lives in
+  uint32_t layer = 0;
+
+  bool isValid() const { return bool(handle); }
+};
+
+// Textures of the same size and format share 2D texture arrays and are addressed by layer.
+// Objects sampling different textures of one array can be drawn with the same descriptor set.
+class ENJAM_API TextureTable final {
+ public:
+  static constexpr uint32_t LAYERS_PER_ARRAY = 64;
+
+  explicit TextureTable(RendererBackend& backend) : backend(backend) { }
+
+  TextureSlot allocate(uint32_t width, uint32_t height, uint8_t levels, TextureFormat format);
+  void free(const TextureSlot&);
+  void setData(const TextureSlot&, uint32_t level, uint32_t width, uint32_t height, const void* data);
+  void destroy();
+
+  uint32_t getArraysCount() const { return arrays.size(); }
+
+ private:
+  struct TextureArray {
+    TextureHandle handle;
+    uint32_t width;
+    uint32_t height;
+    uint8_t levels;
+    TextureFormat format;
+    std::vector<uint32_t> freeLayers;
+  };
+
+  RendererBackend& backend;
+  std::vector<TextureArray> arrays;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_TEXTURE_TABLE_H_
@@ -0,0 +1,56 @@
+#ifndef INCLUDE_ENJAM_THREAD_POOL_H_
+#define INCLUDE_ENJAM_THREAD_POOL_H_
+
+#include <enjam/defines.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Enjam {
+
+// Worker threads for data parallel loops. The calling thread works on the loop too,
+// so a pool without workers runs everything inline.
+class ENJAM_API ThreadPool final {
+ public:
+  // One worker less than the hardware threads by default, the caller is the last one
+  explicit ThreadPool(uint32_t workersCount = getDefaultWorkersCount());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Calls f(index) for every index in [0, count) and returns when all the calls are done.
+  // Loops are run one at a time, a parallelFor called from inside f runs inline.
+  void parallelFor(uint32_t count, const std::function<void(uint32_t)>& f);
+
+  uint32_t getThreadsCount() const { return workers.size() + 1; }
+
+  static uint32_t getDefaultWorkersCount();
+
+ private:
+  void workerLoop();
+  void runIndices();
+
+ private:
+  std::vector<std::thread> workers;
+  std::mutex loopMutex;
+
+  std::mutex mutex;
+  std::condition_variable wakeCondition;
+  std::condition_variable doneCondition;
+  uint64_t generation = 0;
+  uint32_t activeWorkers = 0;
+  bool stopping = false;
+
+  const std::function<void(uint32_t)>* function = nullptr;
+  uint32_t indicesCount = 0;
+  std::atomic<uint32_t> nextIndex = 0;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_THREAD_POOL_H_
@@ -0,0 +1,238 @@
+#ifndef INCLUDE_ENJAM_VERTEX_FORMAT_H_
+#define INCLUDE_ENJAM_VERTEX_FORMAT_H_
+
+#include <enjam/math.h>
+#include <enjam/renderer_backend.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace Enjam {
+
+// Encoding of the vertex streams of an imported mesh. Streams are uploaded as they are stored,
+// the vertex attributes decode them when they are fetched.
+// The drawn attributes are position, texture coordinates 0, normal and tangent, in that order. They are either
+// in a stream each or interleaved in a single one, so a vertex fetch touches one cache line instead of four.
+struct VertexFormat {
+  enum class Layout : uint8_t {
+    SEPARATE,
+    INTERLEAVED
+  };
+
+  enum class Position : uint8_t {
+    FLOAT3,
+    UNORM16 // x, y, z and padding, relative to the bounds, see getPositionDecode
+  };
+
+  enum class TexCoord : uint8_t {
+    FLOAT2,
+    HALF2,
+    UNORM16 // coordinates in [0, 1] only
+  };
+
+  static constexpr uint8_t NORMAL_SIZE = 4;
+  static constexpr uint8_t TANGENT_SIZE = 4;
+
+  Layout layout = Layout::SEPARATE;
+  Position positions = Position::FLOAT3;
+  TexCoord texCoords = TexCoord::FLOAT2;
+  // position = positionOffset + encoded * positionScale, the scale is the same on every axis
+  // so normals transformed by the model matrix stay perpendicular to the surface
+  math::vec3f positionOffset { 0.0f };
+  float positionScale = 1;
+
+  // Sizes of the encoded attributes, the strides of their streams in the separate layout
+  uint8_t getPositionStride() const { return positions == Position::FLOAT3 ? 12 : 8; }
+  uint8_t getTexCoordStride() const { return texCoords == TexCoord::FLOAT2 ? 8 : 4; }
+
+  // Size of a vertex of the drawn attributes, the stride of the interleaved stream
+  uint8_t getVertexStride() const { return getPositionStride() + getTexCoordStride() + NORMAL_SIZE + TANGENT_SIZE; }
+
+  uint32_t getStreamsCount() const { return layout == Layout::INTERLEAVED ? 1 : 4; }
+  uint8_t getStreamStride(uint32_t stream) const {
+    if(layout == Layout::INTERLEAVED) {
+      return getVertexStride();
+    }
+    const uint8_t strides[] = { getPositionStride(), getTexCoordStride(), NORMAL_SIZE, TANGENT_SIZE };
+    return strides[stream];
+  }
+
+  // Attributes with a zero offset start a stream, see GeometryPool
+  VertexAttribute getPositionAttribute() const {
+    return positions == Position::FLOAT3
+        ? VertexAttribute { .type = VertexAttributeType::FLOAT3, .stride = getStreamStride(0) }
+        : VertexAttribute { .type = VertexAttributeType::USHORT3, .flags = VertexAttribute::FLAG_NORMALIZED, .stride = getStreamStride(0) };
+  }
+
+  VertexAttribute getTexCoordAttribute() const {
+    auto offset = getAttributeOffset(1);
+    auto stride = getStreamStride(1);
+    switch(texCoords) {
+      case TexCoord::HALF2: return { .type = VertexAttributeType::HALF2, .offset = offset, .stride = stride };
+      case TexCoord::UNORM16: return { .type = VertexAttributeType::USHORT2, .flags = VertexAttribute::FLAG_NORMALIZED, .offset = offset, .stride = stride };
+      default: return { .type = VertexAttributeType::FLOAT2, .offset = offset, .stride = stride };
+    }
+  }
+
+  // Octahedral snorm16
+  VertexAttribute getNormalAttribute() const {
+    return { .type = VertexAttributeType::SHORT2, .flags = VertexAttribute::FLAG_NORMALIZED, .offset = getAttributeOffset(2), .stride = getStreamStride(2) };
+  }
+
+  // Octahedral snorm16 with the bitangent sign in the lowest bit of y. Not normalized, the shader divides
+  // by 32767 itself once it read the bit.
+  VertexAttribute getTangentAttribute() const {
+    return { .type = VertexAttributeType::SHORT2, .offset = getAttributeOffset(3), .stride = getStreamStride(3) };
+  }
+
+  // Offset and scale of the positions, given to the shader by RenderPrimitive::setPositionDecode
+  math::vec4f getPositionDecode() const { return math::vec4f { positionOffset, positionScale }; }
+
+  math::vec3f decodePosition(const uint8_t* data) const;
+
+  bool operator==(const VertexFormat& other) const {
+    return layout == other.layout && positions == other.positions && texCoords == other.texCoords
+        && positionOffset.x == other.positionOffset.x && positionOffset.y == other.positionOffset.y
+        && positionOffset.z == other.positionOffset.z && positionScale == other.positionScale;
+  }
+
+ private:
+  // in the stream of the attribute
+  uint32_t getAttributeOffset(uint32_t attribute) const {
+    if(layout == Layout::SEPARATE) {
+      return 0;
+    }
+    const uint32_t offsets[] = { 0, getPositionStride(), uint32_t(getPositionStride() + getTexCoordStride()),
+                                 uint32_t(getPositionStride() + getTexCoordStride() + NORMAL_SIZE) };
+    return offsets[attribute];
+  }
+};
+
+inline int16_t toSnorm16(float value) {
+  return int16_t(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline float fromSnorm16(int16_t value) {
+  return std::max(float(value) / 32767.0f, -1.0f);
+}
+
+inline uint16_t toUnorm16(float value) {
+  return uint16_t(std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+inline float fromUnorm16(uint16_t value) {
+  return float(value) / 65535.0f;
+}
+
+// IEEE 754 binary16, rounded to nearest even
+inline uint16_t toHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  auto sign = uint16_t((bits >> 16) & 0x8000);
+  auto floatExponent = (bits >> 23) & 0xff;
+  auto mantissa = bits & 0x7fffff;
+
+  if(floatExponent == 0xff) {
+    return sign | 0x7c00 | (mantissa ? 0x200 : 0); // infinity or NaN
+  }
+  auto exponent = int32_t(floatExponent) - 127 + 15;
+  if(exponent >= 31) {
+    return sign | 0x7c00;
+  }
+
+  uint32_t half, rest, halfway;
+  if(exponent <= 0) {
+    if(exponent < -10) {
+      return sign;
+    }
+    auto shift = uint32_t(14 - exponent);
+    mantissa |= 0x800000;
+    half = mantissa >> shift;
+    rest = mantissa & ((1u << shift) - 1);
+    halfway = 1u << (shift - 1);
+  } else {
+    half = uint32_t(exponent) << 10 | mantissa >> 13;
+    rest = mantissa & 0x1fff;
+    halfway = 0x1000;
+  }
+  // a carry out of the mantissa rounds up to the next exponent
+  if(rest > halfway || (rest == halfway && (half & 1))) {
+    half++;
+  }
+  return uint16_t(sign | half);
+}
+
+inline float fromHalf(uint16_t half) {
+  auto sign = uint32_t(half & 0x8000) << 16;
+  auto exponent = uint32_t(half >> 10) & 0x1f;
+  auto mantissa = uint32_t(half & 0x3ff);
+
+  if(exponent == 0) {
+    auto value = std::ldexp(float(mantissa), -24);
+    return sign ? -value : value;
+  }
+  auto bits = exponent == 31
+      ? sign | 0x7f800000 | mantissa << 13
+      : sign | (exponent + 127 - 15) << 23 | mantissa << 13;
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Unit vector folded onto the octahedron |x| + |y| + |z| = 1, whose lower half is unfolded over the corners
+inline std::array<int16_t, 2> encodeOctahedral(const math::vec3f& vector) {
+  auto sum = std::abs(vector.x) + std::abs(vector.y) + std::abs(vector.z);
+  if(sum == 0) {
+    return { 0, 0 };
+  }
+  auto x = vector.x / sum;
+  auto y = vector.y / sum;
+  if(vector.z < 0) {
+    auto foldedX = (1 - std::abs(y)) * (x >= 0 ? 1.0f : -1.0f);
+    auto foldedY = (1 - std::abs(x)) * (y >= 0 ? 1.0f : -1.0f);
+    x = foldedX;
+    y = foldedY;
+  }
+  return { toSnorm16(x), toSnorm16(y) };
+}
+
+inline math::vec3f decodeOctahedral(int16_t encodedX, int16_t encodedY) {
+  auto x = fromSnorm16(encodedX);
+  auto y = fromSnorm16(encodedY);
+  auto z = 1 - std::abs(x) - std::abs(y);
+  auto fold = std::max(-z, 0.0f);
+  x += x >= 0 ? -fold : fold;
+  y += y >= 0 ? -fold : fold;
+  return normalize(math::vec3f { x, y, z });
+}
+
+// bitangentSign is the w of the tangent, negative for mirrored texture coordinates
+inline std::array<int16_t, 2> encodeTangent(const math::vec3f& tangent, float bitangentSign) {
+  auto encoded = encodeOctahedral(tangent);
+  encoded[1] = int16_t((encoded[1] & ~1) | (bitangentSign < 0 ? 1 : 0));
+  return encoded;
+}
+
+inline math::vec3f decodeTangent(const std::array<int16_t, 2>& encoded, float& bitangentSign) {
+  bitangentSign = (encoded[1] & 1) ? -1.0f : 1.0f;
+  return decodeOctahedral(encoded[0], encoded[1]);
+}
+
+inline math::vec3f VertexFormat::decodePosition(const uint8_t* data) const {
+  if(positions == Position::FLOAT3) {
+    math::vec3f position;
+    std::memcpy(&position, data, sizeof(position));
+    return position;
+  }
+  uint16_t encoded[3];
+  std::memcpy(encoded, data, sizeof(encoded));
+  return positionOffset + math::vec3f {
+      fromUnorm16(encoded[0]), fromUnorm16(encoded[1]), fromUnorm16(encoded[2])
+  } * positionScale;
+}
+
+}
+
+#endif //INCLUDE_ENJAM_VERTEX_FORMAT_H_
@@ -0,0 +1,107 @@
+#ifndef ENGINE_INCLUDE_ENJAM_VULKAN_ALLOCATOR_H_
+#define ENGINE_INCLUDE_ENJAM_VULKAN_ALLOCATOR_H_
+
+#include <enjam/defines.h>
+#include <vulkan/vulkan.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Enjam {
+
+// Thread-safe pool of fixed size blocks, grows by chunks and keeps them until destroyed
+class SmallObjectPool final {
+ public:
+  static constexpr size_t SIZE_CLASSES_COUNT = 6;
+  static constexpr size_t MIN_BLOCK_SIZE = 32;
+  static constexpr size_t MAX_BLOCK_SIZE = MIN_BLOCK_SIZE << (SIZE_CLASSES_COUNT - 1);
+  static constexpr size_t CHUNK_SIZE = 64 * 1024;
+  static constexpr size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+  static constexpr uint8_t NO_SIZE_CLASS = UINT8_MAX;
+
+  SmallObjectPool() = default;
+  ~SmallObjectPool();
+
+  SmallObjectPool(const SmallObjectPool&) = delete;
+  SmallObjectPool& operator=(const SmallObjectPool&) = delete;
+
+  static uint8_t sizeClass(size_t size);
+  static size_t blockSize(uint8_t sizeClass) { return MIN_BLOCK_SIZE << sizeClass; }
+
+  void* alloc(uint8_t sizeClass);
+  void free(void* block, uint8_t sizeClass);
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct SizeClass {
+    std::mutex mutex;
+    FreeBlock* freeList = nullptr;
+    std::vector<void*> chunks;
+  };
+
+  std::array<SizeClass, SIZE_CLASSES_COUNT> sizeClasses;
+};
+
+// VkAllocationCallbacks backed by the engine allocator. Tracks bytes and counts per VkSystemAllocationScope
+// and serves the frequent small driver allocations from a SmallObjectPool.
+class ENJAM_API VulkanHostAllocator final {
+ public:
+  static constexpr size_t SCOPES_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+  struct ScopeStats {
+    uint64_t liveBytes = 0;
+    uint64_t liveAllocations = 0;
+    uint64_t totalAllocations = 0;
+    uint64_t pooledAllocations = 0;
+    uint64_t internalBytes = 0;
+  };
+
+  using Stats = std::array<ScopeStats, SCOPES_COUNT>;
+
+  VulkanHostAllocator();
+
+  VulkanHostAllocator(const VulkanHostAllocator&) = delete;
+  VulkanHostAllocator& operator=(const VulkanHostAllocator&) = delete;
+
+  const VkAllocationCallbacks* getCallbacks() const { return &callbacks; }
+  Stats getStats() const;
+  void logStats() const;
+
+  void* alloc(size_t size, size_t alignment, VkSystemAllocationScope scope);
+  void* realloc(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+  void free(void* memory);
+
+ private:
+  struct AllocationHeader;
+
+  struct AtomicScopeStats {
+    std::atomic<uint64_t> liveBytes = 0;
+    std::atomic<uint64_t> liveAllocations = 0;
+    std::atomic<uint64_t> totalAllocations = 0;
+    std::atomic<uint64_t> pooledAllocations = 0;
+    std::atomic<uint64_t> internalBytes = 0;
+  };
+
+  static AllocationHeader* getHeader(void* memory);
+
+  static void* VKAPI_PTR allocCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+  static void* VKAPI_PTR reallocCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+  static void VKAPI_PTR freeCallback(void* userData, void* memory);
+  static void VKAPI_PTR internalAllocCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope);
+  static void VKAPI_PTR internalFreeCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope);
+
+ private:
+  VkAllocationCallbacks callbacks;
+  SmallObjectPool pool;
+  std::array<AtomicScopeStats, SCOPES_COUNT> stats;
+};
+
+}
+
+#endif //ENGINE_INCLUDE_ENJAM_VULKAN_ALLOCATOR_H_
@@ -0,0 +1,56 @@
+#ifndef INCLUDE_ENJAM_WORLD_ASSET_H_
+#define INCLUDE_ENJAM_WORLD_ASSET_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <enjam/assets_manager.h>
+#include <enjam/bounds.h>
+#include <enjam/math_assetparser.h>
+
+namespace Enjam {
+
+// Scene split by dcc_importer -cells into a grid of cells on the XZ plane, each one stored as its own DCC asset
+class WorldAsset {
+ public:
+  struct Cell {
+    int32_t x;
+    int32_t z;
+    std::string path; // of the cell DCC asset
+    Aabb bounds; // world bounds of the cell meshes
+    uint64_t size; // bytes of the cell geometry
+  };
+
+ public:
+  WorldAsset(float cellSize, std::vector<Cell> cells) : cellSize(cellSize), cells(std::move(cells)) { }
+
+  float getCellSize() const { return cellSize; }
+  const std::vector<Cell>& getCells() const { return cells; }
+
+ private:
+  float cellSize;
+  std::vector<Cell> cells;
+};
+
+class WorldAssetFactory {
+ public:
+  AssetRef<WorldAsset> operator()(const Asset& asset) {
+    std::vector<WorldAsset::Cell> cells;
+    for(auto& assetCell : *asset.at("cells")) {
+      cells.push_back({
+          .x = assetCell.at("x")->as<int32_t>(),
+          .z = assetCell.at("z")->as<int32_t>(),
+          .path = assetCell.at("path")->as<std::string>(),
+          .bounds = Aabb { .min = assetCell.at("min")->as<math::vec3f>(), .max = assetCell.at("max")->as<math::vec3f>() },
+          .size = assetCell.at("size")->as<uint64_t>(),
+      });
+    }
+
+    return std::make_shared<WorldAsset>(asset.at("cellSize")->as<float>(), std::move(cells));
+  }
+};
+
+}
+
+#endif //INCLUDE_ENJAM_WORLD_ASSET_H_
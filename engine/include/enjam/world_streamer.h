@@ -0,0 +1,164 @@
+#ifndef INCLUDE_ENJAM_WORLD_STREAMER_H_
+#define INCLUDE_ENJAM_WORLD_STREAMER_H_
+
+#include <enjam/defines.h>
+#include <enjam/dcc_asset.h>
+#include <enjam/entity_registry.h>
+#include <enjam/geometry_pool.h>
+#include <enjam/world_asset.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Enjam {
+
+class MaterialInstance;
+class Scene;
+
+// Keeps the cells of a WorldAsset around the camera resident in a Scene.
+// Cell assets are read and prepared on a streaming thread. Their geometry is uploaded to the GeometryPool
+// in slices on the main thread, within a byte and a time budget per frame.
+// The pool streams are expected to be positions, texture coordinates, normals and tangents in the vertex format
+// of the cells, the cells in another format fail to load.
+class ENJAM_API WorldStreamer final {
+ public:
+  // Reads a cell asset, called on the streaming thread
+  using CellLoader = std::function<AssetRef<DCCAsset>(const std::string& path)>;
+
+  struct Config {
+    float loadRadius = 100; // cells closer than this to the camera are loaded
+    float unloadRadius = 150; // and unloaded once they are farther than this
+    uint64_t memoryBudget = 256ull << 20; // bytes of geometry of the loading and resident cells
+    uint64_t uploadBudget = 4ull << 20; // bytes uploaded per frame
+    float frameBudgetMs = 2; // time update may take
+    uint32_t maxLoadingCells = 4; // read at once by the streaming thread
+  };
+
+  enum class CellState : uint8_t {
+    UNLOADED,
+    LOADING, // on the streaming thread
+    UPLOADING, // geometry and primitives are added over several frames
+    RESIDENT,
+    FAILED // the asset could not be read, it is not requested again
+  };
+
+  struct Stats {
+    uint32_t loadingCells = 0;
+    uint32_t uploadingCells = 0;
+    uint32_t residentCells = 0;
+    uint64_t memoryUsed = 0; // bytes of the loading, uploading and resident cells
+    // of the last update
+    uint64_t uploadedBytes = 0;
+    uint32_t unloadedCells = 0;
+    uint32_t deferredCells = 0; // in reach but over the memory budget
+    float updateMs = 0;
+  };
+
+ public:
+  WorldStreamer(Scene&, GeometryPool&, AssetRef<WorldAsset>, CellLoader, const Config&);
+  ~WorldStreamer();
+
+  WorldStreamer(const WorldStreamer&) = delete;
+  WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+  // Material of the primitives of the cells added from now on
+  void setMaterial(MaterialInstance* instance, uint32_t index) {
+    materialInstance = instance;
+    materialIndex = index;
+  }
+
+  // Unloads the cells out of reach, requests the ones in reach and continues the uploads, called once per frame
+  void update(RendererBackend&, const math::vec3f& cameraPosition);
+
+  // Removes the cells from the scene and frees their geometry, the ones still loading are dropped when they arrive
+  void unloadAll();
+
+  CellState getCellState(uint32_t cell) const { return cells[cell].state; }
+  const Stats& getStats() const { return stats; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Primitive {
+    math::mat4f transform;
+    Aabb bounds; // local
+    const DCCAsset::Mesh* mesh;
+    std::shared_ptr<const OccluderMesh> occluder;
+    std::shared_ptr<const std::vector<Meshlet>> meshlets;
+  };
+
+  // Cell asset with its nodes flattened into primitives, made on the streaming thread
+  struct LoadedCell {
+    uint32_t cell;
+    AssetRef<DCCAsset> asset;
+    std::vector<Primitive> primitives;
+  };
+
+  // vertex streams of the asset go to the pool stream of the same index, one after the other
+  enum class UploadStep : uint8_t {
+    VERTICES,
+    INDICES,
+    INDICES16,
+    PRIMITIVES
+  };
+
+  struct Cell {
+    CellState state = CellState::UNLOADED;
+    bool cancelled = false; // went out of reach while loading
+    uint64_t size = 0;
+    float distance = 0; // to the camera on the last update
+
+    // kept until the upload is done
+    AssetRef<DCCAsset> asset;
+    std::vector<Primitive> primitives;
+    UploadStep step = UploadStep::VERTICES;
+    uint8_t stream = 0; // of the VERTICES step
+    uint32_t stepOffset = 0; // elements of the step already done
+
+    GeometryRange geometry;
+    std::vector<Entity> entities;
+  };
+
+  void streamingLoop();
+  void receiveLoadedCells();
+  void requestCells();
+  bool upload(RendererBackend&, Cell&, Clock::time_point deadline, uint64_t& uploadBudget);
+  void unload(Cell&);
+
+  static LoadedCell prepare(uint32_t cell, AssetRef<DCCAsset>);
+
+ private:
+  // upload slices are small enough for the time budget to be checked often
+  static constexpr uint64_t MAX_SLICE_SIZE = 256 * 1024;
+
+  Scene& scene;
+  GeometryPool& geometryPool;
+  AssetRef<WorldAsset> world;
+  CellLoader loader;
+  Config config;
+
+  MaterialInstance* materialInstance = nullptr;
+  uint32_t materialIndex = 0;
+
+  std::vector<Cell> cells;
+  std::vector<uint32_t> order; // cells by distance to the camera
+  Stats stats;
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<uint32_t> requests;
+  std::vector<LoadedCell> loadedCells;
+  std::vector<LoadedCell> receivedCells;
+  bool stopping = false;
+};
+
+}
+
+#endif //INCLUDE_ENJAM_WORLD_STREAMER_H_
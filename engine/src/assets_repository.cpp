@@ -34,6 +34,7 @@ void AssetsFilesystemRep::save(const Path& path, const Asset& asset) {
   }
 
   std::ofstream file(fullPath);
+  savedFiles.push_back(fullPath);
   AssetFileOutput output {
     .out = file,
     .buffers = [this, path](uint64_t hash) -> std::unique_ptr<std::ostream> {
@@ -85,6 +86,7 @@ std::unique_ptr<std::ostream> AssetsFilesystemRep::getBufferOutput(const Path& a
     ENJAM_ERROR("Saving buffer failed {}", path.c_str());
     return { };
   }
+  savedFiles.push_back(path);
   return file;
 }
 
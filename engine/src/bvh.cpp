@@ -0,0 +1,566 @@
+#include <enjam/bvh.h>
+#include <enjam/assert.h>
+#include <algorithm>
+
+namespace Enjam {
+
+namespace {
+
+constexpr uint32_t SAH_BINS_COUNT = 16;
+constexpr uint32_t STACK_SIZE = 256;
+
+// Lanes of a node that are outside the shape, and the ones entirely inside it
+struct LanesTest {
+  bool outside[Bvh::WIDTH] = { };
+  bool inside[Bvh::WIDTH] = { };
+};
+
+template<class Node>
+LanesTest testLanes(const Node& node, const Frustum& frustum) {
+  LanesTest test;
+  bool partial[Bvh::WIDTH] = { };
+  for(auto& plane : frustum.planes) {
+    auto px = plane.x > 0 ? node.maxX : node.minX, nx = plane.x > 0 ? node.minX : node.maxX;
+    auto py = plane.y > 0 ? node.maxY : node.minY, ny = plane.y > 0 ? node.minY : node.maxY;
+    auto pz = plane.z > 0 ? node.maxZ : node.minZ, nz = plane.z > 0 ? node.minZ : node.maxZ;
+    for(uint32_t k = 0; k < Bvh::WIDTH; k++) {
+      test.outside[k] |= plane.x * px[k] + plane.y * py[k] + plane.z * pz[k] + plane.w < 0;
+      partial[k] |= plane.x * nx[k] + plane.y * ny[k] + plane.z * nz[k] + plane.w < 0;
+    }
+  }
+  for(uint32_t k = 0; k < Bvh::WIDTH; k++) {
+    test.inside[k] = !partial[k];
+  }
+  return test;
+}
+
+template<class Node>
+LanesTest testLanes(const Node& node, const Aabb& box) {
+  LanesTest test;
+  for(uint32_t k = 0; k < Bvh::WIDTH; k++) {
+    test.outside[k] = node.minX[k] > box.max.x || node.maxX[k] < box.min.x
+        || node.minY[k] > box.max.y || node.maxY[k] < box.min.y
+        || node.minZ[k] > box.max.z || node.maxZ[k] < box.min.z;
+    test.inside[k] = node.minX[k] >= box.min.x && node.maxX[k] <= box.max.x
+        && node.minY[k] >= box.min.y && node.maxY[k] <= box.max.y
+        && node.minZ[k] >= box.min.z && node.maxZ[k] <= box.max.z;
+  }
+  return test;
+}
+
+template<class Node>
+LanesTest testLanes(const Node& node, const Sphere& sphere) {
+  LanesTest test;
+  auto& c = sphere.center;
+  auto radiusSquared = sphere.radius * sphere.radius;
+  for(uint32_t k = 0; k < Bvh::WIDTH; k++) {
+    auto dx = std::max(std::max(node.minX[k] - c.x, c.x - node.maxX[k]), 0.0f);
+    auto dy = std::max(std::max(node.minY[k] - c.y, c.y - node.maxY[k]), 0.0f);
+    auto dz = std::max(std::max(node.minZ[k] - c.z, c.z - node.maxZ[k]), 0.0f);
+    test.outside[k] = dx * dx + dy * dy + dz * dz > radiusSquared;
+
+    auto fx = std::max(c.x - node.minX[k], node.maxX[k] - c.x);
+    auto fy = std::max(c.y - node.minY[k], node.maxY[k] - c.y);
+    auto fz = std::max(c.z - node.minZ[k], node.maxZ[k] - c.z);
+    test.inside[k] = fx * fx + fy * fy + fz * fz <= radiusSquared;
+  }
+  return test;
+}
+
+bool overlaps(const Frustum& frustum, const Aabb& box) { return frustum.intersects(box); }
+bool overlaps(const Aabb& query, const Aabb& box) { return query.intersects(box); }
+bool overlaps(const Sphere& sphere, const Aabb& box) { return sphere.intersects(box); }
+
+}
+
+Aabb Bvh::Node::getSlotBounds(uint32_t slot) const {
+  return Aabb {
+      .min = { minX[slot], minY[slot], minZ[slot] },
+      .max = { maxX[slot], maxY[slot], maxZ[slot] }
+  };
+}
+
+void Bvh::Node::setSlotBounds(uint32_t slot, const Aabb& bounds) {
+  minX[slot] = bounds.min.x;
+  minY[slot] = bounds.min.y;
+  minZ[slot] = bounds.min.z;
+  maxX[slot] = bounds.max.x;
+  maxY[slot] = bounds.max.y;
+  maxZ[slot] = bounds.max.z;
+}
+
+uint32_t Bvh::insert(const Aabb& bounds, uint32_t userData) {
+  uint32_t proxy;
+  if(!freeProxies.empty()) {
+    proxy = freeProxies.back();
+    freeProxies.pop_back();
+  } else {
+    proxy = proxyBounds.size();
+    proxyBounds.emplace_back();
+    proxyUserData.emplace_back();
+    proxyNodes.emplace_back();
+    proxyPositions.emplace_back();
+    proxyFlags.emplace_back();
+  }
+
+  proxyBounds[proxy] = bounds;
+  proxyUserData[proxy] = userData;
+  proxyNodes[proxy] = NO_NODE;
+  proxyFlags[proxy] = PROXY_ALIVE;
+  pendingProxies.push_back(proxy);
+  proxiesCount++;
+  return proxy;
+}
+
+void Bvh::remove(uint32_t proxy) {
+  ENJAM_ASSERT(proxyFlags[proxy] & PROXY_ALIVE);
+
+  if(proxyFlags[proxy] & PROXY_IN_TREE) {
+    // the tree still references the proxy, it can be reused only after the rebuild.
+    // Empty bounds never overlap anything, so the queries do not need to check the proxy is alive.
+    primitivesBounds[proxyPositions[proxy]] = Aabb { };
+    markDirty(proxyNodes[proxy]);
+    proxyFlags[proxy] = PROXY_IN_TREE;
+    removedCount++;
+    movedCount++;
+  } else {
+    auto it = std::find(pendingProxies.begin(), pendingProxies.end(), proxy);
+    *it = pendingProxies.back();
+    pendingProxies.pop_back();
+    proxyFlags[proxy] = 0;
+    freeProxies.push_back(proxy);
+  }
+
+  proxiesCount--;
+}
+
+void Bvh::update(uint32_t proxy, const Aabb& bounds) {
+  ENJAM_ASSERT(proxyFlags[proxy] & PROXY_ALIVE);
+  proxyBounds[proxy] = bounds;
+
+  if(proxyFlags[proxy] & PROXY_IN_TREE) {
+    primitivesBounds[proxyPositions[proxy]] = bounds;
+    markDirty(proxyNodes[proxy]);
+    movedCount++;
+  }
+}
+
+void Bvh::clear() {
+  nodes.clear();
+  primitives.clear();
+  primitivesBounds.clear();
+  primitivesUserData.clear();
+  proxyBounds.clear();
+  proxyUserData.clear();
+  proxyNodes.clear();
+  proxyPositions.clear();
+  proxyFlags.clear();
+  freeProxies.clear();
+  pendingProxies.clear();
+
+  proxiesCount = 0;
+  removedCount = 0;
+  movedCount = 0;
+  commitsSinceBuild = 0;
+  builtRootArea = 0;
+}
+
+void Bvh::commit() {
+  if(movedCount == 0 && pendingProxies.empty()) {
+    return;
+  }
+
+  commitsSinceBuild++;
+  if(needsRebuild()) {
+    build();
+    return;
+  }
+
+  if(movedCount > 0) {
+    refit();
+    movedCount = 0;
+
+    // objects moved apart since the build, the tree is too loose to be worth keeping.
+    // A tree built over degenerate bounds has no area to compare with, it waits for the rebuild interval.
+    Aabb rootBounds;
+    for(uint32_t k = 0; k < WIDTH; k++) {
+      rootBounds.expand(nodes[0].getSlotBounds(k));
+    }
+    if(builtRootArea > 0 && rootBounds.getSurfaceArea() > 2 * builtRootArea) {
+      build();
+    }
+  }
+}
+
+bool Bvh::needsRebuild() const {
+  if(nodes.empty()) {
+    return proxiesCount > 0;
+  }
+
+  auto threshold = std::max(32u, proxiesCount / 8);
+  return pendingProxies.size() > threshold
+      || removedCount > threshold
+      || commitsSinceBuild >= rebuildInterval;
+}
+
+void Bvh::build() {
+  nodes.clear();
+  buildPrimitives.clear();
+  pendingProxies.clear();
+
+  for(uint32_t proxy = 0; proxy < proxyFlags.size(); proxy++) {
+    if(proxyFlags[proxy] & PROXY_ALIVE) {
+      proxyFlags[proxy] = PROXY_ALIVE | PROXY_IN_TREE;
+      auto& bounds = proxyBounds[proxy];
+      buildPrimitives.push_back(BuildPrimitive { .bounds = bounds, .center = bounds.getCenter(), .proxy = proxy });
+    } else if(proxyFlags[proxy] & PROXY_IN_TREE) {
+      proxyFlags[proxy] = 0;
+      freeProxies.push_back(proxy);
+    }
+  }
+
+  removedCount = 0;
+  movedCount = 0;
+  commitsSinceBuild = 0;
+  builtRootArea = 0;
+  rebuildsCount++;
+
+  auto count = uint32_t(buildPrimitives.size());
+  if(count > 0) {
+    nodes.reserve(count / LEAF_SIZE + 1);
+    buildNode(0, count, NO_NODE);
+  }
+
+  primitives.resize(count);
+  primitivesBounds.resize(count);
+  primitivesUserData.resize(count);
+  for(uint32_t i = 0; i < count; i++) {
+    auto proxy = buildPrimitives[i].proxy;
+    primitives[i] = proxy;
+    primitivesBounds[i] = buildPrimitives[i].bounds;
+    primitivesUserData[i] = proxyUserData[proxy];
+    proxyPositions[proxy] = i;
+  }
+
+  builtRootArea = getRangeBounds(0, count).getSurfaceArea();
+  buildPrimitives.clear();
+}
+
+uint32_t Bvh::buildNode(uint32_t first, uint32_t count, uint32_t parent) {
+  struct Range {
+    uint32_t first;
+    uint32_t count;
+  };
+
+  // split the largest ranges until there is one per lane
+  Range ranges[WIDTH] = { { first, count } };
+  uint32_t rangesCount = 1;
+  while(rangesCount < WIDTH) {
+    int32_t largest = -1;
+    for(uint32_t i = 0; i < rangesCount; i++) {
+      if(ranges[i].count > LEAF_SIZE && (largest < 0 || ranges[i].count > ranges[largest].count)) {
+        largest = i;
+      }
+    }
+    if(largest < 0) {
+      break;
+    }
+
+    auto range = ranges[largest];
+    auto middle = split(range.first, range.count);
+    ranges[largest] = { range.first, middle - range.first };
+    ranges[rangesCount++] = { middle, range.first + range.count - middle };
+  }
+
+  auto index = uint32_t(nodes.size());
+  auto& node = nodes.emplace_back();
+  node.parent = parent;
+  node.dirty = 0;
+  for(uint32_t k = 0; k < WIDTH; k++) {
+    node.setSlotBounds(k, Aabb { });
+    node.child[k] = NO_NODE;
+    node.first[k] = 0;
+    node.count[k] = 0;
+  }
+
+  for(uint32_t k = 0; k < rangesCount; k++) {
+    auto range = ranges[k];
+    nodes[index].setSlotBounds(k, getBuildRangeBounds(range.first, range.count));
+    nodes[index].first[k] = range.first;
+    nodes[index].count[k] = range.count;
+
+    if(range.count <= LEAF_SIZE) {
+      for(auto i = range.first; i < range.first + range.count; i++) {
+        proxyNodes[buildPrimitives[i].proxy] = index;
+      }
+    } else {
+      // children are created after the parent, refit walks the nodes backwards
+      auto child = buildNode(range.first, range.count, index);
+      nodes[index].child[k] = child;
+    }
+  }
+
+  return index;
+}
+
+uint32_t Bvh::split(uint32_t first, uint32_t count) {
+  auto begin = buildPrimitives.begin() + first;
+  auto end = begin + count;
+
+  Aabb centroidBounds;
+  for(auto it = begin; it != end; ++it) {
+    centroidBounds.expand(it->center);
+  }
+
+  uint32_t axis = 0;
+  for(uint32_t i = 1; i < 3; i++) {
+    auto extent = centroidBounds.max[i] - centroidBounds.min[i];
+    if(extent > centroidBounds.max[axis] - centroidBounds.min[axis]) {
+      axis = i;
+    }
+  }
+
+  auto axisMin = centroidBounds.min[axis];
+  auto axisExtent = centroidBounds.max[axis] - axisMin;
+  if(axisExtent <= 0) {
+    return first + count / 2;
+  }
+
+  auto scale = SAH_BINS_COUNT / axisExtent * 0.9999f;
+  auto getBin = [&](const BuildPrimitive& primitive) {
+    auto bin = uint32_t((primitive.center[axis] - axisMin) * scale);
+    return std::min(bin, SAH_BINS_COUNT - 1);
+  };
+
+  Aabb bins[SAH_BINS_COUNT];
+  uint32_t binCounts[SAH_BINS_COUNT] = { };
+  for(auto it = begin; it != end; ++it) {
+    auto bin = getBin(*it);
+    bins[bin].expand(it->bounds);
+    binCounts[bin]++;
+  }
+
+  // cost of splitting after every bin, the area of the right side is swept from the end
+  float rightAreas[SAH_BINS_COUNT];
+  uint32_t rightCounts[SAH_BINS_COUNT];
+  Aabb right;
+  uint32_t rightCount = 0;
+  for(auto i = SAH_BINS_COUNT - 1; i > 0; i--) {
+    right.expand(bins[i]);
+    rightCount += binCounts[i];
+    rightAreas[i - 1] = right.getSurfaceArea();
+    rightCounts[i - 1] = rightCount;
+  }
+
+  Aabb left;
+  uint32_t leftCount = 0;
+  auto bestCost = FLT_MAX;
+  uint32_t bestSplit = 0;
+  for(uint32_t i = 0; i < SAH_BINS_COUNT - 1; i++) {
+    left.expand(bins[i]);
+    leftCount += binCounts[i];
+    auto cost = left.getSurfaceArea() * leftCount + rightAreas[i] * rightCounts[i];
+    if(leftCount > 0 && rightCounts[i] > 0 && cost < bestCost) {
+      bestCost = cost;
+      bestSplit = i;
+    }
+  }
+
+  auto middle = std::partition(begin, end, [&](const BuildPrimitive& primitive) { return getBin(primitive) <= bestSplit; });
+  if(middle == begin || middle == end) {
+    return first + count / 2;
+  }
+  return first + uint32_t(middle - begin);
+}
+
+Aabb Bvh::getBuildRangeBounds(uint32_t first, uint32_t count) const {
+  Aabb bounds;
+  for(auto i = first; i < first + count; i++) {
+    bounds.expand(buildPrimitives[i].bounds);
+  }
+  return bounds;
+}
+
+Aabb Bvh::getRangeBounds(uint32_t first, uint32_t count) const {
+  Aabb bounds;
+  for(auto i = first; i < first + count; i++) {
+    bounds.expand(primitivesBounds[i]);
+  }
+  return bounds;
+}
+
+void Bvh::markDirty(uint32_t node) {
+  while(node != NO_NODE && !nodes[node].dirty) {
+    nodes[node].dirty = 1;
+    node = nodes[node].parent;
+  }
+}
+
+void Bvh::refit() {
+  for(auto index = uint32_t(nodes.size()); index-- > 0;) {
+    auto& node = nodes[index];
+    if(!node.dirty) {
+      continue;
+    }
+
+    for(uint32_t k = 0; k < WIDTH; k++) {
+      if(node.count[k] == 0) {
+        continue;
+      }
+
+      if(node.child[k] == NO_NODE) {
+        node.setSlotBounds(k, getRangeBounds(node.first[k], node.count[k]));
+      } else {
+        auto& child = nodes[node.child[k]];
+        Aabb bounds;
+        for(uint32_t c = 0; c < WIDTH; c++) {
+          bounds.expand(child.getSlotBounds(c));
+        }
+        node.setSlotBounds(k, bounds);
+      }
+    }
+    node.dirty = 0;
+  }
+
+  refitsCount++;
+}
+
+void Bvh::appendRange(uint32_t first, uint32_t count, std::vector<uint32_t>& result) const {
+  if(removedCount == 0) {
+    result.insert(result.end(), primitivesUserData.begin() + first, primitivesUserData.begin() + first + count);
+    return;
+  }
+
+  for(auto i = first; i < first + count; i++) {
+    if(proxyFlags[primitives[i]] & PROXY_ALIVE) {
+      result.push_back(primitivesUserData[i]);
+    }
+  }
+}
+
+template<class Shape>
+void Bvh::queryShape(const Shape& shape, std::vector<uint32_t>& result) const {
+  for(auto proxy : pendingProxies) {
+    if(overlaps(shape, proxyBounds[proxy])) {
+      result.push_back(proxyUserData[proxy]);
+    }
+  }
+
+  if(nodes.empty()) {
+    return;
+  }
+
+  uint32_t stack[STACK_SIZE];
+  uint32_t stackSize = 0;
+  stack[stackSize++] = 0;
+
+  while(stackSize > 0) {
+    auto& node = nodes[stack[--stackSize]];
+    auto test = testLanes(node, shape);
+
+    for(uint32_t k = 0; k < WIDTH; k++) {
+      if(node.count[k] == 0 || test.outside[k]) {
+        continue;
+      }
+
+      if(test.inside[k]) {
+        appendRange(node.first[k], node.count[k], result);
+      } else if(node.child[k] == NO_NODE) {
+        for(auto i = node.first[k]; i < node.first[k] + node.count[k]; i++) {
+          if(overlaps(shape, primitivesBounds[i])) {
+            result.push_back(primitivesUserData[i]);
+          }
+        }
+      } else {
+        ENJAM_ASSERT(stackSize < STACK_SIZE);
+        stack[stackSize++] = node.child[k];
+      }
+    }
+  }
+}
+
+void Bvh::query(const Frustum& frustum, std::vector<uint32_t>& result) const {
+  queryShape(frustum, result);
+}
+
+void Bvh::query(const Aabb& box, std::vector<uint32_t>& result) const {
+  queryShape(box, result);
+}
+
+void Bvh::query(const Sphere& sphere, std::vector<uint32_t>& result) const {
+  queryShape(sphere, result);
+}
+
+bool Bvh::raycast(const Ray& ray, float maxDistance, RayHit& hit) const {
+  auto closest = maxDistance;
+  auto found = false;
+
+  auto testProxy = [&](uint32_t proxy) {
+    auto distance = ray.intersect(proxyBounds[proxy], closest);
+    if(distance >= 0) {
+      closest = distance;
+      hit = RayHit { .userData = proxyUserData[proxy], .distance = distance };
+      found = true;
+    }
+  };
+
+  for(auto proxy : pendingProxies) {
+    testProxy(proxy);
+  }
+
+  if(nodes.empty()) {
+    return found;
+  }
+
+  math::vec3f inverse { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+  auto& origin = ray.origin;
+  auto& direction = ray.direction;
+
+  uint32_t stack[STACK_SIZE];
+  uint32_t stackSize = 0;
+  stack[stackSize++] = 0;
+
+  while(stackSize > 0) {
+    auto& node = nodes[stack[--stackSize]];
+
+    float entry[WIDTH];
+    for(uint32_t k = 0; k < WIDTH; k++) {
+      float tMin = 0, tMax = closest;
+      Ray::clipSlab(node.minX[k], node.maxX[k], origin.x, direction.x, inverse.x, tMin, tMax);
+      Ray::clipSlab(node.minY[k], node.maxY[k], origin.y, direction.y, inverse.y, tMin, tMax);
+      Ray::clipSlab(node.minZ[k], node.maxZ[k], origin.z, direction.z, inverse.z, tMin, tMax);
+      entry[k] = tMin <= tMax ? tMin : -1;
+    }
+
+    for(uint32_t k = 0; k < WIDTH; k++) {
+      if(node.count[k] == 0 || entry[k] < 0 || entry[k] > closest) {
+        continue;
+      }
+
+      if(node.child[k] == NO_NODE) {
+        for(auto i = node.first[k]; i < node.first[k] + node.count[k]; i++) {
+          if(proxyFlags[primitives[i]] & PROXY_ALIVE) {
+            testProxy(primitives[i]);
+          }
+        }
+      } else {
+        ENJAM_ASSERT(stackSize < STACK_SIZE);
+        stack[stackSize++] = node.child[k];
+      }
+    }
+  }
+
+  return found;
+}
+
+Bvh::Stats Bvh::getStats() const {
+  return Stats {
+      .proxiesCount = proxiesCount,
+      .nodesCount = uint32_t(nodes.size()),
+      .pendingCount = uint32_t(pendingProxies.size()),
+      .rebuildsCount = rebuildsCount,
+      .refitsCount = refitsCount
+  };
+}
+
+}
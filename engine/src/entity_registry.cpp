@@ -0,0 +1,234 @@
+#include <enjam/entity_registry.h>
+#include <algorithm>
+#include <mutex>
+
+namespace Enjam {
+
+namespace {
+
+struct ComponentTypesStorage {
+  std::mutex mutex;
+  std::unordered_map<std::type_index, ComponentId> ids;
+  std::array<ComponentInfo, MAX_COMPONENT_TYPES> infos;
+};
+
+ComponentTypesStorage& getComponentTypesStorage() {
+  static ComponentTypesStorage storage;
+  return storage;
+}
+
+uint32_t alignUp(uint32_t value, uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+ComponentId ComponentTypes::getId(std::type_index type, const ComponentInfo& info) {
+  auto& storage = getComponentTypesStorage();
+  std::lock_guard lock { storage.mutex };
+
+  auto it = storage.ids.find(type);
+  if(it != storage.ids.end()) {
+    return it->second;
+  }
+
+  ENJAM_ASSERT(storage.ids.size() < MAX_COMPONENT_TYPES && "Too many component types");
+  ENJAM_ASSERT(info.alignment <= Archetype::CHUNK_ALIGNMENT);
+
+  auto id = ComponentId(storage.ids.size());
+  storage.infos[id] = info;
+  storage.ids.emplace(type, id);
+  return id;
+}
+
+const ComponentInfo& ComponentTypes::getInfo(ComponentId id) {
+  auto& storage = getComponentTypesStorage();
+  std::lock_guard lock { storage.mutex };
+  return storage.infos[id];
+}
+
+Archetype::Archetype(ComponentMask mask)
+    : mask(mask) {
+  uint32_t rowSize = sizeof(Entity);
+  for(uint32_t id = 0; id < MAX_COMPONENT_TYPES; id++) {
+    if(has(id)) {
+      components.push_back(id);
+      infos[id] = ComponentTypes::getInfo(id);
+      rowSize += infos[id].size;
+    }
+  }
+
+  // largest alignment first keeps the padding between the arrays small
+  std::stable_sort(components.begin(), components.end(), [this](ComponentId lhs, ComponentId rhs) {
+    return infos[lhs].alignment > infos[rhs].alignment;
+  });
+
+  auto layout = [this](uint32_t capacity) {
+    uint32_t offset = sizeof(Entity) * capacity;
+    for(auto id : components) {
+      auto& info = infos[id];
+      offset = alignUp(offset, info.alignment);
+      columnOffsets[id] = offset;
+      offset += info.size * capacity;
+    }
+    return offset <= CHUNK_SIZE;
+  };
+
+  chunkCapacity = CHUNK_SIZE / rowSize;
+  while(chunkCapacity > 0 && !layout(chunkCapacity)) {
+    chunkCapacity--;
+  }
+  ENJAM_ASSERT(chunkCapacity > 0 && "Components do not fit into a chunk");
+}
+
+Archetype::~Archetype() {
+  while(entitiesCount > 0) {
+    removeRow(entitiesCount - 1);
+  }
+  for(auto chunk : chunks) {
+    ::operator delete(chunk, std::align_val_t(CHUNK_ALIGNMENT));
+  }
+}
+
+uint32_t Archetype::getChunkEntitiesCount(uint32_t chunk) const {
+  return std::min(chunkCapacity, entitiesCount - chunk * chunkCapacity);
+}
+
+uint32_t Archetype::pushRow(Entity entity) {
+  auto row = entitiesCount++;
+  if(row / chunkCapacity >= chunks.size()) {
+    chunks.push_back(static_cast<std::byte*>(::operator new(CHUNK_SIZE, std::align_val_t(CHUNK_ALIGNMENT))));
+  }
+
+  new (&getEntity(row)) Entity(entity);
+  return row;
+}
+
+Entity Archetype::removeRow(uint32_t row) {
+  auto last = entitiesCount - 1;
+  for(auto id : components) {
+    auto& info = infos[id];
+    info.destroy(getComponent(row, id));
+    if(row != last) {
+      info.moveConstruct(getComponent(row, id), getComponent(last, id));
+      info.destroy(getComponent(last, id));
+    }
+  }
+
+  Entity moved;
+  if(row != last) {
+    moved = getEntity(last);
+    getEntity(row) = moved;
+  }
+
+  entitiesCount--;
+  return moved;
+}
+
+void* Archetype::getComponent(uint32_t row, ComponentId id) const {
+  return chunks[row / chunkCapacity] + columnOffsets[id] + std::size_t(row % chunkCapacity) * infos[id].size;
+}
+
+Entity& Archetype::getEntity(uint32_t row) const {
+  return getEntities(row / chunkCapacity)[row % chunkCapacity];
+}
+
+EntityRegistry::~EntityRegistry() {
+  clear();
+}
+
+void EntityRegistry::destroy(Entity entity) {
+  ENJAM_ASSERT(isAlive(entity));
+  auto& record = records[entity.index];
+
+  auto moved = record.archetype->removeRow(record.row);
+  if(moved.isValid()) {
+    records[moved.index].row = record.row;
+  }
+
+  record.archetype = nullptr;
+  record.generation++;
+  freeIndices.push_back(entity.index);
+  entitiesCount--;
+  version++;
+}
+
+bool EntityRegistry::isAlive(Entity entity) const {
+  return entity.index < records.size()
+      && records[entity.index].archetype
+      && records[entity.index].generation == entity.generation;
+}
+
+void EntityRegistry::clear() {
+  archetypes.clear();
+  archetypesByMask.clear();
+  // records are kept with their generations bumped, indices are reused like those of destroyed entities
+  for(uint32_t index = 0; index < records.size(); index++) {
+    auto& record = records[index];
+    if(record.archetype) {
+      record.archetype = nullptr;
+      record.generation++;
+      freeIndices.push_back(index);
+    }
+  }
+  entitiesCount = 0;
+  version++;
+}
+
+Entity EntityRegistry::allocateEntity() {
+  entitiesCount++;
+  if(!freeIndices.empty()) {
+    auto index = freeIndices.back();
+    freeIndices.pop_back();
+    return Entity { .index = index, .generation = records[index].generation };
+  }
+
+  records.emplace_back();
+  return Entity { .index = uint32_t(records.size() - 1), .generation = 0 };
+}
+
+Archetype& EntityRegistry::getArchetype(ComponentMask mask) {
+  auto it = archetypesByMask.find(mask);
+  if(it != archetypesByMask.end()) {
+    return *it->second;
+  }
+
+  auto& archetype = archetypes.emplace_back(std::make_unique<Archetype>(mask));
+  archetypesByMask.emplace(mask, archetype.get());
+  return *archetype;
+}
+
+uint32_t EntityRegistry::place(Entity entity, Archetype& archetype) {
+  auto& record = records[entity.index];
+  record.archetype = &archetype;
+  record.row = archetype.pushRow(entity);
+  version++;
+  return record.row;
+}
+
+uint32_t EntityRegistry::migrate(Entity entity, ComponentMask mask) {
+  auto& record = records[entity.index];
+  auto& source = *record.archetype;
+  auto sourceRow = record.row;
+
+  auto& target = getArchetype(mask);
+  auto row = target.pushRow(entity);
+  for(auto id : source.components) {
+    if(target.has(id)) {
+      source.infos[id].moveConstruct(target.getComponent(row, id), source.getComponent(sourceRow, id));
+    }
+  }
+
+  // moved-from and dropped components are destroyed with the source row
+  auto moved = source.removeRow(sourceRow);
+  if(moved.isValid()) {
+    records[moved.index].row = sourceRow;
+  }
+
+  record.archetype = &target;
+  record.row = row;
+  version++;
+  return row;
+}
+
+}
@@ -0,0 +1,46 @@
+#include <enjam/frame_latency.h>
+#include <algorithm>
+
+namespace Enjam {
+
+void FrameLatency::onInputPolled(Clock::time_point time) {
+  inputTime = time;
+}
+
+void FrameLatency::onPresented(Clock::time_point time) {
+  if(!inputTime) {
+    return;
+  }
+
+  std::chrono::duration<float, std::milli> latency = time - inputTime.value();
+  samples[framesCount % WINDOW_SIZE] = latency.count();
+  framesCount++;
+
+  inputTime.reset();
+}
+
+FrameLatency::Stats FrameLatency::getStats() const {
+  Stats stats { .frames = framesCount };
+  if(framesCount == 0) {
+    return stats;
+  }
+
+  auto count = std::min<uint64_t>(framesCount, WINDOW_SIZE);
+  float sum = 0;
+  for(uint64_t i = 0; i < count; i++) {
+    sum += samples[i];
+    stats.maxMs = std::max(stats.maxMs, samples[i]);
+  }
+
+  stats.lastMs = samples[(framesCount - 1) % WINDOW_SIZE];
+  stats.averageMs = sum / float(count);
+  return stats;
+}
+
+void FrameLatency::reset() {
+  inputTime.reset();
+  samples = { };
+  framesCount = 0;
+}
+
+}
@@ -0,0 +1,51 @@
+#include <enjam/geometry_layout.h>
+#include <cstring>
+
+namespace Enjam {
+
+GeometryLayout GeometryLayout::pack(uint32_t vertexCount, const std::vector<ByteArray>& vertexStreams,
+                                    const ByteArray& indices, const ByteArray& indices16, ByteArray& geometry) {
+  auto append = [&geometry](const ByteArray& bytes) {
+    Section section { .offset = (geometry.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, .size = bytes.size() };
+    geometry.resize(section.offset + section.size);
+    if(!bytes.empty()) {
+      std::memcpy(geometry.data() + section.offset, bytes.data(), bytes.size());
+    }
+    return section;
+  };
+
+  // reserved once so appending doesn't move what was appended before, every section may need padding
+  auto size = geometry.size() + indices.size() + indices16.size() + (vertexStreams.size() + 2) * ALIGNMENT;
+  for(auto& stream : vertexStreams) {
+    size += stream.size();
+  }
+  geometry.reserve(size);
+
+  GeometryLayout layout { .vertexCount = vertexCount, .vertexStreams = { }, .indices = { }, .indices16 = { } };
+  for(auto& stream : vertexStreams) {
+    layout.vertexStreams.push_back(append(stream));
+  }
+  layout.indices = append(indices);
+  layout.indices16 = append(indices16);
+  return layout;
+}
+
+bool GeometryLayout::isValid(const VertexFormat& format, uint64_t geometrySize) const {
+  auto isInside = [geometrySize](const Section& section, uint64_t elementSize) {
+    return section.offset % ALIGNMENT == 0 && section.size % elementSize == 0 && section.offset <= geometrySize
+        && section.size <= geometrySize - section.offset;
+  };
+
+  if(vertexStreams.size() != format.getStreamsCount()) {
+    return false;
+  }
+  for(uint32_t stream = 0; stream < vertexStreams.size(); stream++) {
+    auto stride = format.getStreamStride(stream);
+    if(!isInside(vertexStreams[stream], stride) || vertexStreams[stream].size != uint64_t(vertexCount) * stride) {
+      return false;
+    }
+  }
+  return isInside(indices, sizeof(uint32_t)) && isInside(indices16, sizeof(uint16_t));
+}
+
+}
@@ -0,0 +1,124 @@
+#include <enjam/geometry_pool.h>
+#include <enjam/assert.h>
+#include <enjam/log.h>
+#include <algorithm>
+
+namespace Enjam {
+
+GeometryPool::GeometryPool(RendererBackend& backend,
+                           std::initializer_list<VertexAttribute> attributes,
+                           uint32_t vertexCapacity,
+                           uint32_t indexCapacity,
+                           uint32_t index16Capacity)
+  : vertexBuffer(backend, attributes, vertexCapacity)
+  , vertexRanges(vertexCapacity)
+  , indexArenas {
+      IndexArena { IndexBuffer(backend, index16Capacity, IndexType::UINT16), RangeAllocator(index16Capacity) },
+      IndexArena { IndexBuffer(backend, indexCapacity, IndexType::UINT32), RangeAllocator(indexCapacity) }
+  } {
+  // the streams must not move once they are assigned to the vertex buffer
+  vertexStreams.reserve(attributes.size());
+  vertexStrides.reserve(attributes.size());
+
+  auto it = attributes.begin();
+  while(it != attributes.end()) {
+    ENJAM_ASSERT(it->stride > 0 && "Geometry pool streams need an explicit stride");
+    ENJAM_ASSERT(it->offset == 0 && "Interleaved attributes follow the first attribute of their stream");
+
+    auto end = std::find_if(it + 1, attributes.end(), [](const VertexAttribute& attribute) { return attribute.offset == 0; });
+    for(auto interleaved = it + 1; interleaved != end; interleaved++) {
+      ENJAM_ASSERT(interleaved->stride == it->stride && interleaved->offset < it->stride);
+    }
+
+    auto firstAttribute = uint32_t(it - attributes.begin());
+    auto& stream = vertexStreams.emplace_back(backend, BufferTargetBinding::VERTEX, size_t(vertexCapacity) * it->stride);
+    vertexBuffer.setInterleavedBuffer(backend, firstAttribute, uint32_t(end - it), stream);
+    vertexStrides.push_back(it->stride);
+    it = end;
+  }
+}
+
+GeometryRange GeometryPool::allocate(uint32_t vertexCount, uint32_t indexCount, uint32_t index16Count) {
+  GeometryRange range { .vertices = vertexRanges.allocate(vertexCount), .indices = { } };
+  range.indices[uint8_t(IndexType::UINT16)] = indexArenas[uint8_t(IndexType::UINT16)].ranges.allocate(index16Count);
+  range.indices[uint8_t(IndexType::UINT32)] = indexArenas[uint8_t(IndexType::UINT32)].ranges.allocate(indexCount);
+
+  auto isAllocated = [](const RangeAllocator::Range& range, uint32_t count) { return count == 0 || range.isValid(); };
+  if(!range.isValid()
+     || !isAllocated(range.indices[uint8_t(IndexType::UINT16)], index16Count)
+     || !isAllocated(range.indices[uint8_t(IndexType::UINT32)], indexCount)) {
+    ENJAM_WARN("Geometry pool is out of space for {} vertices, {} indices and {} 16 bit indices",
+               vertexCount, indexCount, index16Count);
+    free(range);
+    return { };
+  }
+
+  return range;
+}
+
+void GeometryPool::free(const GeometryRange& range) {
+  vertexRanges.free(range.vertices);
+  for(uint8_t type = 0; type < indexArenas.size(); type++) {
+    indexArenas[type].ranges.free(range.indices[type]);
+  }
+}
+
+void GeometryPool::setVertices(RendererBackend& backend, const GeometryRange& range, uint8_t stream,
+                               BufferDataDesc&& desc, uint32_t firstVertex) {
+  ENJAM_ASSERT(range.isValid());
+  ENJAM_ASSERT(stream < vertexStreams.size());
+  ENJAM_ASSERT(firstVertex <= range.getVertexCount());
+
+  auto stride = vertexStrides[stream];
+  ENJAM_ASSERT(desc.size <= uint64_t(range.getVertexCount() - firstVertex) * stride);
+
+  vertexStreams[stream].setBuffer(backend, std::move(desc), (range.vertices.offset + firstVertex) * stride);
+}
+
+void GeometryPool::setIndices(RendererBackend& backend, const GeometryRange& range, BufferDataDesc&& desc,
+                              uint32_t firstIndex, IndexType type) {
+  ENJAM_ASSERT(range.isValid());
+  ENJAM_ASSERT(firstIndex <= range.getIndexCount(type));
+
+  auto indexSize = getIndexSize(type);
+  ENJAM_ASSERT(desc.size <= uint64_t(range.getIndexCount(type) - firstIndex) * indexSize);
+
+  indexArenas[uint8_t(type)].buffer.setBuffer(backend, std::move(desc), (range.getFirstIndex(type) + firstIndex) * indexSize);
+}
+
+void GeometryPool::destroy(RendererBackend& backend) {
+  vertexBuffer.destroy(backend);
+  for(auto& arena : indexArenas) {
+    arena.buffer.destroy(backend);
+    arena.ranges.reset();
+  }
+
+  for(auto& stream : vertexStreams) {
+    stream.destroy(backend);
+  }
+  vertexStreams.clear();
+
+  vertexRanges.reset();
+}
+
+GeometryPool::Stats GeometryPool::getStats() const {
+  return Stats {
+    .vertices = vertexRanges.getStats(),
+    .indices = indexArenas[uint8_t(IndexType::UINT32)].ranges.getStats(),
+    .indices16 = indexArenas[uint8_t(IndexType::UINT16)].ranges.getStats()
+  };
+}
+
+void GeometryPool::logStats() const {
+  auto stats = getStats();
+  auto log = [](const char* name, const RangeAllocator::Stats& s) {
+    ENJAM_INFO("Geometry pool {}: {}/{} used by {} meshes, {} free ranges, largest free {}, fragmentation {:.2f}",
+               name, s.usedSize, s.capacity, s.allocationsCount, s.freeRangesCount, s.largestFreeRange, s.fragmentation());
+  };
+
+  log("vertices", stats.vertices);
+  log("indices", stats.indices);
+  log("16 bit indices", stats.indices16);
+}
+
+}
@@ -0,0 +1,116 @@
+#include <enjam/import_batch.h>
+#include <enjam/assert.h>
+#include <enjam/import_cache.h>
+#include <enjam/assets_repository.h>
+#include <enjam/log.h>
+#include <enjam/thread_pool.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace Enjam {
+
+std::vector<ImportJob> readImportManifest(const std::filesystem::path& path) {
+  std::ifstream file(path);
+  if(file.fail()) {
+    ENJAM_ERROR("Couldn't open import manifest {}", path.string());
+    return { };
+  }
+
+  auto directory = path.parent_path();
+  auto resolve = [&directory](const std::string& argument) {
+    std::filesystem::path argumentPath(argument);
+    return argumentPath.is_absolute() ? argumentPath : directory / argumentPath;
+  };
+
+  std::vector<ImportJob> jobs;
+  std::string line;
+  while(std::getline(file, line)) {
+    std::istringstream arguments(line);
+    std::string argument;
+    ImportJob job;
+    while(arguments >> std::quoted(argument)) {
+      if(argument[0] == '#' && job.inputs.empty()) {
+        break;
+      }
+      if(argument == "-o" && arguments >> std::quoted(argument)) {
+        job.output = resolve(argument);
+        continue;
+      }
+      job.inputs.push_back(resolve(argument));
+    }
+
+    if(!job.inputs.empty()) {
+      jobs.push_back(std::move(job));
+    }
+  }
+  return jobs;
+}
+
+std::filesystem::path getImportOutput(const ImportJob& job, std::string_view extension) {
+  if(!job.output.empty()) {
+    return job.output;
+  }
+  auto output = job.inputs.front();
+  output.replace_extension(extension);
+  return output;
+}
+
+bool runImportJobs(ThreadPool& threadPool, const std::vector<ImportJob>& jobs, ImportCache* cache,
+                   const std::function<bool(const ImportJob&, AssetsFilesystemRep&)>& import) {
+  using Clock = std::chrono::steady_clock;
+  auto milliseconds = [](Clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+  for(auto& job : jobs) {
+    ENJAM_ASSERT(!job.output.empty() && "Import jobs need their outputs set");
+  }
+
+  std::atomic<uint32_t> failedCount = 0;
+  std::atomic<uint32_t> upToDateCount = 0;
+  std::atomic<uint32_t> copiedCount = 0;
+  auto start = Clock::now();
+  threadPool.parallelFor(jobs.size(), [&](uint32_t index) {
+    auto& job = jobs[index];
+    auto cached = cache ? cache->restore(job) : ImportCache::Result::MISSING;
+    if(cached == ImportCache::Result::UP_TO_DATE) {
+      upToDateCount++;
+      return;
+    }
+    if(cached == ImportCache::Result::COPIED) {
+      copiedCount++;
+      ENJAM_INFO("Copied {} to {} from the import cache", job.inputs.front().string(), job.output.string());
+      return;
+    }
+
+    auto jobStart = Clock::now();
+    AssetsFilesystemRep repository;
+    auto succeeded = false;
+    try {
+      succeeded = import(job, repository);
+    } catch(const std::exception& e) {
+      ENJAM_ERROR("Importing {} threw: {}", job.inputs.front().string(), e.what());
+    }
+
+    if(!succeeded) {
+      failedCount++;
+      ENJAM_ERROR("Couldn't import {}", job.inputs.front().string());
+      return;
+    }
+    if(cache) {
+      cache->store(job, repository.getSavedFiles());
+    }
+    ENJAM_INFO("Imported {} in {:.1f}ms", job.inputs.front().string(), milliseconds(Clock::now() - jobStart));
+  });
+
+  if(cache) {
+    cache->save();
+  }
+  ENJAM_INFO("Imported {} of {} assets in {:.1f}ms on {} threads, {} up to date, {} copied",
+             jobs.size() - failedCount - upToDateCount - copiedCount, jobs.size(), milliseconds(Clock::now() - start),
+             threadPool.getThreadsCount(), upToDateCount.load(), copiedCount.load());
+  return failedCount == 0;
+}
+
+}
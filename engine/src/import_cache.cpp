@@ -0,0 +1,246 @@
+#include <enjam/import_cache.h>
+#include <enjam/assetfile_reader.h>
+#include <enjam/assets_repository.h>
+#include <enjam/log.h>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+namespace Enjam {
+
+namespace {
+
+struct CacheFileInput {
+  std::istream& input;
+  std::function<std::unique_ptr<std::istream>(uint64_t)> buffers;
+};
+
+std::string toHex(uint64_t value) {
+  return fmt::format("{:x}", value);
+}
+
+uint64_t fromHex(const Asset* asset) {
+  return asset ? std::stoull(asset->as<std::string>(), nullptr, 16) : 0;
+}
+
+}
+
+ImportCache::ImportCache(std::filesystem::path path, std::string settings)
+    : path(std::move(path))
+    , settings(std::move(settings)) {
+  load();
+}
+
+ImportCache::Result ImportCache::restore(const ImportJob& job) {
+  auto key = getKey(job);
+  if(key == 0) {
+    return Result::MISSING;
+  }
+  auto output = job.output.generic_string();
+
+  // the entry of the output itself comes first, the candidates are copied out of the lock since checking their
+  // files takes a while
+  std::vector<std::pair<std::string, Entry>> candidates;
+  {
+    std::lock_guard lock { mutex };
+    auto it = entries.find(output);
+    if(it != entries.end() && it->second.key == key) {
+      candidates.emplace_back(*it);
+    }
+    for(auto& [candidateOutput, entry] : entries) {
+      if(entry.key == key && entry.relocatable && candidateOutput != output) {
+        candidates.emplace_back(candidateOutput, entry);
+      }
+    }
+  }
+
+  auto found = std::find_if(candidates.begin(), candidates.end(), [](const auto& candidate) {
+    return isIntact(candidate.second);
+  });
+  if(found == candidates.end()) {
+    return Result::MISSING;
+  }
+  auto& [source, entry] = *found;
+  if(source == output) {
+    // build rules that depend on the inputs or on the importer see the output as newer than them
+    std::error_code error;
+    std::filesystem::last_write_time(job.output, std::filesystem::file_time_type::clock::now(), error);
+    return Result::UP_TO_DATE;
+  }
+  if(!copy(entry, source, job.output)) {
+    return Result::MISSING;
+  }
+
+  std::vector<std::filesystem::path> files;
+  auto buffers = std::filesystem::path(job.output).replace_extension();
+  for(auto& file : entry.files) {
+    files.push_back(file.path == source ? job.output : buffers / std::filesystem::path(file.path).filename());
+  }
+  store(job, files);
+  return Result::COPIED;
+}
+
+void ImportCache::store(const ImportJob& job, const std::vector<std::filesystem::path>& files) {
+  auto buffers = std::filesystem::path(job.output).replace_extension();
+  Entry entry { .key = getKey(job), .files = { }, .relocatable = true };
+  for(auto& file : files) {
+    auto filePath = file.generic_string();
+    auto isListed = std::any_of(entry.files.begin(), entry.files.end(), [&filePath](const File& listed) {
+      return listed.path == filePath;
+    });
+    if(isListed) {
+      continue;
+    }
+
+    std::error_code error;
+    auto size = std::filesystem::file_size(file, error);
+    if(error) {
+      ENJAM_WARN("Import of {} is not cached, {} is missing", job.inputs.front().string(), filePath);
+      return;
+    }
+    entry.files.push_back({ .path = filePath, .size = size });
+    entry.relocatable &= file == job.output || file.parent_path() == buffers;
+  }
+
+  std::lock_guard lock { mutex };
+  entries[job.output.generic_string()] = std::move(entry);
+}
+
+void ImportCache::save() const {
+  std::lock_guard lock { mutex };
+
+  Asset asset;
+  asset["entries"] = Asset::array();
+  auto& entriesAsset = asset["entries"];
+  for(auto& [output, entry] : entries) {
+    Asset entryAsset;
+    entryAsset["output"] = output;
+    entryAsset["key"] = toHex(entry.key);
+    entryAsset["relocatable"] = uint32_t(entry.relocatable);
+    entryAsset["files"] = Asset::array();
+    for(auto& file : entry.files) {
+      Asset fileAsset;
+      fileAsset["path"] = file.path;
+      fileAsset["size"] = file.size;
+      entryAsset["files"].pushBack(std::move(fileAsset));
+    }
+    entriesAsset.pushBack(std::move(entryAsset));
+  }
+
+  asset["inputs"] = Asset::array();
+  auto& inputsAsset = asset["inputs"];
+  for(auto& [inputPath, input] : inputs) {
+    Asset inputAsset;
+    inputAsset["path"] = inputPath;
+    inputAsset["size"] = input.size;
+    inputAsset["time"] = toHex(input.time);
+    inputAsset["hash"] = toHex(input.hash);
+    inputsAsset.pushBack(std::move(inputAsset));
+  }
+
+  AssetsFilesystemRep { }.save(path, asset);
+}
+
+void ImportCache::load() {
+  std::ifstream file(path);
+  if(file.fail()) {
+    return;
+  }
+
+  CacheFileInput input { .input = file, .buffers = [](uint64_t) { return nullptr; } };
+  Asset asset;
+  if(!AssetFileReader { input }.parse(asset) || !asset.at("entries") || !asset.at("inputs")) {
+    ENJAM_WARN("Import cache {} is invalid, everything is imported again", path.string());
+    return;
+  }
+
+  for(auto& entryAsset : *asset.at("entries")) {
+    Entry entry {
+        .key = fromHex(entryAsset.at("key")),
+        .files = { },
+        .relocatable = entryAsset.at("relocatable")->as<uint32_t>() != 0
+    };
+    for(auto& fileAsset : *entryAsset.at("files")) {
+      entry.files.push_back({ .path = fileAsset.at("path")->as<std::string>(), .size = fileAsset.at("size")->as<uint64_t>() });
+    }
+    entries[entryAsset.at("output")->as<std::string>()] = std::move(entry);
+  }
+
+  for(auto& inputAsset : *asset.at("inputs")) {
+    inputs[inputAsset.at("path")->as<std::string>()] = Input {
+        .size = inputAsset.at("size")->as<uint64_t>(),
+        .time = fromHex(inputAsset.at("time")),
+        .hash = fromHex(inputAsset.at("hash"))
+    };
+  }
+}
+
+// The input contents are keyed with their extensions, which some importers tell the input types by
+uint64_t ImportCache::getKey(const ImportJob& job) {
+  auto text = settings;
+  for(auto& input : job.inputs) {
+    auto hash = hashInput(input);
+    if(hash == 0) {
+      return 0;
+    }
+    text += fmt::format("\n{}:{:x}", input.extension().string(), hash);
+  }
+  return std::hash<std::string> { }(text);
+}
+
+uint64_t ImportCache::hashInput(const std::filesystem::path& input) {
+  std::error_code error;
+  auto size = std::filesystem::file_size(input, error);
+  auto time = std::filesystem::last_write_time(input, error);
+  if(error) {
+    return 0;
+  }
+
+  auto inputPath = input.generic_string();
+  Input result { .size = size, .time = uint64_t(time.time_since_epoch().count()), .hash = 0 };
+  {
+    std::lock_guard lock { mutex };
+    auto it = inputs.find(inputPath);
+    if(it != inputs.end() && it->second.size == result.size && it->second.time == result.time) {
+      return it->second.hash;
+    }
+  }
+
+  std::ifstream file(input, std::ios::in | std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  result.hash = std::hash<std::string> { }(content.str());
+
+  std::lock_guard lock { mutex };
+  inputs[inputPath] = result;
+  return result.hash;
+}
+
+bool ImportCache::isIntact(const Entry& entry) {
+  return std::all_of(entry.files.begin(), entry.files.end(), [](const File& file) {
+    std::error_code error;
+    return std::filesystem::file_size(file.path, error) == file.size && !error;
+  });
+}
+
+// Buffers go to the buffer directory of the new output, under the same names since they are named by their content
+bool ImportCache::copy(const Entry& entry, const std::filesystem::path& from, const std::filesystem::path& to) {
+  auto buffers = std::filesystem::path(to).replace_extension();
+  std::error_code error;
+  std::filesystem::create_directories(to.parent_path(), error);
+  if(entry.files.size() > 1) {
+    std::filesystem::create_directories(buffers, error);
+  }
+  for(auto& file : entry.files) {
+    auto target = file.path == from.generic_string() ? to : buffers / std::filesystem::path(file.path).filename();
+    std::filesystem::copy_file(file.path, target, std::filesystem::copy_options::overwrite_existing, error);
+    if(error) {
+      ENJAM_WARN("Couldn't copy {} to {}: {}", file.path, target.string(), error.message());
+      return false;
+    }
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,181 @@
+#include <enjam/light_clusters.h>
+#include <enjam/bounds.h>
+#include <enjam/thread_pool.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace Enjam {
+
+namespace {
+
+std140::vec4 toStd140(float x, float y, float z, float w) {
+  std140::vec4 result;
+  result[0] = x;
+  result[1] = y;
+  result[2] = z;
+  result[3] = w;
+  return result;
+}
+
+}
+
+void LightClusters::build(const math::mat4f& view,
+                          const math::mat4f& projection,
+                          const std::vector<FrameLight>& frameLights,
+                          ThreadPool& threadPool) {
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  stats = Stats { };
+
+  // lights touching the frustum, the nearest ones are kept when there are too many
+  auto frustum = Frustum::fromMatrix(projection * view);
+  visibleLights.clear();
+  for(uint32_t i = 0; i < frameLights.size(); i++) {
+    auto& light = frameLights[i];
+    if(frustum.intersects(Sphere { .center = light.position, .radius = light.radius })) {
+      auto depth = -(view * math::vec4f { light.position, 1 }).z;
+      visibleLights.emplace_back(depth, i);
+    }
+  }
+  if(visibleLights.size() > LightsUniforms::MAX_LIGHTS) {
+    std::nth_element(visibleLights.begin(), visibleLights.begin() + LightsUniforms::MAX_LIGHTS, visibleLights.end());
+    stats.droppedLightsCount = visibleLights.size() - LightsUniforms::MAX_LIGHTS;
+    visibleLights.resize(LightsUniforms::MAX_LIGHTS);
+  }
+  stats.lightsCount = visibleLights.size();
+
+  viewPositions.clear();
+  radiuses.clear();
+  for(uint32_t i = 0; i < visibleLights.size(); i++) {
+    auto& light = frameLights[visibleLights[i].second];
+    viewPositions.push_back((view * math::vec4f { light.position, 1 }).xyz);
+    radiuses.push_back(light.radius);
+    lights.positionRadius[i] = toStd140(light.position.x, light.position.y, light.position.z, light.radius);
+    lights.colors[i] = toStd140(light.color.x, light.color.y, light.color.z, 0);
+  }
+
+  // near and far planes of a GL perspective projection
+  auto near = projection[3][2] / (projection[2][2] - 1);
+  auto far = projection[3][2] / (projection[2][2] + 1);
+  auto logDepthRange = std::log(far / near);
+  auto grid = float(LightClustersUniforms::GRID_Z);
+  clusters.params = toStd140(grid / logDepthRange, -grid * std::log(near) / logDepthRange, 0, 0);
+
+  if(visibleLights.empty()) {
+    for(auto& ranges : clusters.ranges) {
+      ranges.fill(0);
+    }
+    stats.buildMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    return;
+  }
+
+  threadPool.parallelFor(LightClustersUniforms::GRID_Z, [this, &projection, near, far](uint32_t slice) {
+    assignSlice(slice, projection, near, far);
+  });
+
+  // slices are concatenated front to back, the clusters past the index buffer lose their lights
+  uint32_t offset = 0;
+  uint32_t cluster = 0;
+  for(auto& slice : slices) {
+    auto source = slice.clusterLights.data();
+    for(auto count : slice.clusterCounts) {
+      auto kept = std::min<uint32_t>(count, LightIndicesUniforms::MAX_INDICES - offset);
+      for(uint32_t i = 0; i < kept; i++) {
+        auto n = offset + i;
+        auto& word = indices.indices[n / 16][n / 4 % 4];
+        word = (n % 4 == 0 ? 0 : word) | uint32_t(source[i]) << (n % 4 * 8);
+      }
+      clusters.ranges[cluster / 4][cluster % 4] = offset | kept << 16;
+
+      stats.droppedIndicesCount += count - kept;
+      source += count;
+      offset += kept;
+      cluster++;
+    }
+  }
+  stats.indicesCount = offset;
+  stats.buildMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+void LightClusters::assignSlice(uint32_t slice, const math::mat4f& projection, float near, float far) {
+  using Uniforms = LightClustersUniforms;
+
+  auto getSliceDepth = [near, far](uint32_t slice) {
+    return near * std::pow(far / near, float(slice) / float(Uniforms::GRID_Z));
+  };
+  auto sliceNear = getSliceDepth(slice);
+  auto sliceFar = getSliceDepth(slice + 1);
+
+  auto& sliceLights = slices[slice];
+  sliceLights.x.clear();
+  sliceLights.y.clear();
+  sliceLights.z.clear();
+  sliceLights.radiusSquared.clear();
+  sliceLights.lights.clear();
+  sliceLights.clusterLights.clear();
+
+  for(uint32_t i = 0; i < viewPositions.size(); i++) {
+    auto& position = viewPositions[i];
+    auto radius = radiuses[i];
+    if(-position.z + radius < sliceNear || -position.z - radius > sliceFar) {
+      continue;
+    }
+    sliceLights.x.push_back(position.x);
+    sliceLights.y.push_back(position.y);
+    sliceLights.z.push_back(position.z);
+    sliceLights.radiusSquared.push_back(radius * radius);
+    sliceLights.lights.push_back(uint8_t(i));
+  }
+
+  auto count = uint32_t(sliceLights.lights.size());
+  sliceLights.hits.resize(count);
+  auto x = sliceLights.x.data();
+  auto y = sliceLights.y.data();
+  auto z = sliceLights.z.data();
+  auto radiusSquared = sliceLights.radiusSquared.data();
+  auto hits = sliceLights.hits.data();
+
+  for(uint32_t tileY = 0; tileY < Uniforms::GRID_Y; tileY++) {
+    for(uint32_t tileX = 0; tileX < Uniforms::GRID_X; tileX++) {
+      auto& clusterCount = sliceLights.clusterCounts[tileY * Uniforms::GRID_X + tileX];
+      clusterCount = 0;
+      if(count == 0) {
+        continue;
+      }
+
+      // view space box of the corners of the tile on the near and far planes of the slice
+      Aabb box;
+      for(auto depth : { sliceNear, sliceFar }) {
+        for(auto ndcX : { float(tileX) / Uniforms::GRID_X * 2 - 1, float(tileX + 1) / Uniforms::GRID_X * 2 - 1 }) {
+          for(auto ndcY : { float(tileY) / Uniforms::GRID_Y * 2 - 1, float(tileY + 1) / Uniforms::GRID_Y * 2 - 1 }) {
+            box.expand(math::vec3f {
+                (ndcX + projection[2][0]) * depth / projection[0][0],
+                (ndcY + projection[2][1]) * depth / projection[1][1],
+                -depth
+            });
+          }
+        }
+      }
+
+      // squared distance from every light to the box first, the lights it reaches are appended after
+      auto minX = box.min.x, minY = box.min.y, minZ = box.min.z;
+      auto maxX = box.max.x, maxY = box.max.y, maxZ = box.max.z;
+      for(uint32_t i = 0; i < count; i++) {
+        auto dx = std::max(std::max(minX - x[i], x[i] - maxX), 0.0f);
+        auto dy = std::max(std::max(minY - y[i], y[i] - maxY), 0.0f);
+        auto dz = std::max(std::max(minZ - z[i], z[i] - maxZ), 0.0f);
+        hits[i] = dx * dx + dy * dy + dz * dz <= radiusSquared[i];
+      }
+
+      for(uint32_t i = 0; i < count; i++) {
+        if(hits[i]) {
+          sliceLights.clusterLights.push_back(sliceLights.lights[i]);
+          clusterCount++;
+        }
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,282 @@
+#include <enjam/material.h>
+#include <enjam/log.h>
+#include <atomic>
+
+namespace Enjam {
+
+struct Std140Info {
+  uint32_t alignment;
+  uint32_t size;
+};
+
+static Std140Info toStd140Info(MaterialParameterType type) {
+  using Type = MaterialParameterType;
+  switch (type) {
+    case Type::FLOAT:
+    case Type::INT:
+    case Type::UINT: return { 4, 4 };
+    case Type::FLOAT2: return { 8, 8 };
+    case Type::FLOAT3: return { 16, 12 };
+    case Type::FLOAT4: return { 16, 16 };
+    case Type::MAT4: return { 16, 64 };
+  }
+
+  ENJAM_ASSERT(false && "Unknown material parameter type");
+  return { 4, 4 };
+}
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+  // FNV-1a
+  auto bytes = static_cast<const uint8_t*>(data);
+  for(size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static uint64_t hashInstance(const Material& material, const ByteArray& parameters, const std::vector<TextureHandle>& textures) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  auto id = material.getId();
+  hash = hashBytes(hash, &id, sizeof(id));
+  hash = hashBytes(hash, parameters.data(), parameters.size());
+  for(auto& texture : textures) {
+    auto textureId = texture.getId();
+    hash = hashBytes(hash, &textureId, sizeof(textureId));
+  }
+  return hash;
+}
+
+MaterialParameterLayout& MaterialParameterLayout::add(std::string name, MaterialParameterType type) {
+  auto info = toStd140Info(type);
+  auto offset = (size + info.alignment - 1) / info.alignment * info.alignment;
+
+  parameters.push_back(Parameter { .name = std::move(name), .type = type, .offset = offset, .size = info.size });
+  size = offset + info.size;
+  return *this;
+}
+
+const MaterialParameterLayout::Parameter* MaterialParameterLayout::find(std::string_view name) const {
+  for(auto& parameter : parameters) {
+    if(parameter.name == name) {
+      return &parameter;
+    }
+  }
+  return nullptr;
+}
+
+Material::Material(RendererBackend& backend,
+                   ProgramData& programData,
+                   MaterialParameterLayout&& parameterLayout,
+                   std::vector<std::string>&& textures)
+  : layout(std::move(parameterLayout))
+  , textureNames(std::move(textures)) {
+  static std::atomic<uint32_t> nextId = 0;
+  id = nextId++;
+
+  ProgramData::DescriptorSetInfo setInfo;
+  setInfo.push_back({ layout.getSize() > 0 ? PARAMETERS_BLOCK_NAME : "", ProgramData::DescriptorType::UNIFORM });
+  for(auto& name : textureNames) {
+    setInfo.push_back({ name, ProgramData::DescriptorType::SAMPLER });
+  }
+
+  programData.setDescriptorSet(MATERIAL_SET, std::move(setInfo));
+  programHandle = backend.createProgram(programData);
+}
+
+void Material::destroy(RendererBackend& backend) {
+  if(programHandle) {
+    backend.destroyProgram(programHandle);
+    programHandle = { };
+  }
+}
+
+int32_t Material::findTexture(std::string_view name) const {
+  for(uint32_t i = 0; i < textureNames.size(); i++) {
+    if(textureNames[i] == name) {
+      return int32_t(i);
+    }
+  }
+  return -1;
+}
+
+MaterialInstance::MaterialInstance(const Material& material)
+  : material(&material)
+  , parameters(material.getLayout().getSize(), 0)
+  , textures(material.getTexturesCount()) { }
+
+void MaterialInstance::setTexture(std::string_view name, TextureHandle handle) {
+  auto index = material->findTexture(name);
+  ENJAM_ASSERT(index >= 0 && "Material has no such texture");
+  if(textures[index] != handle) {
+    textures[index] = handle;
+    dirty = true;
+  }
+}
+
+DescriptorSetHandle MaterialInstance::getDescriptorSetHandle() const {
+  ENJAM_ASSERT(binding && "Material instance must be updated by the MaterialSystem before drawing");
+  return binding->descriptorSetHandle;
+}
+
+uint64_t MaterialInstance::getSortKey() const {
+  uint64_t descriptorSetId = binding ? binding->descriptorSetHandle.getId() : 0;
+  return (uint64_t(material->getId()) << 32) | (descriptorSetId & UINT32_MAX);
+}
+
+void MaterialSystem::update(MaterialInstance& instance) {
+  if(!instance.dirty && instance.binding) {
+    return;
+  }
+
+  auto hash = hashInstance(*instance.material, instance.parameters, instance.textures);
+  auto current = instance.binding;
+
+  if(auto shared = find(hash, instance)) {
+    if(shared != current) {
+      release(instance);
+      shared->refCount++;
+      stats.instancesCount++;
+      instance.binding = shared;
+    }
+  } else if(current && current->refCount == 1) {
+    // the only user of the binding, change it in place and move it under the new hash
+    auto node = bindings.extract(locate(current));
+    node.key() = hash;
+    auto it = bindings.insert(std::move(node));
+
+    auto& binding = it->second;
+    binding.hash = hash;
+    upload(binding, instance);
+    instance.binding = &binding;
+  } else {
+    release(instance);
+    auto& binding = create(hash, instance);
+    binding.refCount++;
+    stats.instancesCount++;
+    instance.binding = &binding;
+  }
+
+  instance.dirty = false;
+}
+
+void MaterialSystem::release(MaterialInstance& instance) {
+  auto binding = instance.binding;
+  if(!binding) {
+    return;
+  }
+
+  instance.binding = nullptr;
+  instance.dirty = true;
+  stats.instancesCount--;
+
+  if(--binding->refCount > 0) {
+    return;
+  }
+
+  if(binding->descriptorSetHandle) {
+    backend.destroyDescriptorSet(binding->descriptorSetHandle);
+  }
+  if(binding->bufferHandle) {
+    backend.destroyBufferData(binding->bufferHandle);
+  }
+
+  bindings.erase(locate(binding));
+  stats.descriptorSetsCount--;
+}
+
+void MaterialSystem::destroy() {
+  for(auto& [hash, binding] : bindings) {
+    if(binding.descriptorSetHandle) {
+      backend.destroyDescriptorSet(binding.descriptorSetHandle);
+    }
+    if(binding.bufferHandle) {
+      backend.destroyBufferData(binding.bufferHandle);
+    }
+  }
+
+  bindings.clear();
+  stats = { };
+}
+
+MaterialBinding* MaterialSystem::find(uint64_t hash, const MaterialInstance& instance) {
+  auto [begin, end] = bindings.equal_range(hash);
+  for(auto it = begin; it != end; ++it) {
+    auto& binding = it->second;
+    bool equal = binding.material == instance.material
+        && binding.parameters == instance.parameters
+        && binding.textures == instance.textures;
+    if(equal) {
+      return &binding;
+    }
+  }
+  return nullptr;
+}
+
+MaterialBinding& MaterialSystem::create(uint64_t hash, const MaterialInstance& instance) {
+  auto& material = *instance.material;
+
+  DescriptorSetData setData;
+  auto parametersSize = material.getLayout().getSize();
+  if(parametersSize > 0) {
+    setData.bindings.push_back({ .binding = Material::PARAMETERS_BINDING, .type = DescriptorType::UNIFORM_BUFFER });
+  }
+  for(uint32_t i = 0; i < material.getTexturesCount(); i++) {
+    setData.bindings.push_back({ .binding = uint8_t(Material::PARAMETERS_BINDING + 1 + i), .type = DescriptorType::TEXTURE });
+  }
+
+  auto it = bindings.emplace(hash, MaterialBinding {
+      .material = &material,
+      .parameters = { },
+      .textures = { },
+      .descriptorSetHandle = { },
+      .bufferHandle = { },
+      .hash = hash
+  });
+  auto& binding = it->second;
+
+  if(!setData.bindings.empty()) {
+    binding.descriptorSetHandle = backend.createDescriptorSet(std::move(setData));
+  }
+
+  if(parametersSize > 0) {
+    // uniform buffers of this size are slices of the backend's shared uniform pool
+    binding.bufferHandle = backend.createBufferData(parametersSize, BufferTargetBinding::UNIFORM);
+    backend.updateDescriptorSetBuffer(binding.descriptorSetHandle, Material::PARAMETERS_BINDING,
+                                      binding.bufferHandle, parametersSize, 0);
+  }
+
+  stats.descriptorSetsCount++;
+  upload(binding, instance);
+  return binding;
+}
+
+void MaterialSystem::upload(MaterialBinding& binding, const MaterialInstance& instance) {
+  if(binding.bufferHandle && binding.parameters != instance.parameters) {
+    binding.parameters = instance.parameters;
+    backend.updateBufferData(binding.bufferHandle, { binding.parameters.data(), binding.parameters.size() }, 0);
+    stats.uploadsCount++;
+  }
+
+  for(uint32_t i = 0; i < instance.textures.size(); i++) {
+    auto& texture = instance.textures[i];
+    if(texture && !(i < binding.textures.size() && binding.textures[i] == texture)) {
+      backend.updateDescriptorSetTexture(binding.descriptorSetHandle, Material::PARAMETERS_BINDING + 1 + i, texture);
+    }
+  }
+  binding.textures = instance.textures;
+}
+
+MaterialSystem::BindingsMap::iterator MaterialSystem::locate(const MaterialBinding* binding) {
+  auto [begin, end] = bindings.equal_range(binding->hash);
+  for(auto it = begin; it != end; ++it) {
+    if(&it->second == binding) {
+      return it;
+    }
+  }
+
+  ENJAM_ASSERT(false && "Material binding is not owned by the system");
+  return bindings.end();
+}
+
+}
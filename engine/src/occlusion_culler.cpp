@@ -0,0 +1,486 @@
+#include <enjam/occlusion_culler.h>
+#include <enjam/thread_pool.h>
+#include <enjam/assert.h>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <set>
+#include <unordered_map>
+
+namespace Enjam {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t CULL_BATCH_SIZE = 256;
+constexpr uint32_t OCCLUDER_SAMPLES = 4; // per edge of a simplified triangle
+
+float elapsedMs(Clock::time_point start) {
+  return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+math::vec3f sub(const math::vec3f& a, const math::vec3f& b) {
+  return a + (-b);
+}
+
+// Real-Time Collision Detection 5.1.5, the triangle is not degenerate
+math::vec3f closestPointOnTriangle(const math::vec3f& p, const math::vec3f& a, const math::vec3f& b, const math::vec3f& c) {
+  auto ab = sub(b, a), ac = sub(c, a), ap = sub(p, a);
+  auto d1 = dot(ab, ap), d2 = dot(ac, ap);
+  if(d1 <= 0 && d2 <= 0) {
+    return a;
+  }
+
+  auto bp = sub(p, b);
+  auto d3 = dot(ab, bp), d4 = dot(ac, bp);
+  if(d3 >= 0 && d4 <= d3) {
+    return b;
+  }
+
+  auto vc = d1 * d4 - d3 * d2;
+  if(vc <= 0 && d1 >= 0 && d3 <= 0) {
+    return a + ab * (d1 / (d1 - d3));
+  }
+
+  auto cp = sub(p, c);
+  auto d5 = dot(ab, cp), d6 = dot(ac, cp);
+  if(d6 >= 0 && d5 <= d6) {
+    return c;
+  }
+
+  auto vb = d5 * d2 - d1 * d6;
+  if(vb <= 0 && d2 >= 0 && d6 <= 0) {
+    return a + ac * (d2 / (d2 - d6));
+  }
+
+  auto va = d3 * d6 - d5 * d4;
+  if(va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+    return b + sub(c, b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  }
+
+  auto scale = 1 / (va + vb + vc);
+  return a + ab * (vb * scale) + ac * (vc * scale);
+}
+
+}
+
+OcclusionCuller::OcclusionCuller() : OcclusionCuller(Config { }) { }
+
+OcclusionCuller::OcclusionCuller(const Config& config)
+    : config(config)
+    , tilesX(config.width / TILE_SIZE)
+    , tilesY(config.height / TILE_SIZE) {
+  ENJAM_ASSERT(config.width % TILE_SIZE == 0 && config.height % TILE_SIZE == 0);
+
+  auto width = config.width, height = config.height;
+  while(true) {
+    levels.push_back(Level { .width = width, .height = height, .depth = std::vector<float>(width * height, 0.0f) });
+    if(width == 1 && height == 1) {
+      break;
+    }
+    // rounded up, so the last column or row of an odd level still reaches the next one
+    width = (width + 1) / 2;
+    height = (height + 1) / 2;
+  }
+
+  tileTriangles.resize(tilesX * tilesY);
+}
+
+void OcclusionCuller::begin(const math::mat4f& matrix) {
+  viewProjection = matrix;
+  stats = { };
+  triangles.clear();
+  for(auto& tile : tileTriangles) {
+    tile.clear();
+  }
+}
+
+bool OcclusionCuller::addOccluder(const OccluderMesh& mesh, const math::mat4f& world) {
+  auto trianglesCount = uint32_t(mesh.indices.size() / 3);
+  if(stats.occludersCount >= config.maxOccluders || stats.occluderTrianglesCount + trianglesCount > config.maxOccluderTriangles) {
+    return false;
+  }
+
+  struct Vertex {
+    float x, y, depth;
+    bool clipped;
+  };
+
+  auto matrix = viewProjection * world;
+  auto width = float(config.width), height = float(config.height);
+
+  std::vector<Vertex> vertices(mesh.positions.size());
+  for(size_t i = 0; i < vertices.size(); i++) {
+    auto clip = matrix * math::vec4f { mesh.positions[i], 1 };
+    auto& vertex = vertices[i];
+
+    // triangles crossing the near plane are dropped, it only makes the occlusion weaker
+    vertex.clipped = clip.z < -clip.w || clip.w <= 0;
+    if(!vertex.clipped) {
+      auto invW = 1.0f / clip.w;
+      vertex.x = (clip.x * invW * 0.5f + 0.5f) * width;
+      vertex.y = (clip.y * invW * 0.5f + 0.5f) * height;
+      vertex.depth = invW;
+    }
+  }
+
+  for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    auto& v0 = vertices[mesh.indices[i]];
+    auto& v1 = vertices[mesh.indices[i + 1]];
+    auto& v2 = vertices[mesh.indices[i + 2]];
+    if(v0.clipped || v1.clipped || v2.clipped) {
+      continue;
+    }
+
+    auto minX = std::min({ v0.x, v1.x, v2.x }), maxX = std::max({ v0.x, v1.x, v2.x });
+    auto minY = std::min({ v0.y, v1.y, v2.y }), maxY = std::max({ v0.y, v1.y, v2.y });
+    if(maxX < 0 || maxY < 0 || minX >= width || minY >= height) {
+      continue;
+    }
+
+    auto index = uint32_t(triangles.size());
+    triangles.push_back(Triangle { { v0.x, v1.x, v2.x }, { v0.y, v1.y, v2.y }, { v0.depth, v1.depth, v2.depth } });
+
+    auto tileX0 = uint32_t(std::max(minX, 0.0f)) / TILE_SIZE, tileX1 = std::min(uint32_t(maxX) / TILE_SIZE, tilesX - 1);
+    auto tileY0 = uint32_t(std::max(minY, 0.0f)) / TILE_SIZE, tileY1 = std::min(uint32_t(maxY) / TILE_SIZE, tilesY - 1);
+    for(auto ty = tileY0; ty <= tileY1; ty++) {
+      for(auto tx = tileX0; tx <= tileX1; tx++) {
+        tileTriangles[ty * tilesX + tx].push_back(index);
+      }
+    }
+  }
+
+  stats.occludersCount++;
+  stats.occluderTrianglesCount += trianglesCount;
+  return true;
+}
+
+void OcclusionCuller::rasterize(ThreadPool& threadPool) {
+  auto start = Clock::now();
+
+  threadPool.parallelFor(tilesX * tilesY, [this](uint32_t tile) {
+    rasterizeTile(tile);
+    reduceTile(tile);
+  });
+
+  // levels coarser than a tile mix several tiles, they are tiny
+  for(uint32_t level = 1; level < levels.size(); level++) {
+    if((1u << level) > TILE_SIZE) {
+      reduceLevel(level, 0, 0, levels[level].width, levels[level].height);
+    }
+  }
+
+  stats.rasterizeMs = elapsedMs(start);
+}
+
+void OcclusionCuller::rasterizeTile(uint32_t tile) {
+  auto minX = tile % tilesX * TILE_SIZE, minY = tile / tilesX * TILE_SIZE;
+
+  auto& depth = levels[0].depth;
+  for(auto y = minY; y < minY + TILE_SIZE; y++) {
+    std::fill_n(depth.begin() + y * config.width + minX, TILE_SIZE, 0.0f);
+  }
+
+  for(auto index : tileTriangles[tile]) {
+    rasterizeTriangle(triangles[index], minX, minY, minX + TILE_SIZE, minY + TILE_SIZE);
+  }
+}
+
+void OcclusionCuller::rasterizeTriangle(const Triangle& triangle, uint32_t minX, uint32_t minY, uint32_t maxX, uint32_t maxY) {
+  // counter-clockwise order, occluders are drawn from both sides
+  uint32_t i0 = 0, i1 = 1, i2 = 2;
+  auto& x = triangle.x;
+  auto& y = triangle.y;
+  auto area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+  if(std::abs(area) < 1e-6f) {
+    return;
+  }
+  if(area < 0) {
+    std::swap(i1, i2);
+    area = -area;
+  }
+
+  // edge functions, positive inside the triangle. Pixels centered on an edge are covered so that
+  // triangles sharing the edge leave no holes
+  auto edge = [&](uint32_t a, uint32_t b, float& A, float& B, float& C) {
+    A = y[a] - y[b];
+    B = x[b] - x[a];
+    C = -(A * x[a] + B * y[a]);
+  };
+  float A0, B0, C0, A1, B1, C1, A2, B2, C2;
+  edge(i1, i2, A0, B0, C0);
+  edge(i2, i0, A1, B1, C1);
+  edge(i0, i1, A2, B2, C2);
+
+  // depth plane from the barycentric coordinates
+  auto& d = triangle.depth;
+  auto inverseArea = 1.0f / area;
+  auto dA = (A0 * d[i0] + A1 * d[i1] + A2 * d[i2]) * inverseArea;
+  auto dB = (B0 * d[i0] + B1 * d[i1] + B2 * d[i2]) * inverseArea;
+  auto dC = (C0 * d[i0] + C1 * d[i1] + C2 * d[i2]) * inverseArea;
+
+  auto x0 = std::max(minX, uint32_t(std::max(0.0f, std::floor(std::min({ x[0], x[1], x[2] })))));
+  auto x1 = std::min(maxX, uint32_t(std::max(0.0f, std::ceil(std::max({ x[0], x[1], x[2] })))));
+  auto y0 = std::max(minY, uint32_t(std::max(0.0f, std::floor(std::min({ y[0], y[1], y[2] })))));
+  auto y1 = std::min(maxY, uint32_t(std::max(0.0f, std::ceil(std::max({ y[0], y[1], y[2] })))));
+  if(x0 >= x1 || y0 >= y1) {
+    return;
+  }
+
+  auto& depth = levels[0].depth;
+  auto startX = float(x0) + 0.5f;
+  for(auto row = y0; row < y1; row++) {
+    auto py = float(row) + 0.5f;
+    auto e0 = A0 * startX + B0 * py + C0;
+    auto e1 = A1 * startX + B1 * py + C1;
+    auto e2 = A2 * startX + B2 * py + C2;
+    auto z = dA * startX + dB * py + dC;
+
+    // branchless so the compiler can vectorize the span
+    auto pixels = depth.data() + row * config.width + x0;
+    for(uint32_t i = 0, count = x1 - x0; i < count; i++) {
+      auto fi = float(i);
+      bool inside = (e0 + A0 * fi >= 0) & (e1 + A1 * fi >= 0) & (e2 + A2 * fi >= 0);
+      auto value = z + dA * fi;
+      pixels[i] = inside && value > pixels[i] ? value : pixels[i];
+    }
+  }
+}
+
+void OcclusionCuller::reduceTile(uint32_t tile) {
+  auto minX = tile % tilesX * TILE_SIZE, minY = tile / tilesX * TILE_SIZE;
+  for(uint32_t level = 1; level < levels.size() && (1u << level) <= TILE_SIZE; level++) {
+    reduceLevel(level, minX >> level, minY >> level, (minX + TILE_SIZE) >> level, (minY + TILE_SIZE) >> level);
+  }
+}
+
+void OcclusionCuller::reduceLevel(uint32_t level, uint32_t minX, uint32_t minY, uint32_t maxX, uint32_t maxY) {
+  auto& source = levels[level - 1];
+  auto& target = levels[level];
+  for(auto y = minY; y < maxY; y++) {
+    auto sy0 = std::min(y * 2, source.height - 1), sy1 = std::min(y * 2 + 1, source.height - 1);
+    for(auto x = minX; x < maxX; x++) {
+      auto sx0 = std::min(x * 2, source.width - 1), sx1 = std::min(x * 2 + 1, source.width - 1);
+      target.depth[y * target.width + x] = std::min(
+          std::min(source.depth[sy0 * source.width + sx0], source.depth[sy0 * source.width + sx1]),
+          std::min(source.depth[sy1 * source.width + sx0], source.depth[sy1 * source.width + sx1]));
+    }
+  }
+}
+
+bool OcclusionCuller::isVisible(const Aabb& bounds) const {
+  auto width = float(config.width), height = float(config.height);
+  auto minX = width, minY = height, maxX = 0.0f, maxY = 0.0f;
+  auto nearest = 0.0f;
+
+  for(uint32_t i = 0; i < 8; i++) {
+    math::vec4f corner {
+        i & 1 ? bounds.max.x : bounds.min.x,
+        i & 2 ? bounds.max.y : bounds.min.y,
+        i & 4 ? bounds.max.z : bounds.min.z,
+        1
+    };
+    auto clip = viewProjection * corner;
+    if(clip.z < -clip.w || clip.w <= 0) {
+      return true;
+    }
+
+    auto invW = 1.0f / clip.w;
+    auto x = (clip.x * invW * 0.5f + 0.5f) * width;
+    auto y = (clip.y * invW * 0.5f + 0.5f) * height;
+    minX = std::min(minX, x);
+    maxX = std::max(maxX, x);
+    minY = std::min(minY, y);
+    maxY = std::max(maxY, y);
+    nearest = std::max(nearest, invW);
+  }
+
+  if(maxX < 0 || maxY < 0 || minX >= width || minY >= height) {
+    return true;
+  }
+
+  auto x0 = uint32_t(std::max(minX, 0.0f)), x1 = std::min(uint32_t(maxX), config.width - 1);
+  auto y0 = uint32_t(std::max(minY, 0.0f)), y1 = std::min(uint32_t(maxY), config.height - 1);
+
+  // the level where the rect spans at most 2x2 texels
+  uint32_t level = 0;
+  while(level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+    level++;
+  }
+
+  auto& hiz = levels[level];
+  auto farthest = 1e30f;
+  for(auto y = std::min(y0 >> level, hiz.height - 1); y <= std::min(y1 >> level, hiz.height - 1); y++) {
+    for(auto x = std::min(x0 >> level, hiz.width - 1); x <= std::min(x1 >> level, hiz.width - 1); x++) {
+      farthest = std::min(farthest, hiz.depth[y * hiz.width + x]);
+    }
+  }
+
+  return nearest >= farthest;
+}
+
+void OcclusionCuller::cull(const Aabb* bounds, uint32_t count, uint8_t* visible, ThreadPool& threadPool) {
+  auto start = Clock::now();
+
+  auto batches = (count + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE;
+  threadPool.parallelFor(batches, [&](uint32_t batch) {
+    auto end = std::min(count, (batch + 1) * CULL_BATCH_SIZE);
+    for(auto i = batch * CULL_BATCH_SIZE; i < end; i++) {
+      visible[i] = isVisible(bounds[i]) ? 1 : 0;
+    }
+  });
+
+  stats.testedCount += count;
+  stats.culledCount += uint32_t(count - std::count(visible, visible + count, 1));
+  stats.testMs += elapsedMs(start);
+}
+
+float OcclusionCuller::getDepth(uint32_t level, uint32_t x, uint32_t y) const {
+  auto& hiz = levels[level];
+  return hiz.depth[y * hiz.width + x];
+}
+
+OccluderMesh OccluderMesh::simplify(const math::vec3f* positions, uint32_t verticesCount,
+                                    const std::vector<uint32_t>& indices, uint32_t gridSize) {
+  math::vec3f min { FLT_MAX }, max { -FLT_MAX };
+  for(uint32_t i = 0; i < verticesCount; i++) {
+    for(auto k = 0; k < 3; k++) {
+      min[k] = std::min(min[k], positions[i][k]);
+      max[k] = std::max(max[k], positions[i][k]);
+    }
+  }
+
+  math::vec3f cellSize;
+  for(auto k = 0; k < 3; k++) {
+    cellSize[k] = std::max(max[k] - min[k], 1e-6f) / float(gridSize);
+  }
+  auto maxCellSize = std::max({ cellSize.x, cellSize.y, cellSize.z });
+
+  auto getCoordinate = [&](float value, int k) {
+    return std::min(uint32_t(std::max(value - min[k], 0.0f) / cellSize[k]), gridSize - 1);
+  };
+  auto getCell = [&](uint32_t x, uint32_t y, uint32_t z) { return (z * gridSize + y) * gridSize + x; };
+  auto getPositionCell = [&](const math::vec3f& position) {
+    return getCell(getCoordinate(position.x, 0), getCoordinate(position.y, 1), getCoordinate(position.z, 2));
+  };
+
+  std::unordered_map<uint32_t, uint32_t> cellClusters;
+  std::vector<math::vec3f> averages;
+  std::vector<uint32_t> counts;
+  std::vector<uint32_t> clusters(verticesCount);
+  for(uint32_t i = 0; i < verticesCount; i++) {
+    auto [it, inserted] = cellClusters.emplace(getPositionCell(positions[i]), uint32_t(averages.size()));
+    if(inserted) {
+      averages.emplace_back(0.0f);
+      counts.push_back(0);
+    }
+    averages[it->second] += positions[i];
+    counts[it->second]++;
+    clusters[i] = it->second;
+  }
+
+  // the average of a concave or thin cell is off the surface, the vertex closest to it is not
+  std::vector<uint32_t> representatives(averages.size());
+  std::vector<float> representativeDistances(averages.size(), FLT_MAX);
+  for(uint32_t i = 0; i < verticesCount; i++) {
+    auto cluster = clusters[i];
+    auto offset = sub(positions[i], averages[cluster] * (1.0f / float(counts[cluster])));
+    if(dot(offset, offset) < representativeDistances[cluster]) {
+      representativeDistances[cluster] = dot(offset, offset);
+      representatives[cluster] = i;
+    }
+  }
+
+  // source triangles of every cell they come closer than a cell to
+  std::unordered_map<uint32_t, std::vector<uint32_t>> cellTriangles;
+  for(uint32_t first = 0; first + 2 < indices.size(); first += 3) {
+    auto& a = positions[indices[first]];
+    auto& b = positions[indices[first + 1]];
+    auto& c = positions[indices[first + 2]];
+    auto normal = cross(sub(b, a), sub(c, a));
+    if(dot(normal, normal) == 0) {
+      continue;
+    }
+
+    uint32_t from[3], to[3];
+    for(auto k = 0; k < 3; k++) {
+      from[k] = getCoordinate(std::min({ a[k], b[k], c[k] }) - maxCellSize, k);
+      to[k] = getCoordinate(std::max({ a[k], b[k], c[k] }) + maxCellSize, k);
+    }
+    for(auto z = from[2]; z <= to[2]; z++) {
+      for(auto y = from[1]; y <= to[1]; y++) {
+        for(auto x = from[0]; x <= to[0]; x++) {
+          cellTriangles[getCell(x, y, z)].push_back(first);
+        }
+      }
+    }
+  }
+
+  // on the surface or behind the closest source triangle, which faces outwards
+  auto tolerance = maxCellSize * 1e-3f;
+  auto isInside = [&](const math::vec3f& point) {
+    auto it = cellTriangles.find(getPositionCell(point));
+    if(it == cellTriangles.end()) {
+      return false;
+    }
+
+    auto closestDistance = FLT_MAX;
+    auto side = 0.0f;
+    for(auto first : it->second) {
+      auto& a = positions[indices[first]];
+      auto& b = positions[indices[first + 1]];
+      auto& c = positions[indices[first + 2]];
+      auto offset = sub(point, closestPointOnTriangle(point, a, b, c));
+      if(dot(offset, offset) < closestDistance) {
+        closestDistance = dot(offset, offset);
+        side = dot(offset, cross(sub(b, a), sub(c, a)));
+      }
+    }
+    return closestDistance <= tolerance * tolerance || side < 0;
+  };
+
+  OccluderMesh result;
+  std::vector<uint32_t> vertices(averages.size(), UINT32_MAX);
+  std::set<std::array<uint32_t, 3>> triangles;
+  for(uint32_t first = 0; first + 2 < indices.size(); first += 3) {
+    std::array<uint32_t, 3> triangle { clusters[indices[first]], clusters[indices[first + 1]], clusters[indices[first + 2]] };
+    if(triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0]) {
+      continue;
+    }
+
+    // occluders are rasterized from both sides, the winding does not matter
+    auto key = triangle;
+    std::sort(key.begin(), key.end());
+    if(!triangles.insert(key).second) {
+      continue;
+    }
+
+    auto& a = positions[representatives[triangle[0]]];
+    auto& b = positions[representatives[triangle[1]]];
+    auto& c = positions[representatives[triangle[2]]];
+    auto inside = true;
+    for(uint32_t i = 0; i <= OCCLUDER_SAMPLES && inside; i++) {
+      for(uint32_t j = 0; i + j <= OCCLUDER_SAMPLES && inside; j++) {
+        auto u = float(i) / OCCLUDER_SAMPLES, v = float(j) / OCCLUDER_SAMPLES;
+        inside = isInside(a * (1 - u - v) + b * u + c * v);
+      }
+    }
+    if(!inside) {
+      continue;
+    }
+
+    for(auto cluster : triangle) {
+      if(vertices[cluster] == UINT32_MAX) {
+        vertices[cluster] = result.positions.size();
+        result.positions.push_back(positions[representatives[cluster]]);
+      }
+      result.indices.push_back(vertices[cluster]);
+    }
+  }
+  return result;
+}
+
+}
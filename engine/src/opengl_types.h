@@ -17,10 +17,20 @@ constexpr inline GLenum toBufferBinding(BufferTargetBinding type) {
   }
 }
 
+constexpr inline int32_t toSwapInterval(PresentMode mode) {
+  switch (mode) {
+    case PresentMode::FIFO: return 1;
+    case PresentMode::MAILBOX:
+    case PresentMode::IMMEDIATE: return 0;
+  }
+  return 1;
+}
+
 constexpr inline GLint toGLVertexAttribSize(VertexAttributeType type) {
   using Type = VertexAttributeType;
   switch (type) {
     case Type::FLOAT:
+    case Type::HALF:
     case Type::BYTE:
     case Type::UBYTE:
     case Type::SHORT:
@@ -30,6 +40,7 @@ constexpr inline GLint toGLVertexAttribSize(VertexAttributeType type) {
       return 1;
 
     case Type::FLOAT2:
+    case Type::HALF2:
     case Type::BYTE2:
     case Type::UBYTE2:
     case Type::SHORT2:
@@ -39,6 +50,7 @@ constexpr inline GLint toGLVertexAttribSize(VertexAttributeType type) {
       return 2;
 
     case Type::FLOAT3:
+    case Type::HALF3:
     case Type::BYTE3:
     case Type::UBYTE3:
     case Type::SHORT3:
@@ -48,6 +60,7 @@ constexpr inline GLint toGLVertexAttribSize(VertexAttributeType type) {
       return 3;
 
     case Type::FLOAT4:
+    case Type::HALF4:
     case Type::BYTE4:
     case Type::UBYTE4:
     case Type::SHORT4:
@@ -61,11 +74,12 @@ constexpr inline GLint toGLVertexAttribSize(VertexAttributeType type) {
   return GL_NONE;
 }
 
-constexpr inline uint32_t indexOffsetToByteOffset(uint32_t indexOffset) {
-  // Size in bytes of indices in the index buffer
-  // Assuming that index buffer contains uint32 values
-  uint8_t const indicesShift = 2;
-  return indexOffset << indicesShift;
+constexpr inline GLenum toGLIndexType(IndexType type) {
+  switch (type) {
+    case IndexType::UINT16: return GL_UNSIGNED_SHORT;
+    case IndexType::UINT32: return GL_UNSIGNED_INT;
+  }
+  return GL_UNSIGNED_INT;
 }
 
 constexpr inline GLenum toGLTextureInternalFormat(TextureFormat format) noexcept {
@@ -92,6 +106,12 @@ constexpr inline GLenum toGLVertexAttribType(VertexAttributeType type) {
     case Type::FLOAT4:
       return GL_FLOAT;
 
+    case Type::HALF:
+    case Type::HALF2:
+    case Type::HALF3:
+    case Type::HALF4:
+      return GL_HALF_FLOAT;
+
     case Type::BYTE:
     case Type::BYTE2:
     case Type::BYTE3:
@@ -51,11 +51,12 @@ class GLSwapChainGLFW : public GLSwapChain {
   GLSwapChainGLFW(GLFWwindow* window) : window(window) { }
   void makeCurrent() override { glfwMakeContextCurrent(window); }
   void swapBuffers() override { glfwSwapBuffers(window); }
+  void setSwapInterval(int32_t interval) override { glfwSwapInterval(interval); }
  private:
   GLFWwindow* window;
 };
 
-std::unique_ptr<RendererBackend> PlatformGlfw::createRendererBackend(RendererBackendType type) {
+std::unique_ptr<RendererBackend> PlatformGlfw::createRendererBackend(RendererBackendType type, const PresentationConfig& presentation) {
   init();
   createWindow(type);
   ENJAM_ASSERT(window);
@@ -64,7 +65,9 @@ std::unique_ptr<RendererBackend> PlatformGlfw::createRendererBackend(RendererBac
     case DEFAULT:
     case OPENGL: {
       glfwMakeContextCurrent(window);
-      return std::make_unique<RendererBackendOpengl>((GLLoaderProc) glfwGetProcAddress, new GLSwapChainGLFW(window));
+      auto backend = std::make_unique<RendererBackendOpengl>((GLLoaderProc) glfwGetProcAddress, new GLSwapChainGLFW(window), &frameLatency);
+      backend->setPresentationConfig(presentation);
+      return backend;
     }
     case VULKAN: {
       std::set<std::string_view> requiredExtensions;
@@ -118,14 +121,16 @@ std::unique_ptr<RendererBackend> PlatformGlfw::createRendererBackend(RendererBac
         createInfo.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
       }
 
+      auto hostAllocator = std::make_unique<VulkanHostAllocator>();
+
       VkInstance instance;
-      if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+      if (vkCreateInstance(&createInfo, hostAllocator->getCallbacks(), &instance) != VK_SUCCESS) {
         ENJAM_ERROR("Failed to create VULKAN renderer backend!");
         return { };
       }
 
       VkSurfaceKHR surface;
-      if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+      if (glfwCreateWindowSurface(instance, window, hostAllocator->getCallbacks(), &surface) != VK_SUCCESS) {
         ENJAM_ERROR("Failed to create a surface for vulkan renderer backend!");
         return { };
       }
@@ -133,7 +138,9 @@ std::unique_ptr<RendererBackend> PlatformGlfw::createRendererBackend(RendererBac
       int width, height;
       glfwGetFramebufferSize(window, &width, &height);
 
-      return std::make_unique<RendererBackendVulkan>(instance, surface, math::vec2ui { width, height });
+      auto backend = std::make_unique<RendererBackendVulkan>(instance, surface, math::vec2ui { width, height }, std::move(hostAllocator));
+      backend->setPresentationConfig(presentation);
+      return backend;
     }
     case DIRECTX:
       ENJAM_ERROR("DIRECTX renderer backend is not supported for current platform.");
@@ -195,6 +202,8 @@ void PlatformGlfw::createWindow(RendererBackendType type) {
 }
 
 void PlatformGlfw::pollInputEvents(Input& input) {
+  frameLatency.onInputPolled();
+
   glfwSetWindowUserPointer(window, &input);
   glfwPollEvents();
   glfwSetWindowUserPointer(window, nullptr);
@@ -0,0 +1,268 @@
+#include <enjam/range_allocator.h>
+#include <enjam/assert.h>
+#include <algorithm>
+
+namespace Enjam {
+
+// Sizes are binned with a tiny floating point format: 5 bits of exponent and 3 bits of mantissa.
+// The top bin is the exponent, the leaf bin inside it is the mantissa.
+static constexpr uint32_t MANTISSA_BITS = 3;
+static constexpr uint32_t MANTISSA_VALUE = 1 << MANTISSA_BITS;
+static constexpr uint32_t MANTISSA_MASK = MANTISSA_VALUE - 1;
+
+static inline uint32_t highestSetBit(uint32_t value) {
+  uint32_t bit = 0;
+  while(value >>= 1) {
+    bit++;
+  }
+  return bit;
+}
+
+static inline uint32_t lowestSetBitAfter(uint32_t mask, uint32_t startBit) {
+  if(startBit >= 32) {
+    return RangeAllocator::NO_SPACE;
+  }
+
+  uint32_t masked = mask & ~((1u << startBit) - 1);
+  if(masked == 0) {
+    return RangeAllocator::NO_SPACE;
+  }
+
+  uint32_t bit = 0;
+  while(!(masked & (1u << bit))) {
+    bit++;
+  }
+  return bit;
+}
+
+// Smallest bin whose ranges are all large enough for the size
+static uint32_t toBinRoundUp(uint32_t size) {
+  if(size < MANTISSA_VALUE) {
+    return size;
+  }
+
+  uint32_t mantissaStartBit = highestSetBit(size) - MANTISSA_BITS;
+  uint32_t exponent = mantissaStartBit + 1;
+  uint32_t mantissa = (size >> mantissaStartBit) & MANTISSA_MASK;
+  if(size & ((1u << mantissaStartBit) - 1)) {
+    mantissa++;
+  }
+
+  // mantissa overflow carries into the exponent
+  return (exponent << MANTISSA_BITS) + mantissa;
+}
+
+// Bin the range of this size is stored in
+static uint32_t toBinRoundDown(uint32_t size) {
+  if(size < MANTISSA_VALUE) {
+    return size;
+  }
+
+  uint32_t mantissaStartBit = highestSetBit(size) - MANTISSA_BITS;
+  uint32_t exponent = mantissaStartBit + 1;
+  uint32_t mantissa = (size >> mantissaStartBit) & MANTISSA_MASK;
+  return (exponent << MANTISSA_BITS) | mantissa;
+}
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+  : capacity(capacity) {
+  reset();
+}
+
+void RangeAllocator::reset() {
+  freeSize = 0;
+  allocationsCount = 0;
+  usedBinsTop = 0;
+  usedBins.fill(0);
+  binHeads.fill(UNUSED);
+  nodes.clear();
+  freeNodes.clear();
+
+  if(capacity > 0) {
+    insertNodeIntoBin(capacity, 0);
+  }
+}
+
+uint32_t RangeAllocator::allocNode() {
+  if(!freeNodes.empty()) {
+    auto index = freeNodes.back();
+    freeNodes.pop_back();
+    return index;
+  }
+
+  nodes.emplace_back();
+  return uint32_t(nodes.size() - 1);
+}
+
+RangeAllocator::Range RangeAllocator::allocate(uint32_t size) {
+  if(size == 0 || size > freeSize) {
+    return { };
+  }
+
+  auto minBin = toBinRoundUp(size);
+  auto minTopBin = minBin / BINS_PER_LEAF;
+  auto minLeafBin = minBin % BINS_PER_LEAF;
+
+  auto topBin = minTopBin;
+  auto leafBin = NO_SPACE;
+
+  if(topBin < TOP_BINS_COUNT && (usedBinsTop & (1u << topBin))) {
+    leafBin = lowestSetBitAfter(usedBins[topBin], minLeafBin);
+  }
+
+  if(leafBin == NO_SPACE) {
+    topBin = lowestSetBitAfter(usedBinsTop, minTopBin + 1);
+    if(topBin == NO_SPACE) {
+      return { };
+    }
+    leafBin = lowestSetBitAfter(usedBins[topBin], 0);
+  }
+
+  auto bin = topBin * BINS_PER_LEAF + leafBin;
+  auto nodeIndex = binHeads[bin];
+  ENJAM_ASSERT(nodeIndex != UNUSED);
+
+  auto nodeSize = nodes[nodeIndex].size;
+  removeNodeFromBin(nodeIndex);
+
+  // the node keeps its index and neighbours, only its size shrinks to the allocation
+  freeNodes.pop_back();
+  auto& node = nodes[nodeIndex];
+  node.size = size;
+  node.used = true;
+  node.binPrev = UNUSED;
+  node.binNext = UNUSED;
+
+  auto offset = node.offset;
+  auto remainder = nodeSize - size;
+  if(remainder > 0) {
+    auto neighbourNext = node.neighbourNext;
+    auto remainderIndex = insertNodeIntoBin(remainder, offset + size);
+
+    if(neighbourNext != UNUSED) {
+      nodes[neighbourNext].neighbourPrev = remainderIndex;
+    }
+    nodes[remainderIndex].neighbourPrev = nodeIndex;
+    nodes[remainderIndex].neighbourNext = neighbourNext;
+    nodes[nodeIndex].neighbourNext = remainderIndex;
+  }
+
+  allocationsCount++;
+  return Range { .offset = offset, .size = size, .node = nodeIndex };
+}
+
+void RangeAllocator::free(const Range& range) {
+  if(!range.isValid()) {
+    return;
+  }
+
+  auto nodeIndex = range.node;
+  ENJAM_ASSERT(nodeIndex < nodes.size() && nodes[nodeIndex].used);
+
+  auto& node = nodes[nodeIndex];
+  auto offset = node.offset;
+  auto size = node.size;
+
+  if(node.neighbourPrev != UNUSED && !nodes[node.neighbourPrev].used) {
+    auto& prev = nodes[node.neighbourPrev];
+    offset = prev.offset;
+    size += prev.size;
+    removeNodeFromBin(node.neighbourPrev);
+    node.neighbourPrev = prev.neighbourPrev;
+  }
+
+  if(node.neighbourNext != UNUSED && !nodes[node.neighbourNext].used) {
+    auto& next = nodes[node.neighbourNext];
+    size += next.size;
+    removeNodeFromBin(node.neighbourNext);
+    node.neighbourNext = next.neighbourNext;
+  }
+
+  auto neighbourPrev = node.neighbourPrev;
+  auto neighbourNext = node.neighbourNext;
+  node = { };
+  freeNodes.push_back(nodeIndex);
+
+  auto mergedIndex = insertNodeIntoBin(size, offset);
+  if(neighbourPrev != UNUSED) {
+    nodes[mergedIndex].neighbourPrev = neighbourPrev;
+    nodes[neighbourPrev].neighbourNext = mergedIndex;
+  }
+  if(neighbourNext != UNUSED) {
+    nodes[mergedIndex].neighbourNext = neighbourNext;
+    nodes[neighbourNext].neighbourPrev = mergedIndex;
+  }
+
+  allocationsCount--;
+}
+
+uint32_t RangeAllocator::insertNodeIntoBin(uint32_t size, uint32_t offset) {
+  auto bin = toBinRoundDown(size);
+  auto topBin = bin / BINS_PER_LEAF;
+  auto leafBin = bin % BINS_PER_LEAF;
+
+  if(binHeads[bin] == UNUSED) {
+    usedBins[topBin] |= 1u << leafBin;
+    usedBinsTop |= 1u << topBin;
+  }
+
+  auto headIndex = binHeads[bin];
+  auto nodeIndex = allocNode();
+  nodes[nodeIndex] = Node { .offset = offset, .size = size, .binNext = headIndex };
+  if(headIndex != UNUSED) {
+    nodes[headIndex].binPrev = nodeIndex;
+  }
+  binHeads[bin] = nodeIndex;
+
+  freeSize += size;
+  return nodeIndex;
+}
+
+void RangeAllocator::removeNodeFromBin(uint32_t nodeIndex) {
+  auto& node = nodes[nodeIndex];
+
+  if(node.binPrev != UNUSED) {
+    nodes[node.binPrev].binNext = node.binNext;
+    if(node.binNext != UNUSED) {
+      nodes[node.binNext].binPrev = node.binPrev;
+    }
+  } else {
+    auto bin = toBinRoundDown(node.size);
+    auto topBin = bin / BINS_PER_LEAF;
+    auto leafBin = bin % BINS_PER_LEAF;
+
+    binHeads[bin] = node.binNext;
+    if(node.binNext != UNUSED) {
+      nodes[node.binNext].binPrev = UNUSED;
+    }
+
+    if(binHeads[bin] == UNUSED) {
+      usedBins[topBin] &= ~(1u << leafBin);
+      if(usedBins[topBin] == 0) {
+        usedBinsTop &= ~(1u << topBin);
+      }
+    }
+  }
+
+  freeNodes.push_back(nodeIndex);
+  freeSize -= node.size;
+}
+
+RangeAllocator::Stats RangeAllocator::getStats() const {
+  Stats stats {
+    .capacity = capacity,
+    .usedSize = capacity - freeSize,
+    .allocationsCount = allocationsCount
+  };
+
+  for(auto bin = 0; bin < LEAF_BINS_COUNT; bin++) {
+    for(auto index = binHeads[bin]; index != UNUSED; index = nodes[index].binNext) {
+      stats.freeRangesCount++;
+      stats.largestFreeRange = std::max(stats.largestFreeRange, nodes[index].size);
+    }
+  }
+
+  return stats;
+}
+
+}
@@ -1,10 +1,12 @@
 #include <enjam/render_primitive.h>
+#include <enjam/assert.h>
+#include <enjam/render_components.h>
+#include <enjam/material.h>
 
 namespace Enjam {
 
-IndexBuffer::IndexBuffer(RendererBackend& backend, size_t indexCount) {
-  uint8_t constexpr indexByteSize = sizeof(uint32_t);
-  handle = backend.createIndexBuffer(indexCount * indexByteSize);
+IndexBuffer::IndexBuffer(RendererBackend& backend, size_t indexCount, IndexType type) : type(type) {
+  handle = backend.createIndexBuffer(indexCount * getIndexSize(type), type);
 }
 
 void IndexBuffer::setBuffer(RendererBackend& backend, BufferDataDesc&& desc, uint32_t byteOffset) {
@@ -20,27 +22,52 @@ VertexBuffer::VertexBuffer(RendererBackend& backend, std::initializer_list<Verte
 }
 
 void VertexBuffer::setBuffer(RendererBackend& backend, uint32_t attributeIndex, BufferObject& bufferObj) {
-  auto& bufferHandle = bufferHandles[attributeIndex];
-  if(bufferHandle && bufferHandle.value()) {
-    backend.destroyBufferData(bufferHandle.value());
-    bufferHandle.reset();
-  }
-
-  backend.assignVertexBufferData(handle, attributeIndex, bufferObj.getHandle());
+  setInterleavedBuffer(backend, attributeIndex, 1, bufferObj);
 }
 
 void VertexBuffer::setBuffer(RendererBackend& backend, uint32_t attributeIndex, BufferDataDesc&& desc, uint32_t offset) {
-  auto& bufferHandle = bufferHandles[attributeIndex];
-  if(bufferHandle && bufferHandle.value()) {
-    backend.destroyBufferData(bufferHandle.value());
-    bufferHandle.reset();
-  }
+  releaseBuffers(backend, attributeIndex, 1);
 
   auto newBufferHandle = backend.createBufferData(desc.size, BufferTargetBinding::VERTEX);
   backend.updateBufferData(newBufferHandle, std::move(desc), offset);
   backend.assignVertexBufferData(handle, attributeIndex, newBufferHandle);
 
-  bufferHandle = newBufferHandle;
+  bufferHandles[attributeIndex] = newBufferHandle;
+}
+
+void VertexBuffer::setInterleavedBuffer(RendererBackend& backend, uint32_t firstAttribute, uint32_t attributesCount,
+                                        BufferDataDesc&& desc) {
+  ENJAM_ASSERT(attributesCount > 0);
+  releaseBuffers(backend, firstAttribute, attributesCount);
+
+  auto newBufferHandle = backend.createBufferData(desc.size, BufferTargetBinding::VERTEX);
+  backend.updateBufferData(newBufferHandle, std::move(desc), 0);
+  for(auto i = firstAttribute; i < firstAttribute + attributesCount; i++) {
+    backend.assignVertexBufferData(handle, i, newBufferHandle);
+  }
+
+  bufferHandles[firstAttribute] = newBufferHandle;
+}
+
+void VertexBuffer::setInterleavedBuffer(RendererBackend& backend, uint32_t firstAttribute, uint32_t attributesCount,
+                                        BufferObject& bufferObj) {
+  releaseBuffers(backend, firstAttribute, attributesCount);
+
+  for(auto i = firstAttribute; i < firstAttribute + attributesCount; i++) {
+    backend.assignVertexBufferData(handle, i, bufferObj.getHandle());
+  }
+}
+
+void VertexBuffer::releaseBuffers(RendererBackend& backend, uint32_t firstAttribute, uint32_t attributesCount) {
+  ENJAM_ASSERT(firstAttribute + attributesCount <= VERTEX_ARRAY_MAX_SIZE);
+
+  for(auto i = firstAttribute; i < firstAttribute + attributesCount; i++) {
+    auto& bufferHandle = bufferHandles[i];
+    if(bufferHandle && bufferHandle.value()) {
+      backend.destroyBufferData(bufferHandle.value());
+      bufferHandle.reset();
+    }
+  }
 }
 
 void VertexBuffer::destroy(RendererBackend& backend) {
@@ -68,4 +95,23 @@ void BufferObject::destroy(RendererBackend& backend) {
   backend.destroyBufferData(handle);
 }
 
-}
\ No newline at end of file
+ProgramHandle MaterialComponent::getDrawProgramHandle() const {
+  return instance ? instance->getMaterial().getProgramHandle() : programHandle;
+}
+
+DescriptorSetHandle MaterialComponent::getDrawDescriptorSetHandle() const {
+  return instance ? instance->getDescriptorSetHandle() : descriptorSetHandle;
+}
+
+uint64_t MaterialComponent::getSortKey() const {
+  if(instance) {
+    return instance->getSortKey();
+  }
+
+  // primitives without a material go after all the materials
+  constexpr uint64_t NO_MATERIAL_BIT = uint64_t(1) << 63;
+  auto programId = uint64_t(programHandle.getId()) & INT32_MAX;
+  return NO_MATERIAL_BIT | (programId << 32) | descriptorSetHandle.getId();
+}
+
+}
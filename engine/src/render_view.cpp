@@ -1,30 +1,367 @@
 #include <enjam/render_view.h>
 #include <enjam/scene.h>
+#include <enjam/render_components.h>
 #include <enjam/renderer_backend.h>
+#include <enjam/thread_pool.h>
+#include <enjam/assert.h>
+#include <algorithm>
+#include <cmath>
 
 namespace Enjam {
 
-void RenderView::prepareBuffers() {
+void FrameObjects::prepare(const Scene& scene) {
+  auto& entities = scene.getEntities();
+  bvh = &scene.getBvh();
+  if(registry != &entities || registryVersion != entities.getVersion()) {
+    rebuild(entities);
+  }
+
+  entities.forEachChunk<MaterialComponent>([this](uint32_t count, Entity* chunkEntities, MaterialComponent* chunkMaterials) {
+    for(uint32_t i = 0; i < count; i++) {
+      auto object = objectIndices[chunkEntities[i].index];
+      if(object != NO_OBJECT) {
+        sortKeys[object] = chunkMaterials[i].getSortKey();
+        materialIndices[object] = chunkMaterials[i].materialIndex;
+        programs[object] = chunkMaterials[i].getDrawProgramHandle();
+        descriptorSets[object] = chunkMaterials[i].getDrawDescriptorSetHandle();
+      }
+    }
+  });
+
+  lights.clear();
+  entities.forEachChunk<TransformComponent, LightComponent>(
+      [this](uint32_t count, Entity*, TransformComponent* chunkTransforms, LightComponent* chunkLights) {
+    for(uint32_t i = 0; i < count; i++) {
+      lights.push_back(FrameLight {
+          .position = chunkTransforms[i].world[3].xyz,
+          .radius = chunkLights[i].radius,
+          .color = chunkLights[i].color * chunkLights[i].intensity
+      });
+    }
+  });
+}
+
+void FrameObjects::rebuild(const EntityRegistry& entities) {
+  registry = &entities;
+  registryVersion = entities.getVersion();
+
+  auto count = entities.count<TransformComponent, MeshComponent, MaterialComponent>();
+  transforms.resize(count);
+  meshes.resize(count);
+  proxies.assign(count, Bvh::INVALID_PROXY);
+  lods.assign(count, nullptr);
+  occluders.assign(count, nullptr);
+  meshlets.assign(count, nullptr);
+  sortKeys.resize(count);
+  materialIndices.resize(count);
+  programs.resize(count);
+  descriptorSets.resize(count);
+  objectIndices.assign(entities.getCapacity(), NO_OBJECT);
+
+  uint32_t object = 0;
+  entities.forEachChunk<TransformComponent, MeshComponent, MaterialComponent>(
+      [this, &object](uint32_t count, Entity* chunkEntities, TransformComponent* chunkTransforms, MeshComponent* chunkMeshes,
+                      MaterialComponent*) {
+    for(uint32_t i = 0; i < count; i++, object++) {
+      objectIndices[chunkEntities[i].index] = object;
+      transforms[object] = &chunkTransforms[i].world;
+      meshes[object] = &chunkMeshes[i];
+    }
+  });
+
+  // optional components fill their column in separate passes over their own chunks
+  entities.forEachChunk<BoundsComponent>([this](uint32_t count, Entity* chunkEntities, BoundsComponent* chunkBounds) {
+    for(uint32_t i = 0; i < count; i++) {
+      auto object = objectIndices[chunkEntities[i].index];
+      if(object != NO_OBJECT) {
+        proxies[object] = chunkBounds[i].proxy;
+      }
+    }
+  });
+  entities.forEachChunk<LodComponent>([this](uint32_t count, Entity* chunkEntities, LodComponent* chunkLods) {
+    for(uint32_t i = 0; i < count; i++) {
+      auto object = objectIndices[chunkEntities[i].index];
+      if(object != NO_OBJECT) {
+        lods[object] = &chunkLods[i];
+      }
+    }
+  });
+  entities.forEachChunk<OccluderComponent>([this](uint32_t count, Entity* chunkEntities, OccluderComponent* chunkOccluders) {
+    for(uint32_t i = 0; i < count; i++) {
+      auto object = objectIndices[chunkEntities[i].index];
+      if(object != NO_OBJECT) {
+        occluders[object] = chunkOccluders[i].mesh.get();
+      }
+    }
+  });
+  entities.forEachChunk<MeshletComponent>([this](uint32_t count, Entity* chunkEntities, MeshletComponent* chunkMeshlets) {
+    for(uint32_t i = 0; i < count; i++) {
+      auto object = objectIndices[chunkEntities[i].index];
+      if(object != NO_OBJECT) {
+        meshlets[object] = chunkMeshlets[i].meshlets.get();
+      }
+    }
+  });
+
+  unboundedObjects.clear();
+  for(object = 0; object < count; object++) {
+    if(proxies[object] == Bvh::INVALID_PROXY) {
+      unboundedObjects.push_back(object);
+    }
+  }
+}
+
+void RenderView::prepareBuffers(ThreadPool& threadPool, const FrameObjects& objects) {
   // prepare per view buffer
   perViewUniformBufferData.projection = camera->projectionMatrix;
-  perViewUniformBufferData.view = inverse(camera->modelMatrix);
+  auto view = inverse(camera->modelMatrix);
+  perViewUniformBufferData.view = view;
+
+  // visible objects of the scene, their render data is shared with the other views
+  auto viewProjection = camera->projectionMatrix * view;
+  visibleEntities.clear();
+  scene->query(Frustum::fromMatrix(viewProjection), visibleEntities);
+
+  visibleObjects.clear();
+  for(auto entity : visibleEntities) {
+    auto object = objects.getObjectIndex(entity);
+    if(object != FrameObjects::NO_OBJECT) {
+      visibleObjects.push_back(object);
+    }
+  }
+  if(occlusionCullingEnabled) {
+    cullOccluded(viewProjection, objects, threadPool);
+  }
+
+  // primitives without bounds are always drawn
+  visibleObjects.insert(visibleObjects.end(), objects.unboundedObjects.begin(), objects.unboundedObjects.end());
+
+  drawCommands.clear();
+  lodPixelsPerUnit = camera->projectionMatrix[1][1] * float(viewportHeight) * 0.5f;
+  for(auto object : visibleObjects) {
+    auto& mesh = *objects.meshes[object];
+    auto command = DrawCommand {
+        .sortKey = objects.sortKeys[object],
+        .objectIndex = object,
+        .indexCount = mesh.indexCount,
+        .indexOffset = mesh.indexOffset
+    };
 
-  // prepare per object buffer
-  auto& primitives = scene->getPrimitives();
-  if(primitives.size() > perObjectUniformBufferData.size()) {
-    perObjectUniformBufferData.resize(primitives.size());
+    if(auto lods = objects.lods[object]; lods && objects.hasBounds(object)) {
+      auto& lod = lods->lods[selectLod(*lods, objects.getBounds(object), *objects.transforms[object])];
+      command.indexCount = lod.indexCount;
+      command.indexOffset = lod.indexOffset;
+    }
+    drawCommands.push_back(command);
   }
-  for(auto i = 0; i < primitives.size(); ++i) {
-    perObjectUniformBufferData[i].model = primitives[i].getTransform();
+
+  drawRanges.clear();
+  meshletStats = { };
+  if(meshletCullingEnabled) {
+    cullMeshlets(viewProjection, objects, threadPool);
   }
+
+  std::stable_sort(drawCommands.begin(), drawCommands.end(), [](const DrawCommand& lhs, const DrawCommand& rhs) {
+    return lhs.sortKey < rhs.sortKey;
+  });
+
+  lightClusters.build(view, camera->projectionMatrix, objects.lights, threadPool);
+}
+
+void RenderView::cullOccluded(const math::mat4f& viewProjection, const FrameObjects& objects, ThreadPool& threadPool) {
+  auto cameraPosition = camera->getPosition();
+
+  // the occluders covering most of the screen go first, until the culler budget runs out
+  occluders.clear();
+  for(auto object : visibleObjects) {
+    if(objects.occluders[object]) {
+      auto& bounds = objects.getBounds(object);
+      auto toCamera = bounds.getCenter() + (-cameraPosition);
+      auto extents = bounds.getExtents();
+      occluders.emplace_back(dot(extents, extents) / std::max(dot(toCamera, toCamera), 1e-4f), object);
+    }
+  }
+  std::sort(occluders.begin(), occluders.end(), [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+
+  occlusionCuller.begin(viewProjection);
+  for(auto& [size, object] : occluders) {
+    occlusionCuller.addOccluder(*objects.occluders[object], *objects.transforms[object]);
+  }
+  occlusionCuller.rasterize(threadPool);
+
+  // every object the BVH returned has bounds
+  visibleBounds.clear();
+  for(auto object : visibleObjects) {
+    visibleBounds.push_back(objects.getBounds(object));
+  }
+  visibleFlags.resize(visibleObjects.size());
+  occlusionCuller.cull(visibleBounds.data(), visibleBounds.size(), visibleFlags.data(), threadPool);
+
+  size_t count = 0;
+  for(size_t i = 0; i < visibleObjects.size(); i++) {
+    if(visibleFlags[i]) {
+      visibleObjects[count++] = visibleObjects[i];
+    }
+  }
+  visibleObjects.resize(count);
+}
+
+void RenderView::cullMeshlets(const math::mat4f& viewProjection, const FrameObjects& objects, ThreadPool& threadPool) {
+  auto cameraPosition = camera->getPosition();
+
+  // meshlets split the full mesh only, the coarser levels of detail are drawn whole
+  meshletObjects.clear();
+  meshletJobs.clear();
+  uint32_t rangesCount = 0;
+  for(uint32_t command = 0; command < drawCommands.size(); command++) {
+    auto object = drawCommands[command].objectIndex;
+    auto meshlets = objects.meshlets[object];
+    if(!meshlets || meshlets->size() < 2 || drawCommands[command].indexOffset != objects.meshes[object]->indexOffset) {
+      continue;
+    }
+
+    // the view is taken to mesh units, where the meshlet bounds and cones are
+    auto& world = *objects.transforms[object];
+    meshletObjects.push_back(MeshletObject {
+        .command = command,
+        .frustum = Frustum::fromMatrix(viewProjection * world),
+        .camera = (inverse(world) * math::vec4f { cameraPosition, 1 }).xyz,
+        .mirrored = dot(cross(world[0].xyz, world[1].xyz), world[2].xyz) < 0
+    });
+
+    auto meshletsCount = uint32_t(meshlets->size());
+    for(uint32_t first = 0; first < meshletsCount; first += MESHLETS_PER_JOB) {
+      auto count = std::min(MESHLETS_PER_JOB, meshletsCount - first);
+      meshletJobs.push_back(MeshletJob {
+          .object = uint32_t(meshletObjects.size() - 1),
+          .firstMeshlet = first,
+          .meshletsCount = count,
+          .firstRange = rangesCount,
+          .rangesCount = 0,
+          .stats = { }
+      });
+      rangesCount += count;
+    }
+  }
+  if(meshletJobs.empty()) {
+    return;
+  }
+
+  // at most one range per meshlet, the adjacent visible meshlets are merged
+  drawRanges.resize(rangesCount);
+  threadPool.parallelFor(meshletJobs.size(), [this, &objects](uint32_t index) {
+    auto& job = meshletJobs[index];
+    auto& meshletObject = meshletObjects[job.object];
+    auto& command = drawCommands[meshletObject.command];
+    auto& meshlets = *objects.meshlets[command.objectIndex];
+
+    job.rangesCount = 0;
+    job.stats = { .testedCount = job.meshletsCount };
+    auto ranges = &drawRanges[job.firstRange];
+    for(auto i = job.firstMeshlet; i < job.firstMeshlet + job.meshletsCount; i++) {
+      auto& meshlet = meshlets[i];
+      if(!meshletObject.frustum.intersects(Sphere { .center = meshlet.center, .radius = meshlet.radius })) {
+        job.stats.frustumCulledCount++;
+        continue;
+      }
+      if(!meshletObject.mirrored && meshlet.isBackfacing(meshletObject.camera)) {
+        job.stats.backfacingCount++;
+        continue;
+      }
+
+      auto indexOffset = command.indexOffset + meshlet.indexOffset;
+      if(job.rangesCount > 0 && ranges[job.rangesCount - 1].indexOffset + ranges[job.rangesCount - 1].indexCount == indexOffset) {
+        ranges[job.rangesCount - 1].indexCount += meshlet.indexCount;
+      } else {
+        ranges[job.rangesCount++] = DrawRange { .indexCount = meshlet.indexCount, .indexOffset = indexOffset };
+      }
+    }
+  });
+
+  // the ranges of every job are packed in order and the commands left with none are dropped
+  uint32_t packedCount = 0;
+  for(auto& job : meshletJobs) {
+    auto& command = drawCommands[meshletObjects[job.object].command];
+    if(job.firstMeshlet == 0) {
+      command.firstRange = packedCount;
+      command.rangesCount = 0;
+    }
+    if(job.rangesCount > 0 && command.rangesCount > 0) {
+      // the last range of the previous job may continue into this one
+      auto& last = drawRanges[packedCount - 1];
+      auto& first = drawRanges[job.firstRange];
+      if(last.indexOffset + last.indexCount == first.indexOffset) {
+        last.indexCount += first.indexCount;
+        job.firstRange++;
+        job.rangesCount--;
+      }
+    }
+    // packing only moves ranges towards the front, which std::copy allows on the same array
+    ENJAM_ASSERT(packedCount <= job.firstRange);
+    auto ranges = drawRanges.begin() + job.firstRange;
+    std::copy(ranges, ranges + job.rangesCount, drawRanges.begin() + packedCount);
+    packedCount += job.rangesCount;
+    command.rangesCount += job.rangesCount;
+
+    meshletStats.testedCount += job.stats.testedCount;
+    meshletStats.frustumCulledCount += job.stats.frustumCulledCount;
+    meshletStats.backfacingCount += job.stats.backfacingCount;
+  }
+  drawRanges.resize(packedCount);
+
+  visibleFlags.assign(drawCommands.size(), 1);
+  for(auto& meshletObject : meshletObjects) {
+    visibleFlags[meshletObject.command] = drawCommands[meshletObject.command].rangesCount > 0;
+  }
+  size_t count = 0;
+  for(size_t i = 0; i < drawCommands.size(); i++) {
+    if(visibleFlags[i]) {
+      drawCommands[count++] = drawCommands[i];
+    }
+  }
+  drawCommands.resize(count);
+}
+
+uint32_t RenderView::selectLod(const LodComponent& lods, const Aabb& worldBounds, const math::mat4f& world) const {
+  // errors are in local units, scaled by the largest axis of the transform
+  auto scale = std::max({ length(world[0].xyz), length(world[1].xyz), length(world[2].xyz) });
+  auto distance = std::sqrt(Sphere { .center = camera->getPosition() }.distanceSquared(worldBounds));
+  auto pixelsPerUnit = lodPixelsPerUnit * scale / std::max(distance, 1e-4f);
+
+  for(auto i = lods.lodsCount - 1; i > 0; i--) {
+    if(lods.lods[i].error * pixelsPerUnit <= lodErrorThreshold) {
+      return i;
+    }
+  }
+  return 0;
 }
 
 void RenderView::updateViewUniformBuffer(RendererBackend& rendererBackend, BufferDataHandle handle) {
   rendererBackend.updateBufferData(handle, { &perViewUniformBufferData, sizeof(perViewUniformBufferData) }, 0);
 }
 
-void RenderView::updateObjectUniformBuffer(RendererBackend& rendererBackend, BufferDataHandle handle, uint32_t primitiveIndex) {
-  rendererBackend.updateBufferData(handle, { &perObjectUniformBufferData[primitiveIndex], sizeof(PerObjectUniforms) }, 0);
+void RenderView::updateLightBuffers(RendererBackend& rendererBackend,
+                                    BufferDataHandle lightsHandle,
+                                    BufferDataHandle clustersHandle,
+                                    BufferDataHandle indicesHandle) {
+  // only the used parts of the light and index arrays are uploaded
+  auto& stats = lightClusters.getStats();
+  auto& lights = lightClusters.getLights();
+  if(stats.lightsCount > 0) {
+    auto lightsSize = stats.lightsCount * sizeof(std140::vec4);
+    rendererBackend.updateBufferData(lightsHandle, { (void*) lights.positionRadius.data(), lightsSize }, 0);
+    rendererBackend.updateBufferData(lightsHandle, { (void*) lights.colors.data(), lightsSize },
+                                     offsetof(LightsUniforms, colors));
+  }
+
+  auto& clusters = lightClusters.getClusters();
+  rendererBackend.updateBufferData(clustersHandle, { (void*) &clusters, sizeof(clusters) }, 0);
+
+  if(stats.indicesCount > 0) {
+    auto& indices = lightClusters.getIndices();
+    auto indicesSize = (stats.indicesCount + 15) / 16 * sizeof(indices.indices[0]);
+    rendererBackend.updateBufferData(indicesHandle, { (void*) indices.indices.data(), indicesSize }, 0);
+  }
 }
 
 }
\ No newline at end of file
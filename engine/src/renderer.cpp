@@ -1,60 +1,187 @@
 #include <enjam/renderer.h>
 #include <enjam/renderer_backend.h>
 #include <enjam/assert.h>
+#include <enjam/log.h>
 #include <enjam/render_view.h>
 #include <enjam/scene.h>
+#include <enjam/render_components.h>
 
 namespace Enjam {
 
 Renderer::Renderer(RendererBackend& backend)
-    : rendererBackend(backend) {
+    : rendererBackend(backend)
+    , materialSystem(backend) {
 }
 
 void Renderer::init() {
   bool initialized = rendererBackend.init();
   ENJAM_ASSERT(initialized && "Failed to initialize renderer backend.");
 
-  viewDescriptorSetHandle = rendererBackend.createDescriptorSet(DescriptorSetData {
-      .bindings {
-          { .binding = 0, .type = DescriptorType::UNIFORM_BUFFER },
-          { .binding = 1, .type = DescriptorType::UNIFORM_BUFFER }
-      }
-  });
-
-  viewUniformBufferHandle = rendererBackend.createBufferData(sizeof(PerViewUniforms), BufferTargetBinding::UNIFORM);
-  rendererBackend.updateDescriptorSetBuffer(viewDescriptorSetHandle, 0, viewUniformBufferHandle, sizeof(PerViewUniforms), 0);
+  // the light blocks are bound whole
+  auto maxBlockSize = rendererBackend.getMaxUniformBlockSize();
+  for(auto [name, size] : { std::pair { "lights", sizeof(LightsUniforms) },
+                            std::pair { "light clusters", sizeof(LightClustersUniforms) },
+                            std::pair { "light indices", sizeof(LightIndicesUniforms) } }) {
+    if(size > maxBlockSize) {
+      ENJAM_ERROR("The {} uniform block is {} bytes, the renderer backend reads at most {}", name, size, maxBlockSize);
+    }
+  }
 
-  objectsUniformBufferHandle = rendererBackend.createBufferData(sizeof(PerObjectUniforms), BufferTargetBinding::UNIFORM);
-  rendererBackend.updateDescriptorSetBuffer(viewDescriptorSetHandle, 1, objectsUniformBufferHandle, sizeof(PerObjectUniforms), 0);
+  getViewResources(0);
 }
 
 void Renderer::shutdown() {
-  rendererBackend.destroyDescriptorSet(viewDescriptorSetHandle);
-  rendererBackend.destroyBufferData(viewUniformBufferHandle);
-  rendererBackend.destroyBufferData(objectsUniformBufferHandle);
+  materialSystem.destroy();
+  for(auto& resources : viewResources) {
+    rendererBackend.destroyDescriptorSet(resources.descriptorSetHandle);
+    rendererBackend.destroyBufferData(resources.uniformBufferHandle);
+    rendererBackend.destroyBufferData(resources.lightsBufferHandle);
+    rendererBackend.destroyBufferData(resources.lightClustersBufferHandle);
+    rendererBackend.destroyBufferData(resources.lightIndicesBufferHandle);
+  }
+  viewResources.clear();
 
   rendererBackend.shutdown();
 }
 
+Renderer::ViewResources& Renderer::getViewResources(uint32_t view) {
+  while(viewResources.size() <= view) {
+    auto descriptorSetHandle = rendererBackend.createDescriptorSet(DescriptorSetData {
+        .bindings {
+            { .binding = VIEW_BINDING, .type = DescriptorType::UNIFORM_BUFFER },
+            { .binding = LIGHTS_BINDING, .type = DescriptorType::UNIFORM_BUFFER },
+            { .binding = LIGHT_CLUSTERS_BINDING, .type = DescriptorType::UNIFORM_BUFFER },
+            { .binding = LIGHT_INDICES_BINDING, .type = DescriptorType::UNIFORM_BUFFER }
+        }
+    });
+
+    auto createBuffer = [this, descriptorSetHandle](uint8_t binding, uint32_t size) {
+      auto handle = rendererBackend.createBufferData(size, BufferTargetBinding::UNIFORM);
+      rendererBackend.updateDescriptorSetBuffer(descriptorSetHandle, binding, handle, size, 0);
+      return handle;
+    };
+
+    viewResources.push_back(ViewResources {
+        .descriptorSetHandle = descriptorSetHandle,
+        .uniformBufferHandle = createBuffer(VIEW_BINDING, sizeof(PerViewUniforms)),
+        .lightsBufferHandle = createBuffer(LIGHTS_BINDING, sizeof(LightsUniforms)),
+        .lightClustersBufferHandle = createBuffer(LIGHT_CLUSTERS_BINDING, sizeof(LightClustersUniforms)),
+        .lightIndicesBufferHandle = createBuffer(LIGHT_INDICES_BINDING, sizeof(LightIndicesUniforms))
+    });
+  }
+  return viewResources[view];
+}
+
 void Renderer::draw(RenderView& renderView) {
-  renderView.prepareBuffers();
+  draw(std::vector<RenderView*> { &renderView });
+}
 
-  rendererBackend.beginFrame();
+void Renderer::draw(const std::vector<RenderView*>& views) {
+  if(views.empty()) {
+    return;
+  }
+
+  auto& scene = *views.front()->scene;
+  for(auto view : views) {
+    ENJAM_ASSERT(view->scene == &scene && "Views drawn together should show the same scene");
+  }
+
+  scene.getEntities().each<MaterialComponent>([this](Entity, MaterialComponent& material) {
+    if(material.instance) {
+      materialSystem.update(*material.instance);
+    }
+  });
 
-  rendererBackend.bindDescriptorSet(viewDescriptorSetHandle, 0);
+  scene.updateTransforms();
+  scene.updateSpatialIndex();
+  frameObjects.prepare(scene);
+
+  // a single view keeps the pool for its own occlusion culling
+  if(views.size() == 1) {
+    views.front()->prepareBuffers(threadPool, frameObjects);
+  } else {
+    threadPool.parallelFor(views.size(), [this, &views](uint32_t view) {
+      views[view]->prepareBuffers(threadPool, frameObjects);
+    });
+  }
+
+  stats = Stats { .viewsCount = uint32_t(views.size()), .objectsCount = frameObjects.getCount() };
+  for(auto view : views) {
+    stats.drawCallsCount += view->drawCommands.size();
+    for(auto& command : view->drawCommands) {
+      if(command.rangesCount > 0) {
+        for(uint32_t range = 0; range < command.rangesCount; range++) {
+          stats.trianglesCount += view->drawRanges[command.firstRange + range].indexCount / 3;
+        }
+      } else {
+        stats.trianglesCount += command.indexCount / 3;
+      }
+    }
+    stats.lightsCount += view->lightClusters.getStats().lightsCount;
+    stats.lightIndicesCount += view->lightClusters.getStats().indicesCount;
+
+    if(view->occlusionCullingEnabled) {
+      auto& occlusion = view->getOcclusionStats();
+      stats.occlusion.occludersCount += occlusion.occludersCount;
+      stats.occlusion.occluderTrianglesCount += occlusion.occluderTrianglesCount;
+      stats.occlusion.testedCount += occlusion.testedCount;
+      stats.occlusion.culledCount += occlusion.culledCount;
+      stats.occlusion.rasterizeMs += occlusion.rasterizeMs;
+      stats.occlusion.testMs += occlusion.testMs;
+    }
+    if(view->meshletCullingEnabled) {
+      auto& meshlets = view->getMeshletStats();
+      stats.meshlets.testedCount += meshlets.testedCount;
+      stats.meshlets.frustumCulledCount += meshlets.frustumCulledCount;
+      stats.meshlets.backfacingCount += meshlets.backfacingCount;
+    }
+  }
 
-  renderView.updateViewUniformBuffer(rendererBackend, viewUniformBufferHandle);
+  for(uint32_t i = 0; i < views.size(); i++) {
+    getViewResources(i);
+  }
 
-  auto& primitives = renderView.scene->getPrimitives();
-  for(auto i = 0; i < primitives.size(); ++i) {
-    auto& primitive = primitives[i];
+  rendererBackend.beginFrame();
 
-    rendererBackend.bindDescriptorSet(primitive.getDescriptorSetHandle(), 1);
-    renderView.updateObjectUniformBuffer(rendererBackend, objectsUniformBufferHandle, i);
-    rendererBackend.draw(primitive.getProgramHandle(), primitive.getVertexBuffer()->getHandle(), primitive.getIndexBuffer()->getHandle());
+  for(uint32_t i = 0; i < views.size(); i++) {
+    rendererBackend.bindDescriptorSet(viewResources[i].descriptorSetHandle, 0);
+    views[i]->updateViewUniformBuffer(rendererBackend, viewResources[i].uniformBufferHandle);
+    views[i]->updateLightBuffers(rendererBackend,
+                                 viewResources[i].lightsBufferHandle,
+                                 viewResources[i].lightClustersBufferHandle,
+                                 viewResources[i].lightIndicesBufferHandle);
+
+    for(auto& command : views[i]->drawCommands) {
+      auto object = command.objectIndex;
+      PerObjectUniforms uniforms { };
+      auto& mesh = *frameObjects.meshes[object];
+      uniforms.model = *frameObjects.transforms[object];
+      for(auto k = 0; k < 4; k++) {
+        uniforms.positionDecode[k] = mesh.positionDecode[k];
+      }
+      uniforms.materialIndex = frameObjects.materialIndices[object];
+
+      rendererBackend.bindDescriptorSet(frameObjects.descriptorSets[object], Material::MATERIAL_SET);
+      rendererBackend.setPushConstants(&uniforms, sizeof(PerObjectUniforms));
+      if(command.rangesCount > 0) {
+        rendererBackend.multiDraw(frameObjects.programs[object],
+                                  mesh.vertexBuffer,
+                                  mesh.indexBuffer,
+                                  &views[i]->drawRanges[command.firstRange],
+                                  command.rangesCount,
+                                  mesh.baseVertex);
+        continue;
+      }
+      rendererBackend.draw(frameObjects.programs[object],
+                           mesh.vertexBuffer,
+                           mesh.indexBuffer,
+                           command.indexCount,
+                           command.indexOffset,
+                           mesh.baseVertex);
+    }
   }
 
   rendererBackend.endFrame();
 }
 
-}
\ No newline at end of file
+}
@@ -3,6 +3,7 @@
 #include <enjam/assert.h>
 #include <enjam/type_traits_helpers.h>
 
+#include <algorithm>
 #include <utility>
 
 #include "opengl_types.h"
@@ -19,6 +20,10 @@ namespace Enjam {
 #	define GL_CHECK_ERRORS()
 #endif // GL_API_DEBUG
 
+static inline uint32_t alignUp(uint32_t value, uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
 static void checkErrors(const char* location) {
   GLenum err = glGetError();
   if (err != GL_NO_ERROR) {
@@ -26,9 +31,10 @@ static void checkErrors(const char* location) {
   }
 }
 
-RendererBackendOpengl::RendererBackendOpengl(GLLoaderProc loaderProc, GLSwapChain* swapChain)
+RendererBackendOpengl::RendererBackendOpengl(GLLoaderProc loaderProc, GLSwapChain* swapChain, FrameLatency* frameLatency)
   : loaderProc(loaderProc)
   , swapChain(swapChain)
+  , frameLatency(frameLatency)
   , boundDescriptorSets()
   { }
 
@@ -61,16 +67,43 @@ bool RendererBackendOpengl::init() {
   glGenVertexArrays(1, &defaultVertexArray);
   GL_CHECK_ERRORS();
 
+  GLint uniformBufferOffsetAlignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformBufferOffsetAlignment);
+  pushConstantsRing.alignment = std::max(1, uniformBufferOffsetAlignment);
+  uniformBufferPool.alignment = std::max(1, uniformBufferOffsetAlignment);
+
+  GLint maxBlockSize = 0;
+  glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize);
+  maxUniformBlockSize = uint32_t(std::max(0, maxBlockSize));
+
+  glGenBuffers(1, &pushConstantsRing.id);
+  glBindBuffer(GL_UNIFORM_BUFFER, pushConstantsRing.id);
+  glBufferData(GL_UNIFORM_BUFFER, GLPushConstantsRing::SIZE, nullptr, GL_STREAM_DRAW);
+  GL_CHECK_ERRORS();
+
   return true;
 }
 
 void RendererBackendOpengl::shutdown() {
+  uniformBufferPool.logStats();
+  uniformBufferPool.destroy();
 
+  if(pushConstantsRing.id) {
+    glDeleteBuffers(1, &pushConstantsRing.id);
+    pushConstantsRing = { };
+    GL_CHECK_ERRORS();
+  }
 }
 
 void RendererBackendOpengl::beginFrame() {
   swapChain->makeCurrent();
 
+  if(presentationConfigDirty) {
+    // GL has no control over the images count, the driver decides how many back buffers to use
+    swapChain->setSwapInterval(OpenGL::toSwapInterval(presentationConfig.presentMode));
+    presentationConfigDirty = false;
+  }
+
   glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -79,6 +112,16 @@ void RendererBackendOpengl::beginFrame() {
 
 void RendererBackendOpengl::endFrame() {
   swapChain->swapBuffers();
+  uniformBufferPool.trim();
+
+  if(frameLatency) {
+    frameLatency->onPresented();
+  }
+}
+
+void RendererBackendOpengl::setPresentationConfig(const PresentationConfig& config) {
+  presentationConfig = config;
+  presentationConfigDirty = true;
 }
 
 uint32_t compileShader(GLenum stage, const uint8_t* data, int32_t size) {
@@ -149,6 +192,13 @@ ProgramHandle RendererBackendOpengl::createProgram(ProgramData& data) {
         case ProgramData::DescriptorType::UNIFORM: {
           uint32_t index = glGetUniformBlockIndex(id, desc.name.c_str());
           glUniformBlockBinding(id, index, uniqueBinding);
+          if(desc.size > 0 && index != GL_INVALID_INDEX) {
+            GLint blockSize = 0;
+            glGetActiveUniformBlockiv(id, index, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+            if(uint32_t(blockSize) != desc.size) {
+              ENJAM_ERROR("Uniform block {} is {} bytes in the shader but {} in the program data", desc.name, blockSize, desc.size);
+            }
+          }
           break;
         }
       }
@@ -158,6 +208,16 @@ ProgramHandle RendererBackendOpengl::createProgram(ProgramData& data) {
     }
   }
 
+  auto& pushConstantsInfo = data.getPushConstants();
+  if(!pushConstantsInfo.name.empty()) {
+    uint32_t index = glGetUniformBlockIndex(id, pushConstantsInfo.name.c_str());
+    ENJAM_ASSERT(index != GL_INVALID_INDEX);
+    glUniformBlockBinding(id, index, uniqueBinding);
+
+    p->pushConstantsBinding = uniqueBinding;
+    uniqueBinding++;
+  }
+
   GL_CHECK_ERRORS();
 
   p->id = id;
@@ -165,6 +225,10 @@ ProgramHandle RendererBackendOpengl::createProgram(ProgramData& data) {
 }
 
 void RendererBackendOpengl::destroyProgram(ProgramHandle ph) {
+  if(appliedProgram == ph) {
+    appliedProgram = { };
+  }
+
   auto p = handleAllocator.cast<GLProgram*>(ph);
   glDeleteProgram(p->id);
   GL_CHECK_ERRORS();
@@ -178,6 +242,13 @@ DescriptorSetHandle RendererBackendOpengl::createDescriptorSet(DescriptorSetData
 }
 
 void RendererBackendOpengl::destroyDescriptorSet(DescriptorSetHandle dsh) {
+  // the handle may be reused, it must not pass for the bound set
+  for(auto& bound : boundDescriptorSets) {
+    if(bound == dsh) {
+      bound = { };
+    }
+  }
+
   auto ds = handleAllocator.cast<GLDescriptorSet*>(dsh);
 
   handleAllocator.dealloc(dsh, ds);
@@ -189,10 +260,13 @@ void RendererBackendOpengl::updateDescriptorSetBuffer(DescriptorSetHandle dsh, u
 
   ENJAM_ASSERT(bd->target == GL_UNIFORM_BUFFER);
 
+  ENJAM_ASSERT(offset + size <= bd->size);
+
   auto& descriptor = std::get<GLDescriptorBuffer>(ds->descriptors[binding]);
   descriptor.id = bd->id;
   descriptor.size = size;
-  descriptor.offset = offset;
+  descriptor.offset = bd->offset + offset;
+  invalidateDescriptorSet(dsh);
 }
 
 void RendererBackendOpengl::updateDescriptorSetTexture(DescriptorSetHandle dsh, uint8_t binding, TextureHandle th) {
@@ -202,10 +276,144 @@ void RendererBackendOpengl::updateDescriptorSetTexture(DescriptorSetHandle dsh,
   auto& descriptor = std::get<GLDescriptorTexture>(ds->descriptors[binding]);
   descriptor.id = t->id;
   descriptor.target = t->target;
+  invalidateDescriptorSet(dsh);
 }
 
 void RendererBackendOpengl::bindDescriptorSet(DescriptorSetHandle dsh, uint8_t set) {
-  boundDescriptorSets[set] = dsh;
+  if(boundDescriptorSets[set] != dsh) {
+    boundDescriptorSets[set] = dsh;
+    dirtyDescriptorSets.set(set);
+  }
+}
+
+void RendererBackendOpengl::invalidateDescriptorSet(DescriptorSetHandle dsh) {
+  for(uint32_t set = 0; set < boundDescriptorSets.size(); set++) {
+    if(boundDescriptorSets[set] == dsh) {
+      dirtyDescriptorSets.set(set);
+    }
+  }
+}
+
+void RendererBackendOpengl::setPushConstants(const void* data, uint32_t size, uint32_t offset) {
+  ENJAM_ASSERT(offset + size <= pushConstants.size());
+  std::memcpy(pushConstants.data() + offset, data, size);
+  pushConstantsSize = std::max(pushConstantsSize, offset + size);
+  pushConstantsDirty = true;
+}
+
+void RendererBackendOpengl::updatePushConstants(GLProgram* program) {
+  if(program->pushConstantsBinding == GLProgram::NO_PUSH_CONSTANTS || pushConstantsSize == 0) {
+    return;
+  }
+
+  auto& ring = pushConstantsRing;
+  glBindBuffer(GL_UNIFORM_BUFFER, ring.id);
+
+  if(pushConstantsDirty) {
+    if(ring.head + pushConstantsSize > GLPushConstantsRing::SIZE) {
+      // orphan the storage instead of waiting on draws that still read the previous slices
+      glBufferData(GL_UNIFORM_BUFFER, GLPushConstantsRing::SIZE, nullptr, GL_STREAM_DRAW);
+      ring.head = 0;
+    }
+
+    glBufferSubData(GL_UNIFORM_BUFFER, ring.head, pushConstantsSize, pushConstants.data());
+    ring.lastOffset = ring.head;
+    ring.head = alignUp(ring.head + pushConstantsSize, ring.alignment);
+    pushConstantsDirty = false;
+  }
+
+  glBindBufferRange(GL_UNIFORM_BUFFER, program->pushConstantsBinding, ring.id, ring.lastOffset, pushConstantsSize);
+  GL_CHECK_ERRORS();
+}
+
+bool GLUniformBufferPool::alloc(uint32_t size, GLBufferData& bd) {
+  if(size == 0 || size > MAX_SLICE_SIZE) {
+    return false;
+  }
+
+  auto units = (size + alignment - 1) / alignment;
+  uint32_t index = 0;
+  RangeAllocator::Range range;
+  for(; index < blocks.size(); index++) {
+    if(blocks[index].id != 0 && (range = blocks[index].ranges.allocate(units)).isValid()) {
+      break;
+    }
+  }
+
+  // a released slot is filled again before the pool grows
+  if(index == blocks.size()) {
+    auto released = std::find_if(blocks.begin(), blocks.end(), [](const Block& block) { return block.id == 0; });
+    index = uint32_t(released - blocks.begin());
+    if(released == blocks.end()) {
+      blocks.push_back(Block { .ranges = RangeAllocator { BLOCK_SIZE / alignment } });
+    }
+
+    auto& block = blocks[index];
+    glGenBuffers(1, &block.id);
+    glBindBuffer(GL_UNIFORM_BUFFER, block.id);
+    glBufferData(GL_UNIFORM_BUFFER, BLOCK_SIZE, nullptr, GL_DYNAMIC_DRAW);
+    GL_CHECK_ERRORS();
+
+    range = block.ranges.allocate(units);
+    ENJAM_ASSERT(range.isValid());
+  }
+
+  auto& block = blocks[index];
+  block.slicesCount++;
+  block.idleFrames = 0;
+
+  bd.id = block.id;
+  bd.size = size;
+  bd.offset = range.offset * alignment;
+  bd.target = GL_UNIFORM_BUFFER;
+  bd.poolBlock = index;
+  bd.poolRange = range;
+  return true;
+}
+
+void GLUniformBufferPool::free(GLBufferData& bd) {
+  ENJAM_ASSERT(bd.poolBlock < blocks.size());
+  auto& block = blocks[bd.poolBlock];
+  block.ranges.free(bd.poolRange);
+  block.slicesCount--;
+  bd.poolRange = { };
+}
+
+void GLUniformBufferPool::trim() {
+  for(auto& block : blocks) {
+    if(block.id == 0 || block.slicesCount > 0 || ++block.idleFrames < IDLE_FRAMES) {
+      continue;
+    }
+
+    glDeleteBuffers(1, &block.id);
+    GL_CHECK_ERRORS();
+    block.id = 0;
+    block.idleFrames = 0;
+  }
+
+  // no slice refers to the released blocks at the end
+  while(!blocks.empty() && blocks.back().id == 0) {
+    blocks.pop_back();
+  }
+}
+
+void GLUniformBufferPool::destroy() {
+  for(auto& block : blocks) {
+    glDeleteBuffers(1, &block.id);
+  }
+  GL_CHECK_ERRORS();
+  blocks.clear();
+}
+
+void GLUniformBufferPool::logStats() const {
+  for(uint32_t i = 0; i < blocks.size(); i++) {
+    if(blocks[i].id == 0) {
+      continue;
+    }
+    auto stats = blocks[i].ranges.getStats();
+    ENJAM_INFO("Uniform buffer pool block {}: {}/{} bytes used by {} slices, fragmentation {:.2f}",
+               i, stats.usedSize * alignment, BLOCK_SIZE, stats.allocationsCount, stats.fragmentation());
+  }
 }
 
 void GLDescriptorBuffer::bind(uint8_t binding) const {
@@ -242,15 +450,23 @@ void RendererBackendOpengl::assignVertexBufferData(VertexBufferHandle vbh, uint8
   auto bd = handleAllocator.cast<GLBufferData*>(bdh);
   ENJAM_ASSERT(bd->target == GL_ARRAY_BUFFER);
   vb->attributes[attributeIndex].bufferId = bd->id;
+
+  if(boundVertexBuffer == vbh) {
+    boundVertexBuffer = { };
+  }
 }
 
 void RendererBackendOpengl::destroyVertexBuffer(VertexBufferHandle vbh) {
   auto vb = handleAllocator.cast<GLVertexBuffer*>(vbh);
 
+  if(boundVertexBuffer == vbh) {
+    boundVertexBuffer = { };
+  }
+
   handleAllocator.dealloc(vbh, vb);
 }
 
-IndexBufferHandle RendererBackendOpengl::createIndexBuffer(uint32_t size) {
+IndexBufferHandle RendererBackendOpengl::createIndexBuffer(uint32_t size, IndexType type) {
   auto ibh = handleAllocator.allocAndConstruct<GLIndexBuffer>();
   auto ib = handleAllocator.cast<GLIndexBuffer*>(ibh);
 
@@ -260,6 +476,7 @@ IndexBufferHandle RendererBackendOpengl::createIndexBuffer(uint32_t size) {
   GL_CHECK_ERRORS();
 
   ib->size = size;
+  ib->type = type;
 
   return ibh;
 }
@@ -269,6 +486,10 @@ BufferDataHandle RendererBackendOpengl::createBufferData(uint32_t size, BufferTa
   auto bd = handleAllocator.cast<GLBufferData*>(bdh);
 
   auto target = OpenGL::toBufferBinding(bufferBinding);
+  if(target == GL_UNIFORM_BUFFER && uniformBufferPool.alloc(size, *bd)) {
+    return bdh;
+  }
+
   glGenBuffers(1, &bd->id);
   glBindBuffer(target, bd->id);
   glBufferData(target, size, nullptr, GL_STATIC_DRAW);
@@ -302,11 +523,11 @@ void RendererBackendOpengl::updateIndexBuffer(IndexBufferHandle ibh, BufferDataD
 void RendererBackendOpengl::updateBufferData(BufferDataHandle bdh, BufferDataDesc&& dataDesc, uint32_t byteOffset) {
   auto bd = handleAllocator.cast<GLBufferData*>(bdh);
 
-  ENJAM_ASSERT(byteOffset + bd->size <= bd->size)
+  ENJAM_ASSERT(byteOffset + dataDesc.size <= bd->size)
 
   auto target = bd->target;
   glBindBuffer(target, bd->id);
-  glBufferSubData(target, byteOffset, dataDesc.size, dataDesc.data);
+  glBufferSubData(target, bd->offset + byteOffset, dataDesc.size, dataDesc.data);
   GL_CHECK_ERRORS();
 
   if(dataDesc.onConsumed) {
@@ -316,8 +537,12 @@ void RendererBackendOpengl::updateBufferData(BufferDataHandle bdh, BufferDataDes
 
 void RendererBackendOpengl::destroyBufferData(BufferDataHandle bdh) {
   auto bd = handleAllocator.cast<GLBufferData*>(bdh);
-  glDeleteBuffers(1, &bd->id);
-  GL_CHECK_ERRORS();
+  if(bd->isPooled()) {
+    uniformBufferPool.free(*bd);
+  } else {
+    glDeleteBuffers(1, &bd->id);
+    GL_CHECK_ERRORS();
+  }
 
   handleAllocator.dealloc(bdh, bd);
 }
@@ -358,14 +583,8 @@ TextureHandle RendererBackendOpengl::createTexture(uint32_t width, uint32_t heig
 
   glGenTextures(1, &t->id);
   glBindTexture(t->target, t->id);
-
-  // set the texture wrapping parameters
-  glTexParameteri(t->target, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-  glTexParameteri(t->target, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-  // set texture filtering parameters
-  glTexParameteri(t->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(t->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  dirtyDescriptorSets.set(); // the active texture unit may hold a bound descriptor
+  setDefaultTextureParameters(t->target);
 
   // TODO: use this for GL ES 3.0
   // glTexStorage2D(t->target, GLsizei(levels), t->glFormat, GLsizei(width), GLsizei(height));
@@ -380,6 +599,41 @@ TextureHandle RendererBackendOpengl::createTexture(uint32_t width, uint32_t heig
   return th;
 }
 
+TextureHandle RendererBackendOpengl::createTextureArray(uint32_t width, uint32_t height, uint8_t levels, uint32_t layers, TextureFormat format) {
+  auto th = handleAllocator.allocAndConstruct<GLTexture>();
+  auto t = handleAllocator.cast<GLTexture*>(th);
+  t->target = GL_TEXTURE_2D_ARRAY;
+
+  t->glFormat = OpenGL::toGLTextureInternalFormat(format);
+
+  GLenum pixelFormat = OpenGL::toGLPixelFormat(t->glFormat);
+  GLenum pixelType = OpenGL::toGLPixelType(t->glFormat);
+
+  glGenTextures(1, &t->id);
+  glBindTexture(t->target, t->id);
+  dirtyDescriptorSets.set(); // the active texture unit may hold a bound descriptor
+  setDefaultTextureParameters(t->target);
+
+  for (auto i = 0; i < levels; i++) {
+    glTexImage3D(t->target, i, GLint(t->glFormat), GLsizei(width), GLsizei(height), GLsizei(layers), 0, pixelFormat, pixelType, NULL);
+    width = std::max(1u, width / 2);
+    height = std::max(1u, height / 2);
+  }
+  GL_CHECK_ERRORS();
+
+  return th;
+}
+
+void RendererBackendOpengl::setDefaultTextureParameters(GLenum target) {
+  // set the texture wrapping parameters
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  // set texture filtering parameters
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
 void RendererBackendOpengl::setTextureData(
     TextureHandle th, uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
     uint32_t width, uint32_t height, uint32_t depth, const void* data) {
@@ -389,9 +643,16 @@ void RendererBackendOpengl::setTextureData(
   GLenum pixelType = OpenGL::toGLPixelType(t->glFormat);
 
   glBindTexture(t->target, t->id);
-  glTexSubImage2D(t->target, GLint(level),
-                  GLint(xoffset), GLint(yoffset),
-                  GLsizei(width), GLsizei(height), pixelFormat, pixelType, data);
+  dirtyDescriptorSets.set(); // the active texture unit may hold a bound descriptor
+  if(t->target == GL_TEXTURE_2D_ARRAY) {
+    glTexSubImage3D(t->target, GLint(level),
+                    GLint(xoffset), GLint(yoffset), GLint(zoffset),
+                    GLsizei(width), GLsizei(height), GLsizei(std::max(1u, depth)), pixelFormat, pixelType, data);
+  } else {
+    glTexSubImage2D(t->target, GLint(level),
+                    GLint(xoffset), GLint(yoffset),
+                    GLsizei(width), GLsizei(height), pixelFormat, pixelType, data);
+  }
   GL_CHECK_ERRORS();
 }
 
@@ -427,26 +688,62 @@ void RendererBackendOpengl::updateDescriptorSets(GLProgram* program, const Descr
   }
 }
 
-void RendererBackendOpengl::draw(ProgramHandle ph, VertexBufferHandle vbh, IndexBufferHandle ibh, uint32_t indexCount, uint32_t indexOffset) {
+GLIndexBuffer* RendererBackendOpengl::bindDrawState(ProgramHandle ph, VertexBufferHandle vbh, IndexBufferHandle ibh) {
   auto program = handleAllocator.cast<GLProgram*>(ph);
   auto vb = handleAllocator.cast<GLVertexBuffer*>(vbh);
   auto ib = handleAllocator.cast<GLIndexBuffer*>(ibh);
 
-  updateDescriptorSets(program, ULONG_MAX);
+  // binding points differ between programs, a new program gets every set applied again
+  if(appliedProgram != ph) {
+    appliedProgram = ph;
+    dirtyDescriptorSets.set();
+  }
+  updateDescriptorSets(program, dirtyDescriptorSets);
+  dirtyDescriptorSets.reset();
+  updatePushConstants(program);
 
   glUseProgram(program->id);
 
   glBindVertexArray(defaultVertexArray);
 
-  updateVertexAttributes(vb->attributes, vb->attributesCount);
+  // meshes from the same geometry pool share the vertex buffer, the attributes are set up once for all of them
+  if(boundVertexBuffer != vbh) {
+    updateVertexAttributes(vb->attributes, vb->attributesCount);
+    boundVertexBuffer = vbh;
+  }
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->id);
+  return ib;
+}
+
+void RendererBackendOpengl::draw(ProgramHandle ph, VertexBufferHandle vbh, IndexBufferHandle ibh, uint32_t indexCount, uint32_t indexOffset, int32_t baseVertex) {
+  auto ib = bindDrawState(ph, vbh, ibh);
 
+  auto indexSize = getIndexSize(ib->type);
   if(indexCount == 0) {
-    indexCount = ib->size;
+    indexCount = ib->size / indexSize;
   }
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->id);
-  void* pointer = (void*) (uintptr_t) (OpenGL::indexOffsetToByteOffset(indexOffset));
-  glDrawElements(GL_TRIANGLES, (GLsizei) indexCount, GL_UNSIGNED_INT, pointer);
+  void* pointer = (void*) (uintptr_t) (uint64_t(indexOffset) * indexSize);
+  glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei) indexCount, OpenGL::toGLIndexType(ib->type), pointer, baseVertex);
+  GL_CHECK_ERRORS();
+}
+
+void RendererBackendOpengl::multiDraw(ProgramHandle ph, VertexBufferHandle vbh, IndexBufferHandle ibh,
+                                      const DrawRange* ranges, uint32_t rangesCount, int32_t baseVertex) {
+  auto ib = bindDrawState(ph, vbh, ibh);
+
+  auto indexSize = getIndexSize(ib->type);
+  multiDrawCounts.resize(rangesCount);
+  multiDrawOffsets.resize(rangesCount);
+  multiDrawBaseVertices.assign(rangesCount, baseVertex);
+  for(uint32_t i = 0; i < rangesCount; i++) {
+    multiDrawCounts[i] = GLsizei(ranges[i].indexCount);
+    multiDrawOffsets[i] = (const void*) (uintptr_t) (uint64_t(ranges[i].indexOffset) * indexSize);
+  }
+
+  glMultiDrawElementsBaseVertex(GL_TRIANGLES, multiDrawCounts.data(), OpenGL::toGLIndexType(ib->type),
+                                multiDrawOffsets.data(), GLsizei(rangesCount), multiDrawBaseVertices.data());
   GL_CHECK_ERRORS();
 }
 
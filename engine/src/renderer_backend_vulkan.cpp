@@ -41,7 +41,7 @@ void vkDestroyDebugUtilsMessenger(VkInstance instance, VkDebugUtilsMessengerEXT
   }
 }
 
-void createDebugUtilsMessenger(VkInstance instance, VkAllocationCallbacks* alloc, VkDebugUtilsMessengerEXT* messenger) {
+void createDebugUtilsMessenger(VkInstance instance, const VkAllocationCallbacks* alloc, VkDebugUtilsMessengerEXT* messenger) {
   VkDebugUtilsMessengerCreateInfoEXT createInfo {
       .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
       .messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
@@ -165,7 +165,7 @@ VkShaderModule RendererBackendVulkan::createShaderModule(const ByteArray& code)
   createInfo.codeSize = code.size();
   createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
   VkShaderModule shaderModule;
-  if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+  if (vkCreateShaderModule(device, &createInfo, vkAlloc, &shaderModule) != VK_SUCCESS) {
     ENJAM_ERROR("Failed to create shader module!");
     return VK_NULL_HANDLE;
   }
@@ -203,11 +203,11 @@ void RendererBackendVulkan::createGraphicsPipeline(const ProgramData& data) {
 
 
 
-  vkDestroyShaderModule(device, fragShaderModule, nullptr);
-  vkDestroyShaderModule(device, vertShaderModule, nullptr);
+  vkDestroyShaderModule(device, fragShaderModule, vkAlloc);
+  vkDestroyShaderModule(device, vertShaderModule, vkAlloc);
 }
 
-VkDevice createLogicalDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex) {
+VkDevice createLogicalDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, const VkAllocationCallbacks* alloc) {
   float queuePriority = 1.0f;
   VkDeviceQueueCreateInfo queueCreateInfo {
     .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
@@ -257,7 +257,7 @@ VkDevice createLogicalDevice(VkPhysicalDevice physicalDevice, uint32_t queueFami
   };
 
   VkDevice ret;
-  if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &ret) != VK_SUCCESS) {
+  if (vkCreateDevice(physicalDevice, &createInfo, alloc, &ret) != VK_SUCCESS) {
     ENJAM_ERROR("Vulkan failed to create logical device!");
     return VK_NULL_HANDLE;
   }
@@ -265,6 +265,15 @@ VkDevice createLogicalDevice(VkPhysicalDevice physicalDevice, uint32_t queueFami
   return ret;
 }
 
+VkPresentModeKHR toVkPresentMode(PresentMode mode) {
+  switch (mode) {
+    case PresentMode::FIFO: return VK_PRESENT_MODE_FIFO_KHR;
+    case PresentMode::MAILBOX: return VK_PRESENT_MODE_MAILBOX_KHR;
+    case PresentMode::IMMEDIATE: return VK_PRESENT_MODE_IMMEDIATE_KHR;
+  }
+  return VK_PRESENT_MODE_FIFO_KHR;
+}
+
 VulkanSwapChain RendererBackendVulkan::createSwapChain() {
   auto availableFormats = vulkan::utils::vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface);
 
@@ -279,7 +288,13 @@ VulkanSwapChain RendererBackendVulkan::createSwapChain() {
   ENJAM_ASSERT(surfaceFormat != availableFormats.end());
 
   auto presentModes = vulkan::utils::vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface);
-  auto presentMode = std::find(presentModes.begin(), presentModes.end(), VK_PRESENT_MODE_FIFO_KHR);
+  auto requestedPresentMode = toVkPresentMode(presentationConfig.presentMode);
+  auto presentMode = std::find(presentModes.begin(), presentModes.end(), requestedPresentMode);
+  if(presentMode == presentModes.end()) {
+    // FIFO is the only mode every surface has to support
+    ENJAM_WARN("Present mode {} is not supported, falling back to FIFO", (int) requestedPresentMode);
+    presentMode = std::find(presentModes.begin(), presentModes.end(), VK_PRESENT_MODE_FIFO_KHR);
+  }
   ENJAM_ASSERT(presentMode != presentModes.end());
 
   VkSurfaceCapabilitiesKHR capabilities;
@@ -297,12 +312,15 @@ VulkanSwapChain RendererBackendVulkan::createSwapChain() {
     extent = capabilities.currentExtent;
   }
 
-  uint32_t imageCount = capabilities.minImageCount + 1;
+  uint32_t imageCount = presentationConfig.imageCount > 0 ? presentationConfig.imageCount : capabilities.minImageCount + 1;
+  imageCount = std::max(imageCount, capabilities.minImageCount);
   if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
     imageCount = capabilities.maxImageCount;
   }
 
-  VkSwapchainCreateInfoKHR createInfo;
+  VkSwapchainKHR oldSwapChain = swapChain.vkHandle;
+
+  VkSwapchainCreateInfoKHR createInfo { };
   createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
   createInfo.surface = surface;
   createInfo.minImageCount = imageCount;
@@ -315,10 +333,16 @@ VulkanSwapChain RendererBackendVulkan::createSwapChain() {
   createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
   createInfo.presentMode = *presentMode;
   createInfo.clipped = VK_TRUE;
-  createInfo.oldSwapchain = VK_NULL_HANDLE;
+  createInfo.oldSwapchain = oldSwapChain;
 
   swapChain = { };
-  if(vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain.vkHandle) != VK_SUCCESS) {
+  VkResult result = vkCreateSwapchainKHR(device, &createInfo, vkAlloc, &swapChain.vkHandle);
+
+  if(oldSwapChain != VK_NULL_HANDLE) {
+    vkDestroySwapchainKHR(device, oldSwapChain, vkAlloc);
+  }
+
+  if(result != VK_SUCCESS) {
     ENJAM_ERROR("Failed to create swap chain!");
     return swapChain;
   }
@@ -337,10 +361,14 @@ bool RendererBackendVulkan::init() {
   physicalDevice = selectPhysicalDevice(instance);
   if(physicalDevice == VK_NULL_HANDLE) {
     ENJAM_ERROR("Vulkan failed to find a suitable GPU!");
+  } else {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    maxUniformBlockSize = properties.limits.maxUniformBufferRange;
   }
 
   auto deviceQueueFamilyIndex = (uint32_t) getQueueFamilyIndex(physicalDevice, VK_QUEUE_GRAPHICS_BIT);
-  device = createLogicalDevice(physicalDevice, deviceQueueFamilyIndex);
+  device = createLogicalDevice(physicalDevice, deviceQueueFamilyIndex, vkAlloc);
   vkGetDeviceQueue(device, deviceQueueFamilyIndex, 0, &graphicsQueue);
 
   createSwapChain();
@@ -351,14 +379,18 @@ bool RendererBackendVulkan::init() {
 void RendererBackendVulkan::shutdown() {
 #if ENJAM_VULKAN_ENABLED(ENJAM_VULKAN_DEBUG_UTILS)
   if (debugMessenger) {
-    vkDestroyDebugUtilsMessenger(instance, debugMessenger, nullptr);
+    vkDestroyDebugUtilsMessenger(instance, debugMessenger, vkAlloc);
   }
 #endif
 
-  vkDestroySwapchainKHR(device, swapChain.vkHandle, nullptr);
-  vkDestroyDevice(device, nullptr);
-  vkDestroySurfaceKHR(instance, surface, nullptr);
-  vkDestroyInstance(instance, nullptr);
+  vkDestroySwapchainKHR(device, swapChain.vkHandle, vkAlloc);
+  vkDestroyDevice(device, vkAlloc);
+  vkDestroySurfaceKHR(instance, surface, vkAlloc);
+  vkDestroyInstance(instance, vkAlloc);
+
+  if(hostAllocator) {
+    hostAllocator->logStats();
+  }
 }
 
 void RendererBackendVulkan::beginFrame() {
@@ -368,14 +400,35 @@ void RendererBackendVulkan::endFrame() {
 
 }
 
+void RendererBackendVulkan::setPresentationConfig(const PresentationConfig& config) {
+  presentationConfig = config;
+
+  if(swapChain.vkHandle != VK_NULL_HANDLE) {
+    vkDeviceWaitIdle(device);
+    createSwapChain();
+  }
+}
+
 void RendererBackendVulkan::draw(ProgramHandle handle,
                                  VertexBufferHandle bufferHandle,
                                  IndexBufferHandle indexBufferHandle,
                                  uint32_t indexCount,
-                                 uint32_t indexOffset) {
+                                 uint32_t indexOffset,
+                                 int32_t baseVertex) {
 
 }
 
+void RendererBackendVulkan::multiDraw(ProgramHandle handle,
+                                      VertexBufferHandle bufferHandle,
+                                      IndexBufferHandle indexBufferHandle,
+                                      const DrawRange* ranges,
+                                      uint32_t rangesCount,
+                                      int32_t baseVertex) {
+  for(uint32_t i = 0; i < rangesCount; i++) {
+    draw(handle, bufferHandle, indexBufferHandle, ranges[i].indexCount, ranges[i].indexOffset, baseVertex);
+  }
+}
+
 ProgramHandle RendererBackendVulkan::createProgram(ProgramData& data) {
   return Enjam::ProgramHandle();
 }
@@ -402,6 +455,9 @@ void RendererBackendVulkan::updateDescriptorSetTexture(DescriptorSetHandle dsh,
 }
 void RendererBackendVulkan::bindDescriptorSet(DescriptorSetHandle dsh, uint8_t set) {
 
+}
+void RendererBackendVulkan::setPushConstants(const void* data, uint32_t size, uint32_t offset) {
+
 }
 VertexBufferHandle RendererBackendVulkan::createVertexBuffer(std::initializer_list<VertexAttribute> list,
                                                              uint64_t vertexCount) {
@@ -415,7 +471,7 @@ void RendererBackendVulkan::assignVertexBufferData(VertexBufferHandle handle,
 void RendererBackendVulkan::destroyVertexBuffer(VertexBufferHandle handle) {
 
 }
-IndexBufferHandle RendererBackendVulkan::createIndexBuffer(uint32_t byteSize) {
+IndexBufferHandle RendererBackendVulkan::createIndexBuffer(uint32_t byteSize, IndexType type) {
   return Enjam::IndexBufferHandle();
 }
 void RendererBackendVulkan::updateIndexBuffer(IndexBufferHandle handle, BufferDataDesc&& desc, uint32_t byteOffset) {
@@ -439,6 +495,13 @@ TextureHandle RendererBackendVulkan::createTexture(uint32_t width,
                                                    TextureFormat format) {
   return Enjam::TextureHandle();
 }
+TextureHandle RendererBackendVulkan::createTextureArray(uint32_t width,
+                                                        uint32_t height,
+                                                        uint8_t levels,
+                                                        uint32_t layers,
+                                                        TextureFormat format) {
+  return Enjam::TextureHandle();
+}
 void RendererBackendVulkan::setTextureData(TextureHandle th,
                                            uint32_t level,
                                            uint32_t xoffset,
@@ -1,7 +1,275 @@
 #include <enjam/scene.h>
+#include <enjam/render_primitive.h>
+#include <enjam/render_components.h>
+#include <enjam/assert.h>
+#include <enjam/log.h>
+#include <algorithm>
 
 namespace Enjam {
 
+math::mat4f Transform::toMatrix() const {
+  auto x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
 
+  math::mat4f m;
+  m[0] = math::vec4f { 1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y), 0 } * scale.x;
+  m[1] = math::vec4f { 2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x), 0 } * scale.y;
+  m[2] = math::vec4f { 2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y), 0 } * scale.z;
+  m[3] = math::vec4f { translation, 1 };
+  return m;
+}
 
-}
\ No newline at end of file
+Transform Transform::fromMatrix(const math::mat4f& m) {
+  Transform transform;
+  transform.translation = m[3].xyz;
+
+  math::vec3f axes[3] = { m[0].xyz, m[1].xyz, m[2].xyz };
+  math::vec3f scale { length(axes[0]), length(axes[1]), length(axes[2]) };
+  if(dot(cross(axes[0], axes[1]), axes[2]) < 0) {
+    scale.x = -scale.x;
+  }
+  transform.scale = scale;
+
+  for(auto i = 0; i < 3; i++) {
+    axes[i] = axes[i] * (scale[i] != 0 ? 1 / scale[i] : 0.0f);
+  }
+
+  // r(row, column) of the rotation matrix
+  auto r = [&axes](int row, int column) { return axes[column][row]; };
+
+  math::vec4f q;
+  auto trace = r(0, 0) + r(1, 1) + r(2, 2);
+  if(trace > 0) {
+    auto s = 0.5f / std::sqrt(trace + 1);
+    q = { (r(2, 1) - r(1, 2)) * s, (r(0, 2) - r(2, 0)) * s, (r(1, 0) - r(0, 1)) * s, 0.25f / s };
+  } else if(r(0, 0) > r(1, 1) && r(0, 0) > r(2, 2)) {
+    auto s = 2 * std::sqrt(1 + r(0, 0) - r(1, 1) - r(2, 2));
+    q = { 0.25f * s, (r(0, 1) + r(1, 0)) / s, (r(0, 2) + r(2, 0)) / s, (r(2, 1) - r(1, 2)) / s };
+  } else if(r(1, 1) > r(2, 2)) {
+    auto s = 2 * std::sqrt(1 + r(1, 1) - r(0, 0) - r(2, 2));
+    q = { (r(0, 1) + r(1, 0)) / s, 0.25f * s, (r(1, 2) + r(2, 1)) / s, (r(0, 2) - r(2, 0)) / s };
+  } else {
+    auto s = 2 * std::sqrt(1 + r(2, 2) - r(0, 0) - r(1, 1));
+    q = { (r(0, 2) + r(2, 0)) / s, (r(1, 2) + r(2, 1)) / s, 0.25f * s, (r(1, 0) - r(0, 1)) / s };
+  }
+
+  transform.rotation = normalize(q);
+  return transform;
+}
+
+Entity Scene::addPrimitive(RenderPrimitive& primitive) {
+  auto transform = TransformComponent { .world = primitive.getTransform() };
+  auto mesh = MeshComponent {
+      .vertexBuffer = primitive.getVertexBuffer(),
+      .indexBuffer = primitive.getIndexBuffer(),
+      .indexCount = primitive.getIndexCount(),
+      .indexOffset = primitive.getIndexOffset(),
+      .baseVertex = primitive.getBaseVertex(),
+      .positionDecode = primitive.getPositionDecode()
+  };
+  auto material = MaterialComponent {
+      .instance = primitive.getMaterialInstance(),
+      .programHandle = primitive.getProgramHandle(),
+      .descriptorSetHandle = primitive.getDescriptorSetHandle(),
+      .materialIndex = primitive.getMaterialIndex()
+  };
+
+  auto node = primitive.getNode();
+  if(node != NO_NODE) {
+    transform.world = worldTransforms[node];
+  }
+
+  auto world = transform.world;
+  auto entity = node == NO_NODE
+      ? entities.create(std::move(transform), std::move(mesh), std::move(material))
+      : entities.create(std::move(transform), std::move(mesh), std::move(material), SceneNodeComponent { .node = node });
+
+  if(node != NO_NODE) {
+    nodeEntities[node].push_back(entity);
+  }
+
+  auto& bounds = primitive.getBounds();
+  if(!bounds.isEmpty()) {
+    entities.add(entity, BoundsComponent { .local = bounds, .proxy = bvh.insert(bounds.transformed(world), entity.index) });
+    if(auto& occluder = primitive.getOccluder()) {
+      entities.add(entity, OccluderComponent { .mesh = occluder });
+    }
+    if(auto& meshlets = primitive.getMeshlets(); meshlets && !meshlets->empty()) {
+      entities.add(entity, MeshletComponent { .meshlets = meshlets });
+    }
+    if(auto& lods = primitive.getLods(); !lods.empty()) {
+      // assets loaded from files can have any number of levels, the finest ones are kept
+      auto count = std::min<size_t>(lods.size(), LodComponent::MAX_LODS - 1);
+      if(count < lods.size()) {
+        ENJAM_WARN("Primitive has {} levels of detail, the {} coarsest are dropped", lods.size(), lods.size() - count);
+      }
+      LodComponent component { .lods = { }, .lodsCount = uint32_t(count + 1) };
+      component.lods[0] = MeshLod { .indexCount = primitive.getIndexCount(), .indexOffset = primitive.getIndexOffset(), .error = 0 };
+      std::copy(lods.begin(), lods.begin() + count, component.lods.begin() + 1);
+      entities.add(entity, component);
+    }
+  }
+  return entity;
+}
+
+Entity Scene::addLight(const PointLight& light) {
+  auto component = LightComponent { .color = light.color, .intensity = light.intensity, .radius = light.radius };
+  if(light.node == NO_NODE) {
+    return entities.create(TransformComponent { .world = math::mat4f::translation(light.position) }, std::move(component));
+  }
+  auto entity = entities.create(TransformComponent { .world = worldTransforms[light.node] }, std::move(component),
+                                SceneNodeComponent { .node = light.node });
+  nodeEntities[light.node].push_back(entity);
+  return entity;
+}
+
+void Scene::removePrimitive(Entity entity) {
+  if(auto bounds = entities.get<BoundsComponent>(entity)) {
+    bvh.remove(bounds->proxy);
+  }
+  unfollowNode(entity);
+  entities.destroy(entity);
+}
+
+void Scene::removeLight(Entity entity) {
+  unfollowNode(entity);
+  entities.destroy(entity);
+}
+
+void Scene::clearPrimitives() {
+  entities.clear();
+  bvh.clear();
+  for(auto& followers : nodeEntities) {
+    followers.clear();
+  }
+}
+
+void Scene::unfollowNode(Entity entity) {
+  auto component = entities.get<SceneNodeComponent>(entity);
+  if(!component) {
+    return;
+  }
+
+  auto& followers = nodeEntities[component->node];
+  auto it = std::find(followers.begin(), followers.end(), entity);
+  ENJAM_ASSERT(it != followers.end());
+  *it = followers.back();
+  followers.pop_back();
+}
+
+void Scene::setTransform(Entity entity, const math::mat4f& world) {
+  ENJAM_ASSERT(!entities.has<SceneNodeComponent>(entity) && "The primitive follows a scene node");
+  entities.get<TransformComponent>(entity)->world = world;
+  if(auto bounds = entities.get<BoundsComponent>(entity)) {
+    bvh.update(bounds->proxy, bounds->local.transformed(world));
+  }
+}
+
+template<class Shape>
+void Scene::queryEntities(const Shape& shape, std::vector<Entity>& result) const {
+  std::vector<uint32_t> indices;
+  bvh.query(shape, indices);
+
+  result.reserve(result.size() + indices.size());
+  for(auto index : indices) {
+    result.push_back(entities.getEntity(index));
+  }
+}
+
+void Scene::query(const Frustum& frustum, std::vector<Entity>& result) const {
+  queryEntities(frustum, result);
+}
+
+void Scene::query(const Aabb& box, std::vector<Entity>& result) const {
+  queryEntities(box, result);
+}
+
+void Scene::query(const Sphere& sphere, std::vector<Entity>& result) const {
+  queryEntities(sphere, result);
+}
+
+bool Scene::raycast(const Ray& ray, float maxDistance, Entity& entity, float& distance) const {
+  Bvh::RayHit hit;
+  if(!bvh.raycast(ray, maxDistance, hit)) {
+    return false;
+  }
+
+  entity = entities.getEntity(hit.userData);
+  distance = hit.distance;
+  return true;
+}
+
+Scene::NodeIndex Scene::addNode(NodeIndex parent, const Transform& local) {
+  auto index = NodeIndex(parents.size());
+  ENJAM_ASSERT(parent == NO_NODE || (parent < index && parent + NodeIndex(subtreeSizes[parent]) == index));
+
+  localTransforms.push_back(local);
+  worldTransforms.emplace_back();
+  parents.push_back(parent);
+  subtreeSizes.push_back(1);
+  dirtyFlags.push_back(0);
+  nodeEntities.emplace_back();
+
+  for(auto ancestor = parent; ancestor != NO_NODE; ancestor = parents[ancestor]) {
+    subtreeSizes[ancestor]++;
+  }
+
+  setLocalTransform(index, local);
+  return index;
+}
+
+void Scene::clearNodes() {
+  localTransforms.clear();
+  worldTransforms.clear();
+  parents.clear();
+  subtreeSizes.clear();
+  dirtyNodes.clear();
+  dirtyFlags.clear();
+  nodeEntities.clear();
+}
+
+void Scene::setLocalTransform(NodeIndex node, const Transform& local) {
+  localTransforms[node] = local;
+  if(!dirtyFlags[node]) {
+    dirtyFlags[node] = 1;
+    dirtyNodes.push_back(node);
+  }
+}
+
+uint32_t Scene::updateTransforms() {
+  if(dirtyNodes.empty()) {
+    return 0;
+  }
+
+  // parents come before their children, a dirty node inside an already updated subtree is skipped
+  std::sort(dirtyNodes.begin(), dirtyNodes.end());
+
+  uint32_t updatedCount = 0;
+  NodeIndex updatedEnd = 0;
+  for(auto node : dirtyNodes) {
+    dirtyFlags[node] = 0;
+    if(node < updatedEnd) {
+      continue;
+    }
+
+    auto end = node + NodeIndex(subtreeSizes[node]);
+    for(auto i = node; i < end; i++) {
+      auto parent = parents[i];
+      auto local = localTransforms[i].toMatrix();
+      worldTransforms[i] = parent == NO_NODE ? local : worldTransforms[parent] * local;
+      for(auto entity : nodeEntities[i]) {
+        entities.get<TransformComponent>(entity)->world = worldTransforms[i];
+        if(auto bounds = entities.get<BoundsComponent>(entity)) {
+          bvh.update(bounds->proxy, bounds->local.transformed(worldTransforms[i]));
+        }
+      }
+    }
+
+    updatedCount += end - node;
+    updatedEnd = end;
+  }
+
+  dirtyNodes.clear();
+  return updatedCount;
+}
+
+}
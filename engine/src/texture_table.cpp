@@ -0,0 +1,67 @@
+#include <enjam/texture_table.h>
+#include <enjam/assert.h>
+#include <enjam/log.h>
+
+namespace Enjam {
+
+TextureSlot TextureTable::allocate(uint32_t width, uint32_t height, uint8_t levels, TextureFormat format) {
+  for(auto& array : arrays) {
+    bool compatible = array.width == width && array.height == height && array.levels == levels && array.format == format;
+    if(!compatible || array.freeLayers.empty()) {
+      continue;
+    }
+
+    auto layer = array.freeLayers.back();
+    array.freeLayers.pop_back();
+    return TextureSlot { .handle = array.handle, .layer = layer };
+  }
+
+  auto handle = backend.createTextureArray(width, height, levels, LAYERS_PER_ARRAY, format);
+  if(!handle) {
+    ENJAM_ERROR("Failed to create texture array {}x{}", width, height);
+    return { };
+  }
+
+  auto& array = arrays.emplace_back(TextureArray {
+    .handle = handle,
+    .width = width,
+    .height = height,
+    .levels = levels,
+    .format = format,
+    .freeLayers = { }
+  });
+
+  // layers are handed out from the back, keep the low ones first
+  array.freeLayers.reserve(LAYERS_PER_ARRAY);
+  for(uint32_t layer = LAYERS_PER_ARRAY; layer > 1; layer--) {
+    array.freeLayers.push_back(layer - 1);
+  }
+
+  ENJAM_INFO("Texture array {}x{} created, {} arrays in the table", width, height, arrays.size());
+  return TextureSlot { .handle = handle, .layer = 0 };
+}
+
+void TextureTable::free(const TextureSlot& slot) {
+  for(auto& array : arrays) {
+    if(array.handle == slot.handle) {
+      array.freeLayers.push_back(slot.layer);
+      return;
+    }
+  }
+
+  ENJAM_ASSERT(false && "Texture slot does not belong to the table");
+}
+
+void TextureTable::setData(const TextureSlot& slot, uint32_t level, uint32_t width, uint32_t height, const void* data) {
+  ENJAM_ASSERT(slot.isValid());
+  backend.setTextureData(slot.handle, level, 0, 0, slot.layer, width, height, 1, data);
+}
+
+void TextureTable::destroy() {
+  for(auto& array : arrays) {
+    backend.destroyTexture(array.handle);
+  }
+  arrays.clear();
+}
+
+}
@@ -0,0 +1,96 @@
+#include <enjam/thread_pool.h>
+#include <algorithm>
+
+namespace Enjam {
+
+namespace {
+
+thread_local bool insideLoop = false;
+
+}
+
+ThreadPool::ThreadPool(uint32_t workersCount) {
+  for(uint32_t i = 0; i < workersCount; i++) {
+    workers.emplace_back([this] { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock { mutex };
+    stopping = true;
+  }
+  wakeCondition.notify_all();
+
+  for(auto& worker : workers) {
+    worker.join();
+  }
+}
+
+uint32_t ThreadPool::getDefaultWorkersCount() {
+  auto threads = std::thread::hardware_concurrency();
+  return threads > 1 ? threads - 1 : 0;
+}
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& f) {
+  if(count == 0) {
+    return;
+  }
+
+  if(insideLoop || workers.empty() || count == 1) {
+    for(uint32_t i = 0; i < count; i++) {
+      f(i);
+    }
+    return;
+  }
+
+  std::lock_guard loopLock { loopMutex };
+  {
+    std::lock_guard lock { mutex };
+    function = &f;
+    indicesCount = count;
+    nextIndex = 0;
+    activeWorkers = workers.size();
+    generation++;
+  }
+  wakeCondition.notify_all();
+
+  runIndices();
+
+  // the workers may still be running the last indices
+  std::unique_lock lock { mutex };
+  doneCondition.wait(lock, [this] { return activeWorkers == 0; });
+  function = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+  uint64_t seenGeneration = 0;
+  while(true) {
+    {
+      std::unique_lock lock { mutex };
+      wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+      if(stopping) {
+        return;
+      }
+      seenGeneration = generation;
+    }
+
+    runIndices();
+
+    {
+      std::lock_guard lock { mutex };
+      activeWorkers--;
+    }
+    doneCondition.notify_one();
+  }
+}
+
+void ThreadPool::runIndices() {
+  insideLoop = true;
+  for(auto index = nextIndex++; index < indicesCount; index = nextIndex++) {
+    (*function)(index);
+  }
+  insideLoop = false;
+}
+
+}
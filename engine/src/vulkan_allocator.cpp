@@ -0,0 +1,210 @@
+#include <enjam/vulkan_allocator.h>
+#include <enjam/log.h>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace Enjam {
+
+SmallObjectPool::~SmallObjectPool() {
+  for(auto& sizeClass : sizeClasses) {
+    for(auto chunk : sizeClass.chunks) {
+      ::operator delete(chunk);
+    }
+  }
+}
+
+uint8_t SmallObjectPool::sizeClass(size_t size) {
+  if(size > MAX_BLOCK_SIZE) {
+    return NO_SIZE_CLASS;
+  }
+
+  uint8_t sizeClass = 0;
+  while(blockSize(sizeClass) < size) {
+    sizeClass++;
+  }
+  return sizeClass;
+}
+
+void* SmallObjectPool::alloc(uint8_t sizeClassIndex) {
+  auto& sizeClass = sizeClasses[sizeClassIndex];
+  std::lock_guard<std::mutex> lock(sizeClass.mutex);
+
+  if(!sizeClass.freeList) {
+    auto chunk = static_cast<uint8_t*>(::operator new(CHUNK_SIZE, std::nothrow));
+    if(!chunk) {
+      return nullptr;
+    }
+    sizeClass.chunks.push_back(chunk);
+
+    auto size = blockSize(sizeClassIndex);
+    for(size_t offset = 0; offset + size <= CHUNK_SIZE; offset += size) {
+      auto block = reinterpret_cast<FreeBlock*>(chunk + offset);
+      block->next = sizeClass.freeList;
+      sizeClass.freeList = block;
+    }
+  }
+
+  auto block = sizeClass.freeList;
+  sizeClass.freeList = block->next;
+  return block;
+}
+
+void SmallObjectPool::free(void* ptr, uint8_t sizeClassIndex) {
+  auto& sizeClass = sizeClasses[sizeClassIndex];
+  std::lock_guard<std::mutex> lock(sizeClass.mutex);
+
+  auto block = static_cast<FreeBlock*>(ptr);
+  block->next = sizeClass.freeList;
+  sizeClass.freeList = block;
+}
+
+struct VulkanHostAllocator::AllocationHeader {
+  uint64_t size;
+  uint32_t offset; // from the start of the block to the user memory
+  uint8_t scope;
+  uint8_t sizeClass;
+};
+
+VulkanHostAllocator::VulkanHostAllocator()
+  : callbacks {
+      .pUserData = this,
+      .pfnAllocation = allocCallback,
+      .pfnReallocation = reallocCallback,
+      .pfnFree = freeCallback,
+      .pfnInternalAllocation = internalAllocCallback,
+      .pfnInternalFree = internalFreeCallback
+    }
+  { }
+
+VulkanHostAllocator::AllocationHeader* VulkanHostAllocator::getHeader(void* memory) {
+  return reinterpret_cast<AllocationHeader*>(static_cast<uint8_t*>(memory) - sizeof(AllocationHeader));
+}
+
+void* VulkanHostAllocator::alloc(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+  if(size == 0) {
+    return nullptr;
+  }
+
+  alignment = std::max(alignment, alignof(AllocationHeader));
+  const size_t blockSize = size + sizeof(AllocationHeader) + alignment - 1;
+
+  uint8_t sizeClass = alignment <= SmallObjectPool::BLOCK_ALIGNMENT
+      ? SmallObjectPool::sizeClass(blockSize)
+      : SmallObjectPool::NO_SIZE_CLASS;
+
+  void* block = sizeClass != SmallObjectPool::NO_SIZE_CLASS
+      ? pool.alloc(sizeClass)
+      : ::operator new(blockSize, std::nothrow);
+
+  if(!block) {
+    return nullptr;
+  }
+
+  auto start = reinterpret_cast<uintptr_t>(block);
+  auto memory = (start + sizeof(AllocationHeader) + alignment - 1) & ~(uintptr_t) (alignment - 1);
+
+  auto header = getHeader(reinterpret_cast<void*>(memory));
+  header->size = size;
+  header->offset = uint32_t(memory - start);
+  header->scope = uint8_t(scope);
+  header->sizeClass = sizeClass;
+
+  auto& scopeStats = stats[scope];
+  scopeStats.liveBytes += size;
+  scopeStats.liveAllocations++;
+  scopeStats.totalAllocations++;
+  if(sizeClass != SmallObjectPool::NO_SIZE_CLASS) {
+    scopeStats.pooledAllocations++;
+  }
+
+  return reinterpret_cast<void*>(memory);
+}
+
+void* VulkanHostAllocator::realloc(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+  if(!original) {
+    return alloc(size, alignment, scope);
+  }
+
+  if(size == 0) {
+    free(original);
+    return nullptr;
+  }
+
+  void* memory = alloc(size, alignment, scope);
+  if(!memory) {
+    // the original allocation must stay valid when reallocation fails
+    return nullptr;
+  }
+
+  std::memcpy(memory, original, std::min<size_t>(size, getHeader(original)->size));
+  free(original);
+  return memory;
+}
+
+void VulkanHostAllocator::free(void* memory) {
+  if(!memory) {
+    return;
+  }
+
+  auto header = getHeader(memory);
+  auto& scopeStats = stats[header->scope];
+  scopeStats.liveBytes -= header->size;
+  scopeStats.liveAllocations--;
+
+  auto block = static_cast<uint8_t*>(memory) - header->offset;
+  auto sizeClass = header->sizeClass;
+  if(sizeClass != SmallObjectPool::NO_SIZE_CLASS) {
+    pool.free(block, sizeClass);
+  } else {
+    ::operator delete(block);
+  }
+}
+
+VulkanHostAllocator::Stats VulkanHostAllocator::getStats() const {
+  Stats ret;
+  for(auto i = 0; i < SCOPES_COUNT; i++) {
+    ret[i] = {
+        .liveBytes = stats[i].liveBytes,
+        .liveAllocations = stats[i].liveAllocations,
+        .totalAllocations = stats[i].totalAllocations,
+        .pooledAllocations = stats[i].pooledAllocations,
+        .internalBytes = stats[i].internalBytes
+    };
+  }
+  return ret;
+}
+
+void VulkanHostAllocator::logStats() const {
+  constexpr const char* scopeNames[SCOPES_COUNT] = { "command", "object", "cache", "device", "instance" };
+
+  auto current = getStats();
+  for(auto i = 0; i < SCOPES_COUNT; i++) {
+    auto& scopeStats = current[i];
+    ENJAM_INFO("Vulkan host memory [{}]: {} bytes in {} live allocations, {} total ({} pooled), {} internal bytes",
+               scopeNames[i], scopeStats.liveBytes, scopeStats.liveAllocations,
+               scopeStats.totalAllocations, scopeStats.pooledAllocations, scopeStats.internalBytes);
+  }
+}
+
+void* VulkanHostAllocator::allocCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+  return static_cast<VulkanHostAllocator*>(userData)->alloc(size, alignment, scope);
+}
+
+void* VulkanHostAllocator::reallocCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+  return static_cast<VulkanHostAllocator*>(userData)->realloc(original, size, alignment, scope);
+}
+
+void VulkanHostAllocator::freeCallback(void* userData, void* memory) {
+  static_cast<VulkanHostAllocator*>(userData)->free(memory);
+}
+
+void VulkanHostAllocator::internalAllocCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope) {
+  static_cast<VulkanHostAllocator*>(userData)->stats[scope].internalBytes += size;
+}
+
+void VulkanHostAllocator::internalFreeCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope) {
+  static_cast<VulkanHostAllocator*>(userData)->stats[scope].internalBytes -= size;
+}
+
+}
@@ -0,0 +1,376 @@
+#include <enjam/world_streamer.h>
+#include <enjam/assert.h>
+#include <enjam/log.h>
+#include <enjam/render_primitive.h>
+#include <enjam/scene.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Enjam {
+
+WorldStreamer::WorldStreamer(Scene& scene,
+                             GeometryPool& geometryPool,
+                             AssetRef<WorldAsset> worldAsset,
+                             CellLoader cellLoader,
+                             const Config& config)
+    : scene(scene)
+    , geometryPool(geometryPool)
+    , world(std::move(worldAsset))
+    , loader(std::move(cellLoader))
+    , config(config)
+    , cells(world->getCells().size())
+    , order(world->getCells().size()) {
+  ENJAM_ASSERT(config.unloadRadius >= config.loadRadius && "Cells would be unloaded right after they are loaded");
+
+  for(size_t i = 0; i < cells.size(); i++) {
+    cells[i].size = world->getCells()[i].size;
+  }
+  std::iota(order.begin(), order.end(), 0);
+
+  thread = std::thread(&WorldStreamer::streamingLoop, this);
+}
+
+WorldStreamer::~WorldStreamer() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  condition.notify_one();
+  thread.join();
+}
+
+void WorldStreamer::update(RendererBackend& backend, const math::vec3f& cameraPosition) {
+  auto start = Clock::now();
+  auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<float, std::milli>(config.frameBudgetMs));
+  stats.uploadedBytes = 0;
+  stats.unloadedCells = 0;
+  stats.deferredCells = 0;
+
+  receiveLoadedCells();
+
+  auto& worldCells = world->getCells();
+  for(size_t i = 0; i < cells.size(); i++) {
+    cells[i].distance = std::sqrt(Sphere { .center = cameraPosition }.distanceSquared(worldCells[i].bounds));
+  }
+  std::sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+    return cells[lhs].distance < cells[rhs].distance;
+  });
+
+  // the farthest cells out of reach go first, cancelling a load costs nothing
+  for(auto it = order.rbegin(); it != order.rend() && cells[*it].distance > config.unloadRadius; it++) {
+    auto& cell = cells[*it];
+    if(cell.state == CellState::LOADING) {
+      unload(cell);
+    } else if(cell.state == CellState::UPLOADING || cell.state == CellState::RESIDENT) {
+      if(Clock::now() >= deadline) {
+        break;
+      }
+      unload(cell);
+    }
+  }
+
+  requestCells();
+
+  // the nearest cells get the upload budget first
+  auto uploadBudget = config.uploadBudget;
+  for(auto index : order) {
+    auto& cell = cells[index];
+    if(cell.state == CellState::UPLOADING && !upload(backend, cell, deadline, uploadBudget)) {
+      break;
+    }
+  }
+
+  stats.loadingCells = 0;
+  stats.uploadingCells = 0;
+  stats.residentCells = 0;
+  stats.memoryUsed = 0;
+  for(auto& cell : cells) {
+    stats.loadingCells += cell.state == CellState::LOADING;
+    stats.uploadingCells += cell.state == CellState::UPLOADING;
+    stats.residentCells += cell.state == CellState::RESIDENT;
+    if(cell.state != CellState::UNLOADED && cell.state != CellState::FAILED) {
+      stats.memoryUsed += cell.size;
+    }
+  }
+  stats.updateMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+void WorldStreamer::unloadAll() {
+  for(auto& cell : cells) {
+    if(cell.state != CellState::UNLOADED && cell.state != CellState::FAILED) {
+      unload(cell);
+    }
+  }
+}
+
+void WorldStreamer::streamingLoop() {
+  std::unique_lock lock(mutex);
+  while(true) {
+    condition.wait(lock, [this] { return stopping || !requests.empty(); });
+    if(stopping) {
+      return;
+    }
+
+    auto cell = requests.front();
+    requests.pop_front();
+    lock.unlock();
+
+    // the world asset is never modified, its cells are read without the lock
+    auto loaded = prepare(cell, loader(world->getCells()[cell].path));
+
+    lock.lock();
+    loadedCells.push_back(std::move(loaded));
+  }
+}
+
+WorldStreamer::LoadedCell WorldStreamer::prepare(uint32_t cell, AssetRef<DCCAsset> asset) {
+  LoadedCell loaded { .cell = cell, .asset = std::move(asset), .primitives = { } };
+  if(!loaded.asset) {
+    return loaded;
+  }
+
+  // streamed primitives do not follow scene nodes, the cell nodes are flattened into world transforms
+  auto& nodes = loaded.asset->getNodes();
+  std::vector<math::mat4f> worldTransforms(nodes.size());
+  for(size_t i = 0; i < nodes.size(); i++) {
+    auto& node = nodes[i];
+    worldTransforms[i] = node.parent < 0 ? node.transform : worldTransforms[node.parent] * node.transform;
+
+    for(auto& mesh : node.meshes) {
+      Primitive primitive {
+          .transform = worldTransforms[i],
+          .bounds = loaded.asset->getBounds(mesh),
+          .mesh = &mesh,
+          .occluder = loaded.asset->getOccluder(mesh),
+          .meshlets = loaded.asset->getMeshlets(mesh)
+      };
+      loaded.primitives.push_back(std::move(primitive));
+    }
+  }
+  return loaded;
+}
+
+void WorldStreamer::receiveLoadedCells() {
+  {
+    std::lock_guard lock(mutex);
+    std::swap(receivedCells, loadedCells);
+  }
+
+  for(auto& loaded : receivedCells) {
+    auto& cell = cells[loaded.cell];
+    ENJAM_ASSERT(cell.state == CellState::LOADING);
+
+    if(cell.cancelled) {
+      cell.cancelled = false;
+      cell.state = CellState::UNLOADED;
+      continue;
+    }
+
+    auto& asset = loaded.asset;
+    if(!asset) {
+      ENJAM_ERROR("Failed to load world cell {}", world->getCells()[loaded.cell].path);
+      cell.state = CellState::FAILED;
+      continue;
+    }
+
+    auto& format = asset->getVertexFormat();
+    auto hasPoolStreams = geometryPool.getStreamsCount() == format.getStreamsCount();
+    for(uint8_t stream = 0; hasPoolStreams && stream < format.getStreamsCount(); stream++) {
+      hasPoolStreams = geometryPool.getVertexStride(stream) == format.getStreamStride(stream);
+    }
+    if(!hasPoolStreams) {
+      ENJAM_ERROR("World cell {} does not have the vertex format of the geometry pool", world->getCells()[loaded.cell].path);
+      cell.state = CellState::FAILED;
+      continue;
+    }
+
+    cell.state = CellState::UPLOADING;
+    cell.size = asset->getGeometry().size();
+    cell.asset = std::move(loaded.asset);
+    cell.primitives = std::move(loaded.primitives);
+    cell.step = UploadStep::VERTICES;
+    cell.stream = 0;
+    cell.stepOffset = 0;
+  }
+  receivedCells.clear();
+}
+
+void WorldStreamer::requestCells() {
+  uint64_t memoryUsed = 0;
+  uint32_t loadingCount = 0;
+  for(auto& cell : cells) {
+    if(cell.state != CellState::UNLOADED && cell.state != CellState::FAILED) {
+      memoryUsed += cell.size;
+    }
+    loadingCount += cell.state == CellState::LOADING;
+  }
+
+  for(auto index : order) {
+    auto& cell = cells[index];
+    if(cell.distance > config.loadRadius) {
+      break;
+    }
+    if(cell.state == CellState::LOADING) {
+      cell.cancelled = false; // came back in reach
+      continue;
+    }
+    if(cell.state != CellState::UNLOADED) {
+      continue;
+    }
+    if(loadingCount >= config.maxLoadingCells) {
+      break;
+    }
+
+    // cells kept only by the hysteresis make room for the ones in reach, the farthest first
+    for(auto it = order.rbegin(); it != order.rend() && memoryUsed + cell.size > config.memoryBudget; it++) {
+      auto& other = cells[*it];
+      if(other.distance <= config.loadRadius) {
+        break;
+      }
+      if(other.state == CellState::UPLOADING || other.state == CellState::RESIDENT) {
+        memoryUsed -= other.size;
+        unload(other);
+      }
+    }
+    if(memoryUsed + cell.size > config.memoryBudget) {
+      stats.deferredCells++;
+      continue;
+    }
+
+    memoryUsed += cell.size;
+    loadingCount++;
+    cell.state = CellState::LOADING;
+    {
+      std::lock_guard lock(mutex);
+      requests.push_back(index);
+    }
+    condition.notify_one();
+  }
+}
+
+bool WorldStreamer::upload(RendererBackend& backend, Cell& cell, Clock::time_point deadline, uint64_t& uploadBudget) {
+  auto& asset = *cell.asset;
+  if(!cell.geometry.isValid()) {
+    cell.geometry = geometryPool.allocate(asset.getVertexCount(), asset.getIndicesCount(), asset.getIndices16Count());
+    if(!cell.geometry.isValid()) {
+      return true; // retried once other cells are unloaded
+    }
+  }
+
+  // slices are uploaded from the geometry buffer of the asset as it was loaded
+  auto& layout = asset.getGeometryLayout();
+  while(cell.step != UploadStep::PRIMITIVES) {
+    GeometryLayout::Section section;
+    uint32_t elementSize = 0;
+    switch(cell.step) {
+      case UploadStep::VERTICES:
+        section = layout.vertexStreams[cell.stream];
+        elementSize = asset.getVertexFormat().getStreamStride(cell.stream);
+        break;
+      case UploadStep::INDICES:
+        section = layout.indices;
+        elementSize = sizeof(uint32_t);
+        break;
+      default:
+        section = layout.indices16;
+        elementSize = sizeof(uint16_t);
+        break;
+    }
+    auto data = asset.getGeometry().data() + section.offset;
+    auto elementsCount = uint32_t(section.size / elementSize);
+
+    if(cell.stepOffset < elementsCount) {
+      auto maxCount = std::min(uploadBudget, MAX_SLICE_SIZE) / elementSize;
+      if(maxCount == 0 || Clock::now() >= deadline) {
+        return false;
+      }
+
+      auto count = uint32_t(std::min<uint64_t>(elementsCount - cell.stepOffset, maxCount));
+      auto size = uint64_t(count) * elementSize;
+      // the slice keeps the asset alive until the backend consumed it
+      auto desc = BufferDataDesc { (void*) (data + uint64_t(cell.stepOffset) * elementSize), size,
+                                   [asset = cell.asset](void*, uint64_t) { } };
+      if(cell.step == UploadStep::INDICES) {
+        geometryPool.setIndices(backend, cell.geometry, std::move(desc), cell.stepOffset, IndexType::UINT32);
+      } else if(cell.step == UploadStep::INDICES16) {
+        geometryPool.setIndices(backend, cell.geometry, std::move(desc), cell.stepOffset, IndexType::UINT16);
+      } else {
+        geometryPool.setVertices(backend, cell.geometry, cell.stream, std::move(desc), cell.stepOffset);
+      }
+
+      cell.stepOffset += count;
+      uploadBudget -= size;
+      stats.uploadedBytes += size;
+    }
+
+    if(cell.stepOffset == elementsCount) {
+      if(cell.step != UploadStep::VERTICES || ++cell.stream == layout.vertexStreams.size()) {
+        cell.step = UploadStep(uint8_t(cell.step) + 1);
+      }
+      cell.stepOffset = 0;
+    }
+  }
+
+  // primitives show up as soon as they are added, the rest of the cell follows in the next frames
+  while(cell.stepOffset < cell.primitives.size()) {
+    if(Clock::now() >= deadline) {
+      return false;
+    }
+
+    auto& source = cell.primitives[cell.stepOffset++];
+    auto& mesh = *source.mesh;
+    auto firstIndex = cell.geometry.getFirstIndex(mesh.indexType);
+    auto primitive = RenderPrimitive { geometryPool.getVertexBuffer()->getHandle(),
+                                       geometryPool.getIndexBuffer(mesh.indexType)->getHandle() };
+    primitive.setMaterialInstance(materialInstance);
+    primitive.setMaterialIndex(materialIndex);
+    primitive.setRange(mesh.count, firstIndex + mesh.offset, cell.geometry.getBaseVertex() + int32_t(mesh.vertexOffset));
+    for(auto& lod : mesh.lods) {
+      primitive.addLod(lod.count, firstIndex + lod.offset, lod.error);
+    }
+    primitive.setPositionDecode(asset.getVertexFormat().getPositionDecode());
+    primitive.setTransform(math::mat4f(source.transform));
+    primitive.setBounds(source.bounds);
+    primitive.setOccluder(source.occluder);
+    primitive.setMeshlets(source.meshlets);
+    cell.entities.push_back(scene.addPrimitive(primitive));
+  }
+
+  cell.state = CellState::RESIDENT;
+  cell.asset.reset();
+  cell.primitives = { };
+  return true;
+}
+
+void WorldStreamer::unload(Cell& cell) {
+  if(cell.state == CellState::LOADING) {
+    // requests the streaming thread did not take yet are dropped right away
+    std::lock_guard lock(mutex);
+    auto it = std::find(requests.begin(), requests.end(), uint32_t(&cell - cells.data()));
+    if(it != requests.end()) {
+      requests.erase(it);
+      cell.state = CellState::UNLOADED;
+    } else {
+      cell.cancelled = true;
+    }
+    return;
+  }
+
+  for(auto entity : cell.entities) {
+    scene.removePrimitive(entity);
+  }
+  cell.entities.clear();
+
+  if(cell.geometry.isValid()) {
+    geometryPool.free(cell.geometry);
+    cell.geometry = { };
+  }
+  cell.asset.reset();
+  cell.primitives = { };
+  cell.state = CellState::UNLOADED;
+  stats.unloadedCells++;
+}
+
+}
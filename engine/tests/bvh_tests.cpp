@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <vector>
+#include "enjam/bvh.h"
+
+using namespace Enjam;
+
+static Aabb makeBox(std::mt19937& random) {
+  std::uniform_real_distribution<float> position { -100, 100 };
+  std::uniform_real_distribution<float> size { 0.1f, 3 };
+  math::vec3f min { position(random), position(random), position(random) };
+  return Aabb { .min = min, .max = min + math::vec3f { size(random), size(random), size(random) } };
+}
+
+template<class Overlaps>
+static std::vector<uint32_t> bruteForce(const std::vector<Aabb>& boxes, const std::vector<bool>& alive, Overlaps&& overlaps) {
+  std::vector<uint32_t> result;
+  for(uint32_t i = 0; i < boxes.size(); i++) {
+    if(alive[i] && overlaps(boxes[i])) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+static std::vector<uint32_t> sorted(std::vector<uint32_t> values) {
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+int main() {
+  std::mt19937 random { 7 };
+
+  constexpr uint32_t COUNT = 5000;
+  Bvh bvh;
+  std::vector<Aabb> boxes;
+  std::vector<uint32_t> proxies;
+  std::vector<bool> alive(COUNT, true);
+  for(uint32_t i = 0; i < COUNT; i++) {
+    boxes.push_back(makeBox(random));
+    proxies.push_back(bvh.insert(boxes.back(), i));
+  }
+  bvh.commit();
+  assert(bvh.getStats().rebuildsCount == 1 && bvh.getStats().pendingCount == 0);
+
+  auto check = [&]() {
+    Aabb box { .min = { -20, -30, -10 }, .max = { 25, 10, 40 } };
+    std::vector<uint32_t> result;
+    bvh.query(box, result);
+    assert(sorted(result) == bruteForce(boxes, alive, [&](const Aabb& b) { return box.intersects(b); }));
+
+    Sphere sphere { .center = { 10, 0, -5 }, .radius = 35 };
+    result.clear();
+    bvh.query(sphere, result);
+    assert(sorted(result) == bruteForce(boxes, alive, [&](const Aabb& b) { return sphere.intersects(b); }));
+
+    auto projection = math::mat4f::perspective(60, 1.5, 0.1, 80);
+    auto frustum = Frustum::fromMatrix(projection * inverse(math::mat4f::translation(math::vec3f { 0, 0, 50 })));
+    result.clear();
+    bvh.query(frustum, result);
+    assert(sorted(result) == bruteForce(boxes, alive, [&](const Aabb& b) { return frustum.intersects(b); }));
+    assert(!result.empty() && result.size() < COUNT);
+
+    Ray ray { .origin = { -150, 1, 2 }, .direction = { 1, 0, 0 } };
+    Bvh::RayHit hit;
+    auto closest = -1.0f;
+    uint32_t closestIndex = 0;
+    for(uint32_t i = 0; i < COUNT; i++) {
+      auto distance = alive[i] ? ray.intersect(boxes[i], 1000) : -1;
+      if(distance >= 0 && (closest < 0 || distance < closest)) {
+        closest = distance;
+        closestIndex = i;
+      }
+    }
+    assert(bvh.raycast(ray, 1000, hit) == (closest >= 0));
+    assert(closest < 0 || (hit.userData == closestIndex && hit.distance == closest));
+  };
+  check();
+
+  // moved proxies are refitted without a rebuild
+  for(uint32_t i = 0; i < COUNT; i += 10) {
+    boxes[i] = makeBox(random);
+    bvh.update(proxies[i], boxes[i]);
+  }
+  bvh.commit();
+  check();
+
+  // removed ones disappear at once, inserted ones before the rebuild are found too
+  for(uint32_t i = 1; i < COUNT; i += 50) {
+    bvh.remove(proxies[i]);
+    alive[i] = false;
+  }
+  for(uint32_t i = 0; i < 10; i++) {
+    boxes.push_back(makeBox(random));
+    alive.push_back(true);
+    proxies.push_back(bvh.insert(boxes.back(), boxes.size() - 1));
+  }
+  assert(bvh.getStats().pendingCount == 10);
+  bvh.commit();
+  check();
+
+  bvh.build();
+  assert(bvh.getStats().pendingCount == 0);
+  check();
+
+  // rays along an axis grazing the faces of a grid of unit boxes, parallel slabs must not turn into NaN
+  Bvh grid;
+  for(uint32_t i = 0; i < 200; i++) {
+    math::vec3f min { float(i % 10) * 2, float(i / 10 % 5) * 2, float(i / 50) * 2 };
+    grid.insert(Aabb { .min = min, .max = min + math::vec3f { 1 } }, i);
+  }
+  grid.commit();
+
+  Bvh::RayHit hit;
+  assert(grid.raycast(Ray { .origin = { -5, 2, 4.5f }, .direction = { 1, 0, 0 } }, 100, hit));
+  assert(hit.userData == 110 && hit.distance == 5);
+  assert(grid.raycast(Ray { .origin = { 3, 3, -1 }, .direction = { 0, 0, 1 } }, 100, hit));
+  assert(hit.userData == 11 && hit.distance == 1);
+  assert(grid.raycast(Ray { .origin = { 2, 8, 7 }, .direction = { 0, -1, 0 } }, 100, hit));
+  assert(hit.userData == 191 && hit.distance == 0);
+  assert(!grid.raycast(Ray { .origin = { -5, 1.5f, 0.5f }, .direction = { 1, 0, 0 } }, 100, hit));
+  assert(!grid.raycast(Ray { .origin = { 1.5f, 0.5f, -5 }, .direction = { 0, 0, 1 } }, 100, hit));
+
+  // a tree built over points has no area, moving them apart waits for the rebuild interval
+  Bvh points;
+  std::vector<uint32_t> pointProxies;
+  for(uint32_t i = 0; i < 100; i++) {
+    pointProxies.push_back(points.insert(Aabb { .min = { 0 }, .max = { 0 } }, i));
+  }
+  points.setRebuildInterval(10);
+  points.commit();
+  assert(points.getStats().rebuildsCount == 1);
+  for(uint32_t i = 1; i < 10; i++) {
+    math::vec3f position { float(i), float(i), float(i) };
+    points.update(pointProxies[i], Aabb { .min = position, .max = position });
+    points.commit();
+    assert(points.getStats().rebuildsCount == 1);
+  }
+  std::vector<uint32_t> found;
+  points.query(Aabb { .min = { 8.5f }, .max = { 9.5f } }, found);
+  assert(found == std::vector<uint32_t> { 9 });
+
+  points.update(pointProxies[10], Aabb { .min = { 10 }, .max = { 10 } });
+  points.commit();
+  assert(points.getStats().rebuildsCount == 2);
+
+  return 0;
+}
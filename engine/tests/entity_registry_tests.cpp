@@ -0,0 +1,79 @@
+#include <cassert>
+#include <memory>
+#include <vector>
+#include "enjam/entity_registry.h"
+
+using namespace Enjam;
+
+struct Position {
+  float x, y, z;
+};
+
+struct Velocity {
+  float x, y, z;
+};
+
+struct Name {
+  std::shared_ptr<int> value;
+};
+
+int main() {
+  EntityRegistry registry;
+
+  // enough entities to spread over several chunks
+  std::vector<Entity> entities;
+  for(auto i = 0; i < 5000; i++) {
+    entities.push_back(registry.create(Position { float(i), 0, 0 }, Velocity { 1, 0, 0 }));
+  }
+  assert(registry.getEntitiesCount() == 5000);
+  assert(registry.count<Position>() == 5000);
+  assert(registry.getArchetypesCount() == 1);
+
+  registry.each<Position, Velocity>([](Entity, Position& position, Velocity& velocity) {
+    position.x += velocity.x;
+  });
+  assert(registry.get<Position>(entities[42])->x == 43);
+  assert(registry.get<Name>(entities[42]) == nullptr);
+
+  // the last entity is moved into the hole, ids stay valid
+  registry.destroy(entities[10]);
+  assert(!registry.isAlive(entities[10]));
+  assert(registry.get<Position>(entities[4999])->x == 5000);
+
+  // the index is reused with a new generation
+  auto reused = registry.create(Position { -1, 0, 0 });
+  assert(reused.index == entities[10].index && !(reused == entities[10]));
+  assert(registry.count<Position>() == 5000);
+  assert((registry.count<Position, Velocity>() == 4999));
+
+  // changing the components moves the entity between archetypes
+  auto version = registry.getVersion();
+  registry.get<Position>(entities[0])->y = 1;
+  assert(registry.getVersion() == version);
+  auto counter = std::make_shared<int>(7);
+  registry.add(entities[0], Name { counter });
+  assert(registry.getVersion() != version);
+  assert(registry.has<Name>(entities[0]) && registry.get<Position>(entities[0])->x == 1);
+  assert(counter.use_count() == 2);
+
+  registry.remove<Velocity>(entities[0]);
+  assert(!registry.has<Velocity>(entities[0]) && *registry.get<Name>(entities[0])->value == 7);
+  assert((registry.count<Position, Name>() == 1));
+  assert(counter.use_count() == 2);
+
+  registry.destroy(entities[0]);
+  assert(counter.use_count() == 1);
+
+  registry.add(entities[1], Name { counter });
+  registry.clear();
+  assert(counter.use_count() == 1);
+  assert(registry.getEntitiesCount() == 0);
+
+  // handles from before a clear stay stale when their indices are reused
+  assert(!registry.isAlive(entities[1]));
+  auto recreated = registry.create();
+  assert(registry.isAlive(recreated) && recreated.index < entities.size());
+  assert(!registry.isAlive(entities[recreated.index]));
+
+  return 0;
+}
@@ -0,0 +1,45 @@
+#include <cassert>
+#include <cstring>
+#include "enjam/geometry_layout.h"
+
+using namespace Enjam;
+
+int main() {
+  VertexFormat format;
+  std::vector<ByteArray> streams;
+  for(uint32_t stream = 0; stream < format.getStreamsCount(); stream++) {
+    streams.emplace_back(3 * format.getStreamStride(stream), uint8_t(stream + 1));
+  }
+  ByteArray indices(3 * sizeof(uint32_t), 7);
+  ByteArray indices16(3 * sizeof(uint16_t), 9);
+
+  // sections are aligned and hold the bytes they were packed from
+  ByteArray geometry;
+  auto layout = GeometryLayout::pack(3, streams, indices, indices16, geometry);
+  assert(layout.vertexStreams.size() == streams.size());
+  for(uint32_t stream = 0; stream < streams.size(); stream++) {
+    auto& section = layout.vertexStreams[stream];
+    assert(section.offset % GeometryLayout::ALIGNMENT == 0 && section.size == streams[stream].size());
+    assert(std::memcmp(geometry.data() + section.offset, streams[stream].data(), section.size) == 0);
+  }
+  assert(layout.indices16.offset % GeometryLayout::ALIGNMENT == 0);
+  assert(std::memcmp(geometry.data() + layout.indices16.offset, indices16.data(), indices16.size()) == 0);
+  assert(layout.isValid(format, geometry.size()));
+
+  // the descriptor saved with the asset comes back the same
+  Asset asset;
+  asset = layout;
+  auto loaded = asset.as<GeometryLayout>();
+  assert(loaded.vertexCount == 3 && loaded.vertexStreams.size() == layout.vertexStreams.size());
+  assert(loaded.vertexStreams[3].offset == layout.vertexStreams[3].offset);
+  assert(loaded.indices.offset == layout.indices.offset && loaded.indices16.size == layout.indices16.size);
+
+  // layouts for another format or a truncated buffer are rejected
+  format.layout = VertexFormat::Layout::INTERLEAVED;
+  assert(!layout.isValid(format, geometry.size()));
+  format.layout = VertexFormat::Layout::SEPARATE;
+  assert(!layout.isValid(format, geometry.size() - 1));
+  layout.indices.offset += 4;
+  assert(!layout.isValid(format, geometry.size()));
+  return 0;
+}
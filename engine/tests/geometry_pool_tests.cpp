@@ -0,0 +1,144 @@
+#include <cassert>
+#include <vector>
+#include "enjam/geometry_pool.h"
+
+using namespace Enjam;
+
+// Hands out handles and records the buffer updates, the pool never touches a device
+class RecordingBackend final : public RendererBackend {
+ public:
+  struct Update {
+    uint32_t handle;
+    uint64_t size;
+    uint32_t byteOffset;
+  };
+
+  std::vector<Update> bufferUpdates;
+  std::vector<Update> indexUpdates;
+  uint32_t liveBuffers = 0;
+
+  bool init() override { return true; }
+  void shutdown() override { }
+  void beginFrame() override { }
+  void endFrame() override { }
+  void setPresentationConfig(const PresentationConfig&) override { }
+  uint32_t getMaxUniformBlockSize() const override { return 16384; }
+
+  void draw(ProgramHandle, VertexBufferHandle, IndexBufferHandle, uint32_t, uint32_t, int32_t) override { }
+  void multiDraw(ProgramHandle, VertexBufferHandle, IndexBufferHandle, const DrawRange*, uint32_t, int32_t) override { }
+
+  ProgramHandle createProgram(ProgramData&) override { return ProgramHandle { nextId++ }; }
+  void destroyProgram(ProgramHandle) override { }
+
+  DescriptorSetHandle createDescriptorSet(DescriptorSetData&&) override { return DescriptorSetHandle { nextId++ }; }
+  void destroyDescriptorSet(DescriptorSetHandle) override { }
+  void updateDescriptorSetBuffer(DescriptorSetHandle, uint8_t, BufferDataHandle, uint32_t, uint32_t) override { }
+  void updateDescriptorSetTexture(DescriptorSetHandle, uint8_t, TextureHandle) override { }
+  void bindDescriptorSet(DescriptorSetHandle, uint8_t) override { }
+  void setPushConstants(const void*, uint32_t, uint32_t) override { }
+
+  VertexBufferHandle createVertexBuffer(std::initializer_list<VertexAttribute>, uint64_t) override {
+    liveBuffers++;
+    return VertexBufferHandle { nextId++ };
+  }
+  void assignVertexBufferData(VertexBufferHandle, uint8_t, BufferDataHandle) override { }
+  void destroyVertexBuffer(VertexBufferHandle) override { liveBuffers--; }
+
+  IndexBufferHandle createIndexBuffer(uint32_t, IndexType) override {
+    liveBuffers++;
+    return IndexBufferHandle { nextId++ };
+  }
+  void updateIndexBuffer(IndexBufferHandle handle, BufferDataDesc&& desc, uint32_t byteOffset) override {
+    indexUpdates.push_back(Update { .handle = handle.getId(), .size = desc.size, .byteOffset = byteOffset });
+  }
+  void destroyIndexBuffer(IndexBufferHandle) override { liveBuffers--; }
+
+  BufferDataHandle createBufferData(uint32_t, BufferTargetBinding) override {
+    liveBuffers++;
+    return BufferDataHandle { nextId++ };
+  }
+  void updateBufferData(BufferDataHandle handle, BufferDataDesc&& desc, uint32_t byteOffset) override {
+    bufferUpdates.push_back(Update { .handle = handle.getId(), .size = desc.size, .byteOffset = byteOffset });
+  }
+  void destroyBufferData(BufferDataHandle) override { liveBuffers--; }
+
+  TextureHandle createTexture(uint32_t, uint32_t, uint8_t, TextureFormat) override { return TextureHandle { nextId++ }; }
+  TextureHandle createTextureArray(uint32_t, uint32_t, uint8_t, uint32_t, TextureFormat) override {
+    return TextureHandle { nextId++ };
+  }
+  void setTextureData(TextureHandle, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t,
+                      const void*) override { }
+  void destroyTexture(TextureHandle) override { }
+
+ private:
+  uint32_t nextId = 0;
+};
+
+int main() {
+  RecordingBackend backend;
+
+  // interleaved position and normal, texture coordinates in a stream of their own
+  GeometryPool pool {
+      backend,
+      {
+        VertexAttribute { .type = VertexAttributeType::FLOAT3, .offset = 0, .stride = 24 },
+        VertexAttribute { .type = VertexAttributeType::FLOAT3, .offset = 12, .stride = 24 },
+        VertexAttribute { .type = VertexAttributeType::FLOAT2, .offset = 0, .stride = 8 }
+      },
+      128, 320, 64
+  };
+  assert(pool.getStreamsCount() == 2);
+  assert(pool.getVertexStride(0) == 24 && pool.getVertexStride(1) == 8);
+
+  auto a = pool.allocate(40, 120);
+  auto b = pool.allocate(30, 0, 60);
+  assert(a.isValid() && b.isValid());
+  assert(a.getBaseVertex() == 0 && a.getVertexCount() == 40);
+  assert(b.getBaseVertex() == 40 && b.getVertexCount() == 30);
+  assert(a.getFirstIndex() == 0 && a.getIndexCount() == 120 && a.getIndexCount(IndexType::UINT16) == 0);
+  assert(!b.indices[uint8_t(IndexType::UINT32)].isValid());
+  assert(b.getFirstIndex(IndexType::UINT16) == 0 && b.getIndexCount(IndexType::UINT16) == 60);
+
+  auto stats = pool.getStats();
+  assert(stats.vertices.usedSize == 70 && stats.indices.usedSize == 120 && stats.indices16.usedSize == 60);
+
+  // uploads land at the range, from the given first vertex or index on
+  pool.setVertices(backend, b, 0, BufferDataDesc { nullptr, 10 * 24 }, 5);
+  assert(backend.bufferUpdates.back().byteOffset == (40 + 5) * 24);
+  pool.setVertices(backend, b, 1, BufferDataDesc { nullptr, 30 * 8 });
+  assert(backend.bufferUpdates.back().byteOffset == 40 * 8);
+  auto c = pool.allocate(10, 90);
+  pool.setIndices(backend, c, BufferDataDesc { nullptr, 90 * 4 });
+  assert(backend.indexUpdates.back().byteOffset == 120 * 4);
+  pool.setIndices(backend, b, BufferDataDesc { nullptr, 30 * 2 }, 30, IndexType::UINT16);
+  assert(backend.indexUpdates.back().byteOffset == 30 * 2);
+
+  // a mesh that does not fit in any of the arenas gets nothing, the arenas with room keep their space
+  assert(!pool.allocate(60, 10).isValid());
+  assert(!pool.allocate(10, 120).isValid());
+  assert(!pool.allocate(10, 0, 8).isValid());
+  stats = pool.getStats();
+  assert(stats.vertices.usedSize == 80 && stats.vertices.allocationsCount == 3);
+  assert(stats.indices.usedSize == 210 && stats.indices.allocationsCount == 2);
+  assert(stats.indices16.usedSize == 60 && stats.indices16.allocationsCount == 1);
+
+  // freed ranges are handed out again
+  pool.free(a);
+  auto d = pool.allocate(40, 120);
+  assert(d.isValid() && d.getBaseVertex() == 0 && d.getFirstIndex() == 0);
+
+  pool.free(b);
+  pool.free(c);
+  pool.free(d);
+  stats = pool.getStats();
+  assert(stats.vertices.usedSize == 0 && stats.indices.usedSize == 0 && stats.indices16.usedSize == 0);
+  assert(stats.vertices.largestFreeRange == 128 && stats.indices.largestFreeRange == 320);
+
+  // capacities on a size bin boundary can be allocated whole
+  auto whole = pool.allocate(128, 320, 64);
+  assert(whole.isValid());
+  pool.free(whole);
+
+  pool.destroy(backend);
+  assert(backend.liveBuffers == 0);
+}
@@ -0,0 +1,76 @@
+#include <cassert>
+#include <vector>
+#include "enjam/light_clusters.h"
+#include "enjam/thread_pool.h"
+
+using namespace Enjam;
+
+using Grid = LightClustersUniforms;
+
+static bool hasLight(const LightClusters& clusters, uint32_t cluster, uint32_t light) {
+  auto offset = clusters.getClusterOffset(cluster);
+  for(uint32_t i = 0; i < clusters.getClusterCount(cluster); i++) {
+    if(clusters.getLightIndex(offset + i) == light) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main() {
+  ThreadPool threadPool { 3 };
+  LightClusters clusters;
+
+  // camera at the origin looking down -z
+  auto projection = math::mat4f::perspective(90.0f, 1.0f, 0.1f, 100.0f);
+  auto view = math::mat4f { };
+
+  std::vector<FrameLight> lights {
+      { .position = { 0, 0, -10 }, .radius = 1, .color = { 1, 0, 0 } }, // in the middle of the screen
+      { .position = { 0, 0, 10 }, .radius = 1, .color = { 0, 1, 0 } }, // behind the camera
+      { .position = { -9, 0, -10 }, .radius = 0.5f, .color = { 0, 0, 1 } }, // on the left edge
+  };
+  clusters.build(view, projection, lights, threadPool);
+  assert(clusters.getStats().lightsCount == 2);
+
+  // the slice and the tiles around the center of the first light
+  auto& params = clusters.getClusters().params;
+  auto slice = uint32_t(std::log(10.0f) * params[0] + params[1]);
+  auto center = (slice * Grid::GRID_Y + Grid::GRID_Y / 2) * Grid::GRID_X + Grid::GRID_X / 2;
+  auto corner = slice * Grid::GRID_Y * Grid::GRID_X;
+  auto left = (slice * Grid::GRID_Y + Grid::GRID_Y / 2) * Grid::GRID_X;
+  auto front = (0 * Grid::GRID_Y + Grid::GRID_Y / 2) * Grid::GRID_X + Grid::GRID_X / 2;
+
+  auto light0 = clusters.getLights().colors[0][0] == 1 ? 0u : 1u;
+  assert(hasLight(clusters, center, light0));
+  assert(!hasLight(clusters, corner, light0));
+  assert(!hasLight(clusters, front, light0));
+  assert(hasLight(clusters, left, 1 - light0));
+  assert(!hasLight(clusters, center, 1 - light0));
+
+  // a light covering everything fills every cluster until the index buffer runs out
+  lights.push_back({ .position = { 0, 0, -50 }, .radius = 1000, .color = { 1, 1, 1 } });
+  clusters.build(view, projection, lights, threadPool);
+  assert(clusters.getStats().lightsCount == 3);
+  assert(clusters.getStats().indicesCount <= LightIndicesUniforms::MAX_INDICES);
+  assert(clusters.getClusterCount(0) == 1);
+
+  // past the light limit the farthest lights are dropped
+  std::vector<FrameLight> manyLights;
+  for(uint32_t i = 0; i < LightsUniforms::MAX_LIGHTS + 10; i++) {
+    manyLights.push_back({ .position = { 0, 0, -1.0f - float(i) * 0.25f }, .radius = 0.1f, .color = { 1, 1, 1 } });
+  }
+  clusters.build(view, projection, manyLights, threadPool);
+  assert(clusters.getStats().lightsCount == LightsUniforms::MAX_LIGHTS);
+  assert(clusters.getStats().droppedLightsCount == 10);
+  for(uint32_t i = 0; i < clusters.getStats().lightsCount; i++) {
+    assert(clusters.getLights().positionRadius[i][2] > -1.0f - float(LightsUniforms::MAX_LIGHTS) * 0.25f);
+  }
+
+  // no lights leaves every cluster empty
+  clusters.build(view, projection, { }, threadPool);
+  assert(clusters.getStats().indicesCount == 0);
+  assert(clusters.getClusterCount(center) == 0);
+
+  return 0;
+}
@@ -0,0 +1,33 @@
+#include <cassert>
+#include "enjam/meshlet.h"
+
+using namespace Enjam;
+
+int main() {
+  // a flat patch facing +y
+  Meshlet flat {
+      .center = { 0, 0, 0 },
+      .radius = 1,
+      .coneAxis = { 0, 1, 0 },
+      .coneCutoff = 0,
+      .indexOffset = 0,
+      .indexCount = 3
+  };
+  assert(!flat.isBackfacing({ 0, 10, 0 }));
+  assert(flat.isBackfacing({ 0, -10, 0 }));
+  // below the patch but close to its plane, some of it may face the camera
+  assert(!flat.isBackfacing({ 10, -0.5f, 0 }));
+
+  // triangles facing up to 60 degrees away from the axis
+  auto curved = flat;
+  curved.coneCutoff = 0.866f;
+  assert(curved.isBackfacing({ 0, -100, 0 }));
+  assert(!curved.isBackfacing({ 10, -10, 0 }));
+
+  // facing every way
+  auto closed = flat;
+  closed.coneCutoff = 1;
+  assert(!closed.isBackfacing({ 0, -10, 0 }));
+  assert(!closed.isBackfacing({ 0, -1000, 0 }));
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include "enjam/occlusion_culler.h"
+#include "enjam/thread_pool.h"
+
+using namespace Enjam;
+
+static Aabb makeBox(const math::vec3f& center, float halfSize) {
+  return Aabb { .min = center + math::vec3f { -halfSize }, .max = center + math::vec3f { halfSize } };
+}
+
+// Distance from the origin to the surface along the direction, the mesh is a radial graph around the origin
+static float getSurfaceDistance(const OccluderMesh& mesh, const math::vec3f& direction) {
+  for(size_t first = 0; first < mesh.indices.size(); first += 3) {
+    auto& a = mesh.positions[mesh.indices[first]];
+    auto e1 = mesh.positions[mesh.indices[first + 1]] + (-a), e2 = mesh.positions[mesh.indices[first + 2]] + (-a);
+    auto p = cross(direction, e2);
+    auto determinant = dot(e1, p);
+    if(std::abs(determinant) < 1e-12f) {
+      continue;
+    }
+    auto s = -a;
+    auto u = dot(s, p) / determinant;
+    auto q = cross(s, e1);
+    auto v = dot(direction, q) / determinant;
+    auto t = dot(e2, q) / determinant;
+    if(u >= -1e-5f && v >= -1e-5f && u + v <= 1 + 1e-5f && t > 0) {
+      return t;
+    }
+  }
+  return 0;
+}
+
+int main() {
+  ThreadPool threadPool { 3 };
+  OcclusionCuller culler;
+
+  // camera at z = 5 looking down -z
+  auto projection = math::mat4f::perspective(60.0f, 2.0f, 0.1f, 100.0f);
+  auto view = math::mat4f::translation(math::vec3f { 0, 0, -5 });
+
+  // a wall at z = 0 facing the camera
+  OccluderMesh wall {
+      .positions = { { -1.5f, -1.5f, 0 }, { 1.5f, -1.5f, 0 }, { 1.5f, 1.5f, 0 }, { -1.5f, 1.5f, 0 } },
+      .indices = { 0, 1, 2, 0, 2, 3 }
+  };
+
+  culler.begin(projection * view);
+  assert(culler.addOccluder(wall, math::mat4f { }));
+  culler.rasterize(threadPool);
+
+  // the wall covers the middle of the screen but not its corners
+  auto top = culler.getLevelsCount() - 1;
+  assert(culler.getDepth(0, 128, 64) > 0);
+  assert(culler.getDepth(top, 0, 0) == 0);
+
+  std::vector<Aabb> boxes {
+      makeBox({ 0, 0, -3 }, 0.5f), // behind the wall
+      makeBox({ 0, 0, 2 }, 0.5f), // in front of it
+      makeBox({ 0, 0, 0 }, 0.5f), // crossing it
+      makeBox({ 30, 0, -30 }, 0.5f), // behind, but off the wall
+      makeBox({ 0, 0, 10 }, 0.5f), // behind the camera
+  };
+  std::vector<uint8_t> visible(boxes.size());
+  culler.cull(boxes.data(), boxes.size(), visible.data(), threadPool);
+
+  assert(visible[0] == 0);
+  assert(visible[1] == 1);
+  assert(visible[2] == 1);
+  assert(visible[3] == 1);
+  assert(visible[4] == 1);
+
+  auto& stats = culler.getStats();
+  assert(stats.occludersCount == 1 && stats.occluderTrianglesCount == 2);
+  assert(stats.testedCount == boxes.size() && stats.culledCount == 1);
+
+  // a new frame without occluders culls nothing
+  culler.begin(projection * view);
+  culler.rasterize(threadPool);
+  assert(culler.isVisible(boxes[0]));
+
+  // levels coarser than a tile can be odd, 96 pixels are 3 texels at TILE_SIZE. A wall over the first two of them
+  // leaves the third one open, and the coarsest level has to see through it.
+  OcclusionCuller wideCuller { OcclusionCuller::Config { .width = 96, .height = 32 } };
+  auto wideProjection = math::mat4f::perspective(60.0f, 3.0f, 0.1f, 100.0f);
+  OccluderMesh leftWall {
+      .positions = { { -10, -10, 0 }, { 1.3f, -10, 0 }, { 1.3f, 10, 0 }, { -10, 10, 0 } },
+      .indices = { 0, 1, 2, 0, 2, 3 }
+  };
+  wideCuller.begin(wideProjection * view);
+  assert(wideCuller.addOccluder(leftWall, math::mat4f { }));
+  wideCuller.rasterize(threadPool);
+  assert(wideCuller.getDepth(0, 16, 16) > 0);
+  assert(wideCuller.getDepth(wideCuller.getLevelsCount() - 1, 0, 0) == 0);
+  assert(wideCuller.isVisible(makeBox({ 0, 0, -20 }, 15)));
+
+  // a sphere with deep grooves, the vertices of a cell on both sides of a groove average to a point above it
+  constexpr uint32_t RINGS = 48, SEGMENTS = 96;
+  constexpr float PI = 3.14159265f;
+  OccluderMesh grooved;
+  grooved.positions.push_back({ 0, 1, 0 });
+  for(uint32_t ring = 1; ring < RINGS; ring++) {
+    for(uint32_t segment = 0; segment < SEGMENTS; segment++) {
+      auto theta = PI * ring / RINGS, phi = 2 * PI * segment / SEGMENTS;
+      auto radius = 1 + 0.3f * std::cos(12 * phi) * std::sin(theta);
+      grooved.positions.push_back(math::vec3f { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) } * radius);
+    }
+  }
+  grooved.positions.push_back({ 0, -1, 0 });
+  auto getVertex = [&](uint32_t ring, uint32_t segment) { return 1 + (ring - 1) * SEGMENTS + segment % SEGMENTS; };
+  for(uint32_t segment = 0; segment < SEGMENTS; segment++) {
+    grooved.indices.insert(grooved.indices.end(), { 0, getVertex(1, segment + 1), getVertex(1, segment) });
+    for(uint32_t ring = 1; ring + 1 < RINGS; ring++) {
+      auto a = getVertex(ring, segment), b = getVertex(ring, segment + 1);
+      auto c = getVertex(ring + 1, segment), d = getVertex(ring + 1, segment + 1);
+      grooved.indices.insert(grooved.indices.end(), { a, b, c, b, d, c });
+    }
+    auto last = uint32_t(grooved.positions.size() - 1);
+    grooved.indices.insert(grooved.indices.end(), { last, getVertex(RINGS - 1, segment), getVertex(RINGS - 1, segment + 1) });
+  }
+
+  auto occluder = OccluderMesh::simplify(grooved.positions.data(), grooved.positions.size(), grooved.indices, 16);
+  assert(!occluder.indices.empty() && occluder.indices.size() < grooved.indices.size() / 2);
+  for(size_t first = 0; first < occluder.indices.size(); first += 3) {
+    auto& a = occluder.positions[occluder.indices[first]];
+    auto& b = occluder.positions[occluder.indices[first + 1]];
+    auto& c = occluder.positions[occluder.indices[first + 2]];
+    for(auto point : { a, b, c, (a + b + c) * (1.0f / 3), (a + b) * 0.5f, (b + c) * 0.5f, (c + a) * 0.5f }) {
+      // averaged cells stick out by up to a cell, 0.16 here
+      auto distance = length(point);
+      assert(distance <= getSurfaceDistance(grooved, point * (1 / distance)) + 1e-3f);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <cassert>
+#include <random>
+#include <vector>
+#include "enjam/range_allocator.h"
+
+int main() {
+  using namespace Enjam;
+
+  RangeAllocator allocator { 1024 };
+  assert(allocator.getStats().largestFreeRange == 1024);
+
+  auto a = allocator.allocate(100);
+  auto b = allocator.allocate(200);
+  auto c = allocator.allocate(300);
+  assert(a.isValid() && b.isValid() && c.isValid());
+  assert(a.offset == 0 && b.offset == 100 && c.offset == 300);
+  assert(allocator.getStats().usedSize == 600);
+  assert(allocator.getStats().allocationsCount == 3);
+
+  assert(!allocator.allocate(1000).isValid());
+  assert(!allocator.allocate(0).isValid());
+
+  // hole in the middle splits the free space
+  allocator.free(b);
+  auto stats = allocator.getStats();
+  assert(stats.freeRangesCount == 2);
+  assert(stats.largestFreeRange == 424);
+  assert(stats.fragmentation() > 0.0f);
+
+  // freeing the neighbours merges everything back into one range
+  allocator.free(a);
+  allocator.free(c);
+  stats = allocator.getStats();
+  assert(stats.usedSize == 0);
+  assert(stats.freeRangesCount == 1);
+  assert(stats.largestFreeRange == 1024);
+  assert(stats.fragmentation() == 0.0f);
+
+  auto whole = allocator.allocate(1024);
+  assert(whole.isValid() && whole.offset == 0);
+  allocator.free(whole);
+
+  // random churn never hands out overlapping ranges
+  std::mt19937 random { 42 };
+  RangeAllocator churn { 1 << 20 };
+  std::vector<RangeAllocator::Range> live;
+  std::vector<uint8_t> owner(1 << 20, 0);
+  for(auto i = 0; i < 20000; i++) {
+    if(live.empty() || random() % 3 != 0) {
+      auto range = churn.allocate(1 + random() % 4096);
+      if(!range.isValid()) { continue; }
+      for(auto j = range.offset; j < range.offset + range.size; j++) {
+        assert(owner[j] == 0);
+        owner[j] = 1;
+      }
+      live.push_back(range);
+    } else {
+      auto index = random() % live.size();
+      auto range = live[index];
+      for(auto j = range.offset; j < range.offset + range.size; j++) {
+        owner[j] = 0;
+      }
+      churn.free(range);
+      live[index] = live.back();
+      live.pop_back();
+    }
+  }
+
+  for(auto& range : live) {
+    churn.free(range);
+  }
+  assert(churn.getStats().usedSize == 0);
+  assert(churn.getStats().freeRangesCount == 1);
+}
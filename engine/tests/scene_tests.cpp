@@ -0,0 +1,81 @@
+#include <cassert>
+#include <cmath>
+#include "enjam/scene.h"
+#include "enjam/render_primitive.h"
+#include "enjam/render_components.h"
+
+using namespace Enjam;
+
+static bool near(const math::vec3f& a, const math::vec3f& b) {
+  return std::abs(a.x - b.x) < 1e-4f && std::abs(a.y - b.y) < 1e-4f && std::abs(a.z - b.z) < 1e-4f;
+}
+
+int main() {
+  Scene scene;
+
+  // root -> child -> grandchild, second root
+  auto root = scene.addNode(Scene::NO_NODE, Transform { .translation = { 1, 0, 0 } });
+  auto child = scene.addNode(root, Transform { .translation = { 0, 2, 0 }, .scale = math::vec3f { 2 } });
+  auto grandchild = scene.addNode(child, Transform { .translation = { 0, 0, 3 } });
+  auto other = scene.addNode(Scene::NO_NODE);
+
+  assert(scene.getSubtreeSize(root) == 3);
+  assert(scene.getParent(grandchild) == child);
+  assert(scene.updateTransforms() == 4);
+  assert(scene.updateTransforms() == 0);
+
+  assert(near(scene.getWorldTransform(child)[3].xyz, { 1, 2, 0 }));
+  assert(near(scene.getWorldTransform(grandchild)[3].xyz, { 1, 2, 6 }));
+
+  // moving the root updates its subtree only, the dirty child is covered by it
+  scene.setLocalTransform(child, Transform { .translation = { 0, 1, 0 } });
+  scene.setLocalTransform(root, Transform { .translation = { 5, 0, 0 } });
+  assert(scene.updateTransforms() == 3);
+  assert(near(scene.getWorldTransform(grandchild)[3].xyz, { 5, 1, 3 }));
+
+  scene.setLocalTransform(other, Transform { .translation = { 0, 0, 1 } });
+  assert(scene.updateTransforms() == 1);
+
+  // entities following a node get the world transform of the updated subtrees
+  auto light = scene.addLight(PointLight { .node = grandchild });
+  auto removed = scene.addLight(PointLight { .node = grandchild });
+  scene.removeLight(removed);
+  scene.setLocalTransform(root, Transform { .translation = { 7, 0, 0 } });
+  assert(scene.updateTransforms() == 3);
+  assert(near(scene.getEntities().get<TransformComponent>(light)->world[3].xyz, { 7, 1, 3 }));
+
+  // and their proxies follow them
+  RenderPrimitive primitive;
+  primitive.setNode(grandchild);
+  primitive.setBounds(Aabb { .min = math::vec3f { -0.5f }, .max = math::vec3f { 0.5f } });
+  auto entity = scene.addPrimitive(primitive);
+  scene.updateSpatialIndex();
+  scene.setLocalTransform(root, Transform { .translation = { 9, 0, 0 } });
+  scene.updateTransforms();
+  scene.updateSpatialIndex();
+  std::vector<Entity> found;
+  scene.query(Aabb { .min = { 8.9f, 0.9f, 2.9f }, .max = { 9.1f, 1.1f, 3.1f } }, found);
+  assert(found.size() == 1 && found[0] == entity);
+  found.clear();
+  scene.query(Aabb { .min = { 6.9f, 0.9f, 2.9f }, .max = { 7.1f, 1.1f, 3.1f } }, found);
+  assert(found.empty());
+
+  // levels of detail past the component capacity are dropped
+  RenderPrimitive detailed;
+  detailed.setBounds(Aabb { .min = math::vec3f { -0.5f }, .max = math::vec3f { 0.5f } });
+  for(uint32_t lod = 0; lod < LodComponent::MAX_LODS + 2; lod++) {
+    detailed.addLod(3, 3 * lod, float(lod));
+  }
+  auto lods = scene.getEntities().get<LodComponent>(scene.addPrimitive(detailed));
+  assert(lods->lodsCount == LodComponent::MAX_LODS && lods->lods[LodComponent::MAX_LODS - 1].error == LodComponent::MAX_LODS - 2);
+
+  // 90 degrees around z survives the round trip through a matrix
+  auto s = std::sqrt(0.5f);
+  Transform rotated { .translation = { 1, 2, 3 }, .rotation = { 0, 0, s, s }, .scale = { 1, 2, 3 } };
+  auto decomposed = Transform::fromMatrix(rotated.toMatrix());
+  assert(near(decomposed.translation, rotated.translation));
+  assert(near(decomposed.scale, rotated.scale));
+  assert(near(decomposed.rotation.xyz, rotated.rotation.xyz));
+
+  return 0;
+}
@@ -0,0 +1,57 @@
+#include <cassert>
+#include <cmath>
+#include "enjam/vertex_format.h"
+
+using namespace Enjam;
+
+int main() {
+  // halves are exact for small integers and simple fractions, and keep 11 bits of precision
+  for(auto value : { 0.0f, 1.0f, -2.0f, 0.5f, 0.25f, 1024.0f, -0.125f }) {
+    assert(fromHalf(toHalf(value)) == value);
+  }
+  assert(std::abs(fromHalf(toHalf(0.3f)) - 0.3f) < 0.3f / 1024);
+  assert(std::abs(fromHalf(toHalf(3.7e-6f)) - 3.7e-6f) < 1e-7f); // subnormal
+  assert(std::isinf(fromHalf(toHalf(1e6f))));
+  assert(toHalf(1e-10f) == 0);
+
+  // octahedral normals stay within a few hundredths of a degree on both hemispheres
+  for(auto z : { -1.0f, -0.7f, 0.0f, 0.3f, 1.0f }) {
+    for(auto angle = 0.0f; angle < 6.28f; angle += 0.37f) {
+      auto radius = std::sqrt(1 - z * z);
+      auto normal = math::vec3f { std::cos(angle) * radius, std::sin(angle) * radius, z };
+      auto encoded = encodeOctahedral(normal);
+      auto decoded = decodeOctahedral(encoded[0], encoded[1]);
+      assert(dot(normal, decoded) > 0.99999f);
+    }
+  }
+
+  // the bitangent sign survives next to the tangent
+  float sign = 0;
+  auto tangent = normalize(math::vec3f { 0.2f, -0.9f, 0.4f });
+  auto decoded = decodeTangent(encodeTangent(tangent, -1), sign);
+  assert(sign == -1 && dot(tangent, decoded) > 0.9999f);
+  decoded = decodeTangent(encodeTangent(tangent, 1), sign);
+  assert(sign == 1 && dot(tangent, decoded) > 0.9999f);
+
+  // unorm16 positions are decoded over the bounds they were encoded on
+  VertexFormat format {
+      .positions = VertexFormat::Position::UNORM16,
+      .positionOffset = math::vec3f { -10, 0, 5 },
+      .positionScale = 20
+  };
+  uint16_t encoded[4] = { toUnorm16(0.5f), toUnorm16(0), toUnorm16(1), 0 };
+  auto position = format.decodePosition(reinterpret_cast<const uint8_t*>(encoded));
+  assert(std::abs(position.x) < 1e-3f && position.y == 0 && position.z == 25);
+  assert(format.getPositionStride() == 8 && format.getPositionAttribute().flags == VertexAttribute::FLAG_NORMALIZED);
+
+  // interleaved attributes share the stride of a whole vertex, one after the other
+  format.layout = VertexFormat::Layout::INTERLEAVED;
+  format.texCoords = VertexFormat::TexCoord::HALF2;
+  assert(format.getStreamsCount() == 1 && format.getVertexStride() == 20);
+  assert(format.getTexCoordAttribute().offset == 8 && format.getTexCoordAttribute().stride == 20);
+  assert(format.getNormalAttribute().offset == 12 && format.getTangentAttribute().offset == 16);
+  format.layout = VertexFormat::Layout::SEPARATE;
+  assert(format.getStreamsCount() == 4 && format.getTangentAttribute().offset == 0 && format.getTangentAttribute().stride == 4);
+
+  return 0;
+}
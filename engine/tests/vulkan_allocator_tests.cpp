@@ -0,0 +1,57 @@
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include "enjam/vulkan_allocator.h"
+
+int main() {
+  using namespace Enjam;
+
+  VulkanHostAllocator allocator;
+  auto callbacks = allocator.getCallbacks();
+  assert(callbacks->pUserData == &allocator);
+
+  auto alloc = [&](size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    return callbacks->pfnAllocation(callbacks->pUserData, size, alignment, scope);
+  };
+
+  std::vector<void*> small;
+  for(auto i = 0; i < 10000; i++) {
+    auto size = 1 + i % 200;
+    auto ptr = alloc(size, 8, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+    assert(ptr);
+    assert(reinterpret_cast<uintptr_t>(ptr) % 8 == 0);
+    std::memset(ptr, 0xab, size);
+    small.push_back(ptr);
+  }
+
+  auto stats = allocator.getStats();
+  assert(stats[VK_SYSTEM_ALLOCATION_SCOPE_OBJECT].liveAllocations == small.size());
+  assert(stats[VK_SYSTEM_ALLOCATION_SCOPE_OBJECT].pooledAllocations == small.size());
+
+  auto large = alloc(1 << 20, 256, VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+  assert(large);
+  assert(reinterpret_cast<uintptr_t>(large) % 256 == 0);
+  assert(allocator.getStats()[VK_SYSTEM_ALLOCATION_SCOPE_DEVICE].liveBytes == 1 << 20);
+  assert(allocator.getStats()[VK_SYSTEM_ALLOCATION_SCOPE_DEVICE].pooledAllocations == 0);
+
+  auto grown = callbacks->pfnReallocation(callbacks->pUserData, small[0], 4096, 8, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+  assert(grown);
+  assert(static_cast<uint8_t*>(grown)[0] == 0xab);
+  small[0] = grown;
+
+  for(auto ptr : small) {
+    callbacks->pfnFree(callbacks->pUserData, ptr);
+  }
+  callbacks->pfnFree(callbacks->pUserData, large);
+  callbacks->pfnFree(callbacks->pUserData, nullptr);
+
+  for(auto& scopeStats : allocator.getStats()) {
+    assert(scopeStats.liveBytes == 0);
+    assert(scopeStats.liveAllocations == 0);
+  }
+
+  callbacks->pfnInternalAllocation(callbacks->pUserData, 128, VK_INTERNAL_ALLOCATION_TYPE_EXECUTABLE, VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+  assert(allocator.getStats()[VK_SYSTEM_ALLOCATION_SCOPE_DEVICE].internalBytes == 128);
+  callbacks->pfnInternalFree(callbacks->pUserData, 128, VK_INTERNAL_ALLOCATION_TYPE_EXECUTABLE, VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+  assert(allocator.getStats()[VK_SYSTEM_ALLOCATION_SCOPE_DEVICE].internalBytes == 0);
+}
@@ -1,13 +1,70 @@
 #version 410 core
 
+// keep in sync with LightsUniforms, LightClustersUniforms and LightIndicesUniforms,
+// the GL backend reports blocks whose size differs from the one in the program data
+#define MAX_LIGHTS 256
+#define GRID_X 16
+#define GRID_Y 8
+#define GRID_Z 24
+#define MAX_LIGHT_INDICES 16384
+
 out vec4 FragColor;
 
 in vec2 TexCoord;
+flat in uint MaterialIndex;
+in vec3 WorldPos;
+in vec4 ClipPos;
+in vec3 Normal;
+
+uniform sampler2DArray texture1;
+
+layout (std140) uniform material {
+   vec4 tint;
+};
+
+layout (std140) uniform lights {
+   vec4 lightPositionRadius[MAX_LIGHTS];
+   vec4 lightColors[MAX_LIGHTS];
+};
+
+layout (std140) uniform lightClusters {
+   vec4 clusterParams;
+   uvec4 clusterRanges[GRID_X * GRID_Y * GRID_Z / 4];
+};
+
+layout (std140) uniform lightIndices {
+   uvec4 lightIndexWords[MAX_LIGHT_INDICES / 16];
+};
+
+vec3 shadeLights()
+{
+   // the cluster of the fragment, tiles split the NDC square and slices grow exponentially with depth
+   vec2 ndc = ClipPos.xy / ClipPos.w;
+   ivec2 tile = clamp(ivec2((ndc * 0.5 + 0.5) * vec2(GRID_X, GRID_Y)), ivec2(0), ivec2(GRID_X - 1, GRID_Y - 1));
+   int slice = clamp(int(log(ClipPos.w) * clusterParams.x + clusterParams.y), 0, GRID_Z - 1);
+   int cluster = (slice * GRID_Y + tile.y) * GRID_X + tile.x;
+
+   uint range = clusterRanges[cluster / 4][cluster % 4];
+   uint offset = range & 0xffffu;
+   uint count = range >> 16;
 
-uniform sampler2D texture1;
+   vec3 normal = normalize(Normal);
+   vec3 result = vec3(0.0);
+   for (uint i = offset; i < offset + count; i++) {
+      uint light = (lightIndexWords[i / 16u][(i / 4u) % 4u] >> ((i % 4u) * 8u)) & 0xffu;
+      vec4 positionRadius = lightPositionRadius[light];
+      vec3 toLight = positionRadius.xyz - WorldPos;
+      float distance = length(toLight);
+      float falloff = clamp(1.0 - distance / positionRadius.w, 0.0, 1.0);
+      float diffuse = max(dot(normal, toLight / max(distance, 1e-4)), 0.0);
+      result += lightColors[light].rgb * falloff * falloff * diffuse;
+   }
+   return result;
+}
 
 void main()
 {
    // FragColor = vec4(1.0f, 0.5f, 0.5f, 1.0f);
-   FragColor = texture(texture1, TexCoord);
+   vec4 albedo = tint * texture(texture1, vec3(TexCoord, MaterialIndex));
+   FragColor = vec4(albedo.rgb * (0.3 + shadeLights()), albedo.a);
 }
\ No newline at end of file
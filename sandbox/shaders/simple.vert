@@ -2,10 +2,14 @@
 
 struct ObjectUniform {
   mat4 model;
+  vec4 positionDecode;
+  uint materialIndex;
 };
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec2 aNormal; // octahedral
+layout (location = 3) in vec2 aTangent; // octahedral snorm16 values, bitangent sign in the lowest bit of y
 
 layout (std140) uniform perView {
    mat4 projection;
@@ -17,10 +21,32 @@ layout (std140) uniform perObject {
 };
 
 out vec2 TexCoord;
+flat out uint MaterialIndex;
+out vec3 WorldPos;
+out vec4 ClipPos;
+out vec3 Normal;
+out vec4 Tangent;
+
+vec3 decodeOctahedral(vec2 e)
+{
+   vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+   float fold = max(-v.z, 0.0);
+   v.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(v.xy, vec2(0.0)));
+   return normalize(v);
+}
 
 void main()
 {
    mat4 model = data.model;
-   gl_Position = projection * view * model * vec4(aPos, 1.0);
+   vec3 position = data.positionDecode.xyz + aPos * data.positionDecode.w;
+   vec4 worldPos = model * vec4(position, 1.0);
+   gl_Position = projection * view * worldPos;
    TexCoord = aTexCoord;
-}
\ No newline at end of file
+   MaterialIndex = data.materialIndex;
+   WorldPos = worldPos.xyz;
+   ClipPos = gl_Position;
+
+   float bitangentSign = (int(aTangent.y) & 1) != 0 ? -1.0 : 1.0;
+   Normal = normalize(mat3(model) * decodeOctahedral(aNormal));
+   Tangent = vec4(normalize(mat3(model) * decodeOctahedral(max(aTangent / 32767.0, -1.0))), bitangentSign);
+}
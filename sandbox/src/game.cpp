@@ -4,15 +4,22 @@
 #include <enjam/assets_repository.h>
 #include <enjam/dependencies.h>
 #include <enjam/dcc_asset.h>
+#include <enjam/geometry_pool.h>
 #include <enjam/input.h>
 #include <enjam/log.h>
+#include <enjam/material.h>
 #include <enjam/math.h>
 #include <enjam/scene.h>
 #include <enjam/simulation.h>
 #include <enjam/texture.h>
+#include <enjam/texture_table.h>
 #include <enjam/renderer.h>
 #include <enjam/render_primitive.h>
 #include <enjam/render_view.h>
+#include <enjam/world_asset.h>
+#include <enjam/world_streamer.h>
+#include <cmath>
+#include <filesystem>
 #include <sstream>
 
 // TODO:
@@ -36,8 +43,10 @@ class SandboxSimulation : public Enjam::Simulation {
       , rendererBackend(rendererBackend)
       , camera(camera)
       , scene(scene)
-      , textureAssets([&](auto& path) { return assetsRepository.load(path); }, Enjam::TextureAssetFactory { })
+      , textureTable(rendererBackend)
+      , textureAssets([&](auto& path) { return assetsRepository.load(path); }, Enjam::TextureAssetFactory { &textureTable })
       , dccAssets([&](auto& path) { return assetsRepository.load(path); }, Enjam::DCCAssetFactory { })
+      , worldAssets([&](auto& path) { return assetsRepository.load(path); }, Enjam::WorldAssetFactory { })
       {}
 
   void start() override {
@@ -53,69 +62,179 @@ class SandboxSimulation : public Enjam::Simulation {
     auto programData = Enjam::ProgramData()
         .setShader(Enjam::ShaderStage::VERTEX, vertexShaderStrBuffer.str().c_str())
         .setShader(Enjam::ShaderStage::FRAGMENT, fragmentShaderStrBuffer.str().c_str())
-        .setDescriptorSet(1, { { "texture1",  Enjam::ProgramData::DescriptorType::SAMPLER } })
-        .setDescriptorSet(0, { { "perView",  Enjam::ProgramData::DescriptorType::UNIFORM },
-                               { "perObject", Enjam::ProgramData::DescriptorType::UNIFORM }});
-
-    programHandle = rendererBackend.createProgram(programData);
+        .setDescriptorSet(0, {
+            { "perView",  Enjam::ProgramData::DescriptorType::UNIFORM, sizeof(Enjam::PerViewUniforms) },
+            { "lights",  Enjam::ProgramData::DescriptorType::UNIFORM, sizeof(Enjam::LightsUniforms) },
+            { "lightClusters",  Enjam::ProgramData::DescriptorType::UNIFORM, sizeof(Enjam::LightClustersUniforms) },
+            { "lightIndices",  Enjam::ProgramData::DescriptorType::UNIFORM, sizeof(Enjam::LightIndicesUniforms) }
+        })
+        .setPushConstants("perObject", sizeof(Enjam::PerObjectUniforms));
+
+    Enjam::MaterialParameterLayout parameters;
+    parameters.add("tint", Enjam::MaterialParameterType::FLOAT4);
+    material.reset(new Enjam::Material { rendererBackend, programData, std::move(parameters), { "texture1" } });
 
     camera.projectionMatrix = Enjam::math::mat4f::perspective(60, 1.4, 0.1, 100);
     camera.modelMatrix = Enjam::math::mat4f::lookAt(Enjam::math::vec3f { 0, 0, -8 }, Enjam::math::vec3f{ 0, 0, 1 }, Enjam::math::vec3f{ 0, 1, 0 });
 
     input.onKeyPress().add(onKeyPress);
 
-    auto descriptorSetHandle = rendererBackend.createDescriptorSet(Enjam::DescriptorSetData {
-        .bindings {
-            { .binding = 0, .type = Enjam::DescriptorType::TEXTURE },
-        }
-    });
-
     dummyTex = textureAssets.load("assets/textures/dummy.nj_tex", rendererBackend);
-    rendererBackend.updateDescriptorSetTexture(descriptorSetHandle, 0, dummyTex->getHandle());
 
+    // equal instances end up sharing one descriptor set and parameters block
+    for(auto& instance : materialInstances) {
+      instance.reset(new Enjam::MaterialInstance { *material });
+      instance->setParameter("tint", Enjam::math::vec4f { 1, 1, 1, 1 });
+      instance->setTexture("texture1", dummyTex->getHandle());
+    }
+
+    // the pool streams are encoded like the cube, the world cells must be imported with the same options
     cubeAsset = dccAssets.load("assets/models/cube.nj_dcc");
-    vertexBuffer.reset(
-        new Enjam::VertexBuffer {
+    auto& vertexFormat = cubeAsset->getVertexFormat();
+    geometryPool.reset(
+        new Enjam::GeometryPool {
           rendererBackend,
           {
-            Enjam::VertexAttribute { .type = Enjam::VertexAttributeType::FLOAT3, .offset = 0, .stride = sizeof(Enjam::math::vec3f) },
-            Enjam::VertexAttribute { .type = Enjam::VertexAttributeType::FLOAT2, .offset = 0, .stride = sizeof(Enjam::math::vec2f) }
+            vertexFormat.getPositionAttribute(),
+            vertexFormat.getTexCoordAttribute(),
+            vertexFormat.getNormalAttribute(),
+            vertexFormat.getTangentAttribute()
           },
-          cubeAsset->getPositions().size()
+          GEOMETRY_POOL_VERTICES,
+          GEOMETRY_POOL_INDICES,
+          GEOMETRY_POOL_INDICES16
         });
-    vertexBuffer->setBuffer(rendererBackend, 0, Enjam::BufferDataDesc{(void*) cubeAsset->getPositions().data(), cubeAsset->getPositions().size() * sizeof(Enjam::math::vec3f)});
-    vertexBuffer->setBuffer(rendererBackend, 1, Enjam::BufferDataDesc{(void*) cubeAsset->getTexCoords0().data(), cubeAsset->getTexCoords0().size() * sizeof(Enjam::math::vec2f)});
 
-    indexBuffer.reset(new Enjam::IndexBuffer(rendererBackend, cubeAsset->getIndices().size()));
-    indexBuffer->setBuffer(rendererBackend, Enjam::BufferDataDesc{(void*) cubeAsset->getIndices().data(), cubeAsset->getIndices().size() * sizeof(uint32_t)});
+    // the sections of the geometry buffer are uploaded where they were loaded to
+    auto& cubeLayout = cubeAsset->getGeometryLayout();
+    auto& cubeBuffer = cubeAsset->getGeometry();
+    auto cubeData = [&cubeBuffer](const Enjam::GeometryLayout::Section& section) {
+      return Enjam::BufferDataDesc{(void*) (cubeBuffer.data() + section.offset), section.size};
+    };
+    cubeGeometry = geometryPool->allocate(cubeAsset->getVertexCount(), cubeAsset->getIndicesCount(), cubeAsset->getIndices16Count());
+    for(uint8_t stream = 0; stream < cubeLayout.vertexStreams.size(); stream++) {
+      geometryPool->setVertices(rendererBackend, cubeGeometry, stream, cubeData(cubeLayout.vertexStreams[stream]));
+    }
+    if(cubeLayout.indices.size > 0) {
+      geometryPool->setIndices(rendererBackend, cubeGeometry, cubeData(cubeLayout.indices));
+    }
+    if(cubeLayout.indices16.size > 0) {
+      geometryPool->setIndices(rendererBackend, cubeGeometry, cubeData(cubeLayout.indices16), 0, Enjam::IndexType::UINT16);
+    }
 
-    auto triangle1 = Enjam::RenderPrimitive { vertexBuffer.get(), indexBuffer.get(), programHandle };
-    triangle1.setDescriptorSetHandle(descriptorSetHandle);
-    scene.getPrimitives().push_back(triangle1);
+    Enjam::Aabb cubeBounds;
+    for(uint32_t i = 0; i < cubeAsset->getVertexCount(); i++) {
+      cubeBounds.expand(cubeAsset->getPosition(i));
+    }
 
-    auto triangle2 = Enjam::RenderPrimitive { vertexBuffer.get(), indexBuffer.get(), programHandle };
-    triangle2.setDescriptorSetHandle(descriptorSetHandle);
-    triangle2.setTransform(Enjam::math::mat4f::translation(Enjam::math::vec3f {4, 0, 0}));
-    scene.getPrimitives().push_back(triangle2);
+    // the index buffer also holds the levels of detail of the cube mesh, only its range is drawn
+    const Enjam::DCCAsset::Mesh* cubeMesh = nullptr;
+    for(auto& node : cubeAsset->getNodes()) {
+      if(!cubeMesh && !node.meshes.empty()) {
+        cubeMesh = &node.meshes.front();
+      }
+    }
+    ENJAM_ASSERT(cubeMesh);
+
+    // set when the cube was imported with -occluders and -meshlets
+    auto cubeOccluder = cubeAsset->getOccluder(*cubeMesh);
+    auto cubeMeshlets = cubeAsset->getMeshlets(*cubeMesh);
+
+    // the mesh indices are relative to its first vertex, in the pool index buffer of their type
+    auto cubeIndexBuffer = geometryPool->getIndexBuffer(cubeMesh->indexType)->getHandle();
+    auto cubeFirstIndex = cubeGeometry.getFirstIndex(cubeMesh->indexType);
+    auto cubeBaseVertex = cubeGeometry.getBaseVertex() + int32_t(cubeMesh->vertexOffset);
+
+    // the second cube is attached to the first one, moving the root node moves both
+    auto rootNode = scene.addNode(Enjam::Scene::NO_NODE);
+    auto childNode = scene.addNode(rootNode, Enjam::Transform { .translation = Enjam::math::vec3f { 4, 0, 0 } });
+
+    auto triangle1 = Enjam::RenderPrimitive { geometryPool->getVertexBuffer()->getHandle(), cubeIndexBuffer };
+    triangle1.setMaterialInstance(materialInstances[0].get());
+    triangle1.setMaterialIndex(dummyTex->getLayer());
+    triangle1.setRange(cubeMesh->count, cubeFirstIndex + cubeMesh->offset, cubeBaseVertex);
+    for(auto& lod : cubeMesh->lods) {
+      triangle1.addLod(lod.count, cubeFirstIndex + lod.offset, lod.error);
+    }
+    triangle1.setPositionDecode(vertexFormat.getPositionDecode());
+    triangle1.setNode(rootNode);
+    triangle1.setBounds(cubeBounds);
+    triangle1.setOccluder(cubeOccluder);
+    triangle1.setMeshlets(cubeMeshlets);
+    scene.addPrimitive(triangle1);
+
+    auto triangle2 = Enjam::RenderPrimitive { geometryPool->getVertexBuffer()->getHandle(), cubeIndexBuffer };
+    triangle2.setMaterialInstance(materialInstances[1].get());
+    triangle2.setMaterialIndex(dummyTex->getLayer());
+    triangle2.setRange(cubeMesh->count, cubeFirstIndex + cubeMesh->offset, cubeBaseVertex);
+    for(auto& lod : cubeMesh->lods) {
+      triangle2.addLod(lod.count, cubeFirstIndex + lod.offset, lod.error);
+    }
+    triangle2.setPositionDecode(vertexFormat.getPositionDecode());
+    triangle2.setNode(childNode);
+    triangle2.setBounds(cubeBounds);
+    triangle2.setOccluder(cubeOccluder);
+    triangle2.setMeshlets(cubeMeshlets);
+    scene.addPrimitive(triangle2);
+
+    // a ring of lights around the cubes, one of them follows the second cube
+    for(auto i = 0; i < LIGHTS_COUNT; i++) {
+      auto angle = float(i) / LIGHTS_COUNT * 6.2831853f;
+      scene.addLight(Enjam::PointLight {
+          .position = Enjam::math::vec3f { 2 + std::cos(angle) * 5, std::sin(angle * 3), std::sin(angle) * 5 },
+          .color = Enjam::math::vec3f { 0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::sin(angle), 0.5f },
+          .radius = 4
+      });
+    }
+    scene.addLight(Enjam::PointLight { .color = Enjam::math::vec3f { 1, 0.8f, 0.6f }, .radius = 3, .node = childNode });
+
+    // cells are read on the streaming thread, with their own repository
+    if(std::filesystem::exists(WORLD_PATH)) {
+      worldStreamer.reset(new Enjam::WorldStreamer {
+          scene,
+          *geometryPool,
+          worldAssets.load(WORLD_PATH),
+          [repository = Enjam::AssetsFilesystemRep { }](const std::string& path) mutable {
+            return Enjam::DCCAssetFactory { }(repository.load(path));
+          },
+          Enjam::WorldStreamer::Config { }
+      });
+      worldStreamer->setMaterial(materialInstances[0].get(), dummyTex->getLayer());
+    }
+
+    geometryPool->logStats();
 
     ENJAM_INFO("Simulation started!");
   }
 
   void stop() override {
-    auto& primitives = scene.getPrimitives();
-    primitives.clear();
+    if(worldStreamer) {
+      worldStreamer->unloadAll();
+      worldStreamer.reset();
+    }
+
+    scene.clearPrimitives();
+    scene.clearNodes();
 
-    if(vertexBuffer) {
-      vertexBuffer->destroy(rendererBackend);
+    if(geometryPool) {
+      geometryPool->free(cubeGeometry);
+      geometryPool->destroy(rendererBackend);
+      geometryPool.reset();
     }
 
-    if(indexBuffer) {
-      indexBuffer->destroy(rendererBackend);
+    dummyTex.reset();
+    textureTable.destroy();
+
+    for(auto& instance : materialInstances) {
+      if(instance) {
+        renderer.getMaterialSystem().release(*instance);
+        instance.reset();
+      }
     }
 
-    if(programHandle) {
-      rendererBackend.destroyProgram(programHandle);
-      programHandle = { };
+    if(material) {
+      material->destroy(rendererBackend);
+      material.reset();
     }
 
     input.onKeyPress().remove(onKeyPress);
@@ -124,10 +243,18 @@ class SandboxSimulation : public Enjam::Simulation {
   }
 
   void tick() override {
-
+    if(worldStreamer) {
+      worldStreamer->update(rendererBackend, camera.getPosition());
+    }
   }
 
  private:
+  static constexpr uint32_t GEOMETRY_POOL_VERTICES = 64 * 1024;
+  static constexpr uint32_t GEOMETRY_POOL_INDICES = 3 * GEOMETRY_POOL_VERTICES;
+  static constexpr uint32_t GEOMETRY_POOL_INDICES16 = 3 * GEOMETRY_POOL_VERTICES;
+  static constexpr int LIGHTS_COUNT = 32;
+  static constexpr const char* WORLD_PATH = "assets/worlds/world.nj_world";
+
   Enjam::AssetsRepository& assetsRepository;
   Enjam::Renderer& renderer;
   Enjam::Input& input;
@@ -135,13 +262,17 @@ class SandboxSimulation : public Enjam::Simulation {
   Enjam::Camera& camera;
   Enjam::Scene& scene;
 
+  Enjam::TextureTable textureTable;
   Enjam::AssetsManager<Enjam::Texture, Enjam::TextureAssetFactory> textureAssets;
   Enjam::AssetsManager<Enjam::DCCAsset, Enjam::DCCAssetFactory> dccAssets;
+  Enjam::AssetsManager<Enjam::WorldAsset, Enjam::WorldAssetFactory> worldAssets;
   Enjam::AssetRef<Enjam::Texture> dummyTex;
   Enjam::AssetRef<Enjam::DCCAsset> cubeAsset;
-  std::unique_ptr<Enjam::VertexBuffer> vertexBuffer;
-  std::unique_ptr<Enjam::IndexBuffer> indexBuffer;
-  Enjam::ProgramHandle programHandle = { };
+  std::unique_ptr<Enjam::GeometryPool> geometryPool;
+  Enjam::GeometryRange cubeGeometry;
+  std::unique_ptr<Enjam::Material> material;
+  std::array<std::unique_ptr<Enjam::MaterialInstance>, 2> materialInstances;
+  std::unique_ptr<Enjam::WorldStreamer> worldStreamer;
 
   Enjam::KeyPressEvent::EventHandler onKeyPress = Enjam::KeyPressEvent::EventHandler {
     [this](const Enjam::KeyPressEventArgs& args) {
@@ -12,8 +12,11 @@
 #include <enjam/utils.h>
 #include <enjam/dependencies.h>
 #include <enjam/platform_glfw.h>
+#include <charconv>
 #include <memory>
 #include <filesystem>
+#include <string_view>
+#include <vector>
 
 Enjam::utils::Path createDllCacheDir(const Enjam::utils::Path& currentPath) {
   auto path = currentPath / "dll-cache";
@@ -55,6 +58,36 @@ Enjam::LibraryLoader CreateLibLoader(const Enjam::utils::Path& dllCacheDir, Enja
   return Enjam::LibraryLoader { dllCacheDir, onLoadLib, onUnloadLib };
 }
 
+// -present fifo|mailbox|immediate and -images <count>, the defaults of PresentationConfig otherwise
+Enjam::PresentationConfig readPresentationConfig(int argc, char* argv[]) {
+  Enjam::PresentationConfig config;
+  std::vector<std::string_view> args {argv + 1, argv + argc};
+  for(auto it = args.begin(); it != args.end(); it++) {
+    if(*it == "-present" && std::next(it) != args.end()) {
+      it++;
+      if(*it == "fifo") {
+        config.presentMode = Enjam::PresentMode::FIFO;
+      } else if(*it == "mailbox") {
+        config.presentMode = Enjam::PresentMode::MAILBOX;
+      } else if(*it == "immediate") {
+        config.presentMode = Enjam::PresentMode::IMMEDIATE;
+      } else {
+        ENJAM_WARN("Unknown present mode {}, using fifo", *it);
+      }
+    } else if(*it == "-images" && std::next(it) != args.end()) {
+      it++;
+      uint32_t count = 0;
+      auto [end, error] = std::from_chars(it->data(), it->data() + it->size(), count);
+      if(error != std::errc { } || end != it->data() + it->size() || count > UINT8_MAX) {
+        ENJAM_WARN("Invalid image count {}, using the default", *it);
+      } else {
+        config.imageCount = uint8_t(count);
+      }
+    }
+  }
+  return config;
+}
+
 int main(int argc, char* argv[]) {
   std::filesystem::path exePath = argv[0];
   std::filesystem::path exeFolder = exePath.parent_path();
@@ -66,7 +99,8 @@ int main(int argc, char* argv[]) {
 
   auto app = std::make_shared<Enjam::Application>();
   auto platform = std::make_shared<Enjam::PlatformGlfw>();
-  std::shared_ptr<Enjam::RendererBackend> rendererBackend = platform->createRendererBackend(Enjam::RendererBackendType::VULKAN);
+  auto presentationConfig = readPresentationConfig(argc, argv);
+  std::shared_ptr<Enjam::RendererBackend> rendererBackend = platform->createRendererBackend(Enjam::RendererBackendType::VULKAN, presentationConfig);
   auto renderer = std::make_shared<Enjam::Renderer>(*rendererBackend);
   auto input = std::make_shared<Enjam::Input>();
   auto scene = std::make_shared<Enjam::Scene>();
@@ -114,12 +148,20 @@ int main(int argc, char* argv[]) {
     }
   };
 
-  auto cleanup = [&renderer, &sim](){
+  auto cleanup = [&renderer, &sim, &platform](){
     if(sim) {
       sim->stop();
       sim.reset();
     }
 
+    auto latency = platform->getFrameLatency().getStats();
+    if(latency.frames == 0) {
+      ENJAM_INFO("Input to present latency not measured, the renderer backend presented no frames");
+    } else {
+      ENJAM_INFO("Input to present latency at the OpenGL buffer swap: last {:.2f}ms, average {:.2f}ms, max {:.2f}ms over {} frames",
+                 latency.lastMs, latency.averageMs, latency.maxMs, latency.frames);
+    }
+
     renderer->shutdown();
   };
 
@@ -1,29 +1,133 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
 #include <filesystem>
+#include <map>
+#include <optional>
 #include <string_view>
 #include <vector>
 #include <unordered_set>
 #include <enjam/math_assetparser.h>
 #include <enjam/asset.h>
+#include <enjam/bounds.h>
+#include <enjam/geometry_layout.h>
 #include <enjam/assets_repository.h>
+#include <enjam/import_batch.h>
+#include <enjam/import_cache.h>
 #include <enjam/log.h>
 #include <enjam/math.h>
+#include <enjam/meshlet.h>
+#include <enjam/occlusion_culler.h>
+#include <enjam/thread_pool.h>
 #include <enjam/utils.h>
+#include <enjam/vertex_format.h>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
+#include "meshlet_builder.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
 
 using namespace Enjam;
 using namespace Enjam::math;
 
 class DCCImporter {
+  struct ImportedData;
+
  public:
-  explicit DCCImporter(const std::filesystem::path& inputPath);
+  // Encodings of the written vertex streams, normals and tangents are always octahedral snorm16
+  struct Quantization {
+    bool texCoords = false; // half, or unorm16 when they are all in [0, 1]
+    bool positions = false; // unorm16 over the bounds of the asset
+    bool interleave = false; // the drawn attributes in a single stream of whole vertices
+    bool packed = false; // the streams and the indices in one buffer, laid out as they are uploaded
+  };
+
+  // Meshes of the nodes named "occluder" get an occluder, all of them when allOccluders is set
+  explicit DCCImporter(const std::filesystem::path& inputPath, bool allOccluders = false);
+
+  void setQuantization(const Quantization& value) { quantization = value; }
+
+  void operator()(Asset& asset) const { write(data, quantization, asset); }
+
+  // Meshes whose world bounds center falls in one square of a grid on the XZ plane
+  struct Cell {
+    int32_t x;
+    int32_t z;
+    Aabb bounds;
+    std::shared_ptr<ImportedData> data;
+    Quantization quantization;
+
+    void operator()(Asset& asset) const { write(*data, quantization, asset); }
+    void mergeStatic() { mergeStaticMeshes(*data); }
+    void buildMeshlets() { splitMeshlets(*data); }
+    uint64_t getSize() const;
+  };
+
+  // Every mesh goes to the cell of the center of its world bounds, under a root node with its world transform
+  std::vector<Cell> partition(float cellSize) const;
+
+  // For scenery that never moves: vertices are moved to world space and the meshes sharing a material are merged
+  // into one index range, drawn at once. The nodes are kept without meshes, every merged mesh lists
+  // the index ranges it was made of and their nodes for picking.
+  void mergeStatic() { mergeStaticMeshes(data); }
+
+  // Splits the full index range of every mesh into meshlets the views cull one by one, after mergeStatic.
+  // Their triangles are reordered so each meshlet is contiguous, within the index ranges of the merged meshes.
+  void buildMeshlets() { splitMeshlets(data); }
+
+ private:
+  static void write(const ImportedData& data, const Quantization& quantization, Asset& asset) {
+    auto format = getVertexFormat(data, quantization);
+    asset["positionFormat"] = uint32_t(format.positions);
+    asset["positionOffset"] = format.positionOffset;
+    asset["positionScale"] = format.positionScale;
+    asset["texCoordFormat"] = uint32_t(format.texCoords);
 
-  void operator()(Asset& asset) const {
-    asset["indices"] = makeByteArray(data.indices.begin(), data.indices.end());
-    asset["positions"] = makeByteArray(data.positions.begin(), data.positions.end());
-    asset["texCoords0"] = makeByteArray(data.texCoords0.begin(), data.texCoords0.end());
-    asset["texCoords1"] = makeByteArray(data.texCoords1.begin(), data.texCoords1.end());
+    std::vector<ByteArray> streams {
+        encodePositions(data.positions, format),
+        encodeTexCoords(data.texCoords0, format),
+        encodeNormals(data.normals),
+        encodeTangents(data.tangents)
+    };
+    if(format.layout == VertexFormat::Layout::INTERLEAVED) {
+      streams = { interleave(streams, format) };
+    }
+    // packed streams are written with the indices, once those are known
+    if(!quantization.packed && format.layout == VertexFormat::Layout::INTERLEAVED) {
+      asset["vertices"] = std::move(streams[0]);
+    } else if(!quantization.packed) {
+      asset["positions"] = std::move(streams[0]);
+      asset["texCoords0"] = std::move(streams[1]);
+      asset["normals"] = std::move(streams[2]);
+      asset["tangents"] = std::move(streams[3]);
+    }
+    asset["texCoords1"] = encodeTexCoords(data.texCoords1, format);
+    if(!data.occluderIndices.empty()) {
+      asset["occluderPositions"] = makeByteArray(data.occluderPositions.begin(), data.occluderPositions.end());
+      asset["occluderIndices"] = makeByteArray(data.occluderIndices.begin(), data.occluderIndices.end());
+    }
+
+    // indices are rebased on the first vertex of their mesh, 16 bit ones go to their own buffer
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> indices;
+    std::vector<uint16_t> indices16;
+    auto writeIndices = [&](const Mesh& mesh, uint64_t offset, uint64_t count) {
+      auto source = data.indices.begin() + offset;
+      if(getIndexType(mesh) == IndexType::UINT16) {
+        auto first = uint32_t(indices16.size());
+        for(uint64_t i = 0; i < count; i++) {
+          indices16.push_back(uint16_t(source[i] - mesh.vertexOffset));
+        }
+        return first;
+      }
+      auto first = uint32_t(indices.size());
+      for(uint64_t i = 0; i < count; i++) {
+        indices.push_back(source[i] - mesh.vertexOffset);
+      }
+      return first;
+    };
 
     asset["nodes"] = Asset::array();
     auto& nodesAsset =  asset["nodes"];
@@ -37,23 +141,124 @@ class DCCImporter {
       auto& meshesAsset = nodeAsset["meshes"];
       for(auto& mesh : node.meshes) {
         Asset meshAsset;
-        meshAsset["offset"] = mesh.offset;
+        auto offset = writeIndices(mesh, mesh.offset, mesh.count);
+        meshAsset["offset"] = offset;
         meshAsset["count"] = mesh.count;
+        meshAsset["indexType"] = uint32_t(getIndexType(mesh));
+        meshAsset["vertexOffset"] = mesh.vertexOffset;
+        meshAsset["material"] = mesh.material;
+
+        meshAsset["lods"] = Asset::array();
+        auto& lodsAsset = meshAsset["lods"];
+        for(auto& lod : mesh.lods) {
+          Asset lodAsset;
+          lodAsset["offset"] = writeIndices(mesh, lod.offset, lod.count);
+          lodAsset["count"] = lod.count;
+          lodAsset["error"] = lod.error;
+          lodsAsset.pushBack(std::move(lodAsset));
+        }
+        if(!mesh.meshlets.empty()) {
+          meshAsset["meshletOffset"] = uint32_t(meshlets.size());
+          meshAsset["meshletCount"] = uint32_t(mesh.meshlets.size());
+          meshlets.insert(meshlets.end(), mesh.meshlets.begin(), mesh.meshlets.end());
+        }
+        if(mesh.occluderIndexCount > 0) {
+          meshAsset["occluderVertexOffset"] = mesh.occluderVertexOffset;
+          meshAsset["occluderVertexCount"] = mesh.occluderVertexCount;
+          meshAsset["occluderIndexOffset"] = mesh.occluderIndexOffset;
+          meshAsset["occluderIndexCount"] = mesh.occluderIndexCount;
+        }
+        if(!mesh.sources.empty()) {
+          meshAsset["sources"] = Asset::array();
+          auto& sourcesAsset = meshAsset["sources"];
+          for(auto& source : mesh.sources) {
+            Asset sourceAsset;
+            sourceAsset["node"] = source.node;
+            sourceAsset["offset"] = offset + uint32_t(source.offset - mesh.offset);
+            sourceAsset["count"] = source.count;
+            sourcesAsset.pushBack(std::move(sourceAsset));
+          }
+        }
         meshesAsset.pushBack(std::move(meshAsset));
       }
 
       nodesAsset.pushBack(std::move(nodeAsset));
     }
+
+    if(quantization.packed) {
+      ByteArray geometry;
+      asset["geometryLayout"] = GeometryLayout::pack(uint32_t(data.positions.size()), streams,
+                                                     makeByteArray(indices.begin(), indices.end()),
+                                                     makeByteArray(indices16.begin(), indices16.end()), geometry);
+      asset["geometry"] = std::move(geometry);
+    } else {
+      asset["indices"] = makeByteArray(indices.begin(), indices.end());
+      if(!indices16.empty()) {
+        asset["indices16"] = makeByteArray(indices16.begin(), indices16.end());
+      }
+    }
+    if(!meshlets.empty()) {
+      asset["meshlets"] = makeByteArray(meshlets.begin(), meshlets.end());
+    }
   }
 
  private:
+  static VertexFormat getVertexFormat(const ImportedData&, const Quantization&);
+  static ByteArray encodePositions(const std::vector<vec3f>&, const VertexFormat&);
+  static ByteArray encodeTexCoords(const std::vector<vec2f>&, const VertexFormat&);
+  static ByteArray encodeNormals(const std::vector<vec3f>&);
+  static ByteArray encodeTangents(const std::vector<vec4f>&);
+  static ByteArray interleave(const std::vector<ByteArray>& separateStreams, const VertexFormat&);
+
   void processNode(const aiScene*, const aiNode*, int32_t parentIndex = -1);
+  void addOccluder(const aiMesh*);
+  void addLods(const aiMesh*, const std::vector<uint32_t>& indices, uint32_t baseVertex);
+  void optimizeMesh(const std::string& name);
+  static void mergeStaticMeshes(ImportedData&);
+  static void splitMeshlets(ImportedData&);
+
+  // every level of detail keeps at most this part of the triangles of the previous one
+  static constexpr uint32_t MAX_LODS = 4;
+  static constexpr float LOD_REDUCTION = 0.5f;
+  static constexpr float LOD_MIN_REDUCTION = 0.9f;
+
+  // cells per axis of the grid the occluder vertices are clustered on
+  static constexpr uint32_t OCCLUDER_GRID_SIZE = 16;
+
+  // Simplified index range over the vertices of the full mesh
+  struct Lod {
+    uint32_t offset;
+    uint32_t count;
+    float error; // distance to the full mesh surface, in mesh units
+  };
+
+  // Index range of a merged mesh that came from the mesh of a node
+  struct Source {
+    int32_t node;
+    uint32_t offset;
+    uint32_t count;
+  };
 
   struct Mesh {
     uint64_t offset;
     uint64_t count;
+    uint32_t vertexOffset;
+    uint32_t vertexCount;
+    uint32_t material = 0;
+    std::vector<Lod> lods;
+    uint32_t occluderVertexOffset = 0;
+    uint32_t occluderVertexCount = 0;
+    uint32_t occluderIndexOffset = 0;
+    uint32_t occluderIndexCount = 0;
+    std::vector<Source> sources; // of merged static meshes
+    std::vector<Meshlet> meshlets; // of the full index range
   };
 
+  // indices are relative to vertexOffset, so 16 bits are enough up to 65536 vertices
+  static IndexType getIndexType(const Mesh& mesh) {
+    return mesh.vertexCount <= UINT16_MAX + 1 ? IndexType::UINT16 : IndexType::UINT32;
+  }
+
   struct Node {
     std::string name;
     int32_t parentIndex;
@@ -65,15 +270,21 @@ class DCCImporter {
     std::vector<vec3f> positions;
     std::vector<vec2f> texCoords0;
     std::vector<vec2f> texCoords1;
+    std::vector<vec3f> normals;
+    std::vector<vec4f> tangents; // w is the bitangent sign
     std::vector<uint32_t> indices;
+    std::vector<vec3f> occluderPositions;
+    std::vector<uint32_t> occluderIndices;
 
     std::vector<Node> nodes;
   };
 
   ImportedData data;
+  bool allOccluders;
+  Quantization quantization;
 };
 
-DCCImporter::DCCImporter(const std::filesystem::path& path) {
+DCCImporter::DCCImporter(const std::filesystem::path& path, bool allOccluders) : allOccluders(allOccluders) {
   Assimp::Importer importer;
   importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_LINE | aiPrimitiveType_POINT);
   importer.SetPropertyBool(AI_CONFIG_IMPORT_COLLADA_IGNORE_UP_DIRECTION, true);
@@ -89,8 +300,7 @@ DCCImporter::DCCImporter(const std::filesystem::path& path) {
        aiProcess_FindInstances |
        aiProcess_OptimizeMeshes |
        aiProcess_JoinIdenticalVertices |
-       // misc optimization
-       aiProcess_ImproveCacheLocality |
+       // misc optimization, the triangle and vertex order is optimized afterwards along with the lods
        aiProcess_SortByPType |
        // we only support triangles
        aiProcess_Triangulate);
@@ -111,7 +321,11 @@ void DCCImporter::processNode(const aiScene* scene, const aiNode* node, int32_t
            t.d1, t.d2, t.d3, t.d4
        })
    });
+  auto nodeIndex = int32_t(data.nodes.size() - 1);
 
+  std::string name = node->mName.C_Str();
+  std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+  bool isOccluder = allOccluders || name.find("occluder") != std::string::npos;
 
   for (size_t i = 0; i < node->mNumMeshes; i++) {
     aiMesh const* mesh = scene->mMeshes[node->mMeshes[i]];
@@ -119,6 +333,9 @@ void DCCImporter::processNode(const aiScene* scene, const aiNode* node, int32_t
     auto positions = reinterpret_cast<vec3f const*>(mesh->mVertices);
     auto texCoords0 = reinterpret_cast<vec3f const*>(mesh->mTextureCoords[0]);
     auto texCoords1 = reinterpret_cast<vec3f const*>(mesh->mTextureCoords[1]);
+    auto normals = reinterpret_cast<vec3f const*>(mesh->mNormals);
+    auto tangents = reinterpret_cast<vec3f const*>(mesh->mTangents);
+    auto bitangents = reinterpret_cast<vec3f const*>(mesh->mBitangents);
 
     const size_t numVertices = mesh->mNumVertices;
 
@@ -136,32 +353,575 @@ void DCCImporter::processNode(const aiScene* scene, const aiNode* node, int32_t
           data.texCoords0.emplace_back(texCoord0);
           data.texCoords1.emplace_back(texCoord1);
           data.positions.emplace_back(positions[j]);
+
+          // tangents are missing without texture coordinates, any direction along the surface will do
+          vec3f normal = normals ? normals[j] : vec3f { 0, 0, 1 };
+          vec4f tangent { 1, 0, 0, 1 };
+          if(tangents && bitangents) {
+            tangent = vec4f { tangents[j], dot(cross(normal, tangents[j]), bitangents[j]) < 0 ? -1.0f : 1.0f };
+          } else {
+            auto axis = std::abs(normal.x) < 0.9f ? vec3f { 1, 0, 0 } : vec3f { 0, 1, 0 };
+            tangent = vec4f { cross(cross(normal, axis), normal), 1 };
+          }
+          data.normals.emplace_back(normal);
+          data.tangents.emplace_back(tangent);
         }
 
         size_t indicesCount = numFaces * faces[0].mNumIndices;
         size_t indexBufferOffset = data.indices.size();
 
+        std::vector<uint32_t> meshIndices;
         for (size_t j = 0; j < numFaces; ++j) {
           const aiFace& face = faces[j];
           for (size_t k = 0; k < face.mNumIndices; ++k) {
+            meshIndices.push_back(face.mIndices[k]);
             data.indices.push_back(uint32_t(face.mIndices[k] + indicesOffset));
           }
         }
 
-        data.nodes.back().meshes.push_back({
+        data.nodes[nodeIndex].meshes.push_back({
              .offset = indexBufferOffset,
-             .count = indicesCount
+             .count = indicesCount,
+             .vertexOffset = uint32_t(indicesOffset),
+             .vertexCount = uint32_t(numVertices),
+             .material = mesh->mMaterialIndex
          });
+
+        addLods(mesh, meshIndices, indicesOffset);
+        optimizeMesh(node->mName.C_Str());
+        if(isOccluder) {
+          addOccluder(mesh);
+        }
       }
     }
   }
 
   for(auto i = 0; i < node->mNumChildren; i++) {
-    processNode(scene, node->mChildren[i], data.nodes.size() - 1);
+    processNode(scene, node->mChildren[i], nodeIndex);
+  }
+}
+
+// Appends the levels of detail of the last added mesh to the index buffer, each one simplified from the full mesh
+void DCCImporter::addLods(const aiMesh* mesh, const std::vector<uint32_t>& indices, uint32_t baseVertex) {
+  MeshSimplifier simplifier(reinterpret_cast<vec3f const*>(mesh->mVertices), mesh->mNumVertices, indices);
+  auto& lods = data.nodes.back().meshes.back().lods;
+
+  auto previousCount = indices.size();
+  for(uint32_t i = 0; i < MAX_LODS; i++) {
+    auto target = uint32_t(previousCount / 3 * LOD_REDUCTION) * 3;
+    float error = 0;
+    auto lodIndices = simplifier.simplify(target, error);
+    if(lodIndices.empty() || lodIndices.size() > previousCount * LOD_MIN_REDUCTION) {
+      break;
+    }
+
+    lods.push_back({ .offset = uint32_t(data.indices.size()), .count = uint32_t(lodIndices.size()), .error = error });
+    for(auto index : lodIndices) {
+      data.indices.push_back(index + baseVertex);
+    }
+    previousCount = lodIndices.size();
   }
 }
 
-bool generateAsset(const std::filesystem::path& inputPath, const std::filesystem::path& outputPath) {
+// Reorders the triangles of the last added mesh and of its levels of detail for the vertex cache and overdraw,
+// then its vertices in the order the triangles use them
+void DCCImporter::optimizeMesh(const std::string& name) {
+  auto& mesh = data.nodes.back().meshes.back();
+  auto baseVertex = mesh.vertexOffset;
+
+  std::vector<std::pair<uint32_t, uint32_t>> ranges { { uint32_t(mesh.offset), uint32_t(mesh.count) } };
+  for(auto& lod : mesh.lods) {
+    ranges.emplace_back(lod.offset, lod.count);
+  }
+  std::vector<std::vector<uint32_t>> indexLists;
+  for(auto [offset, count] : ranges) {
+    auto& indices = indexLists.emplace_back(data.indices.begin() + offset, data.indices.begin() + offset + count);
+    for(auto& index : indices) {
+      index -= baseVertex;
+    }
+  }
+
+  MeshOptimizer optimizer(data.positions.data() + baseVertex, mesh.vertexCount);
+  auto before = optimizer.getStats(indexLists[0]);
+  for(auto& indices : indexLists) {
+    indices = optimizer.optimize(indices);
+  }
+  auto after = optimizer.getStats(indexLists[0]);
+
+  auto remap = optimizer.getFetchRemap(indexLists);
+  auto reorder = [&](auto& attribute) {
+    auto vertices = attribute.begin() + baseVertex;
+    std::vector<std::decay_t<decltype(*vertices)>> source(vertices, vertices + mesh.vertexCount);
+    for(uint32_t i = 0; i < mesh.vertexCount; i++) {
+      vertices[remap[i]] = source[i];
+    }
+  };
+  reorder(data.positions);
+  reorder(data.texCoords0);
+  reorder(data.texCoords1);
+  reorder(data.normals);
+  reorder(data.tangents);
+
+  for(uint32_t i = 0; i < ranges.size(); i++) {
+    auto output = data.indices.begin() + ranges[i].first;
+    for(auto index : indexLists[i]) {
+      *output++ = remap[index] + baseVertex;
+    }
+  }
+
+  ENJAM_INFO("Mesh of {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+             name, before.acmr, after.acmr, before.atvr, after.atvr);
+}
+
+// Simplifies the mesh on a grid over its bounds into an occluder that stays inside it
+void DCCImporter::addOccluder(const aiMesh* mesh) {
+  std::vector<uint32_t> indices;
+  indices.reserve(mesh->mNumFaces * 3);
+  for(size_t i = 0; i < mesh->mNumFaces; i++) {
+    auto& face = mesh->mFaces[i];
+    if(face.mNumIndices == 3) {
+      indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+    }
+  }
+
+  auto occluder = OccluderMesh::simplify(reinterpret_cast<vec3f const*>(mesh->mVertices), mesh->mNumVertices, indices,
+                                         OCCLUDER_GRID_SIZE);
+  if(occluder.indices.empty()) {
+    return;
+  }
+
+  auto& result = data.nodes.back().meshes.back();
+  result.occluderVertexOffset = data.occluderPositions.size();
+  result.occluderVertexCount = occluder.positions.size();
+  result.occluderIndexOffset = data.occluderIndices.size();
+  result.occluderIndexCount = occluder.indices.size();
+
+  data.occluderPositions.insert(data.occluderPositions.end(), occluder.positions.begin(), occluder.positions.end());
+  data.occluderIndices.insert(data.occluderIndices.end(), occluder.indices.begin(), occluder.indices.end());
+}
+
+std::vector<DCCImporter::Cell> DCCImporter::partition(float cellSize) const {
+  std::vector<mat4f> worldTransforms(data.nodes.size());
+  for(size_t i = 0; i < data.nodes.size(); i++) {
+    auto& node = data.nodes[i];
+    worldTransforms[i] = node.parentIndex < 0 ? node.transform : worldTransforms[node.parentIndex] * node.transform;
+  }
+
+  std::map<std::pair<int32_t, int32_t>, Cell> cells;
+  for(size_t i = 0; i < data.nodes.size(); i++) {
+    auto& node = data.nodes[i];
+    for(auto& mesh : node.meshes) {
+      Aabb bounds;
+      for(auto j = mesh.vertexOffset; j < mesh.vertexOffset + mesh.vertexCount; j++) {
+        bounds.expand(data.positions[j]);
+      }
+      bounds = bounds.transformed(worldTransforms[i]);
+
+      auto center = bounds.getCenter();
+      auto x = int32_t(std::floor(center.x / cellSize));
+      auto z = int32_t(std::floor(center.z / cellSize));
+      auto& cell = cells[{ x, z }];
+      if(!cell.data) {
+        cell = Cell { .x = x, .z = z, .bounds = { }, .data = std::make_shared<ImportedData>(), .quantization = quantization };
+      }
+      cell.bounds.expand(bounds);
+
+      // the mesh is copied with its vertices, indices are rebased on the cell buffers
+      auto& cellData = *cell.data;
+      auto cellVertexOffset = uint32_t(cellData.positions.size());
+      auto copyIndices = [&](uint64_t offset, uint64_t count) {
+        for(auto j = offset; j < offset + count; j++) {
+          cellData.indices.push_back(data.indices[j] - mesh.vertexOffset + cellVertexOffset);
+        }
+      };
+
+      auto vertices = [&mesh](auto& source) {
+        return std::make_pair(source.begin() + mesh.vertexOffset, source.begin() + mesh.vertexOffset + mesh.vertexCount);
+      };
+      auto [positionsBegin, positionsEnd] = vertices(data.positions);
+      auto [texCoords0Begin, texCoords0End] = vertices(data.texCoords0);
+      auto [texCoords1Begin, texCoords1End] = vertices(data.texCoords1);
+      auto [normalsBegin, normalsEnd] = vertices(data.normals);
+      auto [tangentsBegin, tangentsEnd] = vertices(data.tangents);
+      cellData.positions.insert(cellData.positions.end(), positionsBegin, positionsEnd);
+      cellData.texCoords0.insert(cellData.texCoords0.end(), texCoords0Begin, texCoords0End);
+      cellData.texCoords1.insert(cellData.texCoords1.end(), texCoords1Begin, texCoords1End);
+      cellData.normals.insert(cellData.normals.end(), normalsBegin, normalsEnd);
+      cellData.tangents.insert(cellData.tangents.end(), tangentsBegin, tangentsEnd);
+
+      Mesh cellMesh {
+          .offset = cellData.indices.size(),
+          .count = mesh.count,
+          .vertexOffset = cellVertexOffset,
+          .vertexCount = mesh.vertexCount,
+          .material = mesh.material,
+          .meshlets = mesh.meshlets
+      };
+      copyIndices(mesh.offset, mesh.count);
+      for(auto& lod : mesh.lods) {
+        cellMesh.lods.push_back({ .offset = uint32_t(cellData.indices.size()), .count = lod.count, .error = lod.error });
+        copyIndices(lod.offset, lod.count);
+      }
+
+      // occluder indices are relative to the first occluder vertex, they are copied as they are
+      if(mesh.occluderIndexCount > 0) {
+        cellMesh.occluderVertexOffset = cellData.occluderPositions.size();
+        cellMesh.occluderVertexCount = mesh.occluderVertexCount;
+        cellMesh.occluderIndexOffset = cellData.occluderIndices.size();
+        cellMesh.occluderIndexCount = mesh.occluderIndexCount;
+
+        auto occluderPositionsBegin = data.occluderPositions.begin() + mesh.occluderVertexOffset;
+        auto occluderIndicesBegin = data.occluderIndices.begin() + mesh.occluderIndexOffset;
+        cellData.occluderPositions.insert(cellData.occluderPositions.end(),
+                                          occluderPositionsBegin, occluderPositionsBegin + mesh.occluderVertexCount);
+        cellData.occluderIndices.insert(cellData.occluderIndices.end(),
+                                        occluderIndicesBegin, occluderIndicesBegin + mesh.occluderIndexCount);
+      }
+
+      cellData.nodes.push_back({ .name = node.name, .parentIndex = -1, .transform = worldTransforms[i], .meshes = { } });
+      cellData.nodes.back().meshes.push_back(std::move(cellMesh));
+    }
+  }
+
+  std::vector<Cell> result;
+  for(auto& [coordinates, cell] : cells) {
+    result.push_back(std::move(cell));
+  }
+  return result;
+}
+
+void DCCImporter::mergeStaticMeshes(ImportedData& data) {
+  std::vector<mat4f> worldTransforms(data.nodes.size());
+  for(size_t i = 0; i < data.nodes.size(); i++) {
+    auto& node = data.nodes[i];
+    worldTransforms[i] = node.parentIndex < 0 ? node.transform : worldTransforms[node.parentIndex] * node.transform;
+  }
+
+  // every node mesh has its own vertices, they are moved in place
+  std::map<uint32_t, std::vector<std::pair<int32_t, Mesh*>>> meshesByMaterial;
+  uint32_t meshesCount = 0;
+  for(size_t i = 0; i < data.nodes.size(); i++) {
+    auto& world = worldTransforms[i];
+    auto scale = std::max({ length(world[0].xyz), length(world[1].xyz), length(world[2].xyz) });
+    // normals go through the inverse transpose, mirroring flips the bitangents
+    auto normalTransform = transpose(inverse(world));
+    auto mirrored = dot(cross(world[0].xyz, world[1].xyz), world[2].xyz) < 0;
+    for(auto& mesh : data.nodes[i].meshes) {
+      for(auto j = mesh.vertexOffset; j < mesh.vertexOffset + mesh.vertexCount; j++) {
+        data.positions[j] = (world * vec4f { data.positions[j], 1 }).xyz;
+        data.normals[j] = normalize((normalTransform * vec4f { data.normals[j], 0 }).xyz);
+        auto& tangent = data.tangents[j];
+        tangent = vec4f { normalize((world * vec4f { tangent.xyz, 0 }).xyz), mirrored ? -tangent.w : tangent.w };
+      }
+      for(auto j = mesh.occluderVertexOffset; j < mesh.occluderVertexOffset + mesh.occluderVertexCount; j++) {
+        data.occluderPositions[j] = (world * vec4f { data.occluderPositions[j], 1 }).xyz;
+      }
+      for(auto& lod : mesh.lods) {
+        lod.error *= scale;
+      }
+      meshesByMaterial[mesh.material].emplace_back(int32_t(i), &mesh);
+      meshesCount++;
+    }
+  }
+
+  std::vector<uint32_t> indices;
+  std::vector<vec3f> occluderPositions;
+  std::vector<uint32_t> occluderIndices;
+  auto appendIndices = [&data, &indices](uint64_t offset, uint64_t count) {
+    indices.insert(indices.end(), data.indices.begin() + offset, data.indices.begin() + offset + count);
+  };
+
+  Node batch { .name = "static", .parentIndex = -1, .transform = mat4f(1), .meshes = { } };
+  for(auto& [material, sources] : meshesByMaterial) {
+    Mesh merged {
+        .offset = indices.size(),
+        .count = 0,
+        .vertexOffset = UINT32_MAX,
+        .vertexCount = 0,
+        .material = material
+    };
+
+    uint32_t vertexEnd = 0;
+    size_t lodsCount = 0;
+    for(auto& [node, mesh] : sources) {
+      merged.sources.push_back({ .node = node, .offset = uint32_t(indices.size()), .count = uint32_t(mesh->count) });
+      appendIndices(mesh->offset, mesh->count);
+
+      merged.vertexOffset = std::min(merged.vertexOffset, mesh->vertexOffset);
+      vertexEnd = std::max(vertexEnd, mesh->vertexOffset + mesh->vertexCount);
+      lodsCount = std::max(lodsCount, mesh->lods.size());
+    }
+    merged.count = indices.size() - merged.offset;
+    merged.vertexCount = vertexEnd - merged.vertexOffset;
+
+    // a level of detail of the batch joins the same level of its meshes, or their coarsest one
+    for(size_t level = 0; level < lodsCount; level++) {
+      Lod lod { .offset = uint32_t(indices.size()), .count = 0, .error = 0 };
+      for(auto& [node, mesh] : sources) {
+        if(mesh->lods.empty()) {
+          appendIndices(mesh->offset, mesh->count);
+          continue;
+        }
+        auto& meshLod = mesh->lods[std::min(level, mesh->lods.size() - 1)];
+        appendIndices(meshLod.offset, meshLod.count);
+        lod.error = std::max(lod.error, meshLod.error);
+      }
+      lod.count = uint32_t(indices.size()) - lod.offset;
+      merged.lods.push_back(lod);
+    }
+
+    // occluder indices are relative to the first occluder vertex of the merged mesh
+    merged.occluderVertexOffset = occluderPositions.size();
+    merged.occluderIndexOffset = occluderIndices.size();
+    for(auto& [node, mesh] : sources) {
+      if(mesh->occluderIndexCount == 0) {
+        continue;
+      }
+      auto base = uint32_t(occluderPositions.size()) - merged.occluderVertexOffset;
+      auto positionsBegin = data.occluderPositions.begin() + mesh->occluderVertexOffset;
+      occluderPositions.insert(occluderPositions.end(), positionsBegin, positionsBegin + mesh->occluderVertexCount);
+      for(auto j = mesh->occluderIndexOffset; j < mesh->occluderIndexOffset + mesh->occluderIndexCount; j++) {
+        occluderIndices.push_back(data.occluderIndices[j] + base);
+      }
+    }
+    merged.occluderVertexCount = occluderPositions.size() - merged.occluderVertexOffset;
+    merged.occluderIndexCount = occluderIndices.size() - merged.occluderIndexOffset;
+
+    batch.meshes.push_back(std::move(merged));
+  }
+
+  ENJAM_INFO("Merged {} static meshes into {} draws", meshesCount, batch.meshes.size());
+
+  for(auto& node : data.nodes) {
+    node.meshes.clear();
+  }
+  data.nodes.push_back(std::move(batch));
+  data.indices = std::move(indices);
+  data.occluderPositions = std::move(occluderPositions);
+  data.occluderIndices = std::move(occluderIndices);
+}
+
+void DCCImporter::splitMeshlets(ImportedData& data) {
+  uint32_t meshesCount = 0;
+  uint32_t meshletsCount = 0;
+  for(auto& node : data.nodes) {
+    for(auto& mesh : node.meshes) {
+      // meshlets never straddle two meshes merged into one range, their sources keep their indices
+      std::vector<std::pair<uint64_t, uint64_t>> ranges;
+      for(auto& source : mesh.sources) {
+        ranges.emplace_back(source.offset, source.count);
+      }
+      if(ranges.empty()) {
+        ranges.emplace_back(mesh.offset, mesh.count);
+      }
+
+      MeshletBuilder builder(data.positions.data() + mesh.vertexOffset, mesh.vertexCount);
+      mesh.meshlets.clear();
+      for(auto [offset, count] : ranges) {
+        std::vector<uint32_t> indices(data.indices.begin() + offset, data.indices.begin() + offset + count);
+        for(auto& index : indices) {
+          index -= mesh.vertexOffset;
+        }
+        auto meshlets = builder.build(indices);
+        for(uint64_t i = 0; i < count; i++) {
+          data.indices[offset + i] = indices[i] + mesh.vertexOffset;
+        }
+        for(auto& meshlet : meshlets) {
+          meshlet.indexOffset += uint32_t(offset - mesh.offset);
+          mesh.meshlets.push_back(meshlet);
+        }
+      }
+
+      // a single meshlet is culled along with the mesh already
+      if(mesh.meshlets.size() < 2) {
+        mesh.meshlets.clear();
+        continue;
+      }
+      meshesCount++;
+      meshletsCount += mesh.meshlets.size();
+    }
+  }
+
+  ENJAM_INFO("Split {} meshes into {} meshlets", meshesCount, meshletsCount);
+}
+
+// Of the streams uploaded by the WorldStreamer
+uint64_t DCCImporter::Cell::getSize() const {
+  auto vertexSize = getVertexFormat(*data, quantization).getVertexStride();
+  uint64_t indicesSize = 0;
+  for(auto& node : data->nodes) {
+    for(auto& mesh : node.meshes) {
+      auto count = mesh.count;
+      for(auto& lod : mesh.lods) {
+        count += lod.count;
+      }
+      indicesSize += count * getIndexSize(getIndexType(mesh));
+    }
+  }
+  return data->positions.size() * vertexSize + indicesSize;
+}
+
+VertexFormat DCCImporter::getVertexFormat(const ImportedData& data, const Quantization& quantization) {
+  VertexFormat format;
+  if(quantization.interleave) {
+    format.layout = VertexFormat::Layout::INTERLEAVED;
+  }
+  if(quantization.positions && !data.positions.empty()) {
+    Aabb bounds;
+    for(auto& position : data.positions) {
+      bounds.expand(position);
+    }
+    auto extent = bounds.max + (-bounds.min);
+    format.positions = VertexFormat::Position::UNORM16;
+    format.positionOffset = bounds.min;
+    format.positionScale = std::max({ extent.x, extent.y, extent.z, 1e-6f });
+  }
+
+  if(quantization.texCoords) {
+    auto isUnit = [](const vec2f& texCoord) {
+      return texCoord.x >= 0 && texCoord.x <= 1 && texCoord.y >= 0 && texCoord.y <= 1;
+    };
+    auto unit = std::all_of(data.texCoords0.begin(), data.texCoords0.end(), isUnit)
+        && std::all_of(data.texCoords1.begin(), data.texCoords1.end(), isUnit);
+    format.texCoords = unit ? VertexFormat::TexCoord::UNORM16 : VertexFormat::TexCoord::HALF2;
+  }
+  return format;
+}
+
+namespace {
+
+template<class T>
+void appendBytes(ByteArray& bytes, const T& value) {
+  auto begin = reinterpret_cast<const uint8_t*>(&value);
+  bytes.insert(bytes.end(), begin, begin + sizeof(T));
+}
+
+}
+
+ByteArray DCCImporter::encodePositions(const std::vector<vec3f>& positions, const VertexFormat& format) {
+  if(format.positions == VertexFormat::Position::FLOAT3) {
+    return makeByteArray(positions.begin(), positions.end());
+  }
+
+  ByteArray bytes;
+  bytes.reserve(positions.size() * format.getPositionStride());
+  for(auto& position : positions) {
+    auto normalized = (position + (-format.positionOffset)) * (1.0f / format.positionScale);
+    appendBytes(bytes, std::array<uint16_t, 4> {
+        toUnorm16(normalized.x), toUnorm16(normalized.y), toUnorm16(normalized.z), 0
+    });
+  }
+  return bytes;
+}
+
+ByteArray DCCImporter::encodeTexCoords(const std::vector<vec2f>& texCoords, const VertexFormat& format) {
+  if(format.texCoords == VertexFormat::TexCoord::FLOAT2) {
+    return makeByteArray(texCoords.begin(), texCoords.end());
+  }
+
+  ByteArray bytes;
+  bytes.reserve(texCoords.size() * format.getTexCoordStride());
+  for(auto& texCoord : texCoords) {
+    if(format.texCoords == VertexFormat::TexCoord::HALF2) {
+      appendBytes(bytes, std::array<uint16_t, 2> { toHalf(texCoord.x), toHalf(texCoord.y) });
+    } else {
+      appendBytes(bytes, std::array<uint16_t, 2> { toUnorm16(texCoord.x), toUnorm16(texCoord.y) });
+    }
+  }
+  return bytes;
+}
+
+ByteArray DCCImporter::encodeNormals(const std::vector<vec3f>& normals) {
+  ByteArray bytes;
+  bytes.reserve(normals.size() * VertexFormat::NORMAL_SIZE);
+  for(auto& normal : normals) {
+    appendBytes(bytes, encodeOctahedral(normal));
+  }
+  return bytes;
+}
+
+ByteArray DCCImporter::encodeTangents(const std::vector<vec4f>& tangents) {
+  ByteArray bytes;
+  bytes.reserve(tangents.size() * VertexFormat::TANGENT_SIZE);
+  for(auto& tangent : tangents) {
+    appendBytes(bytes, encodeTangent(tangent.xyz, tangent.w));
+  }
+  return bytes;
+}
+
+// Streams of the separate layout, in the order of the attributes
+ByteArray DCCImporter::interleave(const std::vector<ByteArray>& separateStreams, const VertexFormat& format) {
+  const uint32_t sizes[] = { format.getPositionStride(), format.getTexCoordStride(),
+                             VertexFormat::NORMAL_SIZE, VertexFormat::TANGENT_SIZE };
+  auto vertexCount = separateStreams[0].size() / sizes[0];
+  auto stride = format.getVertexStride();
+
+  ByteArray bytes(vertexCount * stride);
+  uint32_t offset = 0;
+  for(uint32_t stream = 0; stream < separateStreams.size(); stream++) {
+    for(uint64_t i = 0; i < vertexCount; i++) {
+      std::memcpy(bytes.data() + i * stride + offset, separateStreams[stream].data() + i * sizes[stream], sizes[stream]);
+    }
+    offset += sizes[stream];
+  }
+  return bytes;
+}
+
+// Writes a DCC asset for every cell next to the output and the world asset listing them to the output
+void generateCells(const DCCImporter& importer, const std::filesystem::path& outputPath, float cellSize, bool mergeStatic,
+                   bool meshlets, AssetsFilesystemRep& repository) {
+  Asset world;
+  world["cellSize"] = cellSize;
+  world["cells"] = Asset::array();
+  auto& cellsAsset = world["cells"];
+  for(auto& cell : importer.partition(cellSize)) {
+    auto cellPath = outputPath.parent_path()
+        / fmt::format("{}_{}_{}.nj_dcc", outputPath.stem().string(), cell.x, cell.z);
+
+    if(mergeStatic) {
+      cell.mergeStatic();
+    }
+    if(meshlets) {
+      cell.buildMeshlets();
+    }
+
+    Asset cellAsset;
+    cell(cellAsset);
+    repository.save(cellPath, cellAsset);
+
+    Asset cellInfo;
+    cellInfo["x"] = cell.x;
+    cellInfo["z"] = cell.z;
+    cellInfo["path"] = cellPath.string();
+    cellInfo["min"] = cell.bounds.min;
+    cellInfo["max"] = cell.bounds.max;
+    cellInfo["size"] = cell.getSize();
+    cellsAsset.pushBack(std::move(cellInfo));
+  }
+
+  repository.save(outputPath, world);
+}
+
+// bump when the assets it makes change, so that the import caches of older versions are not used
+constexpr uint32_t IMPORTER_VERSION = 1;
+
+// Options of the command line, the same for every input of a batch
+struct ImportOptions {
+  bool allOccluders = false;
+  float cellSize = 0; // the scene is split into cells of a world asset when set
+  bool mergeStatic = false;
+  bool meshlets = false;
+  DCCImporter::Quantization quantization;
+
+  std::string toString() const {
+    return fmt::format("occluders {} cells {} static {} meshlets {} quantize {} {} interleave {} packed {}", allOccluders,
+                       cellSize, mergeStatic, meshlets, quantization.texCoords, quantization.positions,
+                       quantization.interleave, quantization.packed);
+  }
+};
+
+bool generateAsset(const std::filesystem::path& inputPath, const std::filesystem::path& outputPath,
+                   const ImportOptions& options, AssetsFilesystemRep& repository) {
   using namespace Enjam;
   using namespace Assimp;
 
@@ -175,18 +935,31 @@ bool generateAsset(const std::filesystem::path& inputPath, const std::filesystem
     return false;
   }
 
-  DCCImporter importer(inputPath);
+  DCCImporter importer(inputPath, options.allOccluders);
+  importer.setQuantization(options.quantization);
+  if(options.cellSize > 0) {
+    generateCells(importer, outputPath, options.cellSize, options.mergeStatic, options.meshlets, repository);
+    return true;
+  }
+  if(options.mergeStatic) {
+    importer.mergeStatic();
+  }
+  if(options.meshlets) {
+    importer.buildMeshlets();
+  }
+
   Asset asset;
   importer(asset);
-
-  AssetsFilesystemRep repository;
   repository.save(outputPath, asset);
   return true;
 }
 
 int main(int argc, char* argv[]) {
   std::filesystem::path output;
-  std::filesystem::path input;
+  std::filesystem::path cachePath;
+  std::vector<ImportJob> jobs;
+  uint32_t threadsCount = 0; // one per hardware thread
+  ImportOptions options;
 
   std::vector<std::string_view> args {argv + 1, argv + argc};
 
@@ -202,6 +975,33 @@ int main(int argc, char* argv[]) {
       if(arg == "-o") {
         it++;
         output = *it;
+      } else if(arg == "-manifest") {
+        it++;
+        auto manifestJobs = readImportManifest(*it);
+        jobs.insert(jobs.end(), manifestJobs.begin(), manifestJobs.end());
+      } else if(arg == "-j") {
+        it++;
+        threadsCount = std::stoul(std::string(*it));
+      } else if(arg == "-cache") {
+        it++;
+        cachePath = *it;
+      } else if(arg == "-occluders") {
+        options.allOccluders = true;
+      } else if(arg == "-static") {
+        options.mergeStatic = true;
+      } else if(arg == "-quantize") {
+        options.quantization.texCoords = true;
+      } else if(arg == "-quantize-positions") {
+        options.quantization.positions = true;
+      } else if(arg == "-interleave") {
+        options.quantization.interleave = true;
+      } else if(arg == "-packed") {
+        options.quantization.packed = true;
+      } else if(arg == "-meshlets") {
+        options.meshlets = true;
+      } else if(arg == "-cells") {
+        it++;
+        options.cellSize = std::stof(std::string(*it));
       } else {
         throw std::runtime_error("Unknown option: " + std::string(*it));
       }
@@ -209,18 +1009,35 @@ int main(int argc, char* argv[]) {
       continue;
     }
 
-    input = arg;
+    jobs.push_back({ .inputs = { arg }, .output = { } });
     it++;
   }
 
-  if(input.empty()) {
+  if(jobs.empty()) {
     throw std::runtime_error("Input file path is not provided");
   }
 
-  if(output.empty()) {
-    output = input;
-    output.replace_extension("nj_tex");
+  if(!output.empty()) {
+    if(jobs.size() > 1) {
+      throw std::runtime_error("-o needs a single input, the outputs of a batch are set in its manifest");
+    }
+    jobs.front().output = output;
+  }
+  for(auto& job : jobs) {
+    job.output = getImportOutput(job, ".nj_dcc");
+  }
+
+  // only the scene files are hashed, edits of the materials they reference alone don't invalidate the cache
+  std::optional<ImportCache> cache;
+  if(!cachePath.empty()) {
+    cache.emplace(cachePath, fmt::format("dcc_importer {} {}", IMPORTER_VERSION, options.toString()));
   }
 
-  generateAsset(input, output);
-}
\ No newline at end of file
+  // every scene is imported by a thread of its own, the importers share nothing
+  ThreadPool threadPool(threadsCount > 0 ? threadsCount - 1 : ThreadPool::getDefaultWorkersCount());
+  auto succeeded = runImportJobs(threadPool, jobs, cache ? &*cache : nullptr,
+                                 [&options](const ImportJob& job, AssetsFilesystemRep& repository) {
+    return generateAsset(job.inputs.front(), job.output, options, repository);
+  });
+  return succeeded ? 0 : 1;
+}
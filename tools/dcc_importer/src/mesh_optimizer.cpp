@@ -0,0 +1,275 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using namespace Enjam::math;
+
+namespace {
+
+constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+vec3f sub(const vec3f& a, const vec3f& b) {
+  return a + (-b);
+}
+
+// FIFO post-transform cache simulation, a vertex stays in the cache for the next CACHE_SIZE misses
+class CacheSimulation {
+ public:
+  explicit CacheSimulation(uint32_t verticesCount) : insertions(verticesCount, NEVER) { }
+
+  bool access(uint32_t vertex) {
+    if(insertions[vertex] != NEVER && misses - insertions[vertex] < MeshOptimizer::CACHE_SIZE) {
+      return true;
+    }
+    insertions[vertex] = misses++;
+    return false;
+  }
+
+  void flush() { misses += MeshOptimizer::CACHE_SIZE; }
+  int64_t getMisses() const { return misses; }
+
+ private:
+  static constexpr int64_t NEVER = std::numeric_limits<int64_t>::min();
+
+  std::vector<int64_t> insertions;
+  int64_t misses = 0;
+};
+
+}
+
+MeshOptimizer::MeshOptimizer(const vec3f* positions, uint32_t verticesCount)
+    : positions(positions)
+    , verticesCount(verticesCount) {
+}
+
+std::vector<uint32_t> MeshOptimizer::optimize(const std::vector<uint32_t>& indices, float overdrawThreshold) const {
+  std::vector<uint32_t> deadEnds;
+  auto reordered = reorderForCache(indices, deadEnds);
+  return reorderForOverdraw(reordered, deadEnds, overdrawThreshold);
+}
+
+// Tipsify: triangles are emitted in fans around a vertex, the next one is a vertex of the fan that will still
+// be in the cache once its remaining triangles are emitted. When there is none, the cache is considered
+// flushed and the search goes back to the latest vertices with triangles left, then to a linear scan.
+std::vector<uint32_t> MeshOptimizer::reorderForCache(const std::vector<uint32_t>& indices,
+                                                     std::vector<uint32_t>& deadEnds) const {
+  auto trianglesCount = uint32_t(indices.size() / 3);
+
+  std::vector<uint32_t> liveCounts(verticesCount, 0);
+  for(uint32_t i = 0; i < trianglesCount * 3; i++) {
+    liveCounts[indices[i]]++;
+  }
+  std::vector<uint32_t> adjacencyOffsets(verticesCount + 1, 0);
+  std::partial_sum(liveCounts.begin(), liveCounts.end(), adjacencyOffsets.begin() + 1);
+  std::vector<uint32_t> adjacency(adjacencyOffsets.back());
+  std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+  for(uint32_t i = 0; i < trianglesCount * 3; i++) {
+    adjacency[fill[indices[i]]++] = i / 3;
+  }
+
+  std::vector<int64_t> cacheTimes(verticesCount, 0);
+  int64_t time = CACHE_SIZE + 1;
+  std::vector<bool> emitted(trianglesCount, false);
+  std::vector<uint32_t> deadEndStack;
+  std::vector<uint32_t> candidates;
+  uint32_t cursor = 0;
+
+  auto skipDeadEnd = [&]() {
+    while(!deadEndStack.empty()) {
+      auto vertex = deadEndStack.back();
+      deadEndStack.pop_back();
+      if(liveCounts[vertex] > 0) {
+        return vertex;
+      }
+    }
+    for(; cursor < verticesCount; cursor++) {
+      if(liveCounts[cursor] > 0) {
+        return cursor;
+      }
+    }
+    return NONE;
+  };
+
+  std::vector<uint32_t> result;
+  result.reserve(trianglesCount * 3);
+  deadEnds.clear();
+  deadEnds.push_back(0);
+
+  auto fanning = skipDeadEnd();
+  while(fanning != NONE) {
+    candidates.clear();
+    for(auto i = adjacencyOffsets[fanning]; i < adjacencyOffsets[fanning + 1]; i++) {
+      auto triangle = adjacency[i];
+      if(emitted[triangle]) {
+        continue;
+      }
+      for(auto k = 0; k < 3; k++) {
+        auto vertex = indices[triangle * 3 + k];
+        result.push_back(vertex);
+        deadEndStack.push_back(vertex);
+        candidates.push_back(vertex);
+        liveCounts[vertex]--;
+        if(time - cacheTimes[vertex] > CACHE_SIZE) {
+          cacheTimes[vertex] = time++;
+        }
+      }
+      emitted[triangle] = true;
+    }
+
+    // the oldest candidate that stays in the cache, so the fans do not walk away from the cached vertices
+    auto next = NONE;
+    int64_t bestPriority = -1;
+    for(auto vertex : candidates) {
+      if(liveCounts[vertex] == 0) {
+        continue;
+      }
+      int64_t priority = 0;
+      if(time - cacheTimes[vertex] + 2 * int64_t(liveCounts[vertex]) <= CACHE_SIZE) {
+        priority = time - cacheTimes[vertex];
+      }
+      if(priority > bestPriority) {
+        bestPriority = priority;
+        next = vertex;
+      }
+    }
+    if(next == NONE) {
+      next = skipDeadEnd();
+      if(next != NONE) {
+        deadEnds.push_back(uint32_t(result.size() / 3));
+      }
+    }
+    fanning = next;
+  }
+  return result;
+}
+
+// Clusters are cut at the dead ends, where the cache was flushed anyway, and further where their miss ratio is
+// already close to the one of the whole list. They are sorted by how much they face away from the mesh center,
+// the outer surfaces are drawn first and hide what is behind them.
+std::vector<uint32_t> MeshOptimizer::reorderForOverdraw(const std::vector<uint32_t>& indices,
+                                                        const std::vector<uint32_t>& deadEnds,
+                                                        float threshold) const {
+  auto trianglesCount = uint32_t(indices.size() / 3);
+  if(trianglesCount == 0) {
+    return indices;
+  }
+  auto maxAcmr = getStats(indices).acmr * threshold;
+
+  std::vector<uint32_t> clusters;
+  CacheSimulation cache(verticesCount);
+  for(uint32_t i = 0; i < deadEnds.size(); i++) {
+    auto end = i + 1 < deadEnds.size() ? deadEnds[i + 1] : trianglesCount;
+    auto begin = deadEnds[i];
+    cache.flush();
+    auto beginMisses = cache.getMisses();
+    clusters.push_back(begin);
+    for(auto triangle = begin; triangle < end; triangle++) {
+      for(auto k = 0; k < 3; k++) {
+        cache.access(indices[triangle * 3 + k]);
+      }
+      auto count = triangle + 1 - begin;
+      if(triangle + 1 < end && float(cache.getMisses() - beginMisses) / float(count) <= maxAcmr) {
+        begin = triangle + 1;
+        clusters.push_back(begin);
+        cache.flush();
+        beginMisses = cache.getMisses();
+      }
+    }
+  }
+
+  struct Cluster {
+    uint32_t begin;
+    uint32_t end;
+    vec3f centroid;
+    vec3f normal;
+    float sortKey;
+  };
+  std::vector<Cluster> sortedClusters;
+  vec3f meshCentroid { 0.0f };
+  float meshArea = 0;
+  for(uint32_t i = 0; i < clusters.size(); i++) {
+    Cluster cluster {
+        .begin = clusters[i],
+        .end = i + 1 < clusters.size() ? clusters[i + 1] : trianglesCount,
+        .centroid = vec3f { 0.0f },
+        .normal = vec3f { 0.0f },
+        .sortKey = 0
+    };
+    float area = 0;
+    for(auto triangle = cluster.begin; triangle < cluster.end; triangle++) {
+      auto& p0 = positions[indices[triangle * 3]];
+      auto& p1 = positions[indices[triangle * 3 + 1]];
+      auto& p2 = positions[indices[triangle * 3 + 2]];
+      auto normal = cross(sub(p1, p0), sub(p2, p0));
+      auto triangleArea = length(normal);
+      cluster.normal += normal;
+      cluster.centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+      area += triangleArea;
+    }
+    meshCentroid += cluster.centroid;
+    meshArea += area;
+    if(area > 0) {
+      cluster.centroid = cluster.centroid * (1.0f / area);
+    }
+    sortedClusters.push_back(cluster);
+  }
+  if(meshArea > 0) {
+    meshCentroid = meshCentroid * (1.0f / meshArea);
+  }
+
+  for(auto& cluster : sortedClusters) {
+    auto normalLength = length(cluster.normal);
+    if(normalLength > 0) {
+      cluster.sortKey = dot(sub(cluster.centroid, meshCentroid), cluster.normal * (1.0f / normalLength));
+    }
+  }
+  std::stable_sort(sortedClusters.begin(), sortedClusters.end(), [](const Cluster& a, const Cluster& b) {
+    return a.sortKey > b.sortKey;
+  });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for(auto& cluster : sortedClusters) {
+    result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+  }
+  return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::getFetchRemap(const std::vector<std::vector<uint32_t>>& indexLists) const {
+  std::vector<uint32_t> remap(verticesCount, NONE);
+  uint32_t next = 0;
+  for(auto& indices : indexLists) {
+    for(auto index : indices) {
+      if(remap[index] == NONE) {
+        remap[index] = next++;
+      }
+    }
+  }
+  for(auto& index : remap) {
+    if(index == NONE) {
+      index = next++;
+    }
+  }
+  return remap;
+}
+
+MeshOptimizer::Stats MeshOptimizer::getStats(const std::vector<uint32_t>& indices) const {
+  CacheSimulation cache(verticesCount);
+  std::vector<bool> used(verticesCount, false);
+  uint32_t usedCount = 0;
+  for(auto index : indices) {
+    cache.access(index);
+    if(!used[index]) {
+      used[index] = true;
+      usedCount++;
+    }
+  }
+
+  auto misses = float(cache.getMisses());
+  return {
+      .acmr = indices.empty() ? 0 : misses / float(indices.size() / 3),
+      .atvr = usedCount == 0 ? 0 : misses / float(usedCount)
+  };
+}
@@ -0,0 +1,223 @@
+#include "mesh_simplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace Enjam::math;
+
+namespace {
+
+vec3f sub(const vec3f& a, const vec3f& b) {
+  return a + (-b);
+}
+
+vec3f getNormal(const vec3f& p0, const vec3f& p1, const vec3f& p2) {
+  return cross(sub(p1, p0), sub(p2, p0));
+}
+
+uint64_t getEdgeKey(uint32_t from, uint32_t to) {
+  return uint64_t(from) << 32 | to;
+}
+
+}
+
+void MeshSimplifier::Quadric::add(const Quadric& other) {
+  a2 += other.a2; b2 += other.b2; c2 += other.c2; d2 += other.d2;
+  ab += other.ab; ac += other.ac; ad += other.ad;
+  bc += other.bc; bd += other.bd; cd += other.cd;
+  weight += other.weight;
+}
+
+double MeshSimplifier::Quadric::evaluate(const vec3f& p) const {
+  double x = p.x, y = p.y, z = p.z;
+  return a2 * x * x + b2 * y * y + c2 * z * z + d2
+      + 2 * (ab * x * y + ac * x * z + bc * y * z)
+      + 2 * (ad * x + bd * y + cd * z);
+}
+
+MeshSimplifier::MeshSimplifier(const vec3f* positions, uint32_t verticesCount, const std::vector<uint32_t>& indices)
+    : positions(positions)
+    , verticesCount(verticesCount)
+    , indices(indices)
+    , quadrics(verticesCount, Quadric { })
+    , locked(verticesCount, false) {
+  // plane of every triangle weighted by its area
+  for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+    auto& p0 = positions[indices[i]];
+    auto normal = getNormal(p0, positions[indices[i + 1]], positions[indices[i + 2]]);
+    auto area = length(normal);
+    if(area == 0) {
+      continue;
+    }
+
+    double a = normal.x / area, b = normal.y / area, c = normal.z / area;
+    double d = -(a * p0.x + b * p0.y + c * p0.z);
+    double w = area * 0.5;
+    Quadric plane {
+        .a2 = a * a * w, .b2 = b * b * w, .c2 = c * c * w, .d2 = d * d * w,
+        .ab = a * b * w, .ac = a * c * w, .ad = a * d * w,
+        .bc = b * c * w, .bd = b * d * w, .cd = c * d * w,
+        .weight = w
+    };
+    for(auto k = 0; k < 3; k++) {
+      quadrics[indices[i + k]].add(plane);
+    }
+  }
+
+  // seams split a position into several vertices, moving one of them would tear the surface
+  struct PositionHash {
+    size_t operator()(const vec3f& p) const {
+      uint32_t bits[3];
+      std::memcpy(bits, &p, sizeof(bits));
+      return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+  };
+  struct PositionEqual {
+    bool operator()(const vec3f& a, const vec3f& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+  };
+  std::unordered_map<vec3f, uint32_t, PositionHash, PositionEqual> positionVertices;
+  for(uint32_t i = 0; i < verticesCount; i++) {
+    auto [it, inserted] = positionVertices.emplace(positions[i], i);
+    if(!inserted) {
+      locked[i] = true;
+      locked[it->second] = true;
+    }
+  }
+
+  // an edge without its opposite half lies on a border
+  std::unordered_set<uint64_t> edges;
+  for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+    for(auto k = 0; k < 3; k++) {
+      edges.insert(getEdgeKey(indices[i + k], indices[i + (k + 1) % 3]));
+    }
+  }
+  for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+    for(auto k = 0; k < 3; k++) {
+      auto from = indices[i + k], to = indices[i + (k + 1) % 3];
+      if(edges.count(getEdgeKey(to, from)) == 0) {
+        locked[from] = true;
+        locked[to] = true;
+      }
+    }
+  }
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(uint32_t targetIndicesCount, float& error) const {
+  auto result = indices;
+  auto currentQuadrics = quadrics;
+  double maxError = 0;
+
+  std::vector<uint32_t> adjacencyOffsets;
+  std::vector<uint32_t> adjacency;
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> remap(verticesCount);
+  std::vector<uint8_t> touched(verticesCount);
+
+  // every pass collapses the cheapest edges whose neighbourhoods do not overlap
+  while(result.size() > targetIndicesCount) {
+    adjacencyOffsets.assign(verticesCount + 1, 0);
+    for(auto index : result) {
+      adjacencyOffsets[index + 1]++;
+    }
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+    adjacency.resize(result.size());
+    auto fill = adjacencyOffsets;
+    for(uint32_t i = 0; i < result.size(); i++) {
+      adjacency[fill[result[i]]++] = i / 3;
+    }
+
+    collapses.clear();
+    for(size_t i = 0; i < result.size(); i += 3) {
+      for(auto k = 0; k < 3; k++) {
+        auto a = result[i + k], b = result[i + (k + 1) % 3];
+        if(a > b || (locked[a] && locked[b])) {
+          continue;
+        }
+
+        auto quadric = currentQuadrics[a];
+        quadric.add(currentQuadrics[b]);
+        auto weight = std::max(quadric.weight, 1e-12);
+        auto errorAtB = locked[a] ? INFINITY : std::max(quadric.evaluate(positions[b]) / weight, 0.0);
+        auto errorAtA = locked[b] ? INFINITY : std::max(quadric.evaluate(positions[a]) / weight, 0.0);
+        collapses.push_back(errorAtB <= errorAtA
+            ? Collapse { .source = a, .target = b, .error = errorAtB }
+            : Collapse { .source = b, .target = a, .error = errorAtA });
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+      return lhs.error < rhs.error;
+    });
+
+    std::iota(remap.begin(), remap.end(), 0);
+    std::fill(touched.begin(), touched.end(), 0);
+    size_t removedIndices = 0;
+    for(auto& collapse : collapses) {
+      if(result.size() - removedIndices <= targetIndicesCount) {
+        break;
+      }
+      if(touched[collapse.source] || touched[collapse.target]
+          || flipsTriangles(result, adjacencyOffsets, adjacency, collapse.source, collapse.target)) {
+        continue;
+      }
+
+      remap[collapse.source] = collapse.target;
+      currentQuadrics[collapse.target].add(currentQuadrics[collapse.source]);
+      maxError = std::max(maxError, collapse.error);
+
+      for(auto j = adjacencyOffsets[collapse.source]; j < adjacencyOffsets[collapse.source + 1]; j++) {
+        auto triangle = adjacency[j];
+        for(auto k = 0; k < 3; k++) {
+          touched[result[triangle * 3 + k]] = 1;
+        }
+        // the triangles sharing the edge collapse
+        auto hasTarget = result[triangle * 3] == collapse.target
+            || result[triangle * 3 + 1] == collapse.target
+            || result[triangle * 3 + 2] == collapse.target;
+        removedIndices += hasTarget ? 3 : 0;
+      }
+    }
+
+    if(removedIndices == 0) {
+      break;
+    }
+
+    size_t count = 0;
+    for(size_t i = 0; i < result.size(); i += 3) {
+      auto a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+      if(a != b && b != c && c != a) {
+        result[count++] = a;
+        result[count++] = b;
+        result[count++] = c;
+      }
+    }
+    result.resize(count);
+  }
+
+  error = float(std::sqrt(maxError));
+  return result;
+}
+
+bool MeshSimplifier::flipsTriangles(const std::vector<uint32_t>& current,
+                                    const std::vector<uint32_t>& adjacencyOffsets,
+                                    const std::vector<uint32_t>& adjacency,
+                                    uint32_t source, uint32_t target) const {
+  for(auto j = adjacencyOffsets[source]; j < adjacencyOffsets[source + 1]; j++) {
+    auto triangle = &current[adjacency[j] * 3];
+    if(triangle[0] == target || triangle[1] == target || triangle[2] == target) {
+      continue;
+    }
+
+    vec3f before[3], after[3];
+    for(auto k = 0; k < 3; k++) {
+      before[k] = positions[triangle[k]];
+      after[k] = triangle[k] == source ? positions[target] : before[k];
+    }
+    if(dot(getNormal(before[0], before[1], before[2]), getNormal(after[0], after[1], after[2])) <= 0) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,48 @@
+#ifndef TOOLS_DCC_IMPORTER_MESH_SIMPLIFIER_H_
+#define TOOLS_DCC_IMPORTER_MESH_SIMPLIFIER_H_
+
+#include <cstdint>
+#include <enjam/math.h>
+#include <vector>
+
+// Quadric error edge collapse simplifier. Vertices are never moved or added, collapses only rewrite the
+// indices, so every level of detail shares the vertex buffer of the full mesh.
+// Vertices on open borders and on attribute seams, where another vertex has the same position, stay in place.
+class MeshSimplifier {
+ public:
+  MeshSimplifier(const Enjam::math::vec3f* positions, uint32_t verticesCount, const std::vector<uint32_t>& indices);
+
+  // Collapses edges until at most targetIndicesCount indices are left or nothing can be collapsed.
+  // error is the largest distance between the result and the original surface, in mesh units.
+  std::vector<uint32_t> simplify(uint32_t targetIndicesCount, float& error) const;
+
+ private:
+  struct Quadric {
+    double a2, b2, c2, d2;
+    double ab, ac, ad, bc, bd, cd;
+    double weight;
+
+    void add(const Quadric&);
+    double evaluate(const Enjam::math::vec3f&) const;
+  };
+
+  struct Collapse {
+    uint32_t source;
+    uint32_t target;
+    double error;
+  };
+
+  bool flipsTriangles(const std::vector<uint32_t>& indices,
+                      const std::vector<uint32_t>& adjacencyOffsets,
+                      const std::vector<uint32_t>& adjacency,
+                      uint32_t source, uint32_t target) const;
+
+ private:
+  const Enjam::math::vec3f* positions;
+  uint32_t verticesCount;
+  std::vector<uint32_t> indices;
+  std::vector<Quadric> quadrics;
+  std::vector<bool> locked;
+};
+
+#endif //TOOLS_DCC_IMPORTER_MESH_SIMPLIFIER_H_
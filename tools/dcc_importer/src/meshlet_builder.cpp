@@ -0,0 +1,167 @@
+#include "meshlet_builder.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using namespace Enjam;
+using namespace Enjam::math;
+
+namespace {
+
+constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+vec3f sub(const vec3f& a, const vec3f& b) {
+  return a + (-b);
+}
+
+}
+
+MeshletBuilder::MeshletBuilder(const vec3f* positions, uint32_t verticesCount)
+    : positions(positions)
+    , verticesCount(verticesCount) {
+}
+
+std::vector<Meshlet> MeshletBuilder::build(std::vector<uint32_t>& indices) const {
+  auto trianglesCount = uint32_t(indices.size() / 3);
+
+  std::vector<uint32_t> adjacencyOffsets(verticesCount + 1, 0);
+  for(uint32_t i = 0; i < trianglesCount * 3; i++) {
+    adjacencyOffsets[indices[i] + 1]++;
+  }
+  std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+  std::vector<uint32_t> adjacency(adjacencyOffsets.back());
+  std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+  for(uint32_t i = 0; i < trianglesCount * 3; i++) {
+    adjacency[fill[indices[i]]++] = i / 3;
+  }
+
+  std::vector<bool> emitted(trianglesCount, false);
+  std::vector<uint32_t> vertexMeshlets(verticesCount, NONE); // last meshlet the vertex was added to
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  std::vector<Meshlet> meshlets;
+  uint32_t cursor = 0;
+
+  auto getNewVertices = [&](uint32_t triangle, uint32_t meshlet) {
+    uint32_t count = 0;
+    for(auto k = 0; k < 3; k++) {
+      count += vertexMeshlets[indices[triangle * 3 + k]] != meshlet;
+    }
+    return count;
+  };
+
+  while(true) {
+    while(cursor < trianglesCount && emitted[cursor]) {
+      cursor++;
+    }
+    if(cursor == trianglesCount) {
+      break;
+    }
+
+    auto meshlet = uint32_t(meshlets.size());
+    auto indexOffset = uint32_t(result.size());
+    uint32_t vertexCount = 0;
+    uint32_t triangleCount = 0;
+    candidates.clear();
+
+    auto next = cursor;
+    while(next != NONE) {
+      emitted[next] = true;
+      triangleCount++;
+      for(auto k = 0; k < 3; k++) {
+        auto vertex = indices[next * 3 + k];
+        result.push_back(vertex);
+        if(vertexMeshlets[vertex] != meshlet) {
+          vertexMeshlets[vertex] = meshlet;
+          vertexCount++;
+          candidates.insert(candidates.end(), adjacency.begin() + adjacencyOffsets[vertex],
+                            adjacency.begin() + adjacencyOffsets[vertex + 1]);
+        }
+      }
+      if(triangleCount == Meshlet::MAX_TRIANGLES) {
+        break;
+      }
+
+      // the adjacent triangle adding the fewest vertices, the emitted ones are dropped on the way
+      next = NONE;
+      uint32_t bestNewVertices = 3;
+      uint32_t kept = 0;
+      for(auto triangle : candidates) {
+        if(emitted[triangle]) {
+          continue;
+        }
+        candidates[kept++] = triangle;
+        auto newVertices = getNewVertices(triangle, meshlet);
+        if(vertexCount + newVertices <= Meshlet::MAX_VERTICES && newVertices < bestNewVertices) {
+          bestNewVertices = newVertices;
+          next = triangle;
+        }
+      }
+      candidates.resize(kept);
+    }
+
+    auto bounds = getBounds(result.data() + indexOffset, triangleCount * 3);
+    bounds.indexOffset = indexOffset;
+    bounds.indexCount = triangleCount * 3;
+    meshlets.push_back(bounds);
+  }
+
+  indices = std::move(result);
+  return meshlets;
+}
+
+// Sphere around the bounding box center, cone around the area weighted average normal
+Meshlet MeshletBuilder::getBounds(const uint32_t* indices, uint32_t indexCount) const {
+  vec3f min { FLT_MAX }, max { -FLT_MAX };
+  vec3f axis { 0.0f };
+  for(uint32_t i = 0; i < indexCount; i += 3) {
+    auto& p0 = positions[indices[i]];
+    auto& p1 = positions[indices[i + 1]];
+    auto& p2 = positions[indices[i + 2]];
+    for(auto& p : { p0, p1, p2 }) {
+      for(auto k = 0; k < 3; k++) {
+        min[k] = std::min(min[k], p[k]);
+        max[k] = std::max(max[k], p[k]);
+      }
+    }
+    axis += cross(sub(p1, p0), sub(p2, p0));
+  }
+
+  Meshlet meshlet {
+      .center = (min + max) * 0.5f,
+      .radius = 0,
+      .coneAxis = vec3f { 0, 0, 1 },
+      .coneCutoff = 1,
+      .indexOffset = 0,
+      .indexCount = indexCount
+  };
+  for(uint32_t i = 0; i < indexCount; i++) {
+    meshlet.radius = std::max(meshlet.radius, length(sub(positions[indices[i]], meshlet.center)));
+  }
+
+  auto axisLength = length(axis);
+  if(axisLength == 0) {
+    return meshlet;
+  }
+  axis = axis * (1.0f / axisLength);
+
+  // the widest angle between the axis and a triangle normal, degenerate triangles face nowhere
+  auto minDot = 1.0f;
+  for(uint32_t i = 0; i < indexCount; i += 3) {
+    auto& p0 = positions[indices[i]];
+    auto normal = cross(sub(positions[indices[i + 1]], p0), sub(positions[indices[i + 2]], p0));
+    auto normalLength = length(normal);
+    if(normalLength > 0) {
+      minDot = std::min(minDot, dot(normal, axis) / normalLength);
+    }
+  }
+
+  meshlet.coneAxis = axis;
+  if(minDot > MIN_CONE_DOT) {
+    meshlet.coneCutoff = std::sqrt(1 - minDot * minDot);
+  }
+  return meshlet;
+}
@@ -0,0 +1,31 @@
+#ifndef TOOLS_DCC_IMPORTER_MESHLET_BUILDER_H_
+#define TOOLS_DCC_IMPORTER_MESHLET_BUILDER_H_
+
+#include <cstdint>
+#include <enjam/math.h>
+#include <enjam/meshlet.h>
+#include <vector>
+
+// Splits indexed triangle lists into meshlets of at most Meshlet::MAX_VERTICES vertices and MAX_TRIANGLES
+// triangles. A meshlet grows from the first triangle left in the list order through the triangles sharing
+// the most vertices with it, so it stays a compact patch with a tight bounding sphere and normal cone.
+class MeshletBuilder {
+ public:
+  MeshletBuilder(const Enjam::math::vec3f* positions, uint32_t verticesCount);
+
+  // Reorders the triangles of indices so every meshlet is a contiguous range of them.
+  // The index offsets of the meshlets are relative to the first index of the list.
+  std::vector<Enjam::Meshlet> build(std::vector<uint32_t>& indices) const;
+
+ private:
+  Enjam::Meshlet getBounds(const uint32_t* indices, uint32_t indexCount) const;
+
+ private:
+  // meshlets whose triangles face more than about 84 degrees apart are never backfacing
+  static constexpr float MIN_CONE_DOT = 0.1f;
+
+  const Enjam::math::vec3f* positions;
+  uint32_t verticesCount;
+};
+
+#endif //TOOLS_DCC_IMPORTER_MESHLET_BUILDER_H_
@@ -1,7 +1,11 @@
 #include <unordered_set>
 #include <filesystem>
+#include <optional>
 #include <sstream>
 #include <enjam/assets_repository.h>
+#include <enjam/import_batch.h>
+#include <enjam/import_cache.h>
+#include <enjam/thread_pool.h>
 #include <glslang/Public/ShaderLang.h>
 #include <glslang/Public/ResourceLimits.h>
 #include <SPIRV/SpvTools.h>
@@ -9,6 +13,9 @@
 using Path = std::filesystem::path;
 using SpirvBlob = std::vector<uint32_t>;
 
+// bump when the assets it makes change, so that the import caches of older versions are not used
+constexpr uint32_t IMPORTER_VERSION = 1;
+
 bool OutputSpvBin(const SpirvBlob& spirv, std::ostream& out) {
   for (int i = 0; i < (int)spirv.size(); ++i) {
     unsigned int word = spirv[i];
@@ -86,7 +93,8 @@ EShLanguage toShadingStage(const std::string& ext) {
 }
 
 bool generateAsset(const std::vector<Path>& inputPaths,
-                   const Path& outputPath) {
+                   const Path& outputPath,
+                   Enjam::AssetsFilesystemRep& repository) {
   using namespace Enjam;
 
   struct Source {
@@ -199,15 +207,17 @@ bool generateAsset(const std::vector<Path>& inputPaths,
     }
   }
 
-  AssetsFilesystemRep repository;
   repository.save(outputPath, asset);
 
-  return false;
+  return true;
 }
 
 int main(int argc, char* argv[]) {
   std::filesystem::path output;
+  std::filesystem::path cachePath;
   std::vector<Path> inputs;
+  std::vector<Enjam::ImportJob> jobs; // of the manifests, a program per line
+  uint32_t threadsCount = 0; // one per hardware thread
 
   std::vector<std::string_view> args {argv + 1, argv + argc};
 
@@ -223,6 +233,16 @@ int main(int argc, char* argv[]) {
       if(arg == "-o") {
         it++;
         output = *it;
+      } else if(arg == "-manifest") {
+        it++;
+        auto manifestJobs = Enjam::readImportManifest(*it);
+        jobs.insert(jobs.end(), manifestJobs.begin(), manifestJobs.end());
+      } else if(arg == "-j") {
+        it++;
+        threadsCount = std::stoul(std::string(*it));
+      } else if(arg == "-cache") {
+        it++;
+        cachePath = *it;
       } else {
         throw std::runtime_error("Unknown option: " + std::string(*it));
       }
@@ -234,14 +254,36 @@ int main(int argc, char* argv[]) {
     it++;
   }
 
-  if(inputs.empty()) {
+  // the inputs of the command line are the stages of one program
+  if(!inputs.empty()) {
+    jobs.push_back({ .inputs = std::move(inputs), .output = output });
+  } else if(!output.empty()) {
+    throw std::runtime_error("-o needs input file paths, the outputs of a batch are set in its manifest");
+  }
+
+  if(jobs.empty()) {
     throw std::runtime_error("Input file paths are not provided");
   }
+  for(auto& job : jobs) {
+    job.output = Enjam::getImportOutput(job, ".nj_sl");
+  }
 
-  if(output.empty()) {
-    output = inputs.back();
-    output.replace_extension("nj_sl");
+  // included files are not hashed, edits of them alone don't invalidate the cache
+  std::optional<Enjam::ImportCache> cache;
+  if(!cachePath.empty()) {
+    cache.emplace(cachePath, fmt::format("shader_importer {}", IMPORTER_VERSION));
   }
 
-  generateAsset(inputs, output);
-}
\ No newline at end of file
+  // glslang is set up once for all the threads, every program compiles with shaders of its own
+  glslang::InitializeProcess();
+  bool succeeded;
+  {
+    Enjam::ThreadPool threadPool(threadsCount > 0 ? threadsCount - 1 : Enjam::ThreadPool::getDefaultWorkersCount());
+    succeeded = Enjam::runImportJobs(threadPool, jobs, cache ? &*cache : nullptr,
+                                     [](const Enjam::ImportJob& job, Enjam::AssetsFilesystemRep& repository) {
+      return generateAsset(job.inputs, job.output, repository);
+    });
+  }
+  glslang::FinalizeProcess();
+  return succeeded ? 0 : 1;
+}
@@ -1,8 +1,16 @@
 #include <enjam/assets_repository.h>
+#include <enjam/import_batch.h>
+#include <enjam/import_cache.h>
+#include <enjam/thread_pool.h>
 #include <stb_image/stb_image.h>
+#include <optional>
 #include <unordered_set>
 
-bool generateAsset(const std::filesystem::path& inputPath, const std::filesystem::path& outputPath) {
+// bump when the assets it makes change, so that the import caches of older versions are not used
+constexpr uint32_t IMPORTER_VERSION = 1;
+
+bool generateAsset(const std::filesystem::path& inputPath, const std::filesystem::path& outputPath,
+                   Enjam::AssetsFilesystemRep& repository) {
   using namespace Enjam;
 
   const std::unordered_set<std::string> supportedExtensions {
@@ -17,12 +25,13 @@ bool generateAsset(const std::filesystem::path& inputPath, const std::filesystem
 
   int width, height, channels;
   auto data = stbi_load(inputPath.c_str(), &width, &height, &channels, 0);
+  if(!data) {
+    ENJAM_ERROR("Couldn't load {}: {}", inputPath.string(), stbi_failure_reason());
+    return false;
+  }
   auto size = width * height * channels;
 
 
-  AssetsFilesystemRep repository;
-//  auto texDataHash = repository.saveBuffer(outputPath, reinterpret_cast<char*>(data), size);
-
   Asset asset;
   asset["source"] = inputPath;
   asset["width"] = width;
@@ -40,7 +49,9 @@ bool generateAsset(const std::filesystem::path& inputPath, const std::filesystem
 
 int main(int argc, char* argv[]) {
   std::filesystem::path output;
-  std::filesystem::path input;
+  std::filesystem::path cachePath;
+  std::vector<Enjam::ImportJob> jobs;
+  uint32_t threadsCount = 0; // one per hardware thread
 
   std::vector<std::string_view> args {argv + 1, argv + argc};
 
@@ -56,6 +67,16 @@ int main(int argc, char* argv[]) {
       if(arg == "-o") {
         it++;
         output = *it;
+      } else if(arg == "-manifest") {
+        it++;
+        auto manifestJobs = Enjam::readImportManifest(*it);
+        jobs.insert(jobs.end(), manifestJobs.begin(), manifestJobs.end());
+      } else if(arg == "-j") {
+        it++;
+        threadsCount = std::stoul(std::string(*it));
+      } else if(arg == "-cache") {
+        it++;
+        cachePath = *it;
       } else {
         throw std::runtime_error("Unknown option: " + std::string(*it));
       }
@@ -63,18 +84,33 @@ int main(int argc, char* argv[]) {
       continue;
     }
 
-    input = arg;
+    jobs.push_back({ .inputs = { arg }, .output = { } });
     it++;
   }
 
-  if(input.empty()) {
+  if(jobs.empty()) {
     throw std::runtime_error("Input file path is not provided");
   }
 
-  if(output.empty()) {
-    output = input;
-    output.replace_extension("nj_tex");
+  if(!output.empty()) {
+    if(jobs.size() > 1) {
+      throw std::runtime_error("-o needs a single input, the outputs of a batch are set in its manifest");
+    }
+    jobs.front().output = output;
+  }
+  for(auto& job : jobs) {
+    job.output = Enjam::getImportOutput(job, ".nj_tex");
+  }
+
+  std::optional<Enjam::ImportCache> cache;
+  if(!cachePath.empty()) {
+    cache.emplace(cachePath, fmt::format("tex_importer {}", IMPORTER_VERSION));
   }
 
-  generateAsset(input, output);
-}
\ No newline at end of file
+  Enjam::ThreadPool threadPool(threadsCount > 0 ? threadsCount - 1 : Enjam::ThreadPool::getDefaultWorkersCount());
+  auto succeeded = Enjam::runImportJobs(threadPool, jobs, cache ? &*cache : nullptr,
+                                        [](const Enjam::ImportJob& job, Enjam::AssetsFilesystemRep& repository) {
+    return generateAsset(job.inputs.front(), job.output, repository);
+  });
+  return succeeded ? 0 : 1;
+}